@@ -11,6 +11,7 @@
 #include "errors.h"
 #include "global.h"
 #include "init.h"
+#include "lights.h"
 #include "map.h"
 #include "particles.h"
 #include "platform.h"
@@ -115,6 +116,11 @@ void draw_3d_object_detail(object3d * object_id, Uint32 material_index, Uint32 u
 
 	CHECK_GL_ERRORS();
 
+	if (use_lightning)
+	{
+		select_local_lights(object_id->x_pos, object_id->y_pos, object_id->z_pos);
+	}
+
 	glPushMatrix();//we don't want to affect the rest of the scene
 
 	glMultMatrixf(object_id->matrix);
@@ -249,11 +255,192 @@ void draw_3d_object_detail(object3d * object_id, Uint32 material_index, Uint32 u
 #endif
 }
 
-void draw_3d_objects(unsigned int object_type)
+// The visible objects of the passes drawn together are queued and sorted
+// by the GL state they need, their texture and their e3d, so each texture
+// is bound and each vertex array is set up as few times as possible.
+#define OBJECT_STATE_SELF_LIT		1
+#define OBJECT_STATE_ALPHA		2
+#define OBJECT_STATE_GROUND_ALPHA	4
+#define OBJECT_STATE_NONE		0xFFFFFFFF
+
+typedef struct
+{
+	Uint64 key;		// state, texture and e3d, from the highest bits
+	object3d *object;
+	Uint32 material;
+} object_queue_entry;
+
+static object_queue_entry *object_queue = NULL;
+static object_queue_entry *object_queue_tmp = NULL;
+static Uint32 object_queue_size = 0;
+static Uint32 object_queue_count = 0;
+
+#ifdef RENDER_BENCHMARK
+typedef struct
+{
+	Uint32 objects;
+	Uint32 texture_changes;
+	Uint32 e3d_changes;
+	Uint32 unsorted_texture_changes;
+	Uint32 unsorted_e3d_changes;
+} object_render_stats;
+
+static object_render_stats cur_object_stats, last_object_stats;
+#endif // RENDER_BENCHMARK
+
+static __inline__ Uint32 get_queue_entry_state(const object_queue_entry *entry)
+{
+	return entry->key >> 56;
+}
+
+static __inline__ Uint32 get_queue_entry_texture(const object_queue_entry *entry)
+{
+	return (entry->key >> 32) & 0xFFFFFF;
+}
+
+static void queue_3d_object(object3d *object, Uint32 material, Uint32 state)
+{
+	object_queue_entry *entry;
+	Uint32 texture;
+
+	if (object_queue_count >= object_queue_size)
+	{
+		object_queue_size = object_queue_size ? object_queue_size * 2 : 256;
+		object_queue = realloc(object_queue, object_queue_size * sizeof(object_queue_entry));
+		object_queue_tmp = realloc(object_queue_tmp, object_queue_size * sizeof(object_queue_entry));
+	}
+
+	if (object->e3d_data->materials)
+		texture = object->e3d_data->materials[material].texture;
+	else
+		texture = 0;
+
+	// equal e3d bits only save a vertex array setup, the draw checks the pointer
+	entry = &object_queue[object_queue_count++];
+	entry->key = ((Uint64)state << 56) | ((Uint64)(texture & 0xFFFFFF) << 32) |
+		(Uint32)((size_t)object->e3d_data >> 4);
+	entry->object = object;
+	entry->material = material;
+
+#ifdef RENDER_BENCHMARK
+	if ((object_queue_count == 1) || (get_queue_entry_texture(entry - 1) != texture))
+		cur_object_stats.unsorted_texture_changes++;
+	if ((object_queue_count == 1) || ((entry - 1)->object->e3d_data != object->e3d_data))
+		cur_object_stats.unsorted_e3d_changes++;
+#endif // RENDER_BENCHMARK
+}
+
+// LSD radix sort, one byte at a time. It's stable, so objects with the same
+// key stay in the order of the intersection list.
+static void sort_object_queue(void)
+{
+	Uint32 count[256];
+	Uint32 i, shift, sum, tmp;
+	object_queue_entry *swap;
+
+	for (shift = 0; shift < 64; shift += 8)
+	{
+		memset(count, 0, sizeof(count));
+		for (i = 0; i < object_queue_count; i++)
+		{
+			count[(object_queue[i].key >> shift) & 0xFF]++;
+		}
+		// nothing to do if all keys have the same byte here
+		if (count[(object_queue[0].key >> shift) & 0xFF] == object_queue_count)
+		{
+			continue;
+		}
+		sum = 0;
+		for (i = 0; i < 256; i++)
+		{
+			tmp = count[i];
+			count[i] = sum;
+			sum += tmp;
+		}
+		for (i = 0; i < object_queue_count; i++)
+		{
+			object_queue_tmp[count[(object_queue[i].key >> shift) & 0xFF]++] = object_queue[i];
+		}
+		swap = object_queue;
+		object_queue = object_queue_tmp;
+		object_queue_tmp = swap;
+	}
+}
+
+static void set_3d_object_state(Uint32 state)
+{
+	if ((state & OBJECT_STATE_SELF_LIT) && (!is_day || dungeon))
+	{
+		glDisable(GL_LIGHTING);
+	}
+
+	if (state & OBJECT_STATE_ALPHA)
+	{
+#ifdef	NEW_ALPHA
+		if(use_3d_alpha_blend){
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA);
+		}
+#endif	//NEW_ALPHA
+		//enable alpha filtering, so we have some alpha key
+		glEnable(GL_ALPHA_TEST);
+		if(state & OBJECT_STATE_GROUND_ALPHA)glAlphaFunc(GL_GREATER,0.23f);
+#ifdef OLD_MISC_OBJ_DIR
+		else glAlphaFunc(GL_GREATER,0.06f);
+#else
+		else glAlphaFunc(GL_GREATER,0.3f);
+#endif
+		glDisable(GL_CULL_FACE);
+	}
+}
+
+static void reset_3d_object_state(Uint32 state)
+{
+	if ((state & OBJECT_STATE_SELF_LIT) && (!is_day || dungeon))
+	{
+		glEnable(GL_LIGHTING);
+		glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+	}
+	if (state & OBJECT_STATE_ALPHA)
+	{
+		glEnable(GL_CULL_FACE);
+#ifdef	NEW_ALPHA
+		if(use_3d_alpha_blend){
+			glDisable(GL_BLEND);
+		}
+#endif	//NEW_ALPHA
+		glDisable(GL_ALPHA_TEST);
+	}
+}
+
+#ifdef	NEW_TEXTURES
+// larger and closer objects get their textures streamed first
+static void set_3d_object_texture_priority(object3d *object_id, Uint32 material, Uint32 index)
+{
+	AABBOX bbox;
+	VECTOR3 size, dist;
+	float size2, dist2;
+
+	bbox = get_intersect_item_bbox(main_bbox_tree, index);
+
+	VSub(size, bbox.bbmax, bbox.bbmin);
+	dist[X] = (bbox.bbmin[X] + bbox.bbmax[X]) * 0.5f + camera_x;
+	dist[Y] = (bbox.bbmin[Y] + bbox.bbmax[Y]) * 0.5f + camera_y;
+	dist[Z] = (bbox.bbmin[Z] + bbox.bbmax[Z]) * 0.5f + camera_z;
+
+	size2 = VDot(size, size);
+	dist2 = max2f(VDot(dist, dist), 1.0f);
+
+	set_texture_priority(object_id->e3d_data->materials[material].texture, size2 / dist2);
+}
+#endif	/* NEW_TEXTURES */
+
+static void queue_3d_objects(unsigned int object_type)
 {
 	unsigned int    start, stop;
 	unsigned int    i, l;
-	int is_selflit, is_transparent, is_ground;
+	int is_transparent;
+	Uint32 state;
 #ifdef  SIMPLE_LOD
 	int x, y, dist;
 #endif
@@ -266,11 +453,6 @@ void draw_3d_objects(unsigned int object_type)
 	y= -camera_y;
 #endif
 
- 	cur_e3d= NULL;
-#ifdef  DEBUG
-	cur_e3d_count= 0;
-#endif  //DEBUG
-
 	get_intersect_start_stop(main_bbox_tree, object_type, &start, &stop);
 	// nothing to draw?
 	if(start >= stop){
@@ -296,38 +478,75 @@ void draw_3d_objects(unsigned int object_type)
 	}
 
 	// find the modes we need
-	is_selflit= is_self_lit_3d_object(object_type);
 	is_transparent= is_alpha_3d_object(object_type);
-	is_ground= is_ground_3d_object(object_type);
-	// set the modes we need
-	if (is_selflit && (!is_day || dungeon))
+	state = 0;
+	if (is_self_lit_3d_object(object_type))
+		state |= OBJECT_STATE_SELF_LIT;
+	if (is_transparent)
 	{
-		glDisable(GL_LIGHTING);
+		state |= OBJECT_STATE_ALPHA;
+		if (is_ground_3d_object(object_type))
+			state |= OBJECT_STATE_GROUND_ALPHA;
+	}
+
+	// now loop through each object
+	for (i=start; i<stop; i++)
+	{
+		int	j;
+
+		j = get_intersect_item_ID(main_bbox_tree, i);
+		l = get_3dobject_index(j);
+		if (objects_list[l] == NULL) continue;
+		//track the usage
+		cache_use(objects_list[l]->e3d_data->cache_ptr);
+		if(!objects_list[l]->display) continue;	// not currently on the map, ignore it
+#ifdef CLUSTER_INSIDES_OLD
+		if (objects_list[l]->cluster && objects_list[l]->cluster != cluster)
+			// Object is in another cluster as actor, don't show it
+			continue;
+#endif // CLUSTER_INSIDES_OLD
+#ifdef  SIMPLE_LOD
+		// simple size/distance culling
+		dist= (x-objects_list[l]->x_pos)*(x-objects_list[l]->x_pos) + (y-objects_list[l]->y_pos)*(y-objects_list[l]->y_pos);
+		if(objects_list[l]->e3d_data->materials && (10000*objects_list[l]->e3d_data->materials[get_3dobject_material(j)].max_size)/(dist) < ((is_transparent)?15:10)) continue;
+#endif  //SIMPLE_LOD
+
+#ifdef	NEW_TEXTURES
+		if (get_cur_intersect_type(main_bbox_tree) == INTERSECTION_TYPE_DEFAULT)
+		{
+			set_3d_object_texture_priority(objects_list[l], get_3dobject_material(j), i);
+		}
+#endif	/* NEW_TEXTURES */
+
+		queue_3d_object(objects_list[l], get_3dobject_material(j), state);
+	}
+}
+
+static void flush_3d_objects(void)
+{
+	Uint32 i, state, last_state;
+#ifdef RENDER_BENCHMARK
+	Uint32 last_texture = 0;
+#endif // RENDER_BENCHMARK
+
+	if (object_queue_count == 0)
+	{
+		return;
 	}
 
+	sort_object_queue();
+
+ 	cur_e3d= NULL;
+#ifdef  DEBUG
+	cur_e3d_count= 0;
+#endif  //DEBUG
+
 #ifdef	FSAA
 	if (fsaa > 1)
 	{
 		glEnable(GL_MULTISAMPLE);
 	}
 #endif	/* FSAA */
-	if(is_transparent) {
-#ifdef	NEW_ALPHA
-		if(use_3d_alpha_blend){
-			glEnable(GL_BLEND);
-			glBlendFunc(GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA);
-		}
-#endif	//NEW_ALPHA
-		//enable alpha filtering, so we have some alpha key
-		glEnable(GL_ALPHA_TEST);
-		if(is_ground)glAlphaFunc(GL_GREATER,0.23f);
-#ifdef OLD_MISC_OBJ_DIR
-		else glAlphaFunc(GL_GREATER,0.06f);
-#else
-		else glAlphaFunc(GL_GREATER,0.3f);
-#endif
-		glDisable(GL_CULL_FACE);
-	}
 
 /*
 	// NOTICE: The below code is an ASSUMPTION that appropriate client
@@ -342,29 +561,31 @@ void draw_3d_objects(unsigned int object_type)
 		glTexGeni(GL_T, GL_TEXTURE_GEN_MODE, GL_EYE_LINEAR);
 		ELglActiveTextureARB(base_unit);
 	}
-	// now loop through each object
-	for (i=start; i<stop; i++)
+
+	last_state = OBJECT_STATE_NONE;
+	for (i = 0; i < object_queue_count; i++)
 	{
-		int	j;
+		state = get_queue_entry_state(&object_queue[i]);
+		if (state != last_state)
+		{
+			if (last_state != OBJECT_STATE_NONE)
+			{
+				reset_3d_object_state(last_state);
+			}
+			set_3d_object_state(state);
+			last_state = state;
+		}
 
-		j = get_intersect_item_ID(main_bbox_tree, i);
-		l = get_3dobject_index(j);
-		if (objects_list[l] == NULL) continue;
-		//track the usage
-		cache_use(objects_list[l]->e3d_data->cache_ptr);
-		if(!objects_list[l]->display) continue;	// not currently on the map, ignore it
-#ifdef CLUSTER_INSIDES_OLD
-		if (objects_list[l]->cluster && objects_list[l]->cluster != cluster)
-			// Object is in another cluster as actor, don't show it
-			continue;
-#endif // CLUSTER_INSIDES_OLD
-#ifdef  SIMPLE_LOD
-		// simple size/distance culling
-		dist= (x-objects_list[l]->x_pos)*(x-objects_list[l]->x_pos) + (y-objects_list[l]->y_pos)*(y-objects_list[l]->y_pos);
-		if(objects_list[l]->e3d_data->materials && (10000*objects_list[l]->e3d_data->materials[get_3dobject_material(j)].max_size)/(dist) < ((is_transparent)?15:10)) continue;
-#endif  //SIMPLE_LOD
+#ifdef RENDER_BENCHMARK
+		cur_object_stats.objects++;
+		if ((i == 0) || (get_queue_entry_texture(&object_queue[i]) != last_texture))
+			cur_object_stats.texture_changes++;
+		if (object_queue[i].object->e3d_data != cur_e3d)
+			cur_object_stats.e3d_changes++;
+		last_texture = get_queue_entry_texture(&object_queue[i]);
+#endif // RENDER_BENCHMARK
 
-		draw_3d_object_detail(objects_list[l], get_3dobject_material(j), 1, 1, 1);
+		draw_3d_object_detail(object_queue[i].object, object_queue[i].material, 1, 1, 1);
 
 #ifdef MAP_EDITOR2
 		if ((selected_3d_object == -1) && read_mouse_now && (get_cur_intersect_type(main_bbox_tree) == INTERSECTION_TYPE_DEFAULT))
@@ -372,10 +593,13 @@ void draw_3d_objects(unsigned int object_type)
 		if (read_mouse_now && (get_cur_intersect_type(main_bbox_tree) == INTERSECTION_TYPE_DEFAULT))
 #endif
 		{
-			anything_under_the_mouse(objects_list[l]->id, UNDER_MOUSE_3D_OBJ);
+			anything_under_the_mouse(object_queue[i].object->id, UNDER_MOUSE_3D_OBJ);
 		}
 	}
-	
+	object_queue_count = 0;
+
+	restore_scene_lights();
+
 	if (!dungeon && (clouds_shadows || use_shadow_mapping))
 	{
 		ELglActiveTextureARB(detail_unit);
@@ -387,20 +611,7 @@ void draw_3d_objects(unsigned int object_type)
 	disable_buffer_arrays();
 
 	// restore the settings
-	if (is_selflit && (!is_day || dungeon)) 
-	{
-		glEnable(GL_LIGHTING);
-		glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
-	}
-	if(is_transparent) {
-		glEnable(GL_CULL_FACE);
-#ifdef	NEW_ALPHA
-		if(use_3d_alpha_blend){
-			glDisable(GL_BLEND);
-		}
-#endif	//NEW_ALPHA
-		glDisable(GL_ALPHA_TEST);
-	}
+	reset_3d_object_state(last_state);
 #ifdef	FSAA
 	if (fsaa > 1)
 	{
@@ -420,6 +631,28 @@ void draw_3d_objects(unsigned int object_type)
 #endif  //DEBUG
 }
 
+void draw_3d_objects(unsigned int object_type)
+{
+	queue_3d_objects(object_type);
+	flush_3d_objects();
+}
+
+#ifdef RENDER_BENCHMARK
+void next_3d_object_stats_frame(void)
+{
+	last_object_stats = cur_object_stats;
+	memset(&cur_object_stats, 0, sizeof(cur_object_stats));
+}
+
+void get_3d_object_stats(char *buffer, size_t len)
+{
+	safe_snprintf(buffer, len, "3D objects: %u draws in the last frame, %u texture changes and %u vertex array setups (%u and %u in intersection order)",
+		last_object_stats.objects, last_object_stats.texture_changes,
+		last_object_stats.e3d_changes, last_object_stats.unsorted_texture_changes,
+		last_object_stats.unsorted_e3d_changes);
+}
+#endif // RENDER_BENCHMARK
+
 //Tests to see if an e3d object is already loaded. If it is, return the handle.
 //If not, load it, and return the handle
 static e3d_object *load_e3d_cache(const char* file_name)
@@ -693,10 +926,11 @@ void display_objects(void)
 
 	CHECK_GL_ERRORS();
 
-	draw_3d_objects(TYPE_3D_NO_BLEND_NO_GROUND_NO_ALPHA_SELF_LIT_OBJECT);
-	draw_3d_objects(TYPE_3D_NO_BLEND_NO_GROUND_NO_ALPHA_NO_SELF_LIT_OBJECT);
-	draw_3d_objects(TYPE_3D_NO_BLEND_GROUND_NO_ALPHA_SELF_LIT_OBJECT);
-	draw_3d_objects(TYPE_3D_NO_BLEND_GROUND_NO_ALPHA_NO_SELF_LIT_OBJECT);
+	queue_3d_objects(TYPE_3D_NO_BLEND_NO_GROUND_NO_ALPHA_SELF_LIT_OBJECT);
+	queue_3d_objects(TYPE_3D_NO_BLEND_NO_GROUND_NO_ALPHA_NO_SELF_LIT_OBJECT);
+	queue_3d_objects(TYPE_3D_NO_BLEND_GROUND_NO_ALPHA_SELF_LIT_OBJECT);
+	queue_3d_objects(TYPE_3D_NO_BLEND_GROUND_NO_ALPHA_NO_SELF_LIT_OBJECT);
+	flush_3d_objects();
 
 	CHECK_GL_ERRORS();
 	glDisable(GL_CULL_FACE);
@@ -740,8 +974,9 @@ void display_ground_objects(void)
 
 	CHECK_GL_ERRORS();
 
-	draw_3d_objects(TYPE_3D_NO_BLEND_GROUND_ALPHA_SELF_LIT_OBJECT);
-	draw_3d_objects(TYPE_3D_NO_BLEND_GROUND_ALPHA_NO_SELF_LIT_OBJECT);
+	queue_3d_objects(TYPE_3D_NO_BLEND_GROUND_ALPHA_SELF_LIT_OBJECT);
+	queue_3d_objects(TYPE_3D_NO_BLEND_GROUND_ALPHA_NO_SELF_LIT_OBJECT);
+	flush_3d_objects();
 
 	CHECK_GL_ERRORS();
 	glDisable(GL_CULL_FACE);
@@ -784,8 +1019,9 @@ void display_alpha_objects(void)
 
 	CHECK_GL_ERRORS();
 
-	draw_3d_objects(TYPE_3D_NO_BLEND_NO_GROUND_ALPHA_SELF_LIT_OBJECT);
-	draw_3d_objects(TYPE_3D_NO_BLEND_NO_GROUND_ALPHA_NO_SELF_LIT_OBJECT);
+	queue_3d_objects(TYPE_3D_NO_BLEND_NO_GROUND_ALPHA_SELF_LIT_OBJECT);
+	queue_3d_objects(TYPE_3D_NO_BLEND_NO_GROUND_ALPHA_NO_SELF_LIT_OBJECT);
+	flush_3d_objects();
 
 	CHECK_GL_ERRORS();
 	glDisable(GL_COLOR_MATERIAL);
@@ -830,15 +1066,16 @@ void display_blended_objects(void)
 
 	CHECK_GL_ERRORS();
 
-	draw_3d_objects(TYPE_3D_BLEND_GROUND_NO_ALPHA_SELF_LIT_OBJECT);
-	draw_3d_objects(TYPE_3D_BLEND_GROUND_NO_ALPHA_NO_SELF_LIT_OBJECT);
-	draw_3d_objects(TYPE_3D_BLEND_GROUND_ALPHA_SELF_LIT_OBJECT);
-	draw_3d_objects(TYPE_3D_BLEND_GROUND_ALPHA_NO_SELF_LIT_OBJECT);
+	queue_3d_objects(TYPE_3D_BLEND_GROUND_NO_ALPHA_SELF_LIT_OBJECT);
+	queue_3d_objects(TYPE_3D_BLEND_GROUND_NO_ALPHA_NO_SELF_LIT_OBJECT);
+	queue_3d_objects(TYPE_3D_BLEND_GROUND_ALPHA_SELF_LIT_OBJECT);
+	queue_3d_objects(TYPE_3D_BLEND_GROUND_ALPHA_NO_SELF_LIT_OBJECT);
 
-	draw_3d_objects(TYPE_3D_BLEND_NO_GROUND_NO_ALPHA_SELF_LIT_OBJECT);
-	draw_3d_objects(TYPE_3D_BLEND_NO_GROUND_NO_ALPHA_NO_SELF_LIT_OBJECT);
-	draw_3d_objects(TYPE_3D_BLEND_NO_GROUND_ALPHA_SELF_LIT_OBJECT);
-	draw_3d_objects(TYPE_3D_BLEND_NO_GROUND_ALPHA_NO_SELF_LIT_OBJECT);
+	queue_3d_objects(TYPE_3D_BLEND_NO_GROUND_NO_ALPHA_SELF_LIT_OBJECT);
+	queue_3d_objects(TYPE_3D_BLEND_NO_GROUND_NO_ALPHA_NO_SELF_LIT_OBJECT);
+	queue_3d_objects(TYPE_3D_BLEND_NO_GROUND_ALPHA_SELF_LIT_OBJECT);
+	queue_3d_objects(TYPE_3D_BLEND_NO_GROUND_ALPHA_NO_SELF_LIT_OBJECT);
+	flush_3d_objects();
 
 	CHECK_GL_ERRORS();
 	glDisable(GL_CULL_FACE);
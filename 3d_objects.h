@@ -6,6 +6,7 @@
 #ifndef __OBJ_3D_H__
 #define __OBJ_3D_H__
 
+#include <stddef.h>
 #include "e3d_object.h"
 #include "e3d.h"
 
@@ -19,10 +20,31 @@ extern int use_3d_alpha_blend;	// do 3d models use alpha blending?
  * \ingroup	display_3d
  * \brief	Optimized display or a selected 3d object list
  *
+ * 		The visible objects are sorted by texture and e3d before drawing.
+ *
  * \return	nothing.
  */
 void draw_3d_objects(unsigned int object_type);
 
+#ifdef RENDER_BENCHMARK
+/*!
+ * \ingroup	display_3d
+ * \brief	Starts counting the 3d object draws of a new frame
+ */
+void next_3d_object_stats_frame(void);
+
+/*!
+ * \ingroup	display_3d
+ * \brief	Reports the 3d object draws and state changes of the last frame
+ *
+ * 		Also reports the state changes the objects would have needed in the order of the intersection list.
+ *
+ * \param	buffer The buffer for the result line
+ * \param	len The size of the buffer
+ */
+void get_3d_object_stats(char *buffer, size_t len);
+#endif // RENDER_BENCHMARK
+
 /*!
  * \ingroup	load_3d
  * \brief	Adds a 3d object with a specific ID to the map 
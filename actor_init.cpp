@@ -763,6 +763,20 @@ extern "C" void build_buffers(actor_types* a)
 extern "C" void clear_buffers(actor_types* a)
 {
 	delete a->hardware_model;
+	a->hardware_model = 0;
+
+	// actor types can be unloaded while the game runs, so give the
+	// buffers back as well
+	if (a->vertex_buffer != 0)
+	{
+		ELglDeleteBuffersARB(1, &a->vertex_buffer);
+		a->vertex_buffer = 0;
+	}
+	if (a->index_buffer != 0)
+	{
+		ELglDeleteBuffersARB(1, &a->index_buffer);
+		a->index_buffer = 0;
+	}
 }
 
 static inline void set_transformation_buffer(actor_types *a, actor *act, const Uint32 index,
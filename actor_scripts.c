@@ -93,6 +93,48 @@ int parse_actor_sounds(actor_types *act, const xmlNode *cfg);
 hash_table *emote_cmds = NULL;
 hash_table *emotes = NULL;
 int parse_actor_frames(actor_types *act, const xmlNode *cfg, const xmlNode *defaults);
+int parse_actor_defs(const xmlNode *node);
+
+int max_unused_actor_defs = 16;
+int use_animation_lod = 1;
+
+/* Actors further away than this (in world units) are animated at the
+ * reduced rate, and then at most once per ANIM_LOD_REDUCED_INTERVAL ms. */
+#define ANIM_LOD_NEAR_DISTANCE		10.0f
+#define ANIM_LOD_REDUCED_INTERVAL	100
+/* An actor that hasn't been inside the view frustum for this long (ms) is
+ * considered off-screen. */
+#define ANIM_LOD_VIEW_TIMEOUT		250
+
+/*
+ * At startup the actor definitions are only registered: the file each type
+ * is defined in is remembered and the cal3d skeleton, meshes and animations
+ * are loaded from it by load_actor_def() when the first actor of that type
+ * is created. The emote frames of a type are read from the emotes file at
+ * the same time.
+ *
+ * An actor attachment is resolved against the core model of the attached
+ * type, and a holder gets its animations loaded into it, so the attached
+ * type is loaded first and stays loaded as long as the type depending on
+ * it. For a holder the dependency goes both ways: its core model keeps the
+ * animations of the held type until it is unloaded itself.
+ */
+#define ACTOR_DEFS_CHECK_INTERVAL	10000	// ms between checks for unused actor types
+
+static char *actor_def_files[MAX_ACTOR_DEFS];
+static const char *actor_def_cur_file = NULL;	// the file being registered
+static char emote_defs_file[120];
+static Uint8 actor_def_emote_frames[MAX_ACTOR_DEFS];	// the emotes file has frames for the type
+static Uint8 actor_def_loaded[MAX_ACTOR_DEFS];
+static Uint32 actor_def_last_used[MAX_ACTOR_DEFS];
+static Uint8 actor_def_depends[MAX_ACTOR_DEFS][MAX_ACTOR_DEFS];	// [type][type it needs loaded]
+
+// the types the emote frames without an actor type are for
+static const int emote_frames_races[] = {
+	human_female, human_male, elf_female, elf_male, dwarf_female, dwarf_male,
+	orchan_female, orchan_male, gnome_female, gnome_male, draegoni_female,
+	draegoni_male
+};
 
 
 #ifdef MORE_ATTACHED_ACTORS_DEBUG
@@ -298,22 +340,51 @@ static Uint32 update_actor_animation_speed(actor* a, const float time_diff)
 }
 #endif	/* ANIMATION_SCALING */
 
+static int get_animation_lod(const actor *act, const actor *me)
+{
+	float dx, dy;
+
+	if (!use_animation_lod || me == NULL || act == me)
+		return ANIM_LOD_FULL;
+	// the bones are rotated on top of the animation while aiming, and
+	// actors on a horse read each other's bones every frame
+	if (act->cal_rotation_blend >= 0.0f || act->attached_actor >= 0)
+		return ANIM_LOD_FULL;
+	if (cur_time - act->last_in_view > ANIM_LOD_VIEW_TIMEOUT)
+		return ANIM_LOD_HIDDEN;
+
+	dx = act->x_pos - me->x_pos;
+	dy = act->y_pos - me->y_pos;
+	if (dx * dx + dy * dy > ANIM_LOD_NEAR_DISTANCE * ANIM_LOD_NEAR_DISTANCE)
+		return ANIM_LOD_REDUCED;
+	return ANIM_LOD_FULL;
+}
+
 void animate_actors()
 {
 #ifdef	ANIMATION_SCALING
 	static int last_update = 0;
 	int i, actors_time_diff, time_diff, tmp_time_diff;
-
-	actors_time_diff = cur_time - last_update;
 #else	/* ANIMATION_SCALING */
 	int i;
 	static int last_update= 0;
     int time_diff = cur_time-last_update;
     int tmp_time_diff;
 #endif	/* ANIMATION_SCALING */
+#ifndef	DYNAMIC_ANIMATIONS
+	float anim_diff;
+	actor *me;
+#endif	//DYNAMIC_ANIMATIONS
+
+#ifdef	ANIMATION_SCALING
+	actors_time_diff = cur_time - last_update;
+#endif	/* ANIMATION_SCALING */
 
 	// lock the actors_list so that nothing can interere with this look
 	LOCK_ACTORS_LISTS();	//lock it to avoid timing issues
+#ifndef	DYNAMIC_ANIMATIONS
+	me = get_our_actor();
+#endif	//DYNAMIC_ANIMATIONS
 	for(i=0; i<max_actors; i++) {
 		if(actors_list[i]) {
 #ifdef	ANIMATION_SCALING
@@ -439,10 +510,25 @@ void animate_actors()
 				}
 #endif
 #ifdef	ANIMATION_SCALING
-				CalModel_Update(actors_list[i]->calmodel, (time_diff * actors_list[i]->cur_anim.duration_scale) / 1000.0f);
+				anim_diff = (time_diff * actors_list[i]->cur_anim.duration_scale) / 1000.0f;
 #else	/* ANIMATION_SCALING */
-				CalModel_Update(actors_list[i]->calmodel, (((cur_time-last_update)*actors_list[i]->cur_anim.duration_scale)/1000.0));
+				anim_diff = ((cur_time-last_update)*actors_list[i]->cur_anim.duration_scale)/1000.0;
 #endif	/* ANIMATION_SCALING */
+				actors_list[i]->anim_lod = get_animation_lod(actors_list[i], me);
+				if (actors_list[i]->anim_lod == ANIM_LOD_HIDDEN ||
+					(actors_list[i]->anim_lod == ANIM_LOD_REDUCED &&
+					 cur_time - actors_list[i]->last_skeleton_update < ANIM_LOD_REDUCED_INTERVAL))
+				{
+					// only advance the animation time, the skeleton is
+					// evaluated when it is drawn or its bones are needed
+					CalMixer_UpdateAnimation(CalModel_GetMixer(actors_list[i]->calmodel), anim_diff);
+					actors_list[i]->skeleton_outdated = 1;
+					continue;
+				}
+
+				CalModel_Update(actors_list[i]->calmodel, anim_diff);
+				actors_list[i]->skeleton_outdated = 0;
+				actors_list[i]->last_skeleton_update = cur_time;
 				build_actor_bounding_box(actors_list[i]);
 				{
 				int wasbusy = ACTOR(i)->busy;
@@ -2338,6 +2424,7 @@ void get_actor_damage(int actor_id, int damage)
 			if (strcmp(act->actor_name, "Gargoyle") && strcmp(act->actor_name, "Skeleton") && strcmp(act->actor_name, "Phantom Warrior"))	//Ideally, we'd also check to see if it was a player or not, but since this is just cosmetic...
 			{
 				blood_level=(int)powf(damage / powf(act->max_health, 0.5), 0.75) + 0.5;
+				cal_update_actor_skeleton(act, 1);
 				total_bones = CalSkeleton_GetBonePoints(CalModel_GetSkeleton(act->calmodel), &bone_list[0][0]);
 				bone = rand() % total_bones;
 				bone_x = bone_list[bone][0] + act->x_pos + 0.25;
@@ -2737,6 +2824,76 @@ int parse_emote_def(emote_data *emote, const xmlNode *node)
 }
 
 
+// Emote frames are loaded into the core model of the actor type, so they
+// have to wait until the type itself is loaded.
+static int add_actor_def_frames(int actor_type, const xmlNode *frames)
+{
+	if (actor_type < 0 || actor_type >= MAX_ACTOR_DEFS)
+	{
+		LOG_ERROR("Emote frames for unknown actor type %d", actor_type);
+		return 0;
+	}
+
+	actor_def_emote_frames[actor_type] = 1;
+	if (actor_def_loaded[actor_type])
+		return parse_actor_frames(&actors_defs[actor_type], frames, NULL);
+
+	return 1;
+}
+
+static int is_emote_frames_type(int frames_type, int actor_type)
+{
+	int i;
+
+	if (frames_type >= 0)
+		return frames_type == actor_type;
+	for (i = 0; i < sizeof(emote_frames_races) / sizeof(emote_frames_races[0]); i++)
+	{
+		if (emote_frames_races[i] == actor_type)
+			return 1;
+	}
+	return 0;
+}
+
+// Parses only the frames of one actor type, for loading the type after
+// the emotes themselves were read
+static int parse_actor_def_emote_frames(const xmlNode *node, int actor_type)
+{
+	const xmlNode *def;
+	int ok = 1;
+
+	for (def = node->children; def; def = def->next) {
+		if (def->type == XML_ELEMENT_NODE) {
+			if (xmlStrcasecmp(def->name, (xmlChar*)"frames") == 0
+				&& is_emote_frames_type(get_int_property(def, "actor_type"), actor_type))
+				ok &= parse_actor_frames(&actors_defs[actor_type], def->children, NULL);
+		} else if (def->type == XML_ENTITY_REF_NODE) {
+			ok &= parse_actor_def_emote_frames(def->children, actor_type);
+		}
+	}
+
+	return ok;
+}
+
+static int load_actor_def_emote_frames(int actor_type)
+{
+	const xmlNode *root;
+	xmlDoc *doc;
+	int ok;
+
+	doc = xmlReadFile(emote_defs_file, NULL, 0);
+	if (doc == NULL) {
+		LOG_ERROR("Unable to read emotes definition file %s", emote_defs_file);
+		return 0;
+	}
+
+	root = xmlDocGetRootElement(doc);
+	ok = root != NULL && parse_actor_def_emote_frames(root, actor_type);
+
+	xmlFreeDoc(doc);
+	return ok;
+}
+
 int parse_emotes_defs(const xmlNode *node)
 {
 	const xmlNode *def;
@@ -2757,19 +2914,10 @@ int parse_emotes_defs(const xmlNode *node)
 			} else if (xmlStrcasecmp(def->name, (xmlChar*)"frames") == 0) {
 				int act_type = get_int_property(def, "actor_type");
 				if (act_type < 0) {
-					ok&=parse_actor_frames(&actors_defs[human_female], def->children, NULL);
-					ok&=parse_actor_frames(&actors_defs[human_male], def->children, NULL);
-					ok&=parse_actor_frames(&actors_defs[elf_female], def->children, NULL);
-					ok&=parse_actor_frames(&actors_defs[elf_male], def->children, NULL);
-					ok&=parse_actor_frames(&actors_defs[dwarf_female], def->children, NULL);
-					ok&=parse_actor_frames(&actors_defs[dwarf_male], def->children, NULL);
-					ok&=parse_actor_frames(&actors_defs[orchan_female], def->children, NULL);
-					ok&=parse_actor_frames(&actors_defs[orchan_male], def->children, NULL);
-					ok&=parse_actor_frames(&actors_defs[gnome_female], def->children, NULL);
-					ok&=parse_actor_frames(&actors_defs[gnome_male], def->children, NULL);
-					ok&=parse_actor_frames(&actors_defs[draegoni_female], def->children, NULL);
-					ok&=parse_actor_frames(&actors_defs[draegoni_male], def->children, NULL);
-				} else ok &= parse_actor_frames(&actors_defs[act_type], def->children, NULL);
+					int i;
+					for (i = 0; i < sizeof(emote_frames_races) / sizeof(emote_frames_races[0]); i++)
+						ok&=add_actor_def_frames(emote_frames_races[i], def->children);
+				} else ok &= add_actor_def_frames(act_type, def->children);
 			} else{
 				LOG_ERROR("parse error: emote or include expected");
 				ok = 0;
@@ -2805,6 +2953,8 @@ int read_emotes_defs(const char *dir, const char *index)
 		LOG_ERROR("Unknown key \"%s\" (\"emotes\" expected).", root->name);
 		ok = 0;
 	} else {
+		// the frames of actor types that aren't loaded yet are read again from it
+		safe_strncpy(emote_defs_file, fname, sizeof(emote_defs_file));
 		ok = parse_emotes_defs(root);
 	}
 
@@ -2818,7 +2968,11 @@ void free_emotes()
 {
 	int i;
 	for(i=0;i<MAX_ACTOR_DEFS;i++)
+	{
 		destroy_hash_table(actors_defs[i].emote_frames);
+		actors_defs[i].emote_frames = NULL;
+		actor_def_emote_frames[i] = 0;
+	}
 	destroy_hash_table(emote_cmds);
 	destroy_hash_table(emotes);
 }
@@ -3981,6 +4135,13 @@ int parse_actor_attachment (actor_types *act, const xmlNode *cfg, int actor_type
 
 	if (cfg == NULL || cfg->children == NULL) return 0;
 
+	// the bones and the held animations live in the attached type
+	if (!load_actor_def(actor_type) || actors_defs[actor_type].coremodel == NULL) {
+		LOG_ERROR("the attached actor type %d of actor type %d can't be loaded", actor_type, act->actor_type);
+		return 0;
+	}
+	actor_def_depends[act->actor_type][actor_type] = 1;
+
 	for (item = cfg->children; item; item = item->next) {
 		if (item->type == XML_ELEMENT_NODE) {
 			if (xmlStrcasecmp (item->name, (xmlChar*)"holder") == 0) {
@@ -4087,6 +4248,10 @@ int parse_actor_attachment (actor_types *act, const xmlNode *cfg, int actor_type
 		}
 	}
 
+	// the holder can't be loaded again while the held animations are set
+	if (att->actor_type[actor_type].is_holder)
+		actor_def_depends[actor_type][act->actor_type] = 1;
+
 	return ok;
 }
 
@@ -4392,12 +4557,12 @@ int parse_actor_nodes(actor_types *act, const xmlNode *cfg, const xmlNode *defau
 	return ok;
 }
 
-int parse_actor_script(const xmlNode *cfg)
+// Only remembers where the definition is, the actor type is loaded by
+// load_actor_def() when it is needed
+static int register_actor_script(const xmlNode *cfg)
 {
-	int ok, act_idx, i;
-	int j;
+	int act_idx;
 	actor_types *act;
-	struct CalCoreSkeleton *skel;
 
 	if(cfg == NULL || cfg->children == NULL) return 0;
 
@@ -4430,11 +4595,24 @@ int parse_actor_script(const xmlNode *cfg)
 		);
 		LOG_ERROR(str);
 	}
-	ok= 1;
 	act->actor_type= act_idx;	// memorize the ID & name to help in debugging
 	safe_strncpy(act->actor_name, get_string_property(cfg, "type"), sizeof(act->actor_name));
 	actor_check_string(act, "actor", "name", act->actor_name);
+	if (actor_def_files[act_idx])
+		free(actor_def_files[act_idx]);
+	actor_def_files[act_idx]= strdup(actor_def_cur_file);
+
+	return 1;
+}
+
+static int parse_actor_script(int act_idx, const xmlNode *cfg)
+{
+	int ok, i;
+	int j;
+	actor_types *act;
+	struct CalCoreSkeleton *skel;
 
+	act= &(actors_defs[act_idx]);
 	//Initialize Cal3D settings
 	act->coremodel= NULL;
 	act->actor_scale= 1.0;
@@ -4496,6 +4674,47 @@ int parse_actor_script(const xmlNode *cfg)
 	return ok;
 }
 
+// Registers the actors of an included file, which is read again when one
+// of them is loaded
+static int register_actor_defs_file (const xmlNode *ref)
+{
+	const xmlNode *root;
+	const char *parent_file = actor_def_cur_file;
+	xmlEntity *entity;
+	xmlDoc *doc;
+	int ok = 1;
+
+	entity = xmlGetDocEntity (ref->doc, ref->name);
+	if (entity == NULL || entity->URI == NULL)
+	{
+		LOG_ERROR("Unknown actor definition include \"%s\"", ref->name);
+		return 0;
+	}
+
+	doc = xmlReadFile ((char*)entity->URI, NULL, 0);
+	if (doc == NULL)
+	{
+		LOG_ERROR("Unable to read actor definition file %s", entity->URI);
+		return 0;
+	}
+
+	actor_def_cur_file = (char*)entity->URI;
+	root = xmlDocGetRootElement (doc);
+	if (root == NULL)
+	{
+		LOG_ERROR("Unable to parse actor definition file %s", entity->URI);
+		ok = 0;
+	}
+	else if (xmlStrcasecmp (root->name, (xmlChar*)"actor") == 0)
+		ok = register_actor_script (root);
+	else
+		ok = parse_actor_defs (root);
+	actor_def_cur_file = parent_file;
+
+	xmlFreeDoc (doc);
+	return ok;
+}
+
 int parse_actor_defs(const xmlNode *node)
 {
 	const xmlNode *def;
@@ -4507,7 +4726,7 @@ int parse_actor_defs(const xmlNode *node)
 		{
 			if (xmlStrcasecmp (def->name, (xmlChar*)"actor") == 0)
 			{
-				ok &= parse_actor_script (def);
+				ok &= register_actor_script (def);
 			}
 			else
 			{
@@ -4517,7 +4736,7 @@ int parse_actor_defs(const xmlNode *node)
 		}
 		else if (def->type == XML_ENTITY_REF_NODE)
 		{
-			ok &= parse_actor_defs (def->children);
+			ok &= register_actor_defs_file (def);
 		}
 	}
 
@@ -4722,11 +4941,18 @@ int read_actor_defs (const char *dir, const char *index)
 
 	safe_snprintf (fname, sizeof(fname), "%s/%s", dir, index);
 
+#ifndef EXT_ACTOR_DICT
+	// the actors are included from their own files, which are only read to
+	// register them
+	doc = xmlReadFile (fname, NULL, 0);
+#else // EXT_ACTOR_DICT
 	doc = xmlReadFile (fname, NULL, XML_PARSE_NOENT);
+#endif // EXT_ACTOR_DICT
 	if (doc == NULL) {
 		LOG_ERROR("Unable to read actor definition file %s", fname);
 		return 0;
 	}
+	actor_def_cur_file = fname;
 
 	root = xmlDocGetRootElement (doc);
 	if (root == NULL) {
@@ -4748,6 +4974,7 @@ int read_actor_defs (const char *dir, const char *index)
 #endif // EXT_ACTOR_DICT
 	}
 
+	actor_def_cur_file = NULL;
 	xmlFreeDoc (doc);
 	return ok;
 }
@@ -4763,35 +4990,217 @@ void init_actor_defs()
 	read_actor_defs ("actor_defs", "actor_defs.xml");
 }
 
+static void free_actor_def_data(actor_types *act)
+{
+	if (act->head)
+		free(act->head);
+	if (act->shield)
+		free(act->shield);
+	if (act->cape)
+		free(act->cape);
+	if (act->helmet)
+		free(act->helmet);
+	if (act->neck)
+		free(act->neck);
+	if (act->weapon)
+		free(act->weapon);
+	if (act->shirt)
+		free(act->shirt);
+	if (act->skin)
+		free(act->skin);
+	if (act->hair)
+		free(act->hair);
+	if (act->boots)
+		free(act->boots);
+	if (act->legs)
+		free(act->legs);
+	if (act->hardware_model)
+		clear_buffers(act);
+	CalCoreModel_Delete(act->coremodel);
+	destroy_hash_table(act->emote_frames);
+
+	act->head = NULL;
+	act->shield = NULL;
+	act->cape = NULL;
+	act->helmet = NULL;
+	act->neck = NULL;
+	act->weapon = NULL;
+	act->shirt = NULL;
+	act->skin = NULL;
+	act->hair = NULL;
+	act->boots = NULL;
+	act->legs = NULL;
+	act->coremodel = NULL;
+	act->emote_frames = NULL;
+}
+
+static const xmlNode *find_actor_def_node(const xmlNode *node, int actor_type)
+{
+	const xmlNode *found;
+
+	for (; node; node = node->next)
+	{
+		if (node->type != XML_ELEMENT_NODE)
+			continue;
+		if (xmlStrcasecmp(node->name, (xmlChar*)"actor") == 0)
+		{
+			if (get_int_property(node, "id") == actor_type)
+				return node;
+		}
+		else if ((found = find_actor_def_node(node->children, actor_type)) != NULL)
+			return found;
+	}
+
+	return NULL;
+}
+
+int load_actor_def(int actor_type)
+{
+	const xmlNode *cfg = NULL;
+	actor_types *act;
+	xmlDoc *doc;
+	Uint32 start;
+	int ok;
+
+	if (actor_type < 0 || actor_type >= MAX_ACTOR_DEFS)
+		return 0;
+
+	actor_def_last_used[actor_type] = SDL_GetTicks();
+	if (actor_def_loaded[actor_type])
+		return 1;
+	if (actor_def_files[actor_type] == NULL)
+		return 0;
+
+	act = &actors_defs[actor_type];
+	start = SDL_GetTicks();
+
+	// even a broken definition counts as loaded, it won't get any better by
+	// retrying. Set it first, the types attached to this one may refer back.
+	actor_def_loaded[actor_type] = 1;
+
+	doc = xmlReadFile(actor_def_files[actor_type], NULL, XML_PARSE_NOENT);
+	if (doc != NULL)
+		cfg = find_actor_def_node(xmlDocGetRootElement(doc), actor_type);
+	if (cfg != NULL)
+		ok = parse_actor_script(actor_type, cfg);
+	else
+	{
+		LOG_ERROR("Unable to find actor type %s(%d) in %s", act->actor_name, actor_type, actor_def_files[actor_type]);
+		ok = 0;
+	}
+	if (doc != NULL)
+		xmlFreeDoc(doc);
+
+	if (actor_def_emote_frames[actor_type] && act->coremodel != NULL)
+		ok &= load_actor_def_emote_frames(actor_type);
+	if (!ok)
+		LOG_ERROR("Errors while loading actor type %s(%d)", act->actor_name, actor_type);
+
+	LOG_DEBUG("Loaded actor type %s(%d) in %d ms", act->actor_name, actor_type, SDL_GetTicks() - start);
+
+	return 1;
+}
+
+// Also unloads the types that depend on this one, returns how many types
+// were unloaded
+static int unload_actor_def(int actor_type)
+{
+	actor_types *act = &actors_defs[actor_type];
+	int i, count = 1;
+
+	// first, the dependencies may go round in a circle
+	actor_def_loaded[actor_type] = 0;
+	for (i = 0; i < MAX_ACTOR_DEFS; i++)
+	{
+		if (actor_def_loaded[i] && actor_def_depends[i][actor_type])
+			count += unload_actor_def(i);
+	}
+
+	LOG_DEBUG("Unloading unused actor type %s(%d)", act->actor_name, actor_type);
+
+	free_actor_def_data(act);
+	// the attachment animations live in the core models we just deleted
+	memset(&attached_actors_defs[actor_type], 0, sizeof(attached_actors_defs[actor_type]));
+	memset(actor_def_depends[actor_type], 0, sizeof(actor_def_depends[actor_type]));
+
+	return count;
+}
+
+void unload_unused_actor_defs(void)
+{
+	static Uint32 last_check = 0;
+	Uint8 in_use[MAX_ACTOR_DEFS];
+	Uint32 now = SDL_GetTicks();
+	int i, j, oldest, unused, changed;
+
+	if (now - last_check < ACTOR_DEFS_CHECK_INTERVAL)
+		return;
+	last_check = now;
+
+	memset(in_use, 0, sizeof(in_use));
+	LOCK_ACTORS_LISTS();
+	for (i = 0; i < max_actors; i++)
+	{
+		if (actors_list[i] && actors_list[i]->actor_type >= 0 && actors_list[i]->actor_type < MAX_ACTOR_DEFS)
+			in_use[actors_list[i]->actor_type] = 1;
+	}
+	UNLOCK_ACTORS_LISTS();
+
+	// the types a used type depends on are used as well
+	do
+	{
+		changed = 0;
+		for (i = 0; i < MAX_ACTOR_DEFS; i++)
+		{
+			if (!in_use[i] || !actor_def_loaded[i])
+				continue;
+			for (j = 0; j < MAX_ACTOR_DEFS; j++)
+			{
+				if (actor_def_depends[i][j] && !in_use[j])
+				{
+					in_use[j] = 1;
+					changed = 1;
+				}
+			}
+		}
+	} while (changed);
+
+	unused = 0;
+	for (i = 0; i < MAX_ACTOR_DEFS; i++)
+	{
+		if (!actor_def_loaded[i])
+			continue;
+		if (in_use[i])
+			actor_def_last_used[i] = now;
+		else
+			unused++;
+	}
+
+	// drop the types that have been gone the longest, their dependents
+	// aren't used either
+	while (unused > max_unused_actor_defs)
+	{
+		oldest = -1;
+		for (i = 0; i < MAX_ACTOR_DEFS; i++)
+		{
+			if (actor_def_loaded[i] && !in_use[i] && (oldest < 0 ||
+				now - actor_def_last_used[i] > now - actor_def_last_used[oldest]))
+				oldest = i;
+		}
+		unused -= unload_actor_def(oldest);
+	}
+}
+
 void free_actor_defs()
 {
 	int i;
 	for (i=0; i<MAX_ACTOR_DEFS; i++)
 	{
-		if (actors_defs[i].head)
-			free(actors_defs[i].head);
-		if (actors_defs[i].shield)
-			free(actors_defs[i].shield);
-		if (actors_defs[i].cape)
-			free(actors_defs[i].cape);
-		if (actors_defs[i].helmet)
-			free(actors_defs[i].helmet);
-		if (actors_defs[i].neck)
-			free(actors_defs[i].neck);
-		if (actors_defs[i].weapon)
-			free(actors_defs[i].weapon);
-		if (actors_defs[i].shirt)
-			free(actors_defs[i].shirt);
-		if (actors_defs[i].skin)
-			free(actors_defs[i].skin);
-		if (actors_defs[i].hair)
-			free(actors_defs[i].hair);
-		if (actors_defs[i].boots)
-			free(actors_defs[i].boots);
-		if (actors_defs[i].legs)
-			free(actors_defs[i].legs);
-		if (actors_defs[i].hardware_model)
-			clear_buffers(&actors_defs[i]);
-		CalCoreModel_Delete(actors_defs[i].coremodel);
+		free_actor_def_data(&actors_defs[i]);
+		if (actor_def_files[i])
+			free(actor_def_files[i]);
+		actor_def_files[i] = NULL;
+		actor_def_loaded[i] = 0;
 	}
+	memset(actor_def_depends, 0, sizeof(actor_def_depends));
 }
@@ -173,6 +173,38 @@ void init_actor_defs();
  */
 void free_actor_defs();
 
+extern int max_unused_actor_defs; /*!< how many loaded actor types without any actor in sight are kept in memory */
+extern int use_animation_lod; /*!< evaluate the skeletons of distant actors less often and skip off-screen ones */
+
+/*!
+ * \ingroup other
+ * \brief makes sure an actor type is loaded
+ *
+ *      Actor types are only registered by \ref init_actor_defs, their
+ *      skeleton, meshes and animations are loaded by this function the
+ *      first time an actor of the type is created. The types it has
+ *      attachments for are loaded with it.
+ *
+ * \param actor_type	the actor type to load
+ * \retval int	1 if the type is (now) loaded, 0 if there is no such type
+ * \callgraph
+ */
+int load_actor_def(int actor_type);
+
+/*!
+ * \ingroup other
+ * \brief unloads actor types nobody has seen for a while
+ *
+ *      Called from the main loop. Every few seconds it checks which loaded
+ *      actor types have no actor left in the actors list and, if there are
+ *      more than \ref max_unused_actor_defs of them, unloads the ones that
+ *      have been unused the longest. Types a used type has attachments for
+ *      count as used.
+ *
+ * \callgraph
+ */
+void unload_unused_actor_defs(void);
+
 int checkvisitedlist(int x, int y);
 
 /*!
@@ -14,6 +14,7 @@
 #include "gl_init.h"
 #include "global.h"
 #include "interface.h"
+#include "lights.h"
 #include "load_gl_extensions.h"
 #include "map.h"
 #include "missiles.h"
@@ -258,7 +259,10 @@ void add_actor_attachment(int actor_id, int attachment_type)
 		LOG_ERROR("unable to add an attached actor: illegal/missing actor definition %d", attachment_type);
 	else
 	{
-		int id = add_actor(attachment_type, actors_defs[attachment_type].skin_name,
+		int id;
+
+		load_actor_def(attachment_type);
+		id = add_actor(attachment_type, actors_defs[attachment_type].skin_name,
 						   parent->x_pos, parent->y_pos, parent->z_pos, parent->z_rot, get_actor_scale(parent),
 						   0, 0, 0, 0, 0, 0, -1);
 		actors_list[id]->attached_actor = i;
@@ -971,6 +975,11 @@ void draw_actor_without_banner(actor * actor_id, Uint32 use_lightning, Uint32 us
 	y_rot = actor_id->y_rot;
 	z_rot = 180 - actor_id->z_rot;
 
+	if (use_lightning)
+	{
+		select_local_lights(x_pos + 0.25f, y_pos + 0.25f, z_pos);
+	}
+
 	glTranslatef(x_pos + 0.25f, y_pos + 0.25f, z_pos);
 
 	glRotatef(z_rot, 0.0f, 0.0f, 1.0f);
@@ -980,6 +989,9 @@ void draw_actor_without_banner(actor * actor_id, Uint32 use_lightning, Uint32 us
 	if (actor_id->attached_actor >= 0)
 		glTranslatef(actor_id->attachment_shift[0], actor_id->attachment_shift[1], actor_id->attachment_shift[2]);
 
+	// an actor that just came into view still has the pose it was hidden with
+	cal_update_actor_skeleton(actor_id, 0);
+
 	if (use_animation_program)
 	{
 		cal_render_actor_shader(actor_id, use_lightning, use_textures, use_glow);
@@ -1035,56 +1047,120 @@ CHECK_GL_ERRORS();
 #endif //OPENGL_TRACE
 }
 
-static int comp_actors(const void *in_a, const void *in_b)
+#define ACTOR_GROUP_OPAQUE	0
+#define ACTOR_GROUP_ALPHA	1
+#define ACTOR_GROUP_GHOST	2
+
+/*
+ * The candidates of the frame with their bounding boxes and render keys,
+ * sorted once per frame. Each render pass only filters them against its
+ * frustum, so near_actors keeps the order. The key holds, from the top:
+ * 2 bits draw group, 8 bits actor type, 22 bits texture, 16 bits depth and
+ * 16 bits actor index.
+ */
+typedef struct
 {
-	near_actor *a, *b;
-	int at, bt;
+	Uint64 key;
+	AABBOX bbox;
+	actor *act;
+	int actor;
+} actor_render_entry;
 
-	a = (near_actor *)in_a;
-	b = (near_actor *)in_b;
+static actor_render_entry actor_render_list[MAX_ACTORS];
+static actor_render_entry actor_render_tmp[MAX_ACTORS];
+static int actor_render_count = 0;
+static Uint32 actor_render_time = 0;
 
-	at = a->type;
-	bt = b->type;
+static __inline__ int get_actor_group(int ghost, int buffs, int alpha)
+{
+	if (ghost || (buffs & BUFF_INVISIBILITY))
+	{
+		return ACTOR_GROUP_GHOST;
+	}
+	if (alpha)
+	{
+		return ACTOR_GROUP_ALPHA;
+	}
+	return ACTOR_GROUP_OPAQUE;
+}
+
+static Uint64 get_actor_render_key(const actor *act, int index, const VECTOR3 pos)
+{
+	Uint64 group;
+	Uint32 depth;
+	float dx, dy, dz;
 
-	if (at < bt)
+	group = get_actor_group(act->ghost, act->buffs, act->ghost ? 0 : act->has_alpha);
+
+	dx = pos[X] + camera_x;
+	dy = pos[Y] + camera_y;
+	dz = pos[Z] + camera_z;
+	depth = (Uint32)(sqrtf(dx * dx + dy * dy + dz * dz) * 256.0f);
+	if (depth > 0xFFFF)
 	{
-		return (-1);
+		depth = 0xFFFF;
 	}
-	else
+	// blended ghosts are drawn back to front, the others front to back
+	if (group == ACTOR_GROUP_GHOST)
+	{
+		depth = 0xFFFF - depth;
+	}
+
+	return (group << 62) | ((Uint64)(act->actor_type & 0xFF) << 54) |
+		((Uint64)(act->texture_id & 0x3FFFFF) << 32) | (depth << 16) | (index & 0xFFFF);
+}
+
+// LSD radix sort, one byte at a time, like the 3d object queue
+static void sort_actor_render_list(void)
+{
+	Uint32 count[256];
+	Uint32 shift, sum, tmp;
+	int i;
+	actor_render_entry *src, *dst, *swap;
+
+	src = actor_render_list;
+	dst = actor_render_tmp;
+
+	for (shift = 0; shift < 64; shift += 8)
 	{
-		if (at == bt)
+		memset(count, 0, sizeof(count));
+		for (i = 0; i < actor_render_count; i++)
 		{
-			return (0);
+			count[(src[i].key >> shift) & 0xFF]++;
 		}
-		else
+		if (count[(src[0].key >> shift) & 0xFF] == actor_render_count)
 		{
-			return (1);
+			continue;
 		}
+		sum = 0;
+		for (i = 0; i < 256; i++)
+		{
+			tmp = count[i];
+			count[i] = sum;
+			sum += tmp;
+		}
+		for (i = 0; i < actor_render_count; i++)
+		{
+			dst[count[(src[i].key >> shift) & 0xFF]++] = src[i];
+		}
+		swap = src;
+		src = dst;
+		dst = swap;
+	}
+
+	if (src != actor_render_list)
+	{
+		memcpy(actor_render_list, src, actor_render_count * sizeof(actor_render_entry));
 	}
 }
 
-void get_actors_in_range()
+static void build_actor_render_list(const actor *me)
 {
 	VECTOR3 pos;
 	unsigned int i;
-#ifdef NEW_SOUND
-	unsigned int tmp_nr_enh_act;		// Use temp variables to stop crowd sound interference during count
-	float tmp_dist_to_nr_enh_act;
-#endif // NEW_SOUND
-	actor *me;
-	AABBOX bbox;
-
-	me = get_our_actor ();
-
-	if (!me) return;
+	actor_render_entry *entry;
 
-	no_near_actors = 0;
-#ifdef NEW_SOUND
-	tmp_nr_enh_act = 0;
-	tmp_dist_to_nr_enh_act = 0;
-#endif // NEW_SOUND
-
-	set_current_frustum(get_cur_intersect_type(main_bbox_tree));
+	actor_render_count = 0;
 
 	for (i = 0; i < max_actors; i++)
 	{
@@ -1140,47 +1216,93 @@ void get_actors_in_range()
 
 			if (actors_list[i]->calmodel == NULL) continue;
 
-			memcpy(&bbox, &actors_list[i]->bbox, sizeof(AABBOX));
-			rotate_aabb(&bbox, actors_list[i]->x_rot, actors_list[i]->y_rot, 180.0f-actors_list[i]->z_rot);
+			entry = &actor_render_list[actor_render_count++];
+			memcpy(&entry->bbox, &actors_list[i]->bbox, sizeof(AABBOX));
+			rotate_aabb(&entry->bbox, actors_list[i]->x_rot, actors_list[i]->y_rot, 180.0f-actors_list[i]->z_rot);
 
-			VAddEq(bbox.bbmin, pos);
-			VAddEq(bbox.bbmax, pos);
+			VAddEq(entry->bbox.bbmin, pos);
+			VAddEq(entry->bbox.bbmax, pos);
 
-			if (aabb_in_frustum(bbox))
-			{
-				near_actors[no_near_actors].actor = i;
-				near_actors[no_near_actors].ghost = actors_list[i]->ghost;
-				near_actors[no_near_actors].buffs = actors_list[i]->buffs;
-				near_actors[no_near_actors].select = 0;
-				near_actors[no_near_actors].type = actors_list[i]->actor_type;
-				if (actors_list[i]->ghost)
-				{
-					near_actors[no_near_actors].alpha = 0;
-				}
-				else
-				{
-					near_actors[no_near_actors].alpha =
-						actors_list[i]->has_alpha;
-				}
+			entry->key = get_actor_render_key(actors_list[i], i, pos);
+			entry->act = actors_list[i];
+			entry->actor = i;
+		}
+	}
 
-				actors_list[i]->max_z = actors_list[i]->bbox.bbmax[Z];
+	sort_actor_render_list();
+}
 
-				if (read_mouse_now && (get_cur_intersect_type(main_bbox_tree) == INTERSECTION_TYPE_DEFAULT))
-				{
-					near_actors[no_near_actors].select = 1;
-				}
-				no_near_actors++;
+void get_actors_in_range()
+{
+	int i;
 #ifdef NEW_SOUND
-				if (actors_list[i]->is_enhanced_model && actors_list[i]->actor_id != me->actor_id)
-				{
-					tmp_nr_enh_act++;
-					tmp_dist_to_nr_enh_act += ((me->x_pos - actors_list[i]->x_pos) *
-														(me->x_pos - actors_list[i]->x_pos)) +
-														((me->y_pos - actors_list[i]->y_pos) *
-														(me->y_pos - actors_list[i]->y_pos));
-				}
+	unsigned int tmp_nr_enh_act;		// Use temp variables to stop crowd sound interference during count
+	float tmp_dist_to_nr_enh_act;
 #endif // NEW_SOUND
+	actor *me, *act;
+	actor_render_entry *entry;
+
+	me = get_our_actor ();
+
+	if (!me) return;
+
+	// the reflection, shadow and main passes of a frame share the list
+	if ((actor_render_time != cur_time) || (actor_render_count == 0))
+	{
+		build_actor_render_list(me);
+		actor_render_time = cur_time;
+	}
+
+	no_near_actors = 0;
+#ifdef NEW_SOUND
+	tmp_nr_enh_act = 0;
+	tmp_dist_to_nr_enh_act = 0;
+#endif // NEW_SOUND
+
+	set_current_frustum(get_cur_intersect_type(main_bbox_tree));
+
+	for (i = 0; i < actor_render_count; i++)
+	{
+		entry = &actor_render_list[i];
+		act = actors_list[entry->actor];
+		// the actor went away since the list was built
+		if (act != entry->act) continue;
+
+		if (aabb_in_frustum(entry->bbox))
+		{
+			act->last_in_view = cur_time;
+			near_actors[no_near_actors].actor = entry->actor;
+			near_actors[no_near_actors].ghost = act->ghost;
+			near_actors[no_near_actors].buffs = act->buffs;
+			near_actors[no_near_actors].select = 0;
+			near_actors[no_near_actors].type = act->actor_type;
+			near_actors[no_near_actors].group = entry->key >> 62;
+			if (act->ghost)
+			{
+				near_actors[no_near_actors].alpha = 0;
+			}
+			else
+			{
+				near_actors[no_near_actors].alpha = act->has_alpha;
 			}
+
+			act->max_z = act->bbox.bbmax[Z];
+
+			if (read_mouse_now && (get_cur_intersect_type(main_bbox_tree) == INTERSECTION_TYPE_DEFAULT))
+			{
+				near_actors[no_near_actors].select = 1;
+			}
+			no_near_actors++;
+#ifdef NEW_SOUND
+			if (act->is_enhanced_model && act->actor_id != me->actor_id)
+			{
+				tmp_nr_enh_act++;
+				tmp_dist_to_nr_enh_act += ((me->x_pos - act->x_pos) *
+													(me->x_pos - act->x_pos)) +
+													((me->y_pos - act->y_pos) *
+													(me->y_pos - act->y_pos));
+			}
+#endif // NEW_SOUND
 		}
 	}
 #ifdef NEW_SOUND
@@ -1189,12 +1311,34 @@ void get_actors_in_range()
 	no_near_enhanced_actors = tmp_nr_enh_act;
 	distanceSq_to_near_enhanced_actors = tmp_dist_to_nr_enh_act;
 #endif // NEW_SOUND
-	qsort(near_actors, no_near_actors, sizeof(near_actor), comp_actors);
+}
+
+static void select_near_actor(const near_actor *near_act, const actor *cur_actor)
+{
+	if (cur_actor->kind_of_actor == NPC)
+	{
+		anything_under_the_mouse(near_act->actor, UNDER_MOUSE_NPC);
+	}
+	else
+	{
+		if ((cur_actor->kind_of_actor == HUMAN) ||
+			(cur_actor->kind_of_actor == COMPUTER_CONTROLLED_HUMAN) ||
+			(cur_actor->is_enhanced_model &&
+			((cur_actor->kind_of_actor == PKABLE_HUMAN) ||
+			(cur_actor->kind_of_actor == PKABLE_COMPUTER_CONTROLLED))))
+		{
+			anything_under_the_mouse(near_act->actor, UNDER_MOUSE_PLAYER);
+		}
+		else
+		{
+			anything_under_the_mouse(near_act->actor, UNDER_MOUSE_ANIMAL);
+		}
+	}
 }
 
 void display_actors(int banner, int render_pass)
 {
-	Sint32 i, has_alpha, has_ghosts;
+	Sint32 i, group, last_group;
 	Uint32 use_lightning = 0, use_textures = 0;
 
 	get_actors_in_range();
@@ -1220,162 +1364,92 @@ void display_actors(int banner, int render_pass)
 			break;
 	}
 
-	has_alpha = 0;
-	has_ghosts = 0;
-
 #ifdef	FSAA
 	if (fsaa > 1)
 	{
 		glEnable(GL_MULTISAMPLE);
 	}
 #endif	/* FSAA */
+	// near_actors is sorted by group, so the state only changes twice
+	last_group = ACTOR_GROUP_OPAQUE;
 	for (i = 0; i < no_near_actors; i++)
 	{
-		if (near_actors[i].ghost || (near_actors[i].buffs & BUFF_INVISIBILITY))
+		actor *cur_actor = actors_list[near_actors[i].actor];
+
+		group = near_actors[i].group;
+		if (group == ACTOR_GROUP_GHOST)
 		{
-			if ((render_pass == DEFAULT_RENDER_PASS) ||
-				(render_pass == SHADOW_RENDER_PASS))
+			// the ghosts are only drawn by the main and shadow passes
+			if ((render_pass != DEFAULT_RENDER_PASS) &&
+				(render_pass != SHADOW_RENDER_PASS))
 			{
-				has_ghosts = 1;
+				break;
 			}
 		}
-		else if (near_actors[i].alpha)
-		{
-			has_alpha = 1;
-		}
-		else
+		if (group != last_group)
 		{
-			actor *cur_actor = actors_list[near_actors[i].actor];
-			if (cur_actor)
+			if (last_group == ACTOR_GROUP_ALPHA)
 			{
-				draw_actor_without_banner(cur_actor, use_lightning, use_textures, 1);
-				if (near_actors[i].select)
-				{
-					if (cur_actor->kind_of_actor == NPC)
-					{
-						anything_under_the_mouse(near_actors[i].actor, UNDER_MOUSE_NPC);
-					}
-					else
-					{
-						if ((cur_actor->kind_of_actor == HUMAN) ||
-							(cur_actor->kind_of_actor == COMPUTER_CONTROLLED_HUMAN) ||
-							(cur_actor->is_enhanced_model &&
-							((cur_actor->kind_of_actor == PKABLE_HUMAN) ||
-							(cur_actor->kind_of_actor == PKABLE_COMPUTER_CONTROLLED))))
-						{
-							anything_under_the_mouse(near_actors[i].actor, UNDER_MOUSE_PLAYER);
-						}
-						else
-						{
-							anything_under_the_mouse(near_actors[i].actor, UNDER_MOUSE_ANIMAL);
-						}
-					}
-				}
+				glDisable(GL_ALPHA_TEST);
 			}
-		}
-	}
-	if (has_alpha)
-	{
-		glEnable(GL_ALPHA_TEST);
-		glAlphaFunc(GL_GREATER, 0.4f);
-		for (i = 0; i < no_near_actors; i++)
-		{
-
-			if (near_actors[i].alpha && !(near_actors[i].ghost || (near_actors[i].buffs & BUFF_INVISIBILITY)))
+			if (group == ACTOR_GROUP_ALPHA)
 			{
-
-				actor *cur_actor = actors_list[near_actors[i].actor];
-				if (cur_actor)
+				glEnable(GL_ALPHA_TEST);
+				glAlphaFunc(GL_GREATER, 0.4f);
+			}
+			else if (group == ACTOR_GROUP_GHOST)
+			{
+				glEnable(GL_BLEND);
+				glDisable(GL_LIGHTING);
+				if (use_animation_program)
 				{
-					draw_actor_without_banner(cur_actor, use_lightning, 1, 1);
-
-					if (near_actors[i].select)
-					{
-						if (cur_actor->kind_of_actor == NPC)
-						{
-							anything_under_the_mouse(near_actors[i].actor, UNDER_MOUSE_NPC);
-						}
-						else
-						{
-							if ((cur_actor->kind_of_actor == HUMAN) ||
-								(cur_actor->kind_of_actor == COMPUTER_CONTROLLED_HUMAN) ||
-								(cur_actor->is_enhanced_model &&
-								 ((cur_actor->kind_of_actor == PKABLE_HUMAN) ||
-								 (cur_actor->kind_of_actor == PKABLE_COMPUTER_CONTROLLED))))
-							{
-								anything_under_the_mouse(near_actors[i].actor, UNDER_MOUSE_PLAYER);
-							}
-							else
-							{
-								anything_under_the_mouse(near_actors[i].actor, UNDER_MOUSE_ANIMAL);
-							}
-						}
-					}
+					set_actor_animation_program(render_pass, 1);
 				}
 			}
-		}
-		glDisable(GL_ALPHA_TEST);
-	}
-	if (has_ghosts)
-	{
-		glEnable(GL_BLEND);
-		glDisable(GL_LIGHTING);
-		if (use_animation_program)
-		{
-			set_actor_animation_program(render_pass, 1);
+			last_group = group;
 		}
 
-		for (i = 0; i < no_near_actors; i++)
-		{
+		if (!cur_actor) continue;
 
-			if (near_actors[i].ghost || (near_actors[i].buffs & BUFF_INVISIBILITY))
-			{
-
-				actor *cur_actor = actors_list[near_actors[i].actor];
-				if (cur_actor)
+		switch (group)
+		{
+			case ACTOR_GROUP_OPAQUE:
+				draw_actor_without_banner(cur_actor, use_lightning, use_textures, 1);
+				break;
+			case ACTOR_GROUP_ALPHA:
+				draw_actor_without_banner(cur_actor, use_lightning, 1, 1);
+				break;
+			case ACTOR_GROUP_GHOST:
+				//if any ghost has a glowing weapon, we need to reset the blend function each ghost actor.
+				glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+				if (!use_animation_program)
 				{
-					//if any ghost has a glowing weapon, we need to reset the blend function each ghost actor.
-					glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-					if (!use_animation_program)
+					if ((near_actors[i].buffs & BUFF_INVISIBILITY))
 					{
-						if ((near_actors[i].buffs & BUFF_INVISIBILITY))
-						{
-							glColor4f(1.0f, 1.0f, 1.0f, 0.25f);
-						}
-						else
-						{
-							glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
-						}
+						glColor4f(1.0f, 1.0f, 1.0f, 0.25f);
 					}
-
-					draw_actor_without_banner(cur_actor, use_lightning, use_textures, 1);
-
-					if (near_actors[i].select)
+					else
 					{
-						if (cur_actor->kind_of_actor == NPC)
-						{
-							anything_under_the_mouse(near_actors[i].actor, UNDER_MOUSE_NPC);
-						}
-						else
-						{
-							if ((cur_actor->kind_of_actor == HUMAN) ||
-								(cur_actor->kind_of_actor == COMPUTER_CONTROLLED_HUMAN) ||
-								(cur_actor->is_enhanced_model &&
-								 ((cur_actor->kind_of_actor == PKABLE_HUMAN) ||
-								 (cur_actor->kind_of_actor == PKABLE_COMPUTER_CONTROLLED))))
-							{
-								anything_under_the_mouse(near_actors[i].actor, UNDER_MOUSE_PLAYER);
-							}
-							else
-							{
-								anything_under_the_mouse(near_actors[i].actor, UNDER_MOUSE_ANIMAL);
-							}
-						}
+						glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
 					}
 				}
-			}
+
+				draw_actor_without_banner(cur_actor, use_lightning, use_textures, 1);
+				break;
 		}
+
+		if (near_actors[i].select)
+		{
+			select_near_actor(&near_actors[i], cur_actor);
+		}
+	}
+	if (last_group == ACTOR_GROUP_ALPHA)
+	{
+		glDisable(GL_ALPHA_TEST);
+	}
+	else if (last_group == ACTOR_GROUP_GHOST)
+	{
 		glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
 		glDisable(GL_BLEND);
 		glEnable(GL_LIGHTING);
@@ -1387,6 +1461,8 @@ void display_actors(int banner, int render_pass)
 	}
 #endif	/* FSAA */
 
+	restore_scene_lights();
+
 	if (use_animation_program)
 	{
 		disable_actor_animation_program();
@@ -1483,6 +1559,7 @@ void add_actor_from_server (const char *in_data, int len)
 	if(actor_type < 0 || actor_type >= MAX_ACTOR_DEFS || (actor_type > 0 && actors_defs[actor_type].actor_type != actor_type) ){
 		LOG_ERROR("Illegal/missing actor definition %d", actor_type);
 	}
+	load_actor_def(actor_type);
 
 	//translate from tile to world
 	f_x_pos=x_pos*0.5;
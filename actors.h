@@ -85,6 +85,7 @@ typedef struct {
 	int type;
 	int alpha;
 	int ghost;//If it's a ghost or not
+	int group;	// The draw group (opaque, alpha, ghost) of its render key
 } near_actor;
 
 extern int no_near_actors;
@@ -512,6 +513,10 @@ typedef struct
 	int IsOnIdle;
 	float anim_time;
 	Uint32	last_anim_update;
+	Uint32 last_skeleton_update;	/*!< when the skeleton was last evaluated */
+	Uint32 last_in_view;	/*!< when the actor was last inside the view frustum */
+	char anim_lod;		/*!< how often animate_actors evaluates the skeleton, one of the ANIM_LOD_* values */
+	char skeleton_outdated;	/*!< the animation time was advanced without evaluating the skeleton, see \ref cal_update_actor_skeleton */
 	AABBOX bbox;
 
 	/*! \name Range mode parameters */
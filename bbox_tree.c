@@ -21,6 +21,9 @@
 
 BBOX_TREE* main_bbox_tree = NULL;
 BBOX_ITEMS* main_bbox_tree_items = NULL;
+#ifdef CLUSTER_INSIDES
+static short shadow_cluster = 0;	// the cluster the shadow list was built for
+#endif // CLUSTER_INSIDES
 
 #ifdef	EXTRA_DEBUG
 #define BBOX_TREE_LOG_INFO(item)	log_error_detailed("%s is NULL", __FILE__, __FUNCTION__, __LINE__, item);
@@ -47,6 +50,23 @@ void set_all_intersect_update_needed(BBOX_TREE* bbox_tree)
 	else BBOX_TREE_LOG_INFO("bbox_tree");
 }
 
+void set_view_intersect_update_needed(BBOX_TREE* bbox_tree)
+{
+	Uint32 i;
+
+	if (bbox_tree != NULL)
+	{
+		// the shadow casters only depend on the sun and the camera cell,
+		// calculate_shadow_frustum checks those itself
+		for (i = 0; i < MAX_INTERSECTION_TYPES; i++)
+		{
+			if (i != INTERSECTION_TYPE_SHADOW)
+				bbox_tree->intersect[i].intersect_update_needed = 1;
+		}
+	}
+	else BBOX_TREE_LOG_INFO("bbox_tree");
+}
+
 static __inline__ void adapt_intersect_list_size(BBOX_TREE* bbox_tree, Uint32 count)
 {
 	Uint32 size, idx;
@@ -1139,6 +1159,39 @@ static __inline__ int add_dynamic_aabb_to_abt_node(BBOX_TREE *bbox_tree, Uint32
 	else return 0;
 }
 
+static __inline__ void add_dynamic_item_to_shadow_list(BBOX_TREE *bbox_tree, const AABBOX bbox, Uint32 ID, Uint32 type, Uint32 texture_id)
+{
+	BBOX_ITEM item;
+	Uint32 idx, cur_intersect_type;
+
+	idx = INTERSECTION_TYPE_SHADOW;
+	// a full update is pending anyway
+	if (bbox_tree->intersect[idx].intersect_update_needed > 0) return;
+#ifdef CLUSTER_INSIDES
+	// current_cluster is the one of the new item here
+	if (current_cluster && current_cluster != shadow_cluster) return;
+#endif // CLUSTER_INSIDES
+	if (check_aabb_outside_frustum(bbox, bbox_tree->intersect[idx].frustum,
+		bbox_tree->intersect[idx].frustum_mask) == OUTSIDE) return;
+
+	memset(&item, 0, sizeof(item));
+	VAssign(item.bbox.bbmin, bbox.bbmin);
+	VAssign(item.bbox.bbmax, bbox.bbmax);
+	item.ID = ID;
+	item.type = type;
+	item.texture_id = texture_id;
+#ifdef CLUSTER_INSIDES
+	item.cluster = current_cluster;
+#endif // CLUSTER_INSIDES
+
+	cur_intersect_type = bbox_tree->cur_intersect_type;
+	bbox_tree->cur_intersect_type = idx;
+	add_intersect_item_to_list(bbox_tree, &item, idx);
+	qsort((void *)(bbox_tree->intersect[idx].items), bbox_tree->intersect[idx].count, sizeof(BBOX_ITEM), comp_items);
+	build_start_stop(bbox_tree);
+	bbox_tree->cur_intersect_type = cur_intersect_type;
+}
+
 static __inline__ void add_aabb_to_abt(BBOX_TREE *bbox_tree, const AABBOX bbox, Uint32 ID, Uint32 type, Uint32 texture_id, Uint32 dynamic)
 {
 	Uint32 result;
@@ -1147,7 +1200,8 @@ static __inline__ void add_aabb_to_abt(BBOX_TREE *bbox_tree, const AABBOX bbox,
 	{
 		result = add_dynamic_aabb_to_abt_node(bbox_tree, 0, bbox, ID, type, texture_id);
 		if (result == 0) add_dynamic_item_to_node(bbox_tree, 0, bbox, ID, type, texture_id, 0);
-		set_all_intersect_update_needed(bbox_tree);
+		set_view_intersect_update_needed(bbox_tree);
+		add_dynamic_item_to_shadow_list(bbox_tree, bbox, ID, type, texture_id);
 	}
 	else BBOX_TREE_LOG_INFO("bbox_tree");
 }
@@ -1756,6 +1810,9 @@ void check_bbox_tree_shadow(BBOX_TREE* bbox_tree, const FRUSTUM frustum, Uint32
 		if (idx != INTERSECTION_TYPE_SHADOW) return;
 		if (bbox_tree->intersect[idx].intersect_update_needed > 0)
 		{
+#ifdef CLUSTER_INSIDES
+			shadow_cluster = current_cluster;
+#endif // CLUSTER_INSIDES
 			point_mask = calculate_point_mask(light_dir);
 			calculate_frustum_data(data, view_frustum, light_dir, view_mask);
 			bbox_tree->intersect[idx].count = 0;
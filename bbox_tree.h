@@ -923,6 +923,19 @@ void free_bbox_items(BBOX_ITEMS* bbox_items);
  */
 void set_all_intersect_update_needed(BBOX_TREE* bbox_tree);
 
+/**
+ * @ingroup misc
+ * @brief Sets the intersection lists that depend on the view to update needed.
+ *
+ * Sets all intersection lists but the shadow one to update needed. Used when
+ * only the camera moved, the shadow casters are kept until the sun or the
+ * camera cell changes.
+ *
+ * @param bbox_tree	The bounding box tree of the intersection list.
+ * @callgraph
+ */
+void set_view_intersect_update_needed(BBOX_TREE* bbox_tree);
+
 /**
  * @ingroup misc
  * @brief Calculates the scene bounding box.
@@ -1,6 +1,7 @@
 #include <libxml/xmlmemory.h>
 #include <libxml/parser.h>
 #include <libxml/tree.h>
+#include <limits.h>
 #include <string.h>
 #include "books.h"
 #include "asc.h"
@@ -48,6 +49,10 @@
 
 #define KNOWLEDGE_BOOK_OFFSET 10000
 
+// Local books are laid out this many pages past the active page when shown,
+// the rest follows one <page> per frame while the book is open.
+#define BOOK_PAGES_AHEAD 10
+
 int book_opened=-1;//The ID of the book opened
 
 static int paper1_text = -1; // Index in the texture cache of the paper texture
@@ -91,6 +96,10 @@ typedef struct _book {
 
 	int active_page;
 
+	char file[200];		// the xml source of a local book, laid out on demand
+	xmlDoc *doc;		// kept until all its pages are laid out
+	xmlNode *next_page;	// the next <page> element to lay out
+
 	struct _book * next;
 } book;
 
@@ -118,7 +127,7 @@ page * add_page(book * b)
 	return p;
 }
 
-book *create_book (const char* title, int type, int id)
+static book *new_book (const char* title, int type, int id)
 {
 	book *b=(book*)calloc(1,sizeof(book));
 	
@@ -138,9 +147,16 @@ book *create_book (const char* title, int type, int id)
 	b->type=type;
 	b->id=id;
 	safe_snprintf(b->title, sizeof(b->title), "%s", title);
-	
+
+	return b;
+}
+
+book *create_book (const char* title, int type, int id)
+{
+	book *b=new_book(title, type, id);
+
 	add_book(b);
-	
+
 	return b;
 }
 
@@ -188,6 +204,7 @@ void free_book(book * b)
 	p=b->pages;
 	for(i=0;i<b->no_pages;i++,p++) free_page(*p);
 	free(b->pages);
+	if(b->doc) xmlFreeDoc(b->doc);
 	free(b);
 }
 
@@ -440,57 +457,115 @@ void add_xml_page(xmlNode *cur, book * b)
 	}
 }
 
-book * parse_book(xmlNode *in, char * title, int type, int id)
+static xmlNode *find_xml_page(xmlNode *cur)
 {
-	xmlNode * cur;
-	book * b=create_book(title, type, id);
-	
-	for(cur=in;cur;cur=cur->next){
-		if(cur->type == XML_ELEMENT_NODE){
-			if(!xmlStrcasecmp(cur->name,(xmlChar*)"page")){
-				add_xml_page(cur->children,b);
-			}
-		}
+	for(;cur;cur=cur->next){
+		if(cur->type == XML_ELEMENT_NODE && !xmlStrcasecmp(cur->name,(xmlChar*)"page"))
+			break;
 	}
 
-	return b;
+	return cur;
 }
 
-book * read_book(char * file, int type, int id)
+/* Lays out the <page> elements of a local book until it has more than
+ * page_no pages. Returns 1 if some are still left. */
+static int layout_book_pages(book *b, int page_no)
+{
+	xmlNode *cur;
+
+	while(b->next_page && b->no_pages <= page_no){
+		cur=b->next_page;
+		b->next_page=find_xml_page(cur->next);
+		add_xml_page(cur->children,b);
+	}
+
+	if(!b->next_page && b->doc){
+		xmlFreeDoc(b->doc);
+		b->doc=NULL;
+	}
+
+	return b->next_page!=NULL;
+}
+
+static int find_book_file(const char *file, char *path, int size)
+{
+	safe_snprintf(path, size, "languages/%s/%s", lang, file);
+	if(el_file_exists_anywhere(path))
+		return 1;
+
+	safe_snprintf(path, size, "languages/en/%s", file);
+	return el_file_exists_anywhere(path);
+}
+
+static void book_open_error(const char *path)
+{
+	char str[200];
+
+	safe_snprintf(str, sizeof(str), book_open_err_str, path);
+	LOG_ERROR(str);
+	LOG_TO_CONSOLE(c_red1,str);
+}
+
+/* Reads the xml of a local book, its pages are laid out by layout_book_pages */
+static int load_book_source(book *b)
 {
 	xmlDoc * doc;
 	xmlNode * root=NULL;
 	xmlChar *title=NULL;
-	book *b=NULL;
 	char path[1024];
 
-	safe_snprintf(path, sizeof(path), "languages/%s/%s", lang, file);
-
-	if ((doc = xmlReadFile(path, NULL, 0)) == NULL) {
-		safe_snprintf(path, sizeof(path), "languages/en/%s", file);
+	if(!find_book_file(b->file, path, sizeof(path)) || (doc = xmlReadFile(path, NULL, 0)) == NULL) {
+		book_open_error(path);
+		return 0;
 	}
-	if(doc == NULL && ((doc = xmlReadFile(path, NULL, 0)) == NULL)) {
-		char str[200];
 
-		safe_snprintf(str, sizeof(str), book_open_err_str, path);
-		LOG_ERROR(str);
-		LOG_TO_CONSOLE(c_red1,str);
-	} else if ((root = xmlDocGetRootElement(doc))==NULL) {
+	if ((root = xmlDocGetRootElement(doc))==NULL) {
 		LOG_ERROR("Error while parsing: %s", path);
 	} else if(xmlStrcasecmp(root->name,(xmlChar*)"book")){
 		LOG_ERROR("Root element in %s is not <book>", path);
 	} else if((title=xmlGetProp(root,(xmlChar*)"title"))==NULL){
 		LOG_ERROR("Root element in %s does not contain a title=\"<short title>\" property.", path);
 	} else {
-		b=parse_book(root->children, (char*)title, type, id);
-	}
-	
-	if(title) {
+		safe_snprintf(b->title, sizeof(b->title), "%s", (char*)title);
 		xmlFree(title);
+		b->doc=doc;
+		b->next_page=find_xml_page(root->children);
+		return 1;
 	}
-	
+
 	xmlFreeDoc(doc);
 
+	return 0;
+}
+
+/* Loads a local book the first time it's shown and lays out the pages
+ * around the active one */
+static int prepare_book(book *b)
+{
+	if(b->file[0] && !b->doc && !b->no_pages && !load_book_source(b))
+		return 0;
+
+	layout_book_pages(b, b->active_page+BOOK_PAGES_AHEAD);
+	if(!b->no_pages)
+		add_page(b);
+
+	return 1;
+}
+
+/* Local books are only read when opened, this just checks that the file is there */
+book * read_book(char * file, int type, int id)
+{
+	book *b;
+	char path[1024];
+
+	if(!find_book_file(file, path, sizeof(path))) {
+		book_open_error(path);
+		return NULL;
+	}
+
+	b=create_book("", type, id);
+	safe_snprintf(b->file, sizeof(b->file), "%s", file);
+
 	return b;
 }
 
@@ -829,6 +904,7 @@ int display_book_handler(window_info *win)
 		toggle_window(book_win);
 		return 1;
 	}
+	layout_book_pages(b, b->active_page+BOOK_PAGES_AHEAD);
 	switch(b->type){
 		case 1:
 #ifdef	NEW_TEXTURES
@@ -858,6 +934,9 @@ int display_book_handler(window_info *win)
 		glTranslatef(30,15,0);
 	display_book(b, b->type);
 	glPopMatrix();
+
+	// meanwhile lay out the rest of the book, one page at a time
+	layout_book_pages(b, b->no_pages);
 	
 	glPushMatrix();
 	glTranslatef(0,win->len_y-18,0);
@@ -1104,7 +1183,7 @@ void display_book_window(book *b)
 {
 	int *p;
 
-	if(!b)
+	if(!b || !prepare_book(b))
 		return;
 
 	if(b->type==1){
@@ -1173,6 +1252,43 @@ void free_books()
 		free_book(books);
 }
 
+#ifdef BOOKS_BENCHMARK
+void benchmark_books(char *buffer, size_t len)
+{
+	book *b, *tmp;
+	Uint32 start, open_time, full_time;
+	int count=0, pages=0, pass;
+
+	// first time opening every local book, then laying out all of them as
+	// init_books used to do
+	open_time=full_time=0;
+	for(pass=0;pass<2;pass++){
+		start=SDL_GetTicks();
+		for(b=books;b;b=b->next){
+			if(!b->file[0])
+				continue;
+			tmp=new_book("", b->type, b->id);
+			safe_snprintf(tmp->file, sizeof(tmp->file), "%s", b->file);
+			if(load_book_source(tmp)){
+				layout_book_pages(tmp, pass ? INT_MAX : BOOK_PAGES_AHEAD);
+				if(pass){
+					count++;
+					pages+=tmp->no_pages;
+				}
+			}
+			free_book(tmp);
+		}
+		if(pass)
+			full_time=SDL_GetTicks()-start;
+		else
+			open_time=SDL_GetTicks()-start;
+	}
+
+	safe_snprintf(buffer, len, "Books: %d local books with %d pages; opening all of them takes %u ms, laying out every page %u ms",
+		count, pages, open_time, full_time);
+}
+#endif // BOOKS_BENCHMARK
+
 /* currently UNUSED
 int have_book(int id)
 {
@@ -6,6 +6,8 @@
 #ifndef __BOOKS_H__
 #define __BOOKS_H__
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -83,6 +85,19 @@ void open_book(int id);
  */
 void close_book(int book_id);
 
+#ifdef BOOKS_BENCHMARK
+/*!
+ * \ingroup	books_window
+ * \brief	Times the layout of the local books
+ *
+ * 		Reads every local book twice, once laying out only the pages shown when it's opened and once laying out all pages.
+ *
+ * \param	buffer The buffer for the result line
+ * \param	len The size of the buffer
+ */
+void benchmark_books(char *buffer, size_t len);
+#endif // BOOKS_BENCHMARK
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -24,18 +24,108 @@
 cache_struct *cache_system = NULL;
 cache_struct *cache_e3d = NULL;
 
+int texture_cache_budget = 0;
+int e3d_cache_budget = 0;
+
+// share of the size limit the protected segment may fill
+#define SLRU_PROTECTED_SHARE	80
+// items used this recently are never compacted to meet a budget
+#define CACHE_MIN_IDLE_TIME	10*1000
+
 #ifndef	NEW_TEXTURES
 texture_cache_struct texture_cache[TEXTURE_CACHE_MAX];
 #endif	/* NEW_TEXTURES */
 
 static Uint32 cache_system_clean();
-static Uint32 cache_system_compact();
 static Uint32 cache_clean(cache_struct *cache);
-static Uint32 cache_compact(cache_struct *cache);
+static Uint32 cache_trim(cache_struct *cache);
 static cache_item_struct *cache_find_ptr(cache_struct *cache, const void *item);
 static void cache_remove(cache_struct *cache, cache_item_struct *item);
 static void cache_remove_all(cache_struct *cache);
 
+static void cache_link(cache_struct *cache, cache_item_struct *item, Uint32 segment)
+{
+	item->segment = segment;
+	item->prev = NULL;
+	item->next = cache->head[segment];
+	if (item->next)
+		item->next->prev = item;
+	else
+		cache->tail[segment] = item;
+	cache->head[segment] = item;
+	cache->segment_size[segment] += item->size;
+}
+
+static void cache_unlink(cache_struct *cache, cache_item_struct *item)
+{
+	Uint32 segment = item->segment;
+
+	if (segment == CACHE_SEGMENT_NONE)
+		return;
+	if (item->prev)
+		item->prev->next = item->next;
+	else
+		cache->head[segment] = item->next;
+	if (item->next)
+		item->next->prev = item->prev;
+	else
+		cache->tail[segment] = item->prev;
+	cache->segment_size[segment] -= item->size;
+	item->prev = item->next = NULL;
+	item->segment = CACHE_SEGMENT_NONE;
+}
+
+static Uint32 cache_get_size_limit(const cache_struct *cache)
+{
+	if (cache->budget && *cache->budget > 0)
+		return (Uint32)*cache->budget * 1024 * 1024;
+	return cache->size_limit;
+}
+
+static void lru_insert(cache_struct *cache, cache_item_struct *item)
+{
+	cache_link(cache, item, CACHE_SEGMENT_PROTECTED);
+}
+
+static void lru_touch(cache_struct *cache, cache_item_struct *item)
+{
+	cache_unlink(cache, item);
+	cache_link(cache, item, CACHE_SEGMENT_PROTECTED);
+}
+
+static void slru_insert(cache_struct *cache, cache_item_struct *item)
+{
+	cache_link(cache, item, CACHE_SEGMENT_PROBATION);
+}
+
+// A use in a later frame promotes the item. Like the ghost entries of ARC,
+// compacted items that are needed again go straight to the protected segment.
+static void slru_touch(cache_struct *cache, cache_item_struct *item)
+{
+	cache_item_struct *victim;
+	Uint32 limit;
+
+	cache_unlink(cache, item);
+	cache_link(cache, item, CACHE_SEGMENT_PROTECTED);
+
+	limit = cache_get_size_limit(cache);
+	if (!limit)
+		limit = cache->total_size;
+	limit = limit / 100 * SLRU_PROTECTED_SHARE;
+
+	// demote the least recently used protected items to probation
+	while (cache->segment_size[CACHE_SEGMENT_PROTECTED] > limit
+		&& cache->tail[CACHE_SEGMENT_PROTECTED] != item)
+	{
+		victim = cache->tail[CACHE_SEGMENT_PROTECTED];
+		cache_unlink(cache, victim);
+		cache_link(cache, victim, CACHE_SEGMENT_PROBATION);
+	}
+}
+
+const cache_policy cache_policy_lru = { "LRU", lru_insert, lru_touch };
+const cache_policy cache_policy_slru = { "SLRU", slru_insert, slru_touch };
+
 #ifdef FASTER_MAP_LOAD
 // Compare two cache items by name. NULL pointer always go beyond "real" items.
 static int cache_item_cmp(const void* i, const void *j)
@@ -60,6 +150,7 @@ static int cache_item_cmp_str(const void* str, const void *iptr)
 void cache_system_init(Uint32 max_items)
 {
 	cache_system = cache_init("", max_items, &cache_delete);
+	cache_set_policy(cache_system, &cache_policy_lru);
 	cache_set_time_limit(cache_system, 1*60*1000);	// once per minute check for processing
 }
 
@@ -113,33 +204,60 @@ void cache_dump_sizes(const cache_struct *cache)
 		}
 	}
 }
-#endif	/* ELC */
 
-void cache_system_maint()
+void cache_dump_stats(void)
 {
-	if (!cur_time || !cache_system || !cache_system->time_limit
-		|| cache_system->LRU_time+cache_system->time_limit > cur_time)
+	char str[256];
+	const cache_item_struct *item;
+	const cache_struct *cache;
+	Uint32 limit;
+	Sint32 i;
+
+	if (!cache_system || !cache_system->cached_items)
 		return;
-	//clean anything we can delete
-	cache_system_clean();
-	//do an automated memory compaction
-	cache_system_compact();
-	//actually done already, just forcing it to assist in debugging
-	cache_system->LRU_time = cur_time;
+
+#ifdef FASTER_MAP_LOAD
+	for (i = 0; i < cache_system->num_items; i++)
+#else
+	for (i = 0; i < cache_system->max_item; i++)
+#endif
+	{
+		item = cache_system->cached_items[i];
+		if (!item || !item->cache_item)
+			continue;
+		cache = item->cache_item;
+		limit = cache_get_size_limit(cache);
+		safe_snprintf(str, sizeof(str),
+			"%s (%s): %d items, %uK of %uK, %.1f%% hits, %u evictions (%uK)",
+			cache->name, cache->policy->name, cache->num_items,
+			cache->total_size / 1024, limit / 1024,
+			cache->hits + cache->misses > 0 ?
+				100.0 * cache->hits / (cache->hits + cache->misses) : 0.0,
+			cache->evictions, (Uint32)(cache->evicted_size / 1024));
+		put_colored_text_in_buffer(c_yellow1, CHAT_SERVER, (unsigned char*)str, -1);
+#ifdef MAP_EDITOR2
+		log_error(str);
+#else
+		write_to_log(CHAT_SERVER, (unsigned char*)str, strlen(str));
+#endif
+	}
 }
+#endif	/* ELC */
 
-static Uint32 cache_system_clean()
+void cache_system_maint()
 {
 	cache_item_struct *item;
 	Sint32 i;
-	Uint32 mem_freed = 0;
 
-	if (!cache_system || !cache_system->time_limit
-		|| !cache_system->cached_items) return 0;
+	if (!cur_time || !cache_system || !cache_system->cached_items)
+		return;
 	// make sure we are in a safe place
 #ifdef	ELC
-	if ( !get_show_window (game_root_win) ) return 0;
+	if ( !get_show_window (game_root_win) ) return;
 #endif	/* ELC */
+
+	// checking the budgets is cheap, the caches are walked from their
+	// least recently used end only while they are too big
 #ifdef FASTER_MAP_LOAD
 	for (i = 0; i < cache_system->num_items; i++)
 #else
@@ -148,16 +266,19 @@ static Uint32 cache_system_clean()
 	{
 		item = cache_system->cached_items[i];
 		if (item && item->cache_item)
-			mem_freed += cache_clean(item->cache_item);
+			cache_trim(item->cache_item);
 	}
 
-	//adjust the LRU time-stamp
+	if (!cache_system->time_limit
+		|| cache_system->LRU_time+cache_system->time_limit > cur_time)
+		return;
+	//clean anything we can delete and compact the rest
+	cache_system_clean();
+	//actually done already, just forcing it to assist in debugging
 	cache_system->LRU_time = cur_time;
-	//return how much memory was freed
-	return mem_freed;
 }
 
-static Uint32 cache_system_compact()
+static Uint32 cache_system_clean()
 {
 	cache_item_struct *item;
 	Sint32 i;
@@ -165,7 +286,6 @@ static Uint32 cache_system_compact()
 
 	if (!cache_system || !cache_system->time_limit
 		|| !cache_system->cached_items) return 0;
-
 #ifdef FASTER_MAP_LOAD
 	for (i = 0; i < cache_system->num_items; i++)
 #else
@@ -174,7 +294,7 @@ static Uint32 cache_system_compact()
 	{
 		item = cache_system->cached_items[i];
 		if (item && item->cache_item)
-			mem_freed += cache_compact(item->cache_item);
+			mem_freed += cache_clean(item->cache_item);
 	}
 
 	//adjust the LRU time-stamp
@@ -206,6 +326,8 @@ cache_struct *cache_init(const char* name, Uint32 max_items,
 	cache->size_limit = 0;	// 0 == no space based LRU check
 	cache->free_item = free_item;
 	cache->compact_item = NULL;
+	cache->name = name;
+	cache->policy = &cache_policy_slru;
 	if (cache_system)
 	{
 		cache_add_item(cache_system, name, cache,
@@ -258,80 +380,88 @@ void cache_set_size_limit(cache_struct *cache, Uint32 size_limit)
 	cache->size_limit=size_limit;
 }
 
+void cache_set_budget(cache_struct *cache, const int *budget)
+{
+	cache->budget = budget;
+}
+
+void cache_set_policy(cache_struct *cache, const cache_policy *policy)
+{
+	cache->policy = policy;
+}
+
 void cache_set_free(cache_struct *cache, void (*free_item)())
 {
 	cache->free_item = free_item;
 }
 
-static Uint32 cache_clean(cache_struct *cache)
+static void cache_adj_item_size(cache_struct *cache, cache_item_struct *item, Uint32 size)
 {
-	cache_item_struct *item;
-	Sint32 i;
-	Uint32 mem_freed = 0;
+	cache->total_size += size;
+	if (item->segment != CACHE_SEGMENT_NONE)
+		cache->segment_size[item->segment] += size;
+	if (cache != cache_system)
+		cache_adj_size(cache_system, size, cache);
+	item->size += size;
+}
 
-	if (!cache->cached_items || !cache->time_limit || !cache->free_item)
+// frees or compacts the item, returns how much memory that gave back
+static Uint32 cache_evict(cache_struct *cache, cache_item_struct *item)
+{
+	Uint32 freed;
+
+	if (cache->free_item)
+	{
+		freed = item->size;
+		cache_remove(cache, item);
+	}
+	else if (cache->compact_item)
+	{
+		cache_unlink(cache, item);
+		freed = (*cache->compact_item)(item->cache_item);
+		cache_adj_item_size(cache, item, -freed);
+	}
+	else
+	{
 		return 0;
+	}
 
-#ifdef FASTER_MAP_LOAD
-	for (i = cache->num_items-1; i >= 0; i--)
-#else
-	for (i = 0; i < cache->max_item; i++)
-#endif
+	cache->evictions++;
+	cache->evicted_size += freed;
+	return freed;
+}
+
+// Evicts from the least recently used end of a segment the items that were
+// not used for idle_time, until the cache fits into limit (0 for no limit).
+static Uint32 cache_evict_segment(cache_struct *cache, Uint32 segment,
+	Uint32 idle_time, Uint32 limit)
+{
+	cache_item_struct *item, *prev;
+	Uint32 mem_freed = 0;
+
+	for (item = cache->tail[segment]; item; item = prev)
 	{
-		item = cache->cached_items[i];
-		if (item && item->cache_item)
-		{
-			// decide if this entry needs to be cleaned
-			if (item->access_count == 0
-				&& item->access_time + cache->time_limit < cur_time)
-			{
-				cache_remove(cache, item);
-				mem_freed += item->size;
-			}
-			//item->access_count=0;
-		}
+		prev = item->prev;
+		if (limit && cache->total_size <= limit)
+			break;
+		if (item->access_time + idle_time >= cur_time)
+			break;
+		mem_freed += cache_evict(cache, item);
 	}
 
-	//adjust the LRU time-stamp
-	cache->LRU_time = cur_time;
-	//return how much memory was freed
 	return mem_freed;
 }
 
-static Uint32 cache_compact(cache_struct *cache)
+static Uint32 cache_clean(cache_struct *cache)
 {
-	cache_item_struct *item;
-	Sint32 i;
-	Uint32 freed;
-	Uint32 mem_freed=0;
+	Uint32 mem_freed = 0;
 
-	if (!cache->cached_items || !cache->time_limit || !cache->compact_item)
+	if (!cache->cached_items || !cache->time_limit
+		|| (!cache->free_item && !cache->compact_item))
 		return 0;
 
-#ifdef FASTER_MAP_LOAD
-	for (i = 0; i < cache->num_items; i++)
-#else
-	for (i = 0; i < cache->max_item; i++)
-#endif
-	{
-		item = cache->cached_items[i];
-		if (item && item->cache_item)
-		{
-			//decide if this entry needs to be cleaned
-			if (item->access_count == 0
-				&& item->access_time + cache->time_limit < cur_time)
-			//if(cache->cached_items[i]->access_time+cache->time_limit < cur_time)
-			{
-				freed = (*cache->compact_item)(cache->cached_items[i]->cache_item);
-				mem_freed += freed;
-				cache_adj_size(cache, -freed, cache->cached_items[i]->cache_item);
-			}
-			else
-			{
-				cache->cached_items[i]->access_count = 0;	// clear the counter
-			}
-		}
-	}
+	mem_freed += cache_evict_segment(cache, CACHE_SEGMENT_PROBATION, cache->time_limit, 0);
+	mem_freed += cache_evict_segment(cache, CACHE_SEGMENT_PROTECTED, cache->time_limit, 0);
 
 	//adjust the LRU time-stamp
 	cache->LRU_time = cur_time;
@@ -339,6 +469,34 @@ static Uint32 cache_compact(cache_struct *cache)
 	return mem_freed;
 }
 
+static Uint32 cache_trim(cache_struct *cache)
+{
+	Uint32 limit;
+	Uint32 mem_freed = 0;
+
+	limit = cache_get_size_limit(cache);
+	if (!cache->cached_items || !limit || cache->total_size <= limit)
+		return 0;
+
+	mem_freed += cache_evict_segment(cache, CACHE_SEGMENT_PROBATION, CACHE_MIN_IDLE_TIME, limit);
+	mem_freed += cache_evict_segment(cache, CACHE_SEGMENT_PROTECTED, CACHE_MIN_IDLE_TIME, limit);
+
+	return mem_freed;
+}
+
+void cache_touch(cache_item_struct *item_ptr)
+{
+	cache_struct *cache = item_ptr->cache;
+
+	item_ptr->access_time = cur_time;
+	if (!cache)
+		return;
+	if (item_ptr->segment == CACHE_SEGMENT_NONE)
+		cache->misses++;
+	else
+		cache->hits++;
+	cache->policy->touch(cache, item_ptr);
+}
 
 #ifndef	USE_INLINE
 // detailed items
@@ -346,8 +504,12 @@ void cache_use(cache_item_struct *item_ptr)
 {
 	if (item_ptr)
 	{
-		item_ptr->access_time = cur_time;
 		item_ptr->access_count++;
+		// the item is only moved in the LRU lists once per frame
+		if ((item_ptr->access_time == cur_time) && (item_ptr->segment != CACHE_SEGMENT_NONE))
+			item_ptr->cache->hits++;
+		else
+			cache_touch(item_ptr);
 	}
 }
 #endif	//USE_INLINE
@@ -376,7 +538,10 @@ cache_item_struct *cache_find(cache_struct *cache, const char *name)
 	item = bsearch(name, cache->cached_items, cache->num_items,
 		sizeof(cache_item_struct*), cache_item_cmp_str);
 	if (!item)
+	{
+		cache->misses++;
 		return NULL;
+	}
 	cache_use(*item);
 	cache->recent_item = *item;
 	return *item;
@@ -393,6 +558,7 @@ cache_item_struct *cache_find(cache_struct *cache, const char *name)
 		}
 	}
 
+	cache->misses++;
 	return NULL;
 #endif
 }
@@ -465,6 +631,8 @@ cache_item_struct *cache_add_item(cache_struct *cache, const char* name,
 	new_item->name = name;
 	new_item->access_time = cur_time;
 	new_item->access_count = 1;	//start at 0 or 1? Is this a usage
+	new_item->cache = cache;
+	cache->policy->insert(cache, new_item);
 
 	for (i = 0; i < cache->num_items; i++)
 	{
@@ -516,6 +684,8 @@ cache_item_struct *cache_add_item(cache_struct *cache, const char* name,
 	cache->cached_items[i]->name=name;
 	cache->cached_items[i]->access_time=cur_time;
 	cache->cached_items[i]->access_count=1;	//start at 0 or 1? Is this a usage
+	cache->cached_items[i]->cache=cache;
+	cache->policy->insert(cache, cache->cached_items[i]);
 	cache->num_items++;
 	cache->total_size+=size;
 	if(cache != cache_system) cache_adj_size(cache_system, size, cache);
@@ -544,13 +714,7 @@ void cache_adj_size(cache_struct *cache, Uint32 size, void *item)
 	if (item_ptr)
 	{
 		// adjust the current size
-		//if(item_ptr->size != size)
-		//{
-			cache->total_size += size;
-			if (cache != cache_system)
-				cache_adj_size(cache_system, size, cache);
-		//}
-		item_ptr->size += size;
+		cache_adj_item_size(cache, item_ptr, size);
 		cache_use(item_ptr);
 		//item_ptr->access_time=cur_time;
 		//item_ptr->access_count++;
@@ -561,6 +725,7 @@ static void cache_remove(cache_struct *cache, cache_item_struct *item)
 {
 	if (!item || !cache->cached_items)
 		return;		//nothing to do
+	cache_unlink(cache, item);
 	if (cache != cache_system)
 		cache_adj_size(cache_system, -item->size, cache);
 	if (item->cache_item && cache->free_item)
@@ -13,22 +13,50 @@
 extern "C" {
 #endif
 
+struct cache_struct;
+
 /*!
  * a single item storable in the cache
  */
-typedef struct
+typedef struct cache_item_struct
 {
 	void	*cache_item;	/*!< pointer to the item we are caching */
 	Uint32	size;			/*!< size of item */
 	Uint32	access_time;	/*!< last time used */
 	Uint32	access_count;	/*!< number of usages since last checkpoint */
 	const char *name;	/*!< original source or name, NOTE: this is NOT free()'d and allows dups! */
+	struct cache_item_struct *prev;	/*!< the more recently used item of the same segment */
+	struct cache_item_struct *next;	/*!< the less recently used item of the same segment */
+	struct cache_struct *cache;	/*!< the cache holding the item */
+	Uint32	segment;		/*!< the LRU segment the item is in */
 } cache_item_struct;
 
 /*!
- * structure of the cache used
+ * \name LRU segments
+ */
+/*! @{ */
+#define	CACHE_SEGMENT_NONE	0 /*!< compacted, the item is in no list until it is used again */
+#define	CACHE_SEGMENT_PROBATION	1 /*!< used in a single frame since it was loaded */
+#define	CACHE_SEGMENT_PROTECTED	2 /*!< used again later, kept longer */
+#define	CACHE_SEGMENTS		3
+/*! @} */
+
+/*!
+ * the eviction policy of a cache, it decides where items go in the LRU
+ * segments. Items are compacted from the tail of the probation segment
+ * first, then from the tail of the protected one.
  */
 typedef struct
+{
+	const char *name;	/*!< name of the policy */
+	void	(*insert)(struct cache_struct *cache, cache_item_struct *item);	/*!< links a new item */
+	void	(*touch)(struct cache_struct *cache, cache_item_struct *item);	/*!< relinks an item that was used again */
+} cache_policy;
+
+/*!
+ * structure of the cache used
+ */
+typedef struct cache_struct
 {
 	cache_item_struct	**cached_items; /*!< list of cached items */
 	cache_item_struct	*recent_item; /*!< pointer to the last used item */
@@ -44,6 +72,16 @@ typedef struct
 	Uint32	size_limit;		/*!< limit on size before forcing a scan */
 	void	(*free_item)();	/*!< routine to call to free an item */
 	Uint32	(*compact_item)();	/*!< routine to call to reduce memory usage without freeing */
+	const char *name;		/*!< name of the cache */
+	const cache_policy *policy;	/*!< the eviction policy */
+	cache_item_struct	*head[CACHE_SEGMENTS];	/*!< the most recently used item of each segment */
+	cache_item_struct	*tail[CACHE_SEGMENTS];	/*!< the least recently used item of each segment */
+	Uint32	segment_size[CACHE_SEGMENTS];	/*!< size of the items in each segment */
+	const int	*budget;	/*!< memory budget in MB, overrides \a size_limit if set and not 0 */
+	Uint64	hits;			/*!< uses of items that were in memory */
+	Uint64	misses;			/*!< uses of compacted items and failed lookups */
+	Uint32	evictions;		/*!< number of items compacted or freed */
+	Uint64	evicted_size;		/*!< bytes given back by the evictions */
 } cache_struct;
 
 #ifndef	NEW_TEXTURES
@@ -71,6 +109,12 @@ typedef struct
 extern cache_struct	*cache_system; /*!< system cache */
 extern cache_struct	*cache_e3d; /*!< e3d cache */
 
+extern const cache_policy cache_policy_lru; /*!< a single LRU list */
+extern const cache_policy cache_policy_slru; /*!< segmented LRU, items used again are protected, the default */
+
+extern int texture_cache_budget; /*!< memory budget of the texture cache in MB, 0 for none */
+extern int e3d_cache_budget; /*!< memory budget of the e3d cache in MB, 0 for none */
+
 //proto
 
 /*!
@@ -107,6 +151,17 @@ void cache_system_maint(void);
  * \callgraph
  */
 void cache_dump_sizes(const cache_struct *cache);
+
+/*!
+ * \ingroup cache
+ * \brief dumps the statistics of all caches.
+ *
+ *      Dumps the size, budget, hit rate and evictions of every cache to the
+ *      console.
+ *
+ * \callgraph
+ */
+void cache_dump_stats(void);
 #endif	/* ELC */
 
 /*!
@@ -157,6 +212,32 @@ void cache_set_time_limit(cache_struct *cache, Uint32 time_limit);
  */
 void cache_set_size_limit(cache_struct *cache, Uint32 size_limit);
 
+/*!
+ * \ingroup cache
+ * \brief   sets a memory budget for \a cache.
+ *
+ *      Makes \a cache use the variable \a budget (in MB) as its size limit,
+ *      so changing the variable takes effect at the next maintenance.
+ *      Items that weren't used for a few seconds are compacted, least
+ *      recently used first, while the cache is over the budget.
+ *
+ * \param cache         the cache for which the budget should be set.
+ * \param budget        the variable holding the budget, 0 for none.
+ */
+void cache_set_budget(cache_struct *cache, const int *budget);
+
+/*!
+ * \ingroup cache
+ * \brief   sets the eviction policy of \a cache.
+ *
+ *      Sets the eviction \a policy of \a cache. Has to be called before
+ *      any item is added.
+ *
+ * \param cache         the cache for which the policy should be set.
+ * \param policy        the policy, \see cache_policy_lru and \see cache_policy_slru.
+ */
+void cache_set_policy(cache_struct *cache, const cache_policy *policy);
+
 /*!
  * \ingroup cache
  * \brief   sets the function to free items
@@ -217,6 +298,7 @@ void cache_adj_size(cache_struct *cache, Uint32 size, void *item);
  * \brief   update the last use time of a cache item
  *
  *      Sets the time a cache item was accessed last to the current time
+ *      and moves it to the front of its LRU segment, in constant time.
  *
  * \param item      the item for which to set the access time
  */
@@ -225,12 +307,18 @@ void cache_use(cache_item_struct *item);
 #else	//USE_INLINE
 #include "global.h"
 
+void cache_touch(cache_item_struct *item_ptr);
+
 static __inline__ void	cache_use(cache_item_struct *item_ptr)
 {
 	if (item_ptr)
 	{
-		item_ptr->access_time = cur_time;
 		item_ptr->access_count++;
+		// the item is only moved in the LRU lists once per frame
+		if ((item_ptr->access_time == cur_time) && (item_ptr->segment != CACHE_SEGMENT_NONE))
+			item_ptr->cache->hits++;
+		else
+			cache_touch(item_ptr);
 	}
 }
 #endif	//USE_INLINE
@@ -827,6 +827,25 @@ CHECK_GL_ERRORS();
 #endif //OPENGL_TRACE
 }
 
+void cal_update_actor_skeleton(actor *act, int force)
+{
+	if (act->calmodel == NULL || !act->skeleton_outdated)
+		return;
+	if (!force && act->anim_lod == ANIM_LOD_REDUCED)
+		return;
+
+	// the mixer time is already current, this only evaluates the pose
+	CalModel_Update(act->calmodel, 0.0f);
+	act->skeleton_outdated = 0;
+	act->last_skeleton_update = cur_time;
+	build_actor_bounding_box(act);
+	missiles_rotate_actor_bones(act);
+	if (use_animation_program)
+	{
+		set_transformation_buffers(act);
+	}
+}
+
 void cal_get_actor_bone_local_position(actor *in_act, int in_bone_id, float *in_shift, float *out_pos)
 {
 	struct CalSkeleton *skel;
@@ -835,6 +854,8 @@ void cal_get_actor_bone_local_position(actor *in_act, int in_bone_id, float *in_
 
     if (in_bone_id < 0) return;
 
+	cal_update_actor_skeleton(in_act, 1);
+
 	skel = CalModel_GetSkeleton(in_act->calmodel);
 
     if (in_bone_id >= CalSkeleton_GetBonesNumber(skel)) return;
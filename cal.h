@@ -49,6 +49,23 @@ struct cal_anim cal_load_anim(actor_types *act, const char *str, int duration);
 void cal_actor_set_anim_delay(int id, struct cal_anim anim, float delay);
 void cal_actor_set_anim(int id, struct cal_anim anim);
 
+#define ANIM_LOD_FULL		0	/*!< the skeleton is evaluated every frame */
+#define ANIM_LOD_REDUCED	1	/*!< distant actor, the skeleton is evaluated a few times per second */
+#define ANIM_LOD_HIDDEN		2	/*!< off-screen actor, only the animation time is advanced */
+
+/*!
+ * \brief Brings the skeleton of an actor up to date with its animation time
+ *
+ *      animate_actors skips the skeleton of actors that are off-screen or
+ *      far away and only advances their animation time. Code that needs the
+ *      bones calls this first. The bone position functions below do it
+ *      themselves.
+ *
+ * \param act the actor
+ * \param force 0 to let a distant actor keep lagging behind, 1 to always catch up
+ */
+void cal_update_actor_skeleton(actor *act, int force);
+
 /*!
  * \brief Gets the local position of char bone
  * \param in_act the actor
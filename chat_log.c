@@ -0,0 +1,575 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <SDL.h>
+#include <SDL_thread.h>
+#include "chat_log.h"
+#include "asc.h"
+#include "elconfig.h"
+#include "errors.h"
+#include "text.h"
+#include "threads.h"
+#include "io/elpathwrapper.h"
+
+int chat_log_flush_interval = 2;
+int chat_log_max_size = 0;
+
+/* Once this much is queued the writer is woken early, no need to wait for
+ * the flush interval. */
+#define CHAT_LOG_WAKE_SIZE	(32 * 1024)
+
+/* Index records are 16 bytes, little endian: time, offset and length of the
+ * line in the log, the channel and three bytes of padding. */
+#define CHAT_LOG_RECORD_SIZE	16
+#define CHAT_LOG_SEARCH_RECORDS	1024
+#define CHAT_LOG_SEARCH_SPAN	(256 * 1024)
+#define CHAT_LOG_SEARCH_RESULTS	10
+#define CHAT_LOG_RESULT_LEN	256
+
+typedef struct
+{
+	Uint32 time;
+	Uint32 length;
+	Uint8 channel;
+} log_line;
+
+typedef struct
+{
+	char *data;
+	size_t len;
+	size_t size;
+	log_line *lines;
+	int nr_lines;
+	int max_lines;
+} log_buffer;
+
+typedef struct
+{
+	FILE *file;
+	FILE *index;
+	char base[64];	// the file name without extension
+	int month;	// YYYYMM the file was opened for, 0 without rotation
+	Uint32 size;	// bytes in the log file
+	int is_open;	// main thread view of file != NULL
+	log_buffer pending;	// filled by the main thread, protected by pending_mutex
+	log_buffer writing;	// protected by file_mutex
+} log_stream;
+
+static log_stream streams[2];
+static SDL_mutex *pending_mutex = NULL;
+static SDL_mutex *file_mutex = NULL;
+static SDL_cond *wake_writer = NULL;
+static SDL_Thread *writer_thread = NULL;
+static int writer_running = 0;
+/* the month and date stamp of the last queued line, protected by pending_mutex */
+static int current_month = 0;
+static char current_stamp[20] = "";
+/* set while the search prints its results, they should not end up in the log */
+static int suspended = 0;
+
+static void get_base_name(int stream, int month, char *buf, size_t len)
+{
+	const char *name = (stream == CHAT_LOG_SERVER) ? "srv_log" : "chat_log";
+
+	if (month > 0)
+		safe_snprintf(buf, len, "%s_%06d", name, month);
+	else
+		safe_strncpy(buf, name, len);
+}
+
+static void put_uint32(unsigned char *buf, Uint32 value)
+{
+	buf[0] = value & 0xFF;
+	buf[1] = (value >> 8) & 0xFF;
+	buf[2] = (value >> 16) & 0xFF;
+	buf[3] = (value >> 24) & 0xFF;
+}
+
+static Uint32 get_uint32(const unsigned char *buf)
+{
+	return buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((Uint32)buf[3] << 24);
+}
+
+/* Opens the log and its index. An index that does not fit the log any more,
+ * because the log was edited or a record was only half written, is started
+ * again from scratch. Called with file_mutex held. */
+static int open_stream(log_stream *s, int stream, int month)
+{
+	char name[80];
+	FILE *index;
+	long index_size;
+	int index_valid = 1;
+
+	get_base_name(stream, month, s->base, sizeof(s->base));
+	s->month = month;
+
+	safe_snprintf(name, sizeof(name), "%s.txt", s->base);
+	// binary, the index offsets are byte counts of the lines as queued
+	s->file = open_file_config(name, "ab");
+	if (s->file == NULL)
+		return 0;
+	fseek(s->file, 0, SEEK_END);
+	s->size = ftell(s->file);
+
+	safe_snprintf(name, sizeof(name), "%s.idx", s->base);
+	index = open_file_config(name, "rb");
+	if (index != NULL)
+	{
+		unsigned char record[CHAT_LOG_RECORD_SIZE];
+
+		fseek(index, 0, SEEK_END);
+		index_size = ftell(index);
+		if (index_size % CHAT_LOG_RECORD_SIZE != 0)
+			index_valid = 0;
+		else if (index_size > 0)
+		{
+			fseek(index, index_size - CHAT_LOG_RECORD_SIZE, SEEK_SET);
+			if (fread(record, sizeof(record), 1, index) != 1
+				|| get_uint32(record + 4) + get_uint32(record + 8) > s->size)
+				index_valid = 0;
+		}
+		fclose(index);
+	}
+	s->index = open_file_config(name, index_valid ? "ab" : "wb");
+	if (s->index == NULL)
+		LOG_ERROR("Unable to open %s, the log will not be searchable", name);
+
+	return 1;
+}
+
+static void close_stream(log_stream *s)
+{
+	if (s->file != NULL)
+		fclose(s->file);
+	if (s->index != NULL)
+		fclose(s->index);
+	s->file = NULL;
+	s->index = NULL;
+}
+
+/* Starts a new file when the month changed (with log rotation on) or the
+ * size limit is reached; in the latter case the full log and its index are
+ * renamed with a date stamp first. Called with file_mutex held. */
+static void rotate_stream(log_stream *s, int stream, int month, const char *stamp)
+{
+	if (s->file == NULL)
+		return;
+
+	if (s->month > 0 && month > 0 && month != s->month)
+	{
+		close_stream(s);
+		if (!open_stream(s, stream, month))
+			LOG_ERROR("Unable to open %s.txt, logging stopped", s->base);
+	}
+	else if (chat_log_max_size > 0 && s->size >= (Uint32)chat_log_max_size * 1024 * 1024)
+	{
+		char old_name[80], new_name[100];
+
+		close_stream(s);
+		safe_snprintf(old_name, sizeof(old_name), "%s.txt", s->base);
+		safe_snprintf(new_name, sizeof(new_name), "%s_%s.txt", s->base, stamp);
+		file_rename_config(old_name, new_name);
+		safe_snprintf(old_name, sizeof(old_name), "%s.idx", s->base);
+		safe_snprintf(new_name, sizeof(new_name), "%s_%s.idx", s->base, stamp);
+		file_rename_config(old_name, new_name);
+		if (!open_stream(s, stream, s->month))
+			LOG_ERROR("Unable to open %s.txt, logging stopped", s->base);
+	}
+}
+
+/* Writes a buffer in one go, adds its lines to the index and flushes both
+ * files. Called with file_mutex held. */
+static void write_buffer(log_stream *s, log_buffer *b)
+{
+	unsigned char records[CHAT_LOG_RECORD_SIZE * 64];
+	Uint32 offset = s->size;
+	int i, nr_records = 0;
+
+	if (s->file == NULL || b->len == 0)
+	{
+		b->len = 0;
+		b->nr_lines = 0;
+		return;
+	}
+
+	fwrite(b->data, b->len, 1, s->file);
+	s->size += b->len;
+
+	for (i = 0; i < b->nr_lines; i++)
+	{
+		if (s->index != NULL && b->lines[i].channel != CHAT_LOG_NO_CHANNEL)
+		{
+			unsigned char *record = records + nr_records * CHAT_LOG_RECORD_SIZE;
+
+			put_uint32(record, b->lines[i].time);
+			put_uint32(record + 4, offset);
+			put_uint32(record + 8, b->lines[i].length);
+			record[12] = b->lines[i].channel;
+			record[13] = record[14] = record[15] = 0;
+			if (++nr_records * CHAT_LOG_RECORD_SIZE >= sizeof(records))
+			{
+				fwrite(records, CHAT_LOG_RECORD_SIZE, nr_records, s->index);
+				nr_records = 0;
+			}
+		}
+		offset += b->lines[i].length;
+	}
+	if (nr_records > 0)
+		fwrite(records, CHAT_LOG_RECORD_SIZE, nr_records, s->index);
+
+	// Flush the files, so the content is written even when EL crashes.
+	fflush(s->file);
+	if (s->index != NULL)
+		fflush(s->index);
+
+	b->len = 0;
+	b->nr_lines = 0;
+}
+
+/* Takes everything queued so far and writes it out. Safe to call from any
+ * thread; lock order is file_mutex before pending_mutex. */
+static void flush_streams(void)
+{
+	log_buffer tmp;
+	char stamp[sizeof(current_stamp)];
+	int month, i;
+
+	if (file_mutex == NULL)
+		return;
+
+	CHECK_AND_LOCK_MUTEX(file_mutex);
+	CHECK_AND_LOCK_MUTEX(pending_mutex);
+	for (i = 0; i < 2; i++)
+	{
+		tmp = streams[i].writing;
+		streams[i].writing = streams[i].pending;
+		streams[i].pending = tmp;
+	}
+	month = current_month;
+	safe_strncpy(stamp, current_stamp, sizeof(stamp));
+	CHECK_AND_UNLOCK_MUTEX(pending_mutex);
+
+	for (i = 0; i < 2; i++)
+	{
+		if (streams[i].writing.len > 0)
+		{
+			rotate_stream(&streams[i], i, month, stamp);
+			write_buffer(&streams[i], &streams[i].writing);
+		}
+	}
+	CHECK_AND_UNLOCK_MUTEX(file_mutex);
+}
+
+static int chat_log_writer(void *unused)
+{
+	CHECK_AND_LOCK_MUTEX(pending_mutex);
+	while (writer_running)
+	{
+		int interval = chat_log_flush_interval > 0 ? chat_log_flush_interval : 1;
+
+		SDL_CondWaitTimeout(wake_writer, pending_mutex, interval * 1000);
+		CHECK_AND_UNLOCK_MUTEX(pending_mutex);
+		flush_streams();
+		CHECK_AND_LOCK_MUTEX(pending_mutex);
+	}
+	CHECK_AND_UNLOCK_MUTEX(pending_mutex);
+
+	return 0;
+}
+
+static void start_writer(void)
+{
+	if (writer_thread != NULL || chat_log_flush_interval <= 0)
+		return;
+
+	writer_running = 1;
+	writer_thread = SDL_CreateThread(chat_log_writer, NULL);
+	if (writer_thread == NULL)
+	{
+		// keep logging, just synchronously
+		LOG_ERROR("Unable to start the chat log writer: %s", SDL_GetError());
+		writer_running = 0;
+		chat_log_flush_interval = 0;
+	}
+}
+
+static void stop_writer(void)
+{
+	if (writer_thread == NULL)
+		return;
+
+	CHECK_AND_LOCK_MUTEX(pending_mutex);
+	writer_running = 0;
+	SDL_CondSignal(wake_writer);
+	CHECK_AND_UNLOCK_MUTEX(pending_mutex);
+	SDL_WaitThread(writer_thread, NULL);
+	writer_thread = NULL;
+}
+
+static void free_buffer(log_buffer *b)
+{
+	free(b->data);
+	free(b->lines);
+	memset(b, 0, sizeof(log_buffer));
+}
+
+static int get_month(const struct tm *l_time)
+{
+	return get_rotate_chat_log() ? (l_time->tm_year + 1900) * 100 + l_time->tm_mon + 1 : 0;
+}
+
+int chat_log_open(int with_server_log)
+{
+	struct tm *l_time;
+	time_t c_time;
+	int month;
+
+	if (file_mutex == NULL)
+	{
+		file_mutex = SDL_CreateMutex();
+		pending_mutex = SDL_CreateMutex();
+		wake_writer = SDL_CreateCond();
+	}
+
+	time(&c_time);
+	l_time = localtime(&c_time);
+	month = get_month(l_time);
+
+	CHECK_AND_LOCK_MUTEX(file_mutex);
+	close_stream(&streams[CHAT_LOG_CHAT]);
+	close_stream(&streams[CHAT_LOG_SERVER]);
+	streams[CHAT_LOG_CHAT].is_open = open_stream(&streams[CHAT_LOG_CHAT], CHAT_LOG_CHAT, month);
+	streams[CHAT_LOG_SERVER].is_open = with_server_log
+		&& open_stream(&streams[CHAT_LOG_SERVER], CHAT_LOG_SERVER, month);
+	CHECK_AND_UNLOCK_MUTEX(file_mutex);
+
+	if (streams[CHAT_LOG_CHAT].is_open)
+		start_writer();
+
+	return streams[CHAT_LOG_CHAT].is_open;
+}
+
+int chat_log_is_open(int stream)
+{
+	return streams[stream].is_open;
+}
+
+void chat_log_write(int stream, Uint8 channel, const char *text, int len)
+{
+	log_stream *s = &streams[stream];
+	log_buffer *b = &s->pending;
+	struct tm *l_time;
+	time_t c_time;
+	int wake;
+
+	if (!s->is_open || suspended || len <= 0)
+		return;
+
+	time(&c_time);
+	l_time = localtime(&c_time);
+
+	CHECK_AND_LOCK_MUTEX(pending_mutex);
+	if (b->len + len > b->size)
+	{
+		b->size = b->size ? b->size : 4096;
+		while (b->len + len > b->size)
+			b->size *= 2;
+		b->data = realloc(b->data, b->size);
+	}
+	if (b->nr_lines >= b->max_lines)
+	{
+		b->max_lines = b->max_lines ? b->max_lines * 2 : 64;
+		b->lines = realloc(b->lines, b->max_lines * sizeof(log_line));
+	}
+	memcpy(b->data + b->len, text, len);
+	b->len += len;
+	b->lines[b->nr_lines].time = (Uint32)c_time;
+	b->lines[b->nr_lines].length = len;
+	b->lines[b->nr_lines].channel = channel;
+	b->nr_lines++;
+	current_month = get_month(l_time);
+	strftime(current_stamp, sizeof(current_stamp), "%Y%m%d-%H%M%S", l_time);
+	wake = b->len >= CHAT_LOG_WAKE_SIZE;
+	CHECK_AND_UNLOCK_MUTEX(pending_mutex);
+
+	if (chat_log_flush_interval <= 0)
+	{
+		flush_streams();
+	}
+	else
+	{
+		start_writer();
+		if (wake)
+			SDL_CondSignal(wake_writer);
+	}
+}
+
+void chat_log_flush(void)
+{
+	flush_streams();
+}
+
+void chat_log_close(void)
+{
+	int i;
+
+	if (file_mutex == NULL)
+		return;
+
+	stop_writer();
+	flush_streams();
+	for (i = 0; i < 2; i++)
+	{
+		close_stream(&streams[i]);
+		streams[i].is_open = 0;
+		free_buffer(&streams[i].pending);
+		free_buffer(&streams[i].writing);
+	}
+	SDL_DestroyCond(wake_writer);
+	SDL_DestroyMutex(pending_mutex);
+	SDL_DestroyMutex(file_mutex);
+	wake_writer = NULL;
+	pending_mutex = NULL;
+	file_mutex = NULL;
+}
+
+/* Walks the index of one stream backwards, newest line first, and collects
+ * up to max_results lines containing the needle. Lines referenced by a
+ * block of index records are usually close together in the log, so they
+ * are read with one fread where possible. Called with file_mutex held. */
+static int search_stream(log_stream *s, const char *needle, int needle_len,
+	char results[][CHAT_LOG_RESULT_LEN], int max_results)
+{
+	unsigned char *records;
+	char *span, *line;
+	char name[80];
+	FILE *index, *file;
+	long nr_records;
+	int found = 0;
+
+	safe_snprintf(name, sizeof(name), "%s.idx", s->base);
+	index = open_file_config(name, "rb");
+	safe_snprintf(name, sizeof(name), "%s.txt", s->base);
+	file = open_file_config(name, "rb");
+	if (index == NULL || file == NULL)
+	{
+		if (index != NULL)
+			fclose(index);
+		if (file != NULL)
+			fclose(file);
+		return 0;
+	}
+
+	records = malloc(CHAT_LOG_SEARCH_RECORDS * CHAT_LOG_RECORD_SIZE);
+	span = malloc(CHAT_LOG_SEARCH_SPAN);
+
+	fseek(index, 0, SEEK_END);
+	nr_records = ftell(index) / CHAT_LOG_RECORD_SIZE;
+	while (nr_records > 0 && found < max_results)
+	{
+		long count = nr_records < CHAT_LOG_SEARCH_RECORDS ? nr_records : CHAT_LOG_SEARCH_RECORDS;
+		Uint32 first, last;
+		int use_span, i;
+
+		nr_records -= count;
+		fseek(index, nr_records * CHAT_LOG_RECORD_SIZE, SEEK_SET);
+		if (fread(records, CHAT_LOG_RECORD_SIZE, count, index) != (size_t)count)
+			break;
+
+		first = get_uint32(records + 4);
+		last = get_uint32(records + (count - 1) * CHAT_LOG_RECORD_SIZE + 4)
+			+ get_uint32(records + (count - 1) * CHAT_LOG_RECORD_SIZE + 8);
+		use_span = last > first && last - first <= CHAT_LOG_SEARCH_SPAN;
+		if (use_span)
+		{
+			fseek(file, first, SEEK_SET);
+			use_span = fread(span, last - first, 1, file) == 1;
+		}
+
+		for (i = count - 1; i >= 0 && found < max_results; i--)
+		{
+			const unsigned char *record = records + i * CHAT_LOG_RECORD_SIZE;
+			Uint32 offset = get_uint32(record + 4);
+			Uint32 length = get_uint32(record + 8);
+
+			if (length == 0)
+				continue;
+			if (use_span)
+			{
+				line = span + (offset - first);
+			}
+			else
+			{
+				if (length > CHAT_LOG_SEARCH_SPAN)
+					length = CHAT_LOG_SEARCH_SPAN;
+				fseek(file, offset, SEEK_SET);
+				if (fread(span, length, 1, file) != 1)
+					continue;
+				line = span;
+			}
+			if (safe_strcasestr(line, length, needle, needle_len))
+			{
+				int copy = length < CHAT_LOG_RESULT_LEN ? length : CHAT_LOG_RESULT_LEN - 1;
+
+				// drop the newline
+				if (copy > 0 && line[copy-1] == '\n')
+					copy--;
+				memcpy(results[found], line, copy);
+				results[found][copy] = '\0';
+				found++;
+			}
+		}
+	}
+
+	free(span);
+	free(records);
+	fclose(file);
+	fclose(index);
+
+	return found;
+}
+
+int chat_log_search(char *text, int len)
+{
+	char results[CHAT_LOG_SEARCH_RESULTS][CHAT_LOG_RESULT_LEN];
+	char str[128];
+	int stream, found, i;
+
+	while (len > 0 && *text == ' ')
+	{
+		text++;
+		len--;
+	}
+	if (len <= 0)
+	{
+		LOG_TO_CONSOLE(c_red2, "Usage: #logfind <text>, shows the latest logged lines containing text");
+		return 1;
+	}
+	if (!streams[CHAT_LOG_CHAT].is_open)
+	{
+		LOG_TO_CONSOLE(c_red2, "Chat logging is off, there is nothing to search");
+		return 1;
+	}
+
+	chat_log_flush();
+
+	for (stream = 0; stream < 2; stream++)
+	{
+		if (!streams[stream].is_open)
+			continue;
+
+		CHECK_AND_LOCK_MUTEX(file_mutex);
+		found = search_stream(&streams[stream], text, len, results, CHAT_LOG_SEARCH_RESULTS);
+		safe_snprintf(str, sizeof(str), "%d latest matches in %s.txt:", found, streams[stream].base);
+		CHECK_AND_UNLOCK_MUTEX(file_mutex);
+
+		// the results would otherwise be logged again and show up in the next search
+		suspended = 1;
+		LOG_TO_CONSOLE(c_green1, str);
+		for (i = found - 1; i >= 0; i--)
+			LOG_TO_CONSOLE(c_grey1, results[i]);
+		suspended = 0;
+	}
+
+	return 1;
+}
@@ -0,0 +1,102 @@
+/*!
+ * \file
+ * \ingroup text_font
+ * \brief Buffered background writer for the chat and server logs.
+ *
+ *      Log lines are collected in memory and written out by a background
+ *      thread every \ref chat_log_flush_interval seconds, so a busy channel
+ *      does not cost a write and a flush per message on the main thread.
+ *      Every chat line also gets a record in an append-only index next to
+ *      the log, which \ref chat_log_search uses to find recent lines without
+ *      reading the whole file.
+ */
+#ifndef __CHAT_LOG_H__
+#define __CHAT_LOG_H__
+
+#include <SDL_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \name log streams
+ */
+/*! @{ */
+#define CHAT_LOG_CHAT	0
+#define CHAT_LOG_SERVER	1
+/*! @} */
+
+/*! Channel value for lines that are written to the log but not indexed,
+ *  like the "Log started" headers. */
+#define CHAT_LOG_NO_CHANNEL	255
+
+extern int chat_log_flush_interval; /*!< seconds between writes to disk, 0 writes every line immediately */
+extern int chat_log_max_size; /*!< start a new log file once this many megabytes are reached, 0 for no limit */
+
+/*!
+ * \ingroup text_font
+ * \brief Opens the log files.
+ *
+ *      Opens chat_log.txt (or the monthly chat_log_YYYYMM.txt when log
+ *      rotation is on) together with its index, and the server log as well
+ *      if \a with_server_log is set.
+ *
+ * \param with_server_log	also open the server log
+ * \retval int	1 if at least the chat log could be opened, 0 otherwise
+ * \sa chat_log_is_open
+ */
+int chat_log_open(int with_server_log);
+
+/*!
+ * \ingroup text_font
+ * \brief Checks whether a log stream is open.
+ *
+ * \param stream	CHAT_LOG_CHAT or CHAT_LOG_SERVER
+ * \retval int	1 if \a stream can be written to
+ */
+int chat_log_is_open(int stream);
+
+/*!
+ * \ingroup text_font
+ * \brief Queues a line for the log.
+ *
+ *      Queues \a len bytes of \a text, which should be one complete line
+ *      including the trailing newline, for \a stream. The line is written
+ *      by the background thread, or straight away if
+ *      \ref chat_log_flush_interval is 0.
+ *
+ * \param stream	CHAT_LOG_CHAT or CHAT_LOG_SERVER
+ * \param channel	the chat channel of the line, CHAT_LOG_NO_CHANNEL to leave it out of the index
+ * \param text	the line to write
+ * \param len	the length of \a text
+ */
+void chat_log_write(int stream, Uint8 channel, const char *text, int len);
+
+/*!
+ * \ingroup text_font
+ * \brief Writes everything queued so far to disk and waits for it.
+ */
+void chat_log_flush(void);
+
+/*!
+ * \ingroup text_font
+ * \brief Flushes the logs, stops the writer thread and closes the files.
+ */
+void chat_log_close(void);
+
+/*!
+ * \ingroup text_font
+ * \brief Console command: shows the most recent logged lines containing some text.
+ *
+ * \param text	the command line after the command
+ * \param len	the length of \a text
+ * \retval int	1, the command is always handled
+ */
+int chat_log_search(char *text, int len);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // __CHAT_LOG_H__
@@ -10,6 +10,7 @@
 #include "cache.h"
 #include "cal.h"
 #include "chat.h"
+#include "chat_log.h"
 #include "consolewin.h"
 #include "elconfig.h"
 #include "filter.h"
@@ -40,6 +41,17 @@
 #include "counters.h"
 #include "map.h"
 #include "minimap.h"
+#include "missiles.h"
+#ifdef PAWN_BENCHMARK
+#include "pawn/elpawn.h"
+#endif
+#ifdef BOOKS_BENCHMARK
+#include "books.h"
+#endif
+#ifdef RENDER_BENCHMARK
+#include "3d_objects.h"
+#include "tiles.h"
+#endif
 #include "errors.h"
 #include "io/elpathwrapper.h"
 #include "io/elfilewrapper.h"
@@ -936,6 +948,70 @@ int command_mem(char *text, int len)
 #endif	//DEBUG
 	return 1;
 }
+
+int command_cache_stats(char *text, int len)
+{
+	cache_dump_stats();
+	return 1;
+}
+#ifdef MISSILES_DEBUG
+int command_missiles_stress(char *text, int len)
+{
+	char str[100];
+	int count = atoi(text);
+
+	safe_snprintf(str, sizeof(str), "%d missiles added",
+		missiles_stress_test(count > 0 ? count : 500));
+	LOG_TO_CONSOLE(c_green1, str);
+	return 1;
+}
+#endif // MISSILES_DEBUG
+#ifdef PAWN_BENCHMARK
+static void pawn_benchmark_line(const char *line)
+{
+	LOG_TO_CONSOLE(c_green1, line);
+}
+
+int command_pawn_bench(char *text, int len)
+{
+	int iterations = atoi(text);
+
+	run_pawn_benchmarks(iterations > 0 ? iterations : 100000, pawn_benchmark_line);
+	return 1;
+}
+#endif // PAWN_BENCHMARK
+
+#ifdef BOOKS_BENCHMARK
+int command_books_bench(char *text, int len)
+{
+	char str[256];
+
+	benchmark_books(str, sizeof(str));
+	LOG_TO_CONSOLE(c_green1, str);
+	return 1;
+}
+#endif // BOOKS_BENCHMARK
+
+#ifdef RENDER_BENCHMARK
+int command_terrain_bench(char *text, int len)
+{
+	char str[512];
+
+	terrain_benchmark(str, sizeof(str));
+	LOG_TO_CONSOLE(c_green1, str);
+	return 1;
+}
+
+int command_object_stats(char *text, int len)
+{
+	char str[256];
+
+	get_3d_object_stats(str, sizeof(str));
+	LOG_TO_CONSOLE(c_green1, str);
+	return 1;
+}
+#endif // RENDER_BENCHMARK
+
 int command_ver(char *text, int len)
 {
 	char str[250];
@@ -1693,6 +1769,19 @@ add_command("horse", &horse_cmd);
 	add_command("set_neck", &set_neck);
 #endif
 	
+#ifdef MISSILES_DEBUG
+	add_command("missiles_stress", &command_missiles_stress);
+#endif
+#ifdef PAWN_BENCHMARK
+	add_command("pawn_bench", &command_pawn_bench);
+#endif
+#ifdef BOOKS_BENCHMARK
+	add_command("books_bench", &command_books_bench);
+#endif
+#ifdef RENDER_BENCHMARK
+	add_command("terrain_bench", &command_terrain_bench);
+	add_command("object_stats", &command_object_stats);
+#endif
 	add_command("emotes", &print_emotes);
 #ifdef EMOTES_DEBUG
 	add_command("add_emote", &add_emote);
@@ -1719,6 +1808,7 @@ add_command("horse", &horse_cmd);
 	add_command(cmd_exit, &command_quit);
 	add_command("mem", &command_mem);
 	add_command("cache", &command_mem);
+	add_command("cache_stats", &command_cache_stats);
 	add_command("ver", &command_ver);
 	add_command("vers", &command_ver);
 	add_command(cmd_ignores, &list_ignores);
@@ -1744,6 +1834,7 @@ add_command("horse", &horse_cmd);
 	add_command("current_song", &display_song_name);
 #endif // NEW_SOUND
 	add_command("find", &history_grep);
+	add_command("logfind", &chat_log_search);
 	add_command("save", &save_local_data);
 	add_command("url", &url_command);
 	add_command("chat_to_counters", &chat_to_counters_command);
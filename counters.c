@@ -3,6 +3,7 @@
 #include "counters.h"
 #include "context_menu.h"
 #include "asc.h"
+#include "chat_log.h"
 #include "elconfig.h"
 #include "elwindows.h"
 #include "errors.h"
@@ -1302,6 +1303,7 @@ int chat_to_counters_command(const char *text, int len)
 			entries[types[type]] = 0;
 		}
 
+	chat_log_flush();
 	fp = open_file_config ("chat_log.txt", "r");
 
 	/* consume the chat_log file, adding counter entries as they're found */
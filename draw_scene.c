@@ -2,6 +2,7 @@
 #include <math.h>
 #include <string.h>
 #include "draw_scene.h"
+#include "3d_objects.h"
 #include "bbox_tree.h"
 #include "cal.h"
 #include "console.h"
@@ -113,6 +114,10 @@ void draw_scene()
 {
 	CHECK_GL_ERRORS();
 
+#ifdef RENDER_BENCHMARK
+	next_3d_object_stats_frame();
+#endif // RENDER_BENCHMARK
+
 	glClearColor(skybox_fog_color[0], skybox_fog_color[1], skybox_fog_color[2], 0.0);
 
 	if(!shadows_on || !have_stencil)glClear(GL_DEPTH_BUFFER_BIT|GL_COLOR_BUFFER_BIT);
@@ -237,7 +242,7 @@ void move_camera ()
 		camera_y_duration=0;
 		camera_z_duration=0;
         reset_camera_at_next_update = 0;
-		set_all_intersect_update_needed(main_bbox_tree);
+		set_view_intersect_update_needed(main_bbox_tree);
 	} else {
 		//move near the actor, but smoothly
 		camera_x_speed=(x+camera_x)/follow_speed;
@@ -507,7 +512,7 @@ void update_camera()
 	}
 
 	if(adjust_view){
-		set_all_intersect_update_needed(main_bbox_tree);
+		set_view_intersect_update_needed(main_bbox_tree);
 		old_camera_x= camera_x;
 		old_camera_y= camera_y;
 		old_camera_z= camera_z;
@@ -524,7 +529,7 @@ void update_camera()
 			fol_cam_stop = 0;
 
 		if (last_kludge != camera_kludge && !fol_cam_stop) {
-			set_all_intersect_update_needed(main_bbox_tree);
+			set_view_intersect_update_needed(main_bbox_tree);
 			adjust = (camera_kludge-last_kludge);
 
 			//without this the camera will zip the wrong way when camera_kludge
@@ -21,9 +21,11 @@
  #include "load_gl_extensions.h"
 #else
  #include "achievements.h"
+ #include "actor_scripts.h"
  #include "alphamap.h"
  #include "bags.h"
  #include "buddy.h"
+ #include "cache.h"
  #include "chat.h"
  #include "console.h"
  #include "counters.h"
@@ -76,6 +78,10 @@
 
 #include "asc.h"
 #include "elconfig.h"
+#include "chat_log.h"
+#ifdef PAWN
+#include "pawn/elpawn.h"
+#endif
 #include "text.h"
 #include "consolewin.h"
 #include "queue.h"
@@ -327,6 +333,13 @@ void change_var(int * var)
 	*var= !*var;
 }
 
+#ifdef PAWN
+static void change_pawn_timer_thread(int * var)
+{
+	set_pawn_timer_thread(!*var);
+}
+#endif
+
 #ifndef MAP_EDITOR
 static void change_show_action_bar(int * var)
 {
@@ -2007,6 +2020,8 @@ static void init_ELC_vars(void)
 	add_var(OPT_PASSWORD,"password","p",password_str,change_string,MAX_USERNAME_LENGTH,"Password","Put your password here",SERVER);
 	add_var(OPT_MULTI,"log_chat","log",&log_chat,change_int,LOG_SERVER,"Log Messages","Log messages from the server (chat, harvesting events, GMs, etc)",SERVER,"Do not log chat", "Log chat only", "Log server messages", "Log server to srv_log.txt", NULL);
 	add_var(OPT_BOOL,"rotate_chat_log","rclog",&rotate_chat_log_config_var,change_rotate_chat_log,0,"Rotate Chat Log File","Tag the chat/server message log files with year and month. You will still need to manage deletion of the old files. Requires a client restart.",SERVER);
+	add_var(OPT_INT,"chat_log_flush_interval","clflush",&chat_log_flush_interval,change_int,2,"Chat Log Write Interval","Seconds between writes of the chat and server logs. If the client crashes, at most this much of the log is lost. 0 writes every line straight away.",SERVER,0,60);
+	add_var(OPT_INT,"chat_log_max_size","clmaxsize",&chat_log_max_size,change_int,0,"Chat Log Size Limit","Start a new chat/server log file once the current one reaches this many megabytes. The full one is renamed with the date and time. 0 means no limit.",SERVER,0,2047);
 	add_var(OPT_BOOL,"buddy_log_notice", "buddy_log_notice", &buddy_log_notice, change_var, 1, "Log Buddy Sign On/Off", "Toggle whether to display notices when people on your buddy list log on or off", SERVER);
 	add_var(OPT_STRING,"language","lang",lang,change_string,8,"Language","Wah?",SERVER);
 	add_var(OPT_STRING,"browser","b",browser_name,change_string,70,"Browser","Location of your web browser (Windows users leave blank to use default browser)",SERVER);
@@ -2076,11 +2091,16 @@ static void init_ELC_vars(void)
 	add_var(OPT_INT_F,"water_shader_quality","water_shader_quality",&water_shader_quality,change_water_shader_quality,1,"  water shader quality","Defines what shader is used for water rendering. Higher values are slower but look better. Needs \"toggle frame buffer support\" to be turned on.",VIDEO, int_zero_func, int_max_water_shader_quality);
 #ifdef	NEW_TEXTURES
 	add_var(OPT_BOOL,"small_actor_texture_cache","small_actor_tc",&small_actor_texture_cache,change_small_actor_texture_cache,0,"Small actor texture cache","A small Actor texture cache uses less video memory, but actor loading can be slower.",VIDEO);
+	add_var(OPT_INT,"texture_upload_budget","texupload",&texture_upload_budget,change_int,1024,"Texture upload budget","Textures of 3D objects are loaded in the background and this many kilobytes of them are uploaded per frame. 0 loads them right away, which can stall the game when entering a new area.",VIDEO,0,65536);
 #else	/* NEW_TEXTURES */
 	add_var(OPT_BOOL,"use_mipmaps","mm",&use_mipmaps,change_mipmaps,0,"Mipmaps","Mipmaps is a texture effect that blurs the texture a bit - it may look smoother and better, or it may look worse depending on your graphics driver settings and the like.",VIDEO);
 #endif	/* NEW_TEXTURES */
 	add_var(OPT_BOOL,"use_vertex_buffers","vbo",&use_vertex_buffers,change_vertex_buffers,0,"Vertex Buffer Objects","Toggle the use of the vertex buffer objects, restart required to activate it",VIDEO);
 	add_var(OPT_BOOL, "use_animation_program", "uap", &use_animation_program, change_use_animation_program, 1, "Use animation program", "Use GL_ARB_vertex_program for actor animation", VIDEO);
+	add_var(OPT_INT,"max_unused_actor_types","maxunusedact",&max_unused_actor_defs,change_int,16,"Unused actor types kept","Actor models are loaded the first time they are seen. This is how many of them are kept in memory after the last actor of the type is gone. Lower values save memory, higher values avoid loading the same creatures again.",VIDEO,0,MAX_ACTOR_DEFS);
+	add_var(OPT_INT,"texture_cache_budget","texbudget",&texture_cache_budget,change_int,0,"Texture memory budget","Textures that were not used for a while are unloaded, least recently used first, while the textures use more than this many megabytes. 0 only unloads textures unused for five minutes.",VIDEO,0,4095);
+	add_var(OPT_INT,"e3d_cache_budget","e3dbudget",&e3d_cache_budget,change_int,0,"3D object memory budget","3D object meshes that were not used for a while are unloaded, least recently used first, while the meshes use more than this many megabytes. 0 only unloads meshes unused for five minutes.",VIDEO,0,4095);
+	add_var(OPT_BOOL,"use_animation_lod","animlod",&use_animation_lod,change_var,1,"Animation level of detail","Animate distant actors at a lower rate and skip the animation of actors that are not on the screen. Saves a lot of processing time in crowded places.",VIDEO);
 	add_var(OPT_BOOL_INI, "video_info_sent", "svi", &video_info_sent, change_var, 0, "Video info sent", "Video information are sent to the server (like OpenGL version and OpenGL extentions)", VIDEO);
 	// VIDEO TAB
 
@@ -2117,6 +2137,7 @@ static void init_ELC_vars(void)
 	add_var(OPT_FLOAT,"min_ec_framerate","ecminf",&min_ec_framerate,change_min_ec_framerate,15,"Min Effects Framerate","If your framerate is below this amount, eye candy will use minimum detail.",GFX,1.0,FLT_MAX,1.0);
 	add_var(OPT_INT,"light_columns_threshold","lct",&light_columns_threshold,change_int,5,"Light columns threshold","If your framerate is below this amount, you will not get columns of light around teleportation effects (useful for slow systems).",GFX, 0, INT_MAX);
 	add_var(OPT_INT,"max_idle_cycles_per_second","micps",&max_idle_cycles_per_second,change_int,40,"Max Idle Cycles Per Second","The eye candy 'idle' function, which moves particles around, will run no more than this often.  If your CPU is your limiting factor, lowering this can give you a higher framerate.  Raising it gives smoother particle motion (up to the limit of your framerate).",GFX, 1, INT_MAX);
+	add_var(OPT_INT,"eye_candy_threads","ecthreads",&ec_idle_threads,change_int,0,"Eye Candy Threads","Number of extra threads used to move particles around. On multi-core systems, setting this to the number of spare cores lets busy spell effects scale with the CPU. 0 does all the work in the main thread.",GFX, 0, 16);
 #ifdef	NEW_ALPHA
 	add_var(OPT_BOOL,"use_3d_alpha_blend","3dalpha",&use_3d_alpha_blend,change_var,1,"3D Alpha Blending","Toggle the use of the alpha blending on 3D objects",GFX);
 #endif	//NEW_ALPHA
@@ -2172,6 +2193,9 @@ static void init_ELC_vars(void)
 #endif
 	add_var(OPT_BOOL, "use_animation_program", "uap", &use_animation_program, change_use_animation_program, 1, "Use animation program", "Use GL_ARB_vertex_program for actor animation", TROUBLESHOOT);
 	add_var(OPT_BOOL,"poor_man","poor",&poor_man,change_poor_man,0,"Poor Man","If the game is running very slow for you, toggle this setting.",TROUBLESHOOT);
+#ifdef PAWN
+	add_var(OPT_BOOL,"pawn_timer_thread","pawnthread",&pawn_timer_thread,change_pawn_timer_thread,0,"Pawn Timer Thread","Run the timers of the map scripts on their own thread instead of the main loop.",TROUBLESHOOT);
+#endif
 	// TROUBLESHOOT TAB
 
 	// DEBUGTAB TAB
@@ -861,6 +861,7 @@ namespace ec
 	{
 		base = _base;
 		effect = _effect;
+		parallel_safe = false; // Shares its spawner, mover and effect_count with the parent effect.
 		pos = _pos;
 		center = *pos;
 		type = _type;
@@ -270,9 +270,9 @@ namespace ec
 					state = 1;
 					return true;
 				}
-				effect->particles.erase(this);
+				effect->unregister_particle(this);
 				effect = iter->neighbor;
-				effect->particles[this] = true;
+				effect->register_particle(this);
 			}
 		}
 		else
@@ -540,6 +540,7 @@ namespace ec
 		overall_wind_adjust = Vec3(0.0, 0.0, 0.0);
 		bounding_range = _bounding_range;
 		bounds = bounding_range;
+		parallel_safe = false; // Particles get handed off to neighbouring wind effects.
 		mover = new GradientMover(this);
 		spawner = new FilledBoundingSpawner(_bounding_range, pos, &(base->center), range_scalar);
 		//  max_LOD1_count = (int)(spawner->get_area() * _density * 1.0) / 10;
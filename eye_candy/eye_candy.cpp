@@ -3,6 +3,7 @@
 #include <SDL.h>
 #include <SDL_image.h>
 #include <errno.h>
+#include <algorithm>
 
 #include "eye_candy.h"
 #include "../platform.h"
@@ -100,6 +101,27 @@ namespace ec
 	bool ec_error_status = false;
 	Logger logger;
 
+	Uint64 ParticlePool::allocations = 0;
+	Uint64 ParticlePool::reused = 0;
+	Uint64 ParticlePool::slabs = 0;
+	Uint64 ParticlePool::live = 0;
+	SDL_mutex* ParticlePool::mutex = NULL;
+
+	namespace
+	{
+
+		const size_t POOL_GRANULARITY = 16;
+		const size_t POOL_MAX_SIZE = 512;
+		const size_t POOL_CLASSES = POOL_MAX_SIZE / POOL_GRANULARITY;
+		const size_t POOL_SLAB_SIZE = 16384;
+
+		// A plain array, not a container: particles can still be released
+		// from other static destructors (the wrapper's EyeCandy object) at
+		// exit, after any container here would already have been destroyed.
+		void* pool_free_lists[POOL_CLASSES];
+
+	}
+
 	// C L A S S   F U N C T I O N S //////////////////////////////////////////////
 
 #ifndef	NEW_TEXTURES
@@ -239,8 +261,20 @@ namespace ec
 
 	void Effect::build_particle_buffer(const Uint64 time_diff)
 	{
-		std::map<Particle*, bool>::const_iterator iter;
-		const Vec3 center(base->center);
+		if (map_particle_buffer())
+		{
+			fill_particle_buffer(time_diff);
+			unmap_particle_buffer();
+		}
+	}
+
+	/*!
+	 The buffer building is split in three so that EyeCandy::idle can do the
+	 GL parts (sizing and mapping, then unmapping) on the main thread and
+	 let the idle threads fill the mapped buffers, one effect per task.
+	 */
+	bool Effect::map_particle_buffer()
+	{
 		Uint32 size;
 
 		particle_count = 0;
@@ -249,7 +283,7 @@ namespace ec
 
 		if (particle_max_count == 0)
 		{
-			return;
+			return false;
 		}
 
 		particle_max_count = (particle_max_count + 0xF) & 0xFFFFFFF0;
@@ -268,11 +302,19 @@ namespace ec
 		buffer = static_cast<float*>(particle_vertex_buffer.map(
 			el::hbt_vertex, el::hbat_write_only));
 
+		return buffer != 0;
+	}
+
+	void Effect::fill_particle_buffer(const Uint64 time_diff)
+	{
+		ParticleList::const_iterator iter;
+		const Vec3 center(base->center);
+
 		if (bounds)
 		{
 			for (iter = particles.begin(); iter != particles.end(); iter++)
 			{
-				Particle* p = iter->first;
+				Particle* p = *iter;
 				const coord_t dist_squared = (p->pos - center).magnitude_squared();
 				if (dist_squared < MAX_DRAW_DISTANCE_SQUARED)
 					p->draw(time_diff);
@@ -282,12 +324,17 @@ namespace ec
 		{
 			for (iter = particles.begin(); iter != particles.end(); iter++)
 			{
-				Particle* p = iter->first;
+				Particle* p = *iter;
 				p->draw(time_diff);
 			}
 		}
+	}
 
+	void Effect::unmap_particle_buffer()
+	{
+		particle_vertex_buffer.bind(el::hbt_vertex);
 		particle_vertex_buffer.unmap(el::hbt_vertex);
+		buffer = 0;
 	}
 
 	void Effect::draw_particle_buffer()
@@ -1306,15 +1353,99 @@ namespace ec
 		return ret;
 	}
 
+	void* ParticlePool::allocate(const size_t size)
+	{
+		void* ret;
+
+		if (mutex)
+			SDL_LockMutex(mutex);
+
+		allocations++;
+		live++;
+
+		if (size > POOL_MAX_SIZE)
+		{
+			if (mutex)
+				SDL_UnlockMutex(mutex);
+			return ::operator new(size);
+		}
+
+		const size_t size_class = (size - 1) / POOL_GRANULARITY;
+		ret = pool_free_lists[size_class];
+		if (ret)
+		{
+			pool_free_lists[size_class] = *(void**)ret;
+			reused++;
+		}
+		else
+		{
+			// Free list is empty; carve up a new slab.  The first object is
+			// returned, the rest are chained onto the free list.
+			const size_t object_size = (size_class + 1) * POOL_GRANULARITY;
+			const size_t count = POOL_SLAB_SIZE / object_size;
+			char* slab = (char*)::operator new(POOL_SLAB_SIZE);
+			slabs++;
+			for (size_t i = count - 1; i > 0; i--)
+			{
+				void* obj = slab + i * object_size;
+				*(void**)obj = pool_free_lists[size_class];
+				pool_free_lists[size_class] = obj;
+			}
+			ret = slab;
+		}
+
+		if (mutex)
+			SDL_UnlockMutex(mutex);
+		return ret;
+	}
+
+	void ParticlePool::release(void* ptr, const size_t size)
+	{
+		if (!ptr)
+			return;
+
+		if (size > POOL_MAX_SIZE)
+		{
+			::operator delete(ptr);
+			if (mutex)
+				SDL_LockMutex(mutex);
+			live--;
+			if (mutex)
+				SDL_UnlockMutex(mutex);
+			return;
+		}
+
+		const size_t size_class = (size - 1) / POOL_GRANULARITY;
+		if (mutex)
+			SDL_LockMutex(mutex);
+		live--;
+		*(void**)ptr = pool_free_lists[size_class];
+		pool_free_lists[size_class] = ptr;
+		if (mutex)
+			SDL_UnlockMutex(mutex);
+	}
+
+	void ParticlePool::reset_stats()
+	{
+		allocations = 0;
+		reused = 0;
+	}
+
 	Particle::Particle(Effect* _effect, ParticleMover* _mover, const Vec3 _pos,
 		const Vec3 _velocity, const coord_t _size)
 	{
 		effect = _effect;
 		base = effect->base;
 		cur_motion_blur_point = 0;
-		motion_blur = new ParticleHistory[effect->motion_blur_points];
-		for (int i = 0; i < effect->motion_blur_points; i++)
-			motion_blur[i].alpha = 0;
+		if (effect->motion_blur_points > 0)
+		{
+			motion_blur = new ParticleHistory[effect->motion_blur_points];
+			for (int i = 0; i < effect->motion_blur_points; i++)
+				motion_blur[i].alpha = 0;
+		}
+		else
+			motion_blur = NULL;
+		effect_index = 0;
 		mover = _mover;
 		pos = _pos;
 		velocity = _velocity;
@@ -2064,6 +2195,107 @@ namespace ec
 		return PI * square(avg_radius);
 	}
 
+	/*!
+	 \brief The worker threads behind a threaded EyeCandy::idle
+
+	 run() hands out task numbers to the workers and the calling thread alike
+	 and returns once every task has been run through
+	 EyeCandy::run_idle_task().
+	 */
+	class IdleWorkers
+	{
+		public:
+			IdleWorkers(EyeCandy* _base, const int count);
+			~IdleWorkers();
+
+			void run(const int count);
+			int get_thread_count() const
+			{	return threads.size();};
+
+			SDL_mutex* mutex;
+
+		protected:
+			static int thread_main(void* data);
+			void work();
+
+			EyeCandy* base;
+			std::vector<SDL_Thread*> threads;
+			SDL_sem* start;
+			SDL_sem* done;
+			int next_task;
+			int task_count;
+			bool quit;
+	};
+
+	IdleWorkers::IdleWorkers(EyeCandy* _base, const int count)
+	{
+		base = _base;
+		mutex = SDL_CreateMutex();
+		start = SDL_CreateSemaphore(0);
+		done = SDL_CreateSemaphore(0);
+		next_task = 0;
+		task_count = 0;
+		quit = false;
+		for (int i = 0; i < count; i++)
+		{
+			SDL_Thread* thread = SDL_CreateThread(thread_main, this);
+			if (!thread)
+				break;
+			threads.push_back(thread);
+		}
+	}
+
+	IdleWorkers::~IdleWorkers()
+	{
+		quit = true;
+		for (int i = 0; i < (int)threads.size(); i++)
+			SDL_SemPost(start);
+		for (int i = 0; i < (int)threads.size(); i++)
+			SDL_WaitThread(threads[i], NULL);
+		SDL_DestroySemaphore(done);
+		SDL_DestroySemaphore(start);
+		SDL_DestroyMutex(mutex);
+	}
+
+	int IdleWorkers::thread_main(void* data)
+	{
+		IdleWorkers* workers = (IdleWorkers*)data;
+
+		while (true)
+		{
+			SDL_SemWait(workers->start);
+			if (workers->quit)
+				return 0;
+			workers->work();
+			SDL_SemPost(workers->done);
+		}
+	}
+
+	void IdleWorkers::work()
+	{
+		while (true)
+		{
+			SDL_LockMutex(mutex);
+			const int task = next_task++;
+			SDL_UnlockMutex(mutex);
+
+			if (task >= task_count)
+				return;
+			base->run_idle_task(task);
+		}
+	}
+
+	void IdleWorkers::run(const int count)
+	{
+		next_task = 0;
+		task_count = count;
+		for (int i = 0; i < (int)threads.size(); i++)
+			SDL_SemPost(start);
+		work();
+		for (int i = 0; i < (int)threads.size(); i++)
+			SDL_SemWait(done);
+	}
+
 	EyeCandy::EyeCandy()
 	{
 		set_thresholds(10000, 13, 37);
@@ -2087,6 +2319,11 @@ namespace ec
 		poor_transparency_resolution = false;
 #endif	/* NEW_TEXTURES */
 		draw_shapes = true;
+		idle_usec = 0;
+		idle_calls = 0;
+		idle_workers = NULL;
+		threaded_idle = false;
+		idle_phase = 0;
 	}
 
 	EyeCandy::EyeCandy(int _max_particles)
@@ -2112,10 +2349,16 @@ namespace ec
 		poor_transparency_resolution = false;
 #endif	/* NEW_TEXTURES */
 		draw_shapes = true;
+		idle_usec = 0;
+		idle_calls = 0;
+		idle_workers = NULL;
+		threaded_idle = false;
+		idle_phase = 0;
 	}
 
 	EyeCandy::~EyeCandy()
 	{
+		delete idle_workers;
 		for (std::vector<Particle*>::iterator iter = particles.begin(); iter
 			!= particles.end(); iter++)
 			delete *iter;
@@ -2395,6 +2638,13 @@ namespace ec
 
 	void EyeCandy::push_back_effect(Effect* e)
 	{
+		if (threaded_idle)
+		{
+			SDL_LockMutex(idle_workers->mutex);
+			pending_effects.push_back(e);
+			SDL_UnlockMutex(idle_workers->mutex);
+			return;
+		}
 		effects.push_back(e);
 	}
 
@@ -2405,8 +2655,17 @@ namespace ec
 			delete p;
 			return false;
 		}
+		else if (threaded_idle)
+		{
+			// Only the creating effect's own lists are safe to touch from
+			// an idle thread; merge_threaded_idle() does the rest.
+			p->effect->register_particle(p);
+			p->effect->new_particles.push_back(p);
+			return true;
+		}
 		else
 		{
+			p->base_index = particles.size();
 			particles.push_back(p);
 			p->effect->register_particle(p);
 			light_estimate += p->estimate_light_level();
@@ -2553,9 +2812,9 @@ namespace ec
 			// Draw particles
 			if (e->bounds)
 			{
-				for (std::map<Particle*, bool>::const_iterator iter2 = (*iter)->particles.begin(); iter2 != (*iter)->particles.end(); iter2++)
+				for (ParticleList::const_iterator iter2 = (*iter)->particles.begin(); iter2 != (*iter)->particles.end(); iter2++)
 				{
-					Particle* p = iter2->first;
+					Particle* p = *iter2;
 					const coord_t dist_squared = (p->pos - center).magnitude_squared();
 					if (dist_squared < MAX_DRAW_DISTANCE_SQUARED)
 						p->draw(time_diff);
@@ -2563,9 +2822,9 @@ namespace ec
 			}
 			else
 			{
-				for (std::map<Particle*, bool>::const_iterator iter2 = (*iter)->particles.begin(); iter2 != (*iter)->particles.end(); iter2++)
+				for (ParticleList::const_iterator iter2 = (*iter)->particles.begin(); iter2 != (*iter)->particles.end(); iter2++)
 				{
-					Particle* p = iter2->first;
+					Particle* p = *iter2;
 					p->draw(time_diff);
 				}
 			}
@@ -2628,6 +2887,7 @@ namespace ec
 			const Uint64 cur_time = get_time();
 			if (time_diff < 10)
 			time_diff = 10;
+			idle_calls++;
 
 #if defined CLUSTER_INSIDES && !defined MAP_EDITOR
 			short cluster = get_actor_cluster ();
@@ -2728,6 +2988,13 @@ namespace ec
 					}
 				}
 
+				if (idle_workers && e->parallel_safe)
+				{
+					idle_tasks.push_back(e); // Idled later, on the idle threads.
+					i++;
+					continue;
+				}
+
 				const bool ret = e->idle(time_diff);
 				if (!ret)
 				{
@@ -2802,8 +3069,7 @@ namespace ec
 			for (int i = 0; i < (int)particles.size(); ) //Iterate using an int, not an iterator, because we may be adding/deleting entries, and that messes up iterators.
 
 			{
-				std::vector<Particle*>::iterator iter = particles.begin() + i;
-				Particle* p = *iter;
+				Particle* p = particles[i];
 
 				counter -= particle_cleanout_rate;
 				if (counter < 0) // Kill off a random particle.
@@ -2812,20 +3078,8 @@ namespace ec
 					counter++;
 					if ((p->deletable()) && (!p->effect->active))
 					{
-						particles.erase(iter);
-						for (int j = 0; j < (int)light_particles.size(); )
-						{
-							std::vector< std::pair<Particle*, light_t> >::iterator iter2 = light_particles.begin() + j;
-							if (iter2->first == p)
-							{
-								light_particles.erase(iter2);
-								continue;
-							}
-							j++;
-						}
-						p->effect->unregister_particle(p);
-						light_estimate -= p->estimate_light_level();
-						delete p;
+						delete_particle(i); // The last particle now lives at i; look at it next.
+						continue;
 					}
 
 					i++;
@@ -2838,26 +3092,16 @@ namespace ec
 					continue;
 				}
 
+				if (idle_workers && p->effect->parallel_safe)
+				{
+					i++; // Moved along with its effect on the idle threads.
+					continue;
+				}
+
 				p->mover->move(*p, time_diff);
 				const bool ret = p->idle(time_diff);
 				if (!ret)
-				{
-					iter = particles.begin() + i; //Why the heck do I need to redo this just because I've push_back'ed entries to the vector in idle()?  :P  Makes no sense.  My best guess: array resizing.
-					particles.erase(iter);
-					for (int j = 0; j < (int)light_particles.size(); )
-					{
-						std::vector< std::pair<Particle*, light_t> >::iterator iter2 = light_particles.begin() + j;
-						if (iter2->first == p)
-						{
-							light_particles.erase(iter2);
-							continue;
-						}
-						j++;
-					}
-					p->effect->unregister_particle(p);
-					light_estimate -= p->estimate_light_level();
-					delete p;
-				}
+				delete_particle(i);
 				else
 				i++;
 			}
@@ -2865,24 +3109,180 @@ namespace ec
 
 			//  allowable_particles_to_add = 1 + (int)(particles.size() * 0.00005 * time_diff / 1000000.0 * (max_particles - particles.size()) * change_LOD);
 			//  std::cout << "Current: " << particles.size() << "; Allowable new: " << allowable_particles_to_add << std::endl;
+			if (idle_workers)
+			{
+				idle_phase = 0;
+				idle_results.resize(idle_tasks.size());
+				threaded_idle = true;
+				idle_workers->run(idle_tasks.size());
+				threaded_idle = false;
+				merge_threaded_idle();
+			}
+
 #ifdef	NEW_TEXTURES
 			Uint32 i, count;
 
 			count = effects.size();
 
-			for (i = 0; i < count; i++)
+			if (idle_workers)
 			{
-				Effect* e = effects[i];
+				// Buffers are mapped and unmapped here, on the GL thread;
+				// only the filling is spread over the idle threads.
+				for (i = 0; i < count; i++)
+				{
+					Effect* e = effects[i];
+
+					if (e->active && e->map_particle_buffer())
+						idle_tasks.push_back(e);
+				}
+
+				idle_phase = 1;
+				threaded_idle = true;
+				idle_workers->run(idle_tasks.size());
+				threaded_idle = false;
 
-				if (e->active)
+				for (i = 0; i < idle_tasks.size(); i++)
+					idle_tasks[i]->unmap_particle_buffer();
+				idle_tasks.clear();
+			}
+			else
+			{
+				for (i = 0; i < count; i++)
 				{
-					e->build_particle_buffer(time_diff);
+					Effect* e = effects[i];
+
+					if (e->active)
+					{
+						e->build_particle_buffer(time_diff);
+					}
 				}
 			}
 
 			el::HardwareBuffer::unbind(el::hbt_index);
 			el::HardwareBuffer::unbind(el::hbt_vertex);
 #endif	/* NEW_TEXTURES */
+			idle_usec += get_time() - cur_time;
+		}
+
+		/*!
+		 Spread idle() over count extra threads (0 to idle on the calling
+		 thread only).
+
+		 When threaded, effects flagged parallel_safe are idled concurrently,
+		 each task idling one effect and then moving its particles.  Anything
+		 that would touch EyeCandy's shared state from a task (new and expired
+		 particles, new effects) is recorded on the effect and applied by
+		 merge_threaded_idle() once all tasks are done.  Other effects are idled
+		 on the calling thread first, as before.
+		 */
+		void EyeCandy::set_idle_threads(const int count)
+		{
+			const int current = idle_workers ? idle_workers->get_thread_count() : 0;
+
+			if (count == current)
+			return;
+
+			delete idle_workers;
+			idle_workers = NULL;
+
+			if (count <= 0)
+			return;
+
+			if (!ParticlePool::mutex)
+			ParticlePool::mutex = SDL_CreateMutex();
+			idle_workers = new IdleWorkers(this, count);
+		}
+
+		void EyeCandy::run_idle_task(const int task)
+		{
+			Effect* e = idle_tasks[task];
+
+#ifdef	NEW_TEXTURES
+			if (idle_phase == 1)
+			{
+				e->fill_particle_buffer(time_diff);
+				return;
+			}
+#endif	/* NEW_TEXTURES */
+
+			idle_results[task] = e->idle(time_diff);
+			if (!idle_results[task])
+			return;
+
+			if ((!e->active) && (!e->recall))
+			return;
+
+			// Expired particles stay in the list until the merge, so each
+			// slot is visited exactly once; particles created along the way
+			// are appended and moved this cycle too.
+			for (Uint32 i = 0; i < e->particles.size(); i++)
+			{
+				Particle* p = e->particles[i];
+
+				p->mover->move(*p, time_diff);
+				if (!p->idle(time_diff))
+				e->dead_particles.push_back(p);
+			}
+		}
+
+		void EyeCandy::merge_threaded_idle()
+		{
+			for (int i = 0; i < (int)pending_effects.size(); i++)
+			{
+				effects.push_back(pending_effects[i]);
+				idle_tasks.push_back(pending_effects[i]);
+				idle_results.push_back(true);
+			}
+			pending_effects.clear();
+
+			for (int i = 0; i < (int)idle_tasks.size(); i++)
+			{
+				Effect* e = idle_tasks[i];
+
+				for (int j = 0; j < (int)e->new_particles.size(); j++)
+				{
+					Particle* p = e->new_particles[j];
+					p->base_index = particles.size();
+					particles.push_back(p);
+					light_estimate += p->estimate_light_level();
+				}
+				e->new_particles.clear();
+
+				for (int j = 0; j < (int)e->dead_particles.size(); j++)
+				delete_particle(e->dead_particles[j]->base_index);
+				e->dead_particles.clear();
+
+				if (!idle_results[i])
+				{
+					e->recall = true;
+					effects.erase(std::find(effects.begin(), effects.end(), e));
+					delete e;
+				}
+			}
+			idle_tasks.clear();
+		}
+
+		void EyeCandy::delete_particle(const int index)
+		{
+			// Order doesn't matter, so fill the hole with the last particle
+			// instead of shifting everything after it down.
+			Particle* p = particles[index];
+			particles[index] = particles.back();
+			particles[index]->base_index = index;
+			particles.pop_back();
+			for (int j = 0; j < (int)light_particles.size(); )
+			{
+				std::vector< std::pair<Particle*, light_t> >::iterator iter2 = light_particles.begin() + j;
+				if (iter2->first == p)
+				{
+					light_particles.erase(iter2);
+					continue;
+				}
+				j++;
+			}
+			p->effect->unregister_particle(p);
+			light_estimate -= p->estimate_light_level();
+			delete p;
 		}
 
 		void EyeCandy::add_light(GLenum light_id)
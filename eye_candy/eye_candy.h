@@ -990,6 +990,37 @@ namespace ec
 	class ParticleMover;
 	class Effect;
 
+	/*!
+	 \brief Slab allocator backing all Particle objects
+
+	 Spell-heavy scenes create and destroy particles by the tens of thousands
+	 per second, so going through the general purpose heap for every one of
+	 them is expensive.  Particles are instead carved out of fixed size slabs,
+	 with one free list per size class (in practice, one per particle type,
+	 since each type has its own size).  Slabs are never handed back to the
+	 heap; a freed particle simply becomes the next one handed out for its
+	 size class.  Oversized particles fall through to the normal heap.
+	 */
+	class ParticlePool
+	{
+		public:
+			static void* allocate(const size_t size);
+			static void release(void* ptr, const size_t size);
+
+			static Uint64 allocations; //!< Particles handed out since the last reset_stats().
+			static Uint64 reused; //!< ... of which were recycled from a free list.
+			static Uint64 slabs; //!< Slabs ever requested from the heap.
+			static Uint64 live; //!< Particles currently allocated.
+
+			static void reset_stats();
+
+			/*!
+			 Once set, every allocation and release goes through this lock.
+			 Set by EyeCandy before it starts its idle threads.
+			 */
+			static SDL_mutex* mutex;
+	};
+
 	/*!
 	 \brief An ultra-simplified particle element
 
@@ -1053,6 +1084,17 @@ namespace ec
 				const Vec3 _velocity, const coord_t _size = 1.0f);
 			virtual ~Particle();
 
+			static void* operator new(size_t size)
+			{
+				return ParticlePool::allocate(size);
+			}
+			;
+			static void operator delete(void* ptr, size_t size)
+			{
+				ParticlePool::release(ptr, size);
+			}
+			;
+
 			virtual bool idle(const Uint64 delta_t) = 0;
 #ifdef	NEW_TEXTURES
 			virtual Uint32 get_texture() = 0;
@@ -1100,7 +1142,61 @@ namespace ec
 
 			ParticleHistory* motion_blur;
 			int cur_motion_blur_point;
+			Uint32 effect_index; // Slot in effect->particles; maintained by ParticleList.
+			Uint32 base_index; // Slot in base->particles.
+
+	};
+
+	/*!
+	 \brief The set of particles owned by an effect
 
+	 A dense array rather than a tree: each particle remembers its own slot, so
+	 insertion and removal are O(1) (removal moves the last particle into the
+	 freed slot) and walking the particles touches contiguous memory.  The
+	 order of the particles is therefore arbitrary and changes on removal.
+	 */
+	class ParticleList
+	{
+		public:
+			typedef std::vector<Particle*>::iterator iterator;
+			typedef std::vector<Particle*>::const_iterator const_iterator;
+
+			void insert(Particle* p)
+			{
+				p->effect_index = list.size();
+				list.push_back(p);
+			}
+			;
+			void erase(Particle* p)
+			{
+				const Uint32 index = p->effect_index;
+				assert(index < list.size() && list[index] == p);
+				Particle* last = list.back();
+				list[index] = last;
+				last->effect_index = index;
+				list.pop_back();
+			}
+			;
+
+			size_t size() const
+			{	return list.size();};
+			bool empty() const
+			{	return list.empty();};
+			Particle* operator[](const size_t index) const
+			{	return list[index];};
+			Particle* back() const
+			{	return list.back();};
+			iterator begin()
+			{	return list.begin();};
+			iterator end()
+			{	return list.end();};
+			const_iterator begin() const
+			{	return list.begin();};
+			const_iterator end() const
+			{	return list.end();};
+
+		protected:
+			std::vector<Particle*> list;
 	};
 
 	/*!
@@ -2042,6 +2138,7 @@ namespace ec
 				active = true;
 				obstructions = &null_obstructions;
 				bounds = NULL;
+				parallel_safe = true;
 #ifdef	NEW_TEXTURES
 				particle_max_count = 0;
 				particle_count = 0;
@@ -2062,17 +2159,20 @@ namespace ec
 				const alpha_t alpha, const Vec3 pos,
 				const alpha_t burn);
 			void build_particle_buffer(const Uint64 time_diff);
+			bool map_particle_buffer();
+			void fill_particle_buffer(const Uint64 time_diff);
+			void unmap_particle_buffer();
 			void draw_particle_buffer();
 #endif	/* NEW_TEXTURES */
 
 			void register_particle(Particle* p)
 			{
-				particles[p] = true;
+				particles.insert(p);
 			}
 			;
 			void unregister_particle(Particle* p)
 			{
-				particles.erase(particles.find(p));
+				particles.erase(p);
 			}
 			;
 
@@ -2080,13 +2180,13 @@ namespace ec
 			virtual bool idle(const Uint64 usec) = 0;
 			virtual void draw(const Uint64 usec)
 			{
-				for (std::map<Particle*, bool>::iterator iter2 =
-					particles.begin(); iter2 != particles.end(); iter2++)
+				for (ParticleList::iterator iter2 = particles.begin();
+					iter2 != particles.end(); iter2++)
 				{
 					for (std::vector<Obstruction*>::iterator iter =
 						obstructions->begin(); iter != obstructions->end(); iter++)
 					{
-						(*iter)->get_force_gradient(*(iter2->first));
+						(*iter)->get_force_gradient(**iter2);
 					}
 				}
 			}
@@ -2131,10 +2231,18 @@ namespace ec
 			bool* dead; //Provided by the effect caller; set when this effect is going away.
 			Vec3* pos;
 			std::vector<Obstruction*>* obstructions;
-			std::map<Particle*, bool> particles;
+			ParticleList particles;
 			BoundingRange* bounds;
 			bool active;
 			bool recall;
+			/*!
+			 Whether this effect and its particles may be idled on a worker
+			 thread, concurrently with other effects.  Effects whose idle (or
+			 whose particles' idle) touches another effect must clear this.
+			 */
+			bool parallel_safe;
+			std::vector<Particle*> new_particles; // Created during a threaded idle; not yet in base->particles.
+			std::vector<Particle*> dead_particles; // Expired during a threaded idle; not yet deleted.
 			Uint16 desired_LOD;
 			Uint16 LOD;
 #ifdef	NEW_TEXTURES
@@ -2164,6 +2272,8 @@ namespace ec
 		 effects, you'll want to let it run once to help clear out the system.
 
 		 */
+		class IdleWorkers;
+
 		class EyeCandy
 		{
 			public:
@@ -2197,6 +2307,10 @@ namespace ec
 			{	sprite_scalar = _scalar; temp_sprite_scalar = _scalar * height;};
 			void draw();
 			void idle();
+			void set_idle_threads(const int count);
+			void run_idle_task(const int task);
+			void merge_threaded_idle();
+			void delete_particle(const int index);
 			void add_light(GLenum light_id);
 			void start_draw();
 			void end_draw();
@@ -2280,6 +2394,16 @@ namespace ec
 			std::vector<Effect*> effects;
 			std::vector<Particle*> particles;
 			std::vector<GLenum> lights;
+			Uint64 idle_usec; // Time spent in idle(), for profiling.
+			Uint64 idle_calls;
+
+			// Threaded idle; see idle().
+			IdleWorkers* idle_workers;
+			bool threaded_idle; // True while the idle tasks are running.
+			int idle_phase;
+			std::vector<Effect*> idle_tasks;
+			std::vector<char> idle_results;
+			std::vector<Effect*> pending_effects;
 		};
 
 		extern bool ec_error_status;
@@ -2,15 +2,496 @@
 
 #include <iostream>
 #include <math.h>
+#include <stdio.h>
+#include <vector>
 #include "eye_candy.h"
 
 #include "math_cache.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 namespace ec
 {
 
+	// L O C A L S ////////////////////////////////////////////////////////////////
+
+	namespace
+	{
+
+		// Polynomial coefficients, highest order first.  The SSE and the
+		// scalar code share these, so both paths evaluate the same thing.
+
+		// 2^f on [-0.5, 0.5]: truncated Taylor series for rough, the Cephes
+		// minimax fit for close.
+		const float exp2_rough_coeffs[] =
+		{ 9.618129e-3f, 5.550411e-2f, 2.402265e-1f, 6.931472e-1f, 1.0f };
+		const float exp2_close_coeffs[] =
+		{ 1.535336188e-4f, 1.339887440e-3f, 9.618437357e-3f, 5.550332471e-2f,
+			2.402264791e-1f, 6.931472028e-1f, 1.0f };
+
+		// log2(m) = t * P(t^2), t = (m - 1) / (m + 1), m in [sqrt(1/2), sqrt(2)):
+		// the atanh series scaled by 2 / ln(2).
+		const float log2_rough_coeffs[] =
+		{ 0.9617967f, 2.8853901f };
+		const float log2_close_coeffs[] =
+		{ 0.4121986f, 0.5770780f, 0.9617967f, 2.8853901f };
+
+		// sin(r) = r + r * z * S(z), cos(r) = 1 - z / 2 + z * z * C(z),
+		// z = r * r, r in [-PI / 4, PI / 4].
+		const float sin_rough_coeffs[] =
+		{ 8.333333e-3f, -1.666667e-1f };
+		const float sin_close_coeffs[] =
+		{ -1.9515295891e-4f, 8.3321608736e-3f, -1.6666654611e-1f };
+		const float cos_rough_coeffs[] =
+		{ -1.388889e-3f, 4.166667e-2f };
+		const float cos_close_coeffs[] =
+		{ 2.443315711809948e-5f, -1.388731625493765e-3f,
+			4.166664568298827e-2f };
+
+		// PI / 2 split so that q * PIO2_1 and q * PIO2_2 are exact for the
+		// quadrant counts we care about.
+		const float PIO2_1 = 1.5703125f;
+		const float PIO2_2 = 4.837512969970703125e-4f;
+		const float PIO2_3 = 7.54978995489188216e-8f;
+
+		const float LOG2E = 1.44269504088896341f;
+		const float LN2 = 0.693147180559945309f;
+		const float SQRT2 = 1.41421356237309505f;
+		const float EXP2_LIMIT = 126.0f;
+
+		template<int N> inline float poly(const float x, const float* c)
+		{
+			float ret = c[0];
+			for (int i = 1; i < N; i++)
+				ret = ret * x + c[i];
+			return ret;
+		}
+
+		union FloatBits
+		{
+			float f;
+			Sint32 i;
+		};
+
+		inline float round_nearest(const float x)
+		{
+			return floor(x + 0.5f);
+		}
+
+		template<bool close> inline float exp2_one(float x)
+		{
+			FloatBits scale;
+			x = std::min(std::max(x, -EXP2_LIMIT), EXP2_LIMIT);
+			const float n = round_nearest(x);
+			const float f = x - n;
+			scale.i = ((Sint32)n + 127) << 23;
+			if (close)
+				return poly<7>(f, exp2_close_coeffs) * scale.f;
+			else
+				return poly<5>(f, exp2_rough_coeffs) * scale.f;
+		}
+
+		template<bool close> inline float log2_one(const float x)
+		{
+			FloatBits bits;
+			bits.f = x;
+			int e = ((bits.i >> 23) & 0xFF) - 127;
+			bits.i = (bits.i & 0x007FFFFF) | 0x3F800000;
+			if (bits.f > SQRT2)
+			{
+				bits.f *= 0.5f;
+				e++;
+			}
+			const float t = (bits.f - 1.0f) / (bits.f + 1.0f);
+			const float z = t * t;
+			if (close)
+				return e + t * poly<4>(z, log2_close_coeffs);
+			else
+				return e + t * poly<2>(z, log2_rough_coeffs);
+		}
+
+		template<bool close> inline void sincos_one(const float x,
+			float& sin_out, float& cos_out)
+		{
+			const float q = round_nearest(x * (float)(2.0 / PI));
+			const float r = ((x - q * PIO2_1) - q * PIO2_2) - q * PIO2_3;
+			const float z = r * r;
+			float s, c;
+			if (close)
+			{
+				s = r + r * z * poly<3>(z, sin_close_coeffs);
+				c = 1.0f - 0.5f * z + z * z * poly<3>(z, cos_close_coeffs);
+			}
+			else
+			{
+				s = r + r * z * poly<2>(z, sin_rough_coeffs);
+				c = 1.0f - 0.5f * z + z * z * poly<2>(z, cos_rough_coeffs);
+			}
+			const int quadrant = (int)q;
+			if (quadrant & 1)
+			{
+				const float tmp = s;
+				s = c;
+				c = -tmp;
+			}
+			if (quadrant & 2)
+			{
+				s = -s;
+				c = -c;
+			}
+			sin_out = s;
+			cos_out = c;
+		}
+
+		inline float invsqrt_rough_one(const float x)
+		{
+			FloatBits bits;
+			bits.f = x;
+			bits.i = 0x5F3759DF - (bits.i >> 1);
+			return bits.f * (1.5f - 0.5f * x * bits.f * bits.f);
+		}
+
+#ifdef __SSE2__
+		template<int N> inline __m128 poly4(const __m128 x, const float* c)
+		{
+			__m128 ret = _mm_set1_ps(c[0]);
+			for (int i = 1; i < N; i++)
+				ret = _mm_add_ps(_mm_mul_ps(ret, x), _mm_set1_ps(c[i]));
+			return ret;
+		}
+
+		template<bool close> inline __m128 exp2_four(__m128 x)
+		{
+			x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-EXP2_LIMIT)),
+				_mm_set1_ps(EXP2_LIMIT));
+			const __m128i n = _mm_cvtps_epi32(x);
+			const __m128 f = _mm_sub_ps(x, _mm_cvtepi32_ps(n));
+			const __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(
+				_mm_add_epi32(n, _mm_set1_epi32(127)), 23));
+			if (close)
+				return _mm_mul_ps(poly4<7>(f, exp2_close_coeffs), scale);
+			else
+				return _mm_mul_ps(poly4<5>(f, exp2_rough_coeffs), scale);
+		}
+
+		template<bool close> inline __m128 log2_four(const __m128 x)
+		{
+			const __m128i bits = _mm_castps_si128(x);
+			__m128i e = _mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(bits, 23),
+				_mm_set1_epi32(0xFF)), _mm_set1_epi32(127));
+			__m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits,
+				_mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000)));
+			const __m128 big = _mm_cmpgt_ps(m, _mm_set1_ps(SQRT2));
+			m = _mm_or_ps(_mm_and_ps(big, _mm_mul_ps(m, _mm_set1_ps(0.5f))),
+				_mm_andnot_ps(big, m));
+			e = _mm_sub_epi32(e, _mm_castps_si128(big));
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128 t = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+			const __m128 z = _mm_mul_ps(t, t);
+			const __m128 p = close ? poly4<4>(z, log2_close_coeffs)
+				: poly4<2>(z, log2_rough_coeffs);
+			return _mm_add_ps(_mm_cvtepi32_ps(e), _mm_mul_ps(t, p));
+		}
+
+		template<bool close> inline void sincos_four(const __m128 x,
+			__m128& sin_out, __m128& cos_out)
+		{
+			const __m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(x,
+				_mm_set1_ps((float)(2.0 / PI))));
+			const __m128 q = _mm_cvtepi32_ps(quadrant);
+			__m128 r = _mm_sub_ps(x, _mm_mul_ps(q, _mm_set1_ps(PIO2_1)));
+			r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(PIO2_2)));
+			r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(PIO2_3)));
+			const __m128 z = _mm_mul_ps(r, r);
+			const __m128 s_poly = close ? poly4<3>(z, sin_close_coeffs)
+				: poly4<2>(z, sin_rough_coeffs);
+			const __m128 c_poly = close ? poly4<3>(z, cos_close_coeffs)
+				: poly4<2>(z, cos_rough_coeffs);
+			const __m128 s = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, z), s_poly));
+			const __m128 c = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f),
+				_mm_mul_ps(_mm_set1_ps(0.5f), z)), _mm_mul_ps(_mm_mul_ps(z, z),
+				c_poly));
+			const __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(
+				quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+			const __m128 sin_sign = _mm_castsi128_ps(_mm_slli_epi32(
+				_mm_and_si128(quadrant, _mm_set1_epi32(2)), 30));
+			const __m128 cos_sign = _mm_castsi128_ps(_mm_slli_epi32(
+				_mm_and_si128(_mm_add_epi32(quadrant, _mm_set1_epi32(1)),
+				_mm_set1_epi32(2)), 30));
+			sin_out = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, c),
+				_mm_andnot_ps(swap, s)), sin_sign);
+			cos_out = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, s),
+				_mm_andnot_ps(swap, c)), cos_sign);
+		}
+#endif
+
+		template<bool close> void exp2_batch(const float* in, float* out,
+			const int count, const float in_scale)
+		{
+			int i = 0;
+#ifdef __SSE2__
+			const __m128 scale = _mm_set1_ps(in_scale);
+			for (; i + 4 <= count; i += 4)
+				_mm_storeu_ps(out + i, exp2_four<close>(_mm_mul_ps(
+					_mm_loadu_ps(in + i), scale)));
+#endif
+			for (; i < count; i++)
+				out[i] = exp2_one<close>(in[i] * in_scale);
+		}
+
+		template<bool close> void log2_batch(const float* in, float* out,
+			const int count, const float out_scale)
+		{
+			int i = 0;
+#ifdef __SSE2__
+			const __m128 scale = _mm_set1_ps(out_scale);
+			for (; i + 4 <= count; i += 4)
+				_mm_storeu_ps(out + i, _mm_mul_ps(log2_four<close>(
+					_mm_loadu_ps(in + i)), scale));
+#endif
+			for (; i < count; i++)
+				out[i] = log2_one<close>(in[i]) * out_scale;
+		}
+
+		template<bool close> void powf_batch(const float* base,
+			const float* power, float* out, const int count)
+		{
+			int i = 0;
+#ifdef __SSE2__
+			for (; i + 4 <= count; i += 4)
+				_mm_storeu_ps(out + i, exp2_four<close>(_mm_mul_ps(
+					_mm_loadu_ps(power + i), log2_four<close>(
+					_mm_loadu_ps(base + i)))));
+#endif
+			for (; i < count; i++)
+				out[i] = exp2_one<close>(power[i] * log2_one<close>(base[i]));
+		}
+
+		template<bool close> void sincos_batch(const float* angle,
+			float* sin_out, float* cos_out, const int count)
+		{
+			int i = 0;
+#ifdef __SSE2__
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128 s, c;
+				sincos_four<close>(_mm_loadu_ps(angle + i), s, c);
+				_mm_storeu_ps(sin_out + i, s);
+				_mm_storeu_ps(cos_out + i, c);
+			}
+#endif
+			for (; i < count; i++)
+				sincos_one<close>(angle[i], sin_out[i], cos_out[i]);
+		}
+
+		// Keeps the benchmark loops from being optimized away.
+		volatile float benchmark_sink;
+
+		float checksum(const std::vector<float>& values)
+		{
+			float ret = 0.0f;
+			for (int i = 0; i < (int)values.size(); i += 97)
+				ret += values[i];
+			return ret;
+		}
+
+		float max_abs_error(const std::vector<float>& a,
+			const std::vector<float>& b, const bool relative)
+		{
+			float ret = 0.0f;
+			for (int i = 0; i < (int)a.size(); i++)
+			{
+				float error = fabs(a[i] - b[i]);
+				if (relative && (b[i] != 0.0f))
+					error /= fabs(b[i]);
+				ret = std::max(ret, error);
+			}
+			return ret;
+		}
+
+	}
+
 	// C L A S S   F U N C T I O N S //////////////////////////////////////////////
 
+	void MathCache::exp2_rough(const float* in, float* out, const int count)
+	{
+		exp2_batch<false>(in, out, count, 1.0f);
+	}
+
+	void MathCache::exp2_close(const float* in, float* out, const int count)
+	{
+		exp2_batch<true>(in, out, count, 1.0f);
+	}
+
+	void MathCache::exp_rough(const float* in, float* out, const int count)
+	{
+		exp2_batch<false>(in, out, count, LOG2E);
+	}
+
+	void MathCache::exp_close(const float* in, float* out, const int count)
+	{
+		exp2_batch<true>(in, out, count, LOG2E);
+	}
+
+	void MathCache::log2_rough(const float* in, float* out, const int count)
+	{
+		log2_batch<false>(in, out, count, 1.0f);
+	}
+
+	void MathCache::log2_close(const float* in, float* out, const int count)
+	{
+		log2_batch<true>(in, out, count, 1.0f);
+	}
+
+	void MathCache::log_rough(const float* in, float* out, const int count)
+	{
+		log2_batch<false>(in, out, count, LN2);
+	}
+
+	void MathCache::log_close(const float* in, float* out, const int count)
+	{
+		log2_batch<true>(in, out, count, LN2);
+	}
+
+	void MathCache::powf_05_rough(const float* power, float* out,
+		const int count)
+	{
+		exp2_batch<false>(power, out, count, -1.0f);
+	}
+
+	void MathCache::powf_05_close(const float* power, float* out,
+		const int count)
+	{
+		exp2_batch<true>(power, out, count, -1.0f);
+	}
+
+	void MathCache::powf_rough(const float* base, const float* power,
+		float* out, const int count)
+	{
+		powf_batch<false>(base, power, out, count);
+	}
+
+	void MathCache::powf_close(const float* base, const float* power,
+		float* out, const int count)
+	{
+		powf_batch<true>(base, power, out, count);
+	}
+
+	void MathCache::sincos_rough(const float* angle, float* sin_out,
+		float* cos_out, const int count)
+	{
+		sincos_batch<false>(angle, sin_out, cos_out, count);
+	}
+
+	void MathCache::sincos_close(const float* angle, float* sin_out,
+		float* cos_out, const int count)
+	{
+		sincos_batch<true>(angle, sin_out, cos_out, count);
+	}
+
+	void MathCache::invsqrt_rough(const float* in, float* out, const int count)
+	{
+		int i = 0;
+#ifdef __SSE2__
+		for (; i + 4 <= count; i += 4)
+			_mm_storeu_ps(out + i, _mm_rsqrt_ps(_mm_loadu_ps(in + i)));
+#endif
+		for (; i < count; i++)
+			out[i] = invsqrt_rough_one(in[i]);
+	}
+
+	void MathCache::invsqrt_close(const float* in, float* out, const int count)
+	{
+		int i = 0;
+#ifdef __SSE2__
+		// One Newton-Raphson step on top of the 12 bit estimate.
+		const __m128 half = _mm_set1_ps(0.5f);
+		const __m128 three_halves = _mm_set1_ps(1.5f);
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128 x = _mm_loadu_ps(in + i);
+			const __m128 y = _mm_rsqrt_ps(x);
+			_mm_storeu_ps(out + i, _mm_mul_ps(y, _mm_sub_ps(three_halves,
+				_mm_mul_ps(_mm_mul_ps(half, x), _mm_mul_ps(y, y)))));
+		}
+#endif
+		for (; i < count; i++)
+			out[i] = 1.0f / sqrt(in[i]);
+	}
+
+	void MathCache::benchmark(char* buffer, const size_t len)
+	{
+		const int count = 4096;
+		const int passes = 64;
+		std::vector<float> in(count), negated(count), base(count),
+			power(count), reference(count), reference2(count), rough(count),
+			rough2(count), close(count), close2(count);
+		Uint64 start, libm_time, rough_time, close_time;
+		float rough_error, close_error;
+		int i, pass;
+		size_t used = 0;
+
+		for (i = 0; i < count; i++)
+		{
+			in[i] = randfloat(20.0f);
+			negated[i] = -in[i];
+			base[i] = randfloat(4.0f) + 0.001f;
+			power[i] = -in[i] * 0.25f;
+		}
+
+#define EC_MATH_BENCH(name, reference_loop, rough_call, close_call, relative, extra_check) \
+		start = get_time(); \
+		for (pass = 0; pass < passes; pass++) \
+			for (i = 0; i < count; i++) \
+				reference_loop; \
+		libm_time = get_time() - start + 1; \
+		start = get_time(); \
+		for (pass = 0; pass < passes; pass++) \
+			rough_call; \
+		rough_time = get_time() - start; \
+		start = get_time(); \
+		for (pass = 0; pass < passes; pass++) \
+			close_call; \
+		close_time = get_time() - start; \
+		benchmark_sink = checksum(reference) + checksum(rough) + checksum(close); \
+		rough_error = max_abs_error(rough, reference, relative); \
+		close_error = max_abs_error(close, reference, relative); \
+		extra_check; \
+		if (used < len) \
+			used += snprintf(buffer + used, len - used, \
+				"%s%s: rough %.2fx (%.1e), close %.2fx (%.1e)", \
+				used ? "; " : "", name, \
+				(float)rough_time / libm_time, rough_error, \
+				(float)close_time / libm_time, close_error);
+
+		EC_MATH_BENCH("powf_05", reference[i] = std::pow(0.5f, in[i]),
+			powf_05_rough(&in[0], &rough[0], count),
+			powf_05_close(&in[0], &close[0], count), true, (void)0)
+		EC_MATH_BENCH("exp", reference[i] = std::exp(negated[i]),
+			exp_rough(&negated[0], &rough[0], count),
+			exp_close(&negated[0], &close[0], count), true, (void)0)
+		EC_MATH_BENCH("log", reference[i] = std::log(base[i]),
+			log_rough(&base[0], &rough[0], count),
+			log_close(&base[0], &close[0], count), false, (void)0)
+		EC_MATH_BENCH("pow", reference[i] = std::pow(base[i], power[i]),
+			powf_rough(&base[0], &power[0], &rough[0], count),
+			powf_close(&base[0], &power[0], &close[0], count), true, (void)0)
+		EC_MATH_BENCH("sincos", reference[i] = std::sin(in[i]);
+			reference2[i] = std::cos(in[i]),
+			sincos_rough(&in[0], &rough[0], &rough2[0], count),
+			sincos_close(&in[0], &close[0], &close2[0], count), false,
+			// the cosines have to be right as well
+			rough_error = std::max(rough_error, max_abs_error(rough2, reference2, false));
+			close_error = std::max(close_error, max_abs_error(close2, reference2, false)))
+		EC_MATH_BENCH("invsqrt", reference[i] = 1.0f / std::sqrt(base[i]),
+			invsqrt_rough(&base[0], &rough[0], count),
+			invsqrt_close(&base[0], &close[0], count), true, (void)0)
+
+#undef EC_MATH_BENCH
+	}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 }
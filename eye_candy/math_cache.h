@@ -258,6 +258,49 @@ namespace ec
 			}
 			;
 
+			/*
+			 Batched kernels.  These work on whole arrays of particle
+			 attributes at once, four lanes at a time when SSE2 is available
+			 and with a scalar fallback using the same polynomials otherwise,
+			 so the results barely depend on the build.  in and out may be
+			 the same array.
+
+			 As with the old cache, "rough" trades accuracy for speed and
+			 "close" is good enough for anything visible.  Measured maximum
+			 errors against libm over the documented input ranges:
+
+			 exp2 (|x| < 126):       rough 6e-5 rel, close 1e-7 rel
+			 exp:                    as exp2, plus ~|x| ulp from scaling x
+			 log2/log (x > 0):       rough 9e-5 abs, close 6e-7 abs
+			 powf_05 (x >= 0):       same as exp2
+			 powf (base > 0):        log2 error times |power|, then exp2
+			 sincos (|x| < 1e4):     rough 4e-5 abs, close 1e-7 abs
+			 invsqrt (x > 0):        rough 2e-3 rel (4e-4 with SSE), close 3e-7 rel
+
+			 Inputs outside those ranges are clamped (exp2) or give garbage
+			 (log2 of non-positive values); none of these check for NaN.
+			 */
+			static void exp2_rough(const float* in, float* out, const int count);
+			static void exp2_close(const float* in, float* out, const int count);
+			static void exp_rough(const float* in, float* out, const int count);
+			static void exp_close(const float* in, float* out, const int count);
+			static void log2_rough(const float* in, float* out, const int count);
+			static void log2_close(const float* in, float* out, const int count);
+			static void log_rough(const float* in, float* out, const int count);
+			static void log_close(const float* in, float* out, const int count);
+			static void powf_05_rough(const float* power, float* out, const int count);
+			static void powf_05_close(const float* power, float* out, const int count);
+			static void powf_rough(const float* base, const float* power, float* out, const int count);
+			static void powf_close(const float* base, const float* power, float* out, const int count);
+			static void sincos_rough(const float* angle, float* sin_out, float* cos_out, const int count);
+			static void sincos_close(const float* angle, float* sin_out, float* cos_out, const int count);
+			static void invsqrt_rough(const float* in, float* out, const int count);
+			static void invsqrt_close(const float* in, float* out, const int count);
+
+			// Times the kernels above against libm and reports both the
+			// speed ratio and the worst error seen.
+			static void benchmark(char* buffer, const size_t len);
+
 	};
 
 ////////////////////////////////////////////////////////////////////////////////
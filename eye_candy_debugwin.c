@@ -144,6 +144,9 @@ int ecdw_explosive_arrow_button_id = 11201;
 int ecdw_harv_tool_break_button_id = 11202;
 int ecdw_wind_leaves_button_id = 11203;
 int ecdw_clouds_button_id = 12204;
+int ecdw_bench_burst_button_id = 12205;
+int ecdw_bench_stats_button_id = 12206;
+int ecdw_bench_math_button_id = 12207;
 
 int ecdw_restoration_handler();
 int ecdw_shield_handler();
@@ -249,6 +252,9 @@ int ecdw_explosive_arrow_handler();
 int ecdw_harv_tool_break_handler();
 int ecdw_wind_leaves_handler();
 int ecdw_clouds_handler();
+int ecdw_bench_burst_handler();
+int ecdw_bench_stats_handler();
+int ecdw_bench_math_handler();
 
 void display_ecdebugwin()
 {
@@ -696,6 +702,18 @@ void display_ecdebugwin()
 			ecdw_ongoing_clear_button_id, 
 			NULL, button_x + button_x_shift * 2, button_y + button_y_shift * 3,
 			button_width, 0, 0, 1.0f, 0.77f, 0.57f, 0.39f, "clear OG");
+		ecdw_bench_burst_button_id = button_add_extended(tab_misc,
+			ecdw_bench_burst_button_id, 
+			NULL, button_x + button_x_shift * 2, button_y + button_y_shift * 1,
+			button_width, 0, 0, 1.0f, 0.77f, 0.57f, 0.39f, "bench burst");
+		ecdw_bench_stats_button_id = button_add_extended(tab_misc,
+			ecdw_bench_stats_button_id, 
+			NULL, button_x + button_x_shift * 2, button_y + button_y_shift * 2,
+			button_width, 0, 0, 1.0f, 0.77f, 0.57f, 0.39f, "bench stats");
+		ecdw_bench_math_button_id = button_add_extended(tab_misc,
+			ecdw_bench_math_button_id, 
+			NULL, button_x + button_x_shift * 0, button_y + button_y_shift * 3,
+			button_width, 0, 0, 1.0f, 0.77f, 0.57f, 0.39f, "bench math");
 
 		// arrow effect buttons
 		ecdw_normal_arrow_button_id = button_add_extended(tab_arrows,
@@ -929,6 +947,12 @@ void display_ecdebugwin()
 			ecdw_ongoing_shield_handler);
 		widget_set_OnClick(tab_misc, ecdw_ongoing_harvesting_button_id,
 			ecdw_ongoing_harvesting_handler);
+		widget_set_OnClick(tab_misc, ecdw_bench_burst_button_id,
+			ecdw_bench_burst_handler);
+		widget_set_OnClick(tab_misc, ecdw_bench_stats_button_id,
+			ecdw_bench_stats_handler);
+		widget_set_OnClick(tab_misc, ecdw_bench_math_button_id,
+			ecdw_bench_math_handler);
 
 		// arrow effect handlers
 		widget_set_OnClick(tab_arrows, ecdw_normal_arrow_button_id, ecdw_normal_arrow_handler);
@@ -2355,4 +2379,50 @@ int ecdw_clouds_handler()
 	return 1;
 }
 
+/* Fire a representative spell-heavy burst with fresh counters, read the
+ * result back with "bench stats" once the effects have died down. */
+int ecdw_bench_burst_handler()
+{
+	ec_reset_stats();
+	ecdw_restoration_handler();
+	ecdw_shield_handler();
+	ecdw_heal_handler();
+	ecdw_b2g_handler();
+	ecdw_magic_immunity_handler();
+	ecdw_magic_protection_handler();
+	ecdw_remote_heal_handler();
+	ecdw_poison_handler();
+	ecdw_harm_handler();
+	ecdw_mana_drain_handler();
+	ecdw_life_drain_handler();
+	ecdw_breathe_fire_handler();
+	ecdw_breathe_ice_handler();
+	ecdw_breathe_lightning_handler();
+	ecdw_harv_rare_stone_handler();
+	ecdw_level_up_oa_handler();
+	ecdw_alert_handler();
+	return 1;
+}
+
+int ecdw_bench_stats_handler()
+{
+	char str[256];
+
+	ec_get_stats(str, sizeof(str));
+	LOG_TO_CONSOLE(c_green1, str);
+	ec_obstruction_benchmark(str, sizeof(str));
+	LOG_TO_CONSOLE(c_green1, str);
+	return 1;
+}
+
+/* Time the batched math kernels against libm; ratios below 1 are wins. */
+int ecdw_bench_math_handler()
+{
+	char str[512];
+
+	ec_math_benchmark(str, sizeof(str));
+	LOG_TO_CONSOLE(c_green1, str);
+	return 1;
+}
+
 #endif // ECDEBUGWIN
@@ -1,5 +1,6 @@
 // I N C L U D E S ////////////////////////////////////////////////////////////
 
+#include <algorithm>
 #include "eye_candy_wrapper.h"
 #include "cal.h"
 #include "cal3d_wrapper.h"
@@ -37,6 +38,7 @@ extern "C"
 	int light_columns_threshold = 5;
 	int use_fancy_smoke = 1;
 	int max_idle_cycles_per_second = 40;
+	int ec_idle_threads = 0;
 }
 
 ec::EyeCandy eye_candy;
@@ -52,11 +54,21 @@ const float SWORD_BLADE_LENGTH = 0.5;
 const float X_OFFSET = 0.25;
 const float Y_OFFSET = 0.25;
 
+// Obstructions are kept in a uniform grid over the ground plane, so that
+// an effect only checks its particles against the obstructions near it.
+// The grid wraps around: distant cells share a bucket, and queries filter
+// the entries by distance.
+const float OBSTRUCTION_CELL_SIZE = 4.0;
+const int OBSTRUCTION_GRID_SIZE = 64; // power of two
+const float OBSTRUCTION_QUERY_MARGIN = 4.0; // how far particles stray from the effect
+
 ec_object_obstructions object_obstructions;
 ec_actor_obstructions actor_obstructions;
 ec_actor_obstruction self_actor;
-std::vector<ec::Obstruction*> general_obstructions_list;
-std::vector<ec::Obstruction*> fire_obstructions_list;
+std::map<object3d*, ec_object_obstruction*> obstructions_by_object;
+std::map<e3d_object*, int> obstructions_per_e3d;
+std::vector<ec_obstruction_entry*> obstruction_grid[OBSTRUCTION_GRID_SIZE * OBSTRUCTION_GRID_SIZE];
+Uint32 obstruction_query_stamp = 0;
 bool force_idle = false;
 volatile bool idle_semaphore = false;
 
@@ -83,6 +95,172 @@ extern "C" void ec_load_textures()
 	eye_candy.load_textures();
 }
 
+static int ec_obstruction_cell(const float coord)
+{
+	return (int)floor(coord / OBSTRUCTION_CELL_SIZE);
+}
+
+static std::vector<ec_obstruction_entry*>& ec_obstruction_bucket(const int x, const int z)
+{
+	return obstruction_grid[(x & (OBSTRUCTION_GRID_SIZE - 1)) + (z & (OBSTRUCTION_GRID_SIZE - 1)) * OBSTRUCTION_GRID_SIZE];
+}
+
+static void ec_grid_insert(ec_obstruction_entry* entry)
+{
+	entry->min_cell_x = ec_obstruction_cell(entry->x - entry->radius);
+	entry->min_cell_z = ec_obstruction_cell(entry->z - entry->radius);
+	// a huge object would wrap around onto itself
+	entry->max_cell_x = std::min(ec_obstruction_cell(entry->x + entry->radius), entry->min_cell_x + OBSTRUCTION_GRID_SIZE - 1);
+	entry->max_cell_z = std::min(ec_obstruction_cell(entry->z + entry->radius), entry->min_cell_z + OBSTRUCTION_GRID_SIZE - 1);
+	for (int x = entry->min_cell_x; x <= entry->max_cell_x; x++)
+		for (int z = entry->min_cell_z; z <= entry->max_cell_z; z++)
+			ec_obstruction_bucket(x, z).push_back(entry);
+	entry->in_grid = true;
+}
+
+static void ec_grid_remove(ec_obstruction_entry* entry)
+{
+	if (!entry->in_grid)
+		return;
+	for (int x = entry->min_cell_x; x <= entry->max_cell_x; x++)
+	{
+		for (int z = entry->min_cell_z; z <= entry->max_cell_z; z++)
+		{
+			std::vector<ec_obstruction_entry*>& bucket = ec_obstruction_bucket(x, z);
+			std::vector<ec_obstruction_entry*>::iterator iter = std::find(bucket.begin(), bucket.end(), entry);
+			if (iter != bucket.end())
+			{
+				*iter = bucket.back();
+				bucket.pop_back();
+			}
+		}
+	}
+	entry->in_grid = false;
+}
+
+static void ec_grid_move(ec_obstruction_entry* entry, const float x, const float z)
+{
+	entry->x = x;
+	entry->z = z;
+	if (entry->in_grid
+		&& ec_obstruction_cell(x - entry->radius) == entry->min_cell_x
+		&& ec_obstruction_cell(z - entry->radius) == entry->min_cell_z
+		&& ec_obstruction_cell(x + entry->radius) == entry->max_cell_x
+		&& ec_obstruction_cell(z + entry->radius) == entry->max_cell_z)
+		return;
+	ec_grid_remove(entry);
+	ec_grid_insert(entry);
+}
+
+static void ec_init_obstruction_entry(ec_obstruction_entry* entry, ec::Obstruction* obstruction, const float x, const float z, const float radius, const bool fire_related)
+{
+	entry->obstruction = obstruction;
+	entry->x = x;
+	entry->z = z;
+	entry->radius = radius;
+	entry->fire_related = fire_related;
+	entry->in_grid = false;
+	entry->query_stamp = obstruction_query_stamp;
+	ec_grid_insert(entry);
+}
+
+// Collect the obstructions whose area of effect overlaps the rectangle.
+static void ec_grid_query(const float min_x, const float min_z, const float max_x, const float max_z, const bool fire_only, std::vector<ec::Obstruction*>& obstructions)
+{
+	const int min_cell_x = ec_obstruction_cell(min_x);
+	const int min_cell_z = ec_obstruction_cell(min_z);
+	const int max_cell_x = std::min(ec_obstruction_cell(max_x), min_cell_x + OBSTRUCTION_GRID_SIZE - 1);
+	const int max_cell_z = std::min(ec_obstruction_cell(max_z), min_cell_z + OBSTRUCTION_GRID_SIZE - 1);
+
+	// entries spanning several cells are only added once
+	obstruction_query_stamp++;
+	obstructions.clear();
+	for (int x = min_cell_x; x <= max_cell_x; x++)
+	{
+		for (int z = min_cell_z; z <= max_cell_z; z++)
+		{
+			const std::vector<ec_obstruction_entry*>& bucket = ec_obstruction_bucket(x, z);
+			for (std::vector<ec_obstruction_entry*>::const_iterator iter = bucket.begin(); iter != bucket.end(); iter++)
+			{
+				ec_obstruction_entry* entry = *iter;
+				if (entry->query_stamp == obstruction_query_stamp)
+					continue;
+				entry->query_stamp = obstruction_query_stamp;
+				if (fire_only && !entry->fire_related)
+					continue;
+				const float dx = entry->x - std::max(min_x, std::min(entry->x, max_x));
+				const float dz = entry->z - std::max(min_z, std::min(entry->z, max_z));
+				if (dx * dx + dz * dz <= entry->radius * entry->radius)
+					obstructions.push_back(entry->obstruction);
+			}
+		}
+	}
+}
+
+// Refresh the obstructions an effect checks its particles against.
+static void ec_update_obstructions(ec_internal_reference* ref)
+{
+	float min_x = ref->position.x, max_x = ref->position.x;
+	float min_z = ref->position.z, max_z = ref->position.z;
+	float margin = OBSTRUCTION_QUERY_MARGIN;
+
+	if (ref->obstruction_type == EC_OBSTRUCTIONS_ALONG)
+	{
+		min_x = std::min(min_x, ref->position2.x);
+		max_x = std::max(max_x, ref->position2.x);
+		min_z = std::min(min_z, ref->position2.z);
+		max_z = std::max(max_z, ref->position2.z);
+		for (std::vector<ec::Vec3>::const_iterator iter = ref->targets.begin(); iter != ref->targets.end(); iter++)
+		{
+			min_x = std::min(min_x, iter->x);
+			max_x = std::max(max_x, iter->x);
+			min_z = std::min(min_z, iter->z);
+			max_z = std::max(max_z, iter->z);
+		}
+	}
+	for (std::vector<ec::SmoothPolygonElement>::const_iterator iter = ref->bounds.elements.begin(); iter != ref->bounds.elements.end(); iter++)
+		margin = std::max(margin, (float)iter->radius + OBSTRUCTION_QUERY_MARGIN);
+
+	ec_grid_query(min_x - margin, min_z - margin, max_x + margin, max_z + margin, ref->obstruction_type == EC_FIRE_OBSTRUCTIONS, ref->obstructions);
+}
+
+static std::vector<ec::Obstruction*>* ec_get_obstructions(ec_internal_reference* ref, const ec_obstruction_type type)
+{
+	ref->obstruction_type = type;
+	ec_update_obstructions(ref);
+	return &ref->obstructions;
+}
+
+// Drop an obstruction that is about to be deleted from the effects.
+static void ec_forget_obstruction(const ec::Obstruction* obstruction)
+{
+	for (std::vector<ec_internal_reference*>::iterator iter = references.begin(); iter != references.end(); iter++)
+	{
+		std::vector<ec::Obstruction*>& obstructions = (*iter)->obstructions;
+		std::vector<ec::Obstruction*>::iterator iter2 = std::find(obstructions.begin(), obstructions.end(), obstruction);
+		if (iter2 != obstructions.end())
+			obstructions.erase(iter2);
+	}
+}
+
+static void ec_delete_object_obstruction(ec_object_obstruction* obstruction)
+{
+	// keep object_obstructions packed by moving the last one in its place
+	ec_object_obstruction* last = object_obstructions.back();
+	last->index = obstruction->index;
+	object_obstructions[obstruction->index] = last;
+	object_obstructions.pop_back();
+
+	obstructions_by_object.erase(obstruction->obj3d);
+	if (--obstructions_per_e3d[obstruction->e3dobj] <= 0)
+		obstructions_per_e3d.erase(obstruction->e3dobj);
+
+	ec_grid_remove(&obstruction->entry);
+	ec_forget_obstruction(obstruction->obstruction);
+	delete obstruction->obstruction;
+	delete obstruction;
+}
+
 extern "C" void ec_init()
 {
 	eye_candy.load_textures();
@@ -92,6 +270,7 @@ extern "C" void ec_init()
 	ec_set_draw_method();
 #endif	/* NEW_TEXTURES */
 	self_actor.obstruction = new ec::CappedSimpleCylinderObstruction(&(self_actor.center), 0.45, 3.0, self_actor.center.y, self_actor.center.y + 0.9);
+	ec_init_obstruction_entry(&self_actor.entry, self_actor.obstruction, self_actor.center.x, self_actor.center.z, 0.45, false);
 
 #ifdef MAP_EDITOR
 	ec::SmoothPolygonElement e(0.0, 25.0);
@@ -136,6 +315,7 @@ void set_vec3_actor_bone(ec::Vec3& position, actor* _actor, int bone,
 {
 	float points[1024][3];
 
+	cal_update_actor_skeleton(_actor, 1);
 	const int num_bones = CalSkeleton_GetBonePoints(
 		CalModel_GetSkeleton(_actor->calmodel), &points[0][0]);
 	if (num_bones <= bone)
@@ -472,6 +652,7 @@ extern "C" void ec_idle()
 
 	if ((unsigned int)(ec::get_time() % 1000000) >= (unsigned int)(1000000 * idle_cycles_this_second / max_idle_cycles_per_second))
 	{
+		eye_candy.set_idle_threads(ec_idle_threads);
 		eye_candy.idle();
 		idle_cycles_this_second++;
 	}
@@ -485,8 +666,6 @@ extern "C" void ec_heartbeat()
 	//  if (!((int)(ec_cur_time / 1000000.0) % 9))
 	//    ec_create_breath_fire(44.75, 38.0, 1.0, 44.75, 43.0, 0.6, 2, 1.5);
 	idle_cycles_this_second = 0;
-	general_obstructions_list.clear();
-	fire_obstructions_list.clear();
 	for (ec_object_obstructions::iterator iter = object_obstructions.begin(); iter != object_obstructions.end(); iter++)
 	{
 		(*iter)->center.x = (*iter)->obj3d->x_pos;
@@ -512,9 +691,7 @@ extern "C" void ec_heartbeat()
 		(*iter)->cos_rot_y2 = cos(-(*iter)->obj3d->z_rot * (ec::PI / 180));
 		(*iter)->sin_rot_z2 = sin(((*iter)->obj3d->y_rot * (ec::PI / 180)));
 		(*iter)->cos_rot_z2 = cos(((*iter)->obj3d->y_rot * (ec::PI / 180)));
-		general_obstructions_list.push_back((*iter)->obstruction);
-		if ((*iter)->fire_related)
-			fire_obstructions_list.push_back((*iter)->obstruction);
+		ec_grid_move(&(*iter)->entry, (*iter)->center.x, (*iter)->center.z);
 	}
 	for (ec_actor_obstructions::iterator iter = actor_obstructions.begin(); iter != actor_obstructions.end(); iter++)
 	{
@@ -527,13 +704,88 @@ extern "C" void ec_heartbeat()
 		(*iter)->center.x += X_OFFSET;
 		(*iter)->center.y += Y_OFFSET;
 		(*iter)->center.z -= 0.25;
-		general_obstructions_list.push_back((*iter)->obstruction);
+		ec_grid_move(&(*iter)->entry, (*iter)->center.x, (*iter)->center.z);
 	}
 	// Last but not least... the actor.
 	self_actor.center.x = -camera_x;
 	self_actor.center.y = -camera_z;
 	self_actor.center.z = camera_y;
-	general_obstructions_list.push_back(self_actor.obstruction);
+	ec_grid_move(&self_actor.entry, self_actor.center.x, self_actor.center.z);
+
+	for (std::vector<ec_internal_reference*>::iterator iter = references.begin(); iter != references.end(); iter++)
+	{
+		if (!(*iter)->dead && (*iter)->obstruction_type != EC_NO_OBSTRUCTIONS)
+			ec_update_obstructions(*iter);
+	}
+}
+
+extern "C" void ec_reset_stats()
+{
+	ec::ParticlePool::reset_stats();
+	eye_candy.idle_usec = 0;
+	eye_candy.idle_calls = 0;
+}
+
+extern "C" void ec_get_stats(char* buffer, size_t len)
+{
+	const float usec_per_idle = eye_candy.idle_calls ? (float)eye_candy.idle_usec / eye_candy.idle_calls : 0.0f;
+
+	snprintf(buffer, len, "Eye candy: %u effects, %u particles, %u allocated (%u recycled, %u slabs, %u live), %.1f usec per idle over %u idles",
+		(unsigned int)eye_candy.effects.size(), (unsigned int)eye_candy.particles.size(),
+		(unsigned int)ec::ParticlePool::allocations, (unsigned int)ec::ParticlePool::reused,
+		(unsigned int)ec::ParticlePool::slabs, (unsigned int)ec::ParticlePool::live,
+		usec_per_idle, (unsigned int)eye_candy.idle_calls);
+}
+
+extern "C" void ec_math_benchmark(char* buffer, size_t len)
+{
+	ec::MathCache::benchmark(buffer, len);
+}
+
+extern "C" void ec_obstruction_benchmark(char* buffer, size_t len)
+{
+	const int queries = 1000;
+	const ec::Vec3 camera(-camera_x, -camera_z, camera_y);
+	std::vector<ec::Obstruction*> found;
+	unsigned int near_camera = 1; // ourselves
+	unsigned int found_total = 0, effects = 0, checked_total = 0;
+
+	// Before the grid, every effect checked all obstructions near the camera
+	for (ec_object_obstructions::const_iterator iter = object_obstructions.begin(); iter != object_obstructions.end(); iter++)
+	{
+		if (((*iter)->center - camera).magnitude_squared() <= MAX_OBSTRUCT_DISTANCE_SQUARED)
+			near_camera++;
+	}
+	for (ec_actor_obstructions::const_iterator iter = actor_obstructions.begin(); iter != actor_obstructions.end(); iter++)
+	{
+		if (((*iter)->center - camera).magnitude_squared() <= MAX_OBSTRUCT_DISTANCE_SQUARED)
+			near_camera++;
+	}
+
+	// Query the surroundings of effects placed at random around the camera
+	const Uint64 start = ec::get_time();
+	for (int i = 0; i < queries; i++)
+	{
+		const float x = camera.x + ec::randfloat(2 * MAX_EFFECT_DISTANCE) - MAX_EFFECT_DISTANCE;
+		const float z = camera.z + ec::randfloat(2 * MAX_EFFECT_DISTANCE) - MAX_EFFECT_DISTANCE;
+		ec_grid_query(x - OBSTRUCTION_QUERY_MARGIN, z - OBSTRUCTION_QUERY_MARGIN, x + OBSTRUCTION_QUERY_MARGIN, z + OBSTRUCTION_QUERY_MARGIN, false, found);
+		found_total += found.size();
+	}
+	const Uint64 query_time = ec::get_time() - start;
+
+	for (std::vector<ec_internal_reference*>::const_iterator iter = references.begin(); iter != references.end(); iter++)
+	{
+		if (!(*iter)->dead && (*iter)->obstruction_type != EC_NO_OBSTRUCTIONS)
+		{
+			effects++;
+			checked_total += (*iter)->obstructions.size();
+		}
+	}
+
+	snprintf(buffer, len, "Obstructions: %u objects, %u actors, %u near the camera; grid query %.2f usec returning %.1f; %u live effects check %.1f each",
+		(unsigned int)object_obstructions.size(), (unsigned int)actor_obstructions.size() + 1, near_camera,
+		(float)query_time / queries, (float)found_total / queries,
+		effects, effects ? (float)checked_total / effects : 0.0f);
 }
 
 extern "C" void ec_draw()
@@ -615,14 +867,8 @@ extern "C" void ec_actor_delete(actor* _actor)
 	{
 		if ((*iter)->obstructing_actor == _actor)
 		{
-			for (std::vector<ec::Obstruction*>::iterator iter2 = general_obstructions_list.begin(); iter2 != general_obstructions_list.end(); iter2++)
-			{
-				if (*iter2 == (*iter)->obstruction)
-				{
-					general_obstructions_list.erase(iter2);
-					break;
-				}
-			}
+			ec_grid_remove(&(*iter)->entry);
+			ec_forget_obstruction((*iter)->obstruction);
 			delete (*iter)->obstruction;
 			delete *iter;
 			actor_obstructions.erase(iter);
@@ -655,7 +901,9 @@ extern "C" void ec_destroy_all_effects()
 	}
 	if (!references.empty()) // unlikely to happen but just so we don't get stick on exit.
 		LOG_ERROR("%s: failed to clear up. references.size()=%lu", __PRETTY_FUNCTION__, references.size());
+	ec_grid_remove(&self_actor.entry);
 	delete self_actor.obstruction;
+	eye_candy.set_idle_threads(0);
 }
 
 
@@ -765,18 +1013,22 @@ extern "C" void ec_clear_obstruction_list()
 {
 	for (ec_object_obstructions::iterator iter = object_obstructions.begin(); iter != object_obstructions.end(); iter++)
 	{
+		ec_grid_remove(&(*iter)->entry);
 		delete (*iter)->obstruction;
 		delete *iter;
 	}
 	object_obstructions.clear();
+	obstructions_by_object.clear();
+	obstructions_per_e3d.clear();
 	for (ec_actor_obstructions::iterator iter = actor_obstructions.begin(); iter != actor_obstructions.end(); iter++)
 	{
+		ec_grid_remove(&(*iter)->entry);
 		delete (*iter)->obstruction;
 		delete *iter;
 	}
 	actor_obstructions.clear();
-	general_obstructions_list.clear();
-	fire_obstructions_list.clear();
+	for (std::vector<ec_internal_reference*>::iterator iter = references.begin(); iter != references.end(); iter++)
+		(*iter)->obstructions.clear();
 }
 
 extern "C" void ec_add_object_obstruction(object3d* obj3d, e3d_object *e3dobj, float force)
@@ -818,7 +1070,13 @@ extern "C" void ec_add_object_obstruction(object3d* obj3d, e3d_object *e3dobj, f
 	else if (!strncmp(obj3d->file_name + 2, "trees/fire", 10))
 		obstruction->fire_related = true;
 	obstruction->obstruction = new ec::BoxObstruction(ec::Vec3(e3dobj->min_x, e3dobj->min_z, -e3dobj->max_y), ec::Vec3(e3dobj->max_x, e3dobj->max_z, -e3dobj->min_y), &(obstruction->center), &(obstruction->sin_rot_x), &(obstruction->cos_rot_x), &(obstruction->sin_rot_y), &(obstruction->cos_rot_y), &(obstruction->sin_rot_z), &(obstruction->cos_rot_z), &(obstruction->sin_rot_x2), &(obstruction->cos_rot_x2), &(obstruction->sin_rot_y2), &(obstruction->cos_rot_y2), &(obstruction->sin_rot_z2), &(obstruction->cos_rot_z2), force);
+	// the box obstruction acts within half its diagonal of the center
+	const float radius = ec::Vec3(e3dobj->max_x - e3dobj->min_x, e3dobj->max_z - e3dobj->min_z, e3dobj->max_y - e3dobj->min_y).magnitude() / 2;
+	ec_init_obstruction_entry(&obstruction->entry, obstruction->obstruction, obstruction->center.x, obstruction->center.z, radius, obstruction->fire_related);
+	obstruction->index = object_obstructions.size();
 	object_obstructions.push_back(obstruction);
+	obstructions_by_object[obj3d] = obstruction;
+	obstructions_per_e3d[e3dobj]++;
 }
 
 extern "C" void ec_add_actor_obstruction(actor* _actor, float force)
@@ -827,64 +1085,27 @@ extern "C" void ec_add_actor_obstruction(actor* _actor, float force)
 	obstruction->obstructing_actor = _actor;
 	obstruction->center = ec::Vec3(_actor->x_pos + X_OFFSET, ec_get_z(_actor), -(_actor->y_pos + Y_OFFSET));
 	obstruction->obstruction = new ec::CappedSimpleCylinderObstruction(&(obstruction->center), 0.55, force, obstruction->center.y, obstruction->center.y + 0.9);
+	ec_init_obstruction_entry(&obstruction->entry, obstruction->obstruction, obstruction->center.x, obstruction->center.z, 0.55, false);
 	actor_obstructions.push_back(obstruction);
 }
 
 extern "C" void ec_remove_obstruction_by_object3d(object3d* obj3d)
 {
-	for (ec_object_obstructions::iterator iter = object_obstructions.begin(); iter != object_obstructions.end(); iter++)
-	{
-		if ((*iter)->obj3d == obj3d)
-		{
-			for (std::vector<ec::Obstruction*>::iterator iter2 = general_obstructions_list.begin(); iter2 != general_obstructions_list.end(); iter2++)
-			{
-				if (*iter2 == (*iter)->obstruction)
-				{
-					general_obstructions_list.erase(iter2);
-					break;
-				}
-			}
-			for (std::vector<ec::Obstruction*>::iterator iter2 = fire_obstructions_list.begin(); iter2 != fire_obstructions_list.end(); iter2++)
-			{
-				if (*iter2 == (*iter)->obstruction)
-				{
-					fire_obstructions_list.erase(iter2);
-					break;
-				}
-			}
-			delete (*iter)->obstruction;
-			delete *iter;
-			object_obstructions.erase(iter);
-			return;
-		}
-	}
+	std::map<object3d*, ec_object_obstruction*>::iterator iter = obstructions_by_object.find(obj3d);
+	if (iter != obstructions_by_object.end())
+		ec_delete_object_obstruction(iter->second);
 }
 
 extern "C" void ec_remove_obstruction_by_e3d_object(e3d_object* e3dobj)
 {
+	// Usually called when the cache frees an object nobody uses anymore
+	if (obstructions_per_e3d.find(e3dobj) == obstructions_per_e3d.end())
+		return;
 	for (ec_object_obstructions::iterator iter = object_obstructions.begin(); iter != object_obstructions.end(); iter++)
 	{
 		if ((*iter)->e3dobj == e3dobj)
 		{
-			for (std::vector<ec::Obstruction*>::iterator iter2 = general_obstructions_list.begin(); iter2 != general_obstructions_list.end(); iter2++)
-			{
-				if (*iter2 == (*iter)->obstruction)
-				{
-					general_obstructions_list.erase(iter2);
-					break;
-				}
-			}
-			for (std::vector<ec::Obstruction*>::iterator iter2 = fire_obstructions_list.begin(); iter2 != fire_obstructions_list.end(); iter2++)
-			{
-				if (*iter2 == (*iter)->obstruction)
-				{
-					fire_obstructions_list.erase(iter2);
-					break;
-				}
-			}
-			delete (*iter)->obstruction;
-			delete *iter;
-			object_obstructions.erase(iter);
+			ec_delete_object_obstruction(*iter);
 			return;
 		}
 	}
@@ -1263,7 +1484,7 @@ extern "C" ec_reference ec_create_breath_fire(float sx, float sy, float sz, floa
 	ec_internal_reference* ret = (ec_internal_reference*)ec_create_generic();
 	ret->position = ec::Vec3(sx, sz, -(sy + X_OFFSET));
 	ret->position2 = ec::Vec3(tx, tz, -(ty + Y_OFFSET));
-	ret->effect = new ec::BreathEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, &general_obstructions_list, ec::BreathEffect::FIRE, LOD, scale);
+	ret->effect = new ec::BreathEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec_get_obstructions(ret, EC_OBSTRUCTIONS_ALONG), ec::BreathEffect::FIRE, LOD, scale);
 	eye_candy.push_back_effect(ret->effect);
 	return (ec_reference)ret;
 }
@@ -1280,7 +1501,7 @@ extern "C" ec_reference ec_create_breath_fire2(actor* caster, actor* target, int
 	ret->targetbone = get_actor_bone_id(target, body_bottom_bone);
 	set_vec3_actor_bone2(ret->position, caster, ret->casterbone);
 	set_vec3_target_bone2(ret->position2, target, ret->targetbone);
-	ret->effect = new ec::BreathEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, &general_obstructions_list, ec::BreathEffect::FIRE, LOD, scale);
+	ret->effect = new ec::BreathEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec_get_obstructions(ret, EC_OBSTRUCTIONS_ALONG), ec::BreathEffect::FIRE, LOD, scale);
 	eye_candy.push_back_effect(ret->effect);
 	return (ec_reference)ret;
 }
@@ -1292,7 +1513,7 @@ extern "C" ec_reference ec_create_breath_ice(float sx, float sy, float sz, float
 	ec_internal_reference* ret = (ec_internal_reference*)ec_create_generic();
 	ret->position = ec::Vec3(sx, sz, -(sy + X_OFFSET));
 	ret->position2 = ec::Vec3(tx, tz, -(ty + Y_OFFSET));
-	ret->effect = new ec::BreathEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, &general_obstructions_list, ec::BreathEffect::ICE, LOD, scale);
+	ret->effect = new ec::BreathEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec_get_obstructions(ret, EC_OBSTRUCTIONS_ALONG), ec::BreathEffect::ICE, LOD, scale);
 	eye_candy.push_back_effect(ret->effect);
 	return (ec_reference)ret;
 }
@@ -1309,7 +1530,7 @@ extern "C" ec_reference ec_create_breath_ice2(actor* caster, actor* target, int
 	ret->targetbone = get_actor_bone_id(target, body_bottom_bone);
 	set_vec3_actor_bone2(ret->position, caster, ret->casterbone);
 	set_vec3_target_bone2(ret->position2, target, ret->targetbone);
-	ret->effect = new ec::BreathEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, &general_obstructions_list, ec::BreathEffect::ICE, LOD, scale);
+	ret->effect = new ec::BreathEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec_get_obstructions(ret, EC_OBSTRUCTIONS_ALONG), ec::BreathEffect::ICE, LOD, scale);
 	eye_candy.push_back_effect(ret->effect);
 	return (ec_reference)ret;
 }
@@ -1321,7 +1542,7 @@ extern "C" ec_reference ec_create_breath_poison(float sx, float sy, float sz, fl
 	ec_internal_reference* ret = (ec_internal_reference*)ec_create_generic();
 	ret->position = ec::Vec3(sx, sz, -(sy + X_OFFSET));
 	ret->position2 = ec::Vec3(tx, tz, -(ty + Y_OFFSET));
-	ret->effect = new ec::BreathEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, &general_obstructions_list, ec::BreathEffect::POISON, LOD, scale);
+	ret->effect = new ec::BreathEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec_get_obstructions(ret, EC_OBSTRUCTIONS_ALONG), ec::BreathEffect::POISON, LOD, scale);
 	eye_candy.push_back_effect(ret->effect);
 	return (ec_reference)ret;
 }
@@ -1337,7 +1558,7 @@ extern "C" ec_reference ec_create_breath_poison2(actor* caster, actor* target, i
 	ret->targetbone = get_actor_bone_id(target, body_bottom_bone);
 	set_vec3_actor_bone2(ret->position, caster, ret->casterbone);
 	set_vec3_target_bone2(ret->position2, target, ret->targetbone);
-	ret->effect = new ec::BreathEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, &general_obstructions_list, ec::BreathEffect::POISON, LOD, scale);
+	ret->effect = new ec::BreathEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec_get_obstructions(ret, EC_OBSTRUCTIONS_ALONG), ec::BreathEffect::POISON, LOD, scale);
 	eye_candy.push_back_effect(ret->effect);
 	return (ec_reference)ret;
 }
@@ -1349,7 +1570,7 @@ extern "C" ec_reference ec_create_breath_magic(float sx, float sy, float sz, flo
 	ec_internal_reference* ret = (ec_internal_reference*)ec_create_generic();
 	ret->position = ec::Vec3(sx, sz, -(sy + X_OFFSET));
 	ret->position2 = ec::Vec3(tx, tz, -(ty + Y_OFFSET));
-	ret->effect = new ec::BreathEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, &general_obstructions_list, ec::BreathEffect::MAGIC, LOD, scale);
+	ret->effect = new ec::BreathEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec_get_obstructions(ret, EC_OBSTRUCTIONS_ALONG), ec::BreathEffect::MAGIC, LOD, scale);
 	eye_candy.push_back_effect(ret->effect);
 	return (ec_reference)ret;
 }
@@ -1365,7 +1586,7 @@ extern "C" ec_reference ec_create_breath_magic2(actor* caster, actor* target, in
 	ret->targetbone = get_actor_bone_id(target, body_bottom_bone);
 	set_vec3_actor_bone2(ret->position, caster, ret->casterbone);
 	set_vec3_target_bone2(ret->position2, target, ret->targetbone);
-	ret->effect = new ec::BreathEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, &general_obstructions_list, ec::BreathEffect::MAGIC, LOD, scale);
+	ret->effect = new ec::BreathEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec_get_obstructions(ret, EC_OBSTRUCTIONS_ALONG), ec::BreathEffect::MAGIC, LOD, scale);
 	eye_candy.push_back_effect(ret->effect);
 	return (ec_reference)ret;
 }
@@ -1377,7 +1598,7 @@ extern "C" ec_reference ec_create_breath_lightning(float sx, float sy, float sz,
 	ec_internal_reference* ret = (ec_internal_reference*)ec_create_generic();
 	ret->position = ec::Vec3(sx, sz, -(sy + X_OFFSET));
 	ret->position2 = ec::Vec3(tx, tz, -(ty + Y_OFFSET));
-	ret->effect = new ec::BreathEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, &general_obstructions_list, ec::BreathEffect::LIGHTNING, LOD, scale);
+	ret->effect = new ec::BreathEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec_get_obstructions(ret, EC_OBSTRUCTIONS_ALONG), ec::BreathEffect::LIGHTNING, LOD, scale);
 	eye_candy.push_back_effect(ret->effect);
 	return (ec_reference)ret;
 }
@@ -1393,7 +1614,7 @@ extern "C" ec_reference ec_create_breath_lightning2(actor* caster, actor* target
 	ret->targetbone = get_actor_bone_id(target, head_bone);
 	set_vec3_actor_bone2(ret->position, caster, ret->casterbone);
 	set_vec3_target_bone2(ret->position2, target, ret->targetbone);
-	ret->effect = new ec::BreathEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, &general_obstructions_list, ec::BreathEffect::LIGHTNING, LOD, scale);
+	ret->effect = new ec::BreathEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec_get_obstructions(ret, EC_OBSTRUCTIONS_ALONG), ec::BreathEffect::LIGHTNING, LOD, scale);
 	eye_candy.push_back_effect(ret->effect);
 	return (ec_reference)ret;
 }
@@ -1405,7 +1626,7 @@ extern "C" ec_reference ec_create_breath_wind(float sx, float sy, float sz, floa
 	ec_internal_reference* ret = (ec_internal_reference*)ec_create_generic();
 	ret->position = ec::Vec3(sx, sz, -(sy + X_OFFSET));
 	ret->position2 = ec::Vec3(tx, tz, -(ty + Y_OFFSET));
-	ret->effect = new ec::BreathEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, &general_obstructions_list, ec::BreathEffect::WIND, LOD, scale);
+	ret->effect = new ec::BreathEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec_get_obstructions(ret, EC_OBSTRUCTIONS_ALONG), ec::BreathEffect::WIND, LOD, scale);
 	eye_candy.push_back_effect(ret->effect);
 	return (ec_reference)ret;
 }
@@ -1421,7 +1642,7 @@ extern "C" ec_reference ec_create_breath_wind2(actor* caster, actor* target, int
 	ret->targetbone = get_actor_bone_id(target, body_bottom_bone);
 	set_vec3_actor_bone2(ret->position, caster, ret->casterbone);
 	set_vec3_target_bone2(ret->position2, target, ret->targetbone);
-	ret->effect = new ec::BreathEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, &general_obstructions_list, ec::BreathEffect::WIND, LOD, scale);
+	ret->effect = new ec::BreathEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec_get_obstructions(ret, EC_OBSTRUCTIONS_ALONG), ec::BreathEffect::WIND, LOD, scale);
 	eye_candy.push_back_effect(ret->effect);
 	return (ec_reference)ret;
 }
@@ -1430,7 +1651,7 @@ extern "C" ec_reference ec_create_campfire(float x, float y, float z, float hue_
 {
 	ec_internal_reference* ret = (ec_internal_reference*)ec_create_generic();
 	ret->position = ec::Vec3(x, z, -y);
-	ret->effect = new ec::CampfireEffect(&eye_candy, &ret->dead, &ret->position, &fire_obstructions_list, hue_adjust, saturation_adjust, scale, LOD);
+	ret->effect = new ec::CampfireEffect(&eye_candy, &ret->dead, &ret->position, ec_get_obstructions(ret, EC_FIRE_OBSTRUCTIONS), hue_adjust, saturation_adjust, scale, LOD);
 	eye_candy.push_back_effect(ret->effect);
 	return (ec_reference)ret;
 }
@@ -1450,7 +1671,7 @@ extern "C" ec_reference ec_create_fireflies(float x, float y, float z, float hue
 	ec_internal_reference* ret = (ec_internal_reference*)ec_create_generic();
 	ret->bounds = *(ec::SmoothPolygonBoundingRange*)bounds;
 	ret->position = ec::Vec3(x, z, -y);
-	ret->effect = new ec::FireflyEffect(&eye_candy, &ret->dead, &ret->position, &general_obstructions_list, hue_adjust, saturation_adjust, density, scale, &ret->bounds);
+	ret->effect = new ec::FireflyEffect(&eye_candy, &ret->dead, &ret->position, ec_get_obstructions(ret, EC_OBSTRUCTIONS_AROUND), hue_adjust, saturation_adjust, density, scale, &ret->bounds);
 	eye_candy.push_back_effect(ret->effect);
 	return (ec_reference)ret;
 }
@@ -3261,7 +3482,7 @@ extern "C" ec_reference ec_create_targetmagic_remote_heal(float start_x, float s
 	ec_internal_reference* ret = (ec_internal_reference*)ec_create_generic();
 	ret->position = ec::Vec3(start_x, start_z, -start_y);
 	ret->position2 = ec::Vec3(end_x, end_z, -end_y);
-	ret->effect = new ec::TargetMagicEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec::TargetMagicEffect::REMOTE_HEAL, &general_obstructions_list, LOD);
+	ret->effect = new ec::TargetMagicEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec::TargetMagicEffect::REMOTE_HEAL, ec_get_obstructions(ret, EC_OBSTRUCTIONS_ALONG), LOD);
 	eye_candy.push_back_effect(ret->effect);
 	return (ec_reference)ret;
 }
@@ -3277,7 +3498,7 @@ extern "C" ec_reference ec_create_targetmagic_remote_heal2(actor* caster, actor*
 	ret->targetbone = get_actor_bone_id(target, body_bottom_bone);
 	set_vec3_actor_bone2(ret->position, caster, ret->casterbone);
 	set_vec3_target_bone2(ret->position2, target, ret->targetbone);
-	ret->effect = new ec::TargetMagicEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec::TargetMagicEffect::REMOTE_HEAL, &general_obstructions_list, LOD);
+	ret->effect = new ec::TargetMagicEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec::TargetMagicEffect::REMOTE_HEAL, ec_get_obstructions(ret, EC_OBSTRUCTIONS_ALONG), LOD);
 	eye_candy.push_back_effect(ret->effect);
 	return (ec_reference)ret;
 }
@@ -3289,7 +3510,7 @@ extern "C" ec_reference ec_create_targetmagic_poison(float start_x, float start_
 	ec_internal_reference* ret = (ec_internal_reference*)ec_create_generic();
 	ret->position = ec::Vec3(start_x, start_z, -start_y);
 	ret->position2 = ec::Vec3(end_x, end_z, -end_y);
-	ret->effect = new ec::TargetMagicEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec::TargetMagicEffect::POISON, &general_obstructions_list, LOD);
+	ret->effect = new ec::TargetMagicEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec::TargetMagicEffect::POISON, ec_get_obstructions(ret, EC_OBSTRUCTIONS_ALONG), LOD);
 	eye_candy.push_back_effect(ret->effect);
 	return (ec_reference)ret;
 }
@@ -3304,7 +3525,7 @@ extern "C" ec_reference ec_create_targetmagic_poison2(actor* caster, actor* targ
 	ret->target = target;
 	set_vec3_actor_bone(ret->position, caster, ret->casterbone, ec::Vec3(0.0, 0.0, 0.0));
 	ret->position2 = ec::Vec3(target->x_pos, ec_get_z(target), -target->y_pos);
-	ret->effect = new ec::TargetMagicEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec::TargetMagicEffect::POISON, &general_obstructions_list, LOD);
+	ret->effect = new ec::TargetMagicEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec::TargetMagicEffect::POISON, ec_get_obstructions(ret, EC_OBSTRUCTIONS_ALONG), LOD);
 	eye_candy.push_back_effect(ret->effect);
 	return (ec_reference)ret;
 }
@@ -3316,7 +3537,7 @@ extern "C" ec_reference ec_create_targetmagic_teleport_to_range(float start_x, f
 	ec_internal_reference* ret = (ec_internal_reference*)ec_create_generic();
 	ret->position = ec::Vec3(start_x, start_z, -start_y);
 	ret->position2 = ec::Vec3(end_x, end_z, -end_y);
-	ret->effect = new ec::TargetMagicEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec::TargetMagicEffect::TELEPORT_TO_RANGE, &general_obstructions_list, LOD);
+	ret->effect = new ec::TargetMagicEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec::TargetMagicEffect::TELEPORT_TO_RANGE, ec_get_obstructions(ret, EC_OBSTRUCTIONS_ALONG), LOD);
 	eye_candy.push_back_effect(ret->effect);
 	return (ec_reference)ret;
 }
@@ -3330,7 +3551,7 @@ extern "C" ec_reference ec_create_targetmagic_teleport_to_range2(actor* caster,
 	ret->target = target;
 	ret->position = ec::Vec3(caster->x_pos + X_OFFSET, ec_get_z(caster), -(caster->y_pos + Y_OFFSET));
 	ret->position2 = ec::Vec3(target->x_pos + X_OFFSET, ec_get_z(target), -(target->y_pos + Y_OFFSET));
-	ret->effect = new ec::TargetMagicEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec::TargetMagicEffect::TELEPORT_TO_RANGE, &general_obstructions_list, LOD);
+	ret->effect = new ec::TargetMagicEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec::TargetMagicEffect::TELEPORT_TO_RANGE, ec_get_obstructions(ret, EC_OBSTRUCTIONS_ALONG), LOD);
 	eye_candy.push_back_effect(ret->effect);
 	return (ec_reference)ret;
 }
@@ -3342,7 +3563,7 @@ extern "C" ec_reference ec_create_targetmagic_harm(float start_x, float start_y,
 	ec_internal_reference* ret = (ec_internal_reference*)ec_create_generic();
 	ret->position = ec::Vec3(start_x, start_z, -start_y);
 	ret->position2 = ec::Vec3(end_x, end_z, -end_y);
-	ret->effect = new ec::TargetMagicEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec::TargetMagicEffect::HARM, &general_obstructions_list, LOD);
+	ret->effect = new ec::TargetMagicEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec::TargetMagicEffect::HARM, ec_get_obstructions(ret, EC_OBSTRUCTIONS_ALONG), LOD);
 	eye_candy.push_back_effect(ret->effect);
 	return (ec_reference)ret;
 }
@@ -3358,7 +3579,7 @@ extern "C" ec_reference ec_create_targetmagic_harm2(actor* caster, actor* target
 	ret->target = target;
 	set_vec3_actor_bone(ret->position, caster, ret->casterbone, ec::Vec3(0.0, 0.0, 0.0));
 	ret->position2 = ec::Vec3(target->x_pos, ec_get_z(target), -target->y_pos);
-	ret->effect = new ec::TargetMagicEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec::TargetMagicEffect::HARM, &general_obstructions_list, LOD);
+	ret->effect = new ec::TargetMagicEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec::TargetMagicEffect::HARM, ec_get_obstructions(ret, EC_OBSTRUCTIONS_ALONG), LOD);
 	eye_candy.push_back_effect(ret->effect);
 	return (ec_reference)ret;
 }
@@ -3370,7 +3591,7 @@ extern "C" ec_reference ec_create_targetmagic_life_drain(float start_x, float st
 	ec_internal_reference* ret = (ec_internal_reference*)ec_create_generic();
 	ret->position = ec::Vec3(start_x, start_z, -start_y);
 	ret->position2 = ec::Vec3(end_x, end_z, -end_y);
-	ret->effect = new ec::TargetMagicEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec::TargetMagicEffect::LIFE_DRAIN, &general_obstructions_list, LOD);
+	ret->effect = new ec::TargetMagicEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec::TargetMagicEffect::LIFE_DRAIN, ec_get_obstructions(ret, EC_OBSTRUCTIONS_ALONG), LOD);
 	eye_candy.push_back_effect(ret->effect);
 	return (ec_reference)ret;
 }
@@ -3386,7 +3607,7 @@ extern "C" ec_reference ec_create_targetmagic_life_drain2(actor* caster, actor*
 	ret->targetbone = get_actor_bone_id(target, head_bone); // spell source
 	set_vec3_actor_bone2(ret->position, caster, ret->casterbone);
 	set_vec3_target_bone2(ret->position2, target, ret->targetbone);
-	ret->effect = new ec::TargetMagicEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec::TargetMagicEffect::LIFE_DRAIN, &general_obstructions_list, LOD);
+	ret->effect = new ec::TargetMagicEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec::TargetMagicEffect::LIFE_DRAIN, ec_get_obstructions(ret, EC_OBSTRUCTIONS_ALONG), LOD);
 	eye_candy.push_back_effect(ret->effect);
 	return (ec_reference)ret;
 }
@@ -3403,7 +3624,7 @@ extern "C" void ec_launch_targetmagic_heal_summoned(ec_reference reference, floa
 	std::vector<ec::Vec3*> target_ptrs;
 	for (std::vector<ec::Vec3>::iterator iter = cast_reference->targets.begin(); iter != cast_reference->targets.end(); iter++)
 		target_ptrs.push_back(&(*iter));
-	cast_reference->effect = new ec::TargetMagicEffect(&eye_candy, &cast_reference->dead, &cast_reference->position, target_ptrs, ec::TargetMagicEffect::HEAL_SUMMONED, &general_obstructions_list, LOD);
+	cast_reference->effect = new ec::TargetMagicEffect(&eye_candy, &cast_reference->dead, &cast_reference->position, target_ptrs, ec::TargetMagicEffect::HEAL_SUMMONED, ec_get_obstructions(cast_reference, EC_OBSTRUCTIONS_ALONG), LOD);
 	eye_candy.push_back_effect(cast_reference->effect);
 }
 
@@ -3419,7 +3640,7 @@ extern "C" void ec_launch_targetmagic_smite_summoned(ec_reference reference, flo
 	std::vector<ec::Vec3*> target_ptrs;
 	for (std::vector<ec::Vec3>::iterator iter = cast_reference->targets.begin(); iter != cast_reference->targets.end(); iter++)
 		target_ptrs.push_back(&(*iter));
-	cast_reference->effect = new ec::TargetMagicEffect(&eye_candy, &cast_reference->dead, &cast_reference->position, target_ptrs, ec::TargetMagicEffect::SMITE_SUMMONED, &general_obstructions_list, LOD);
+	cast_reference->effect = new ec::TargetMagicEffect(&eye_candy, &cast_reference->dead, &cast_reference->position, target_ptrs, ec::TargetMagicEffect::SMITE_SUMMONED, ec_get_obstructions(cast_reference, EC_OBSTRUCTIONS_ALONG), LOD);
 	eye_candy.push_back_effect(cast_reference->effect);
 }
 
@@ -3431,7 +3652,7 @@ extern "C" ec_reference ec_create_targetmagic_drain_mana(float start_x, float st
 	ec_internal_reference* ret = (ec_internal_reference*)ec_create_generic();
 	ret->position = ec::Vec3(start_x, start_z, -start_y);
 	ret->position2 = ec::Vec3(end_x, end_z, -end_y);
-	ret->effect = new ec::TargetMagicEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec::TargetMagicEffect::DRAIN_MANA, &general_obstructions_list, LOD);
+	ret->effect = new ec::TargetMagicEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec::TargetMagicEffect::DRAIN_MANA, ec_get_obstructions(ret, EC_OBSTRUCTIONS_ALONG), LOD);
 	eye_candy.push_back_effect(ret->effect);
 	return (ec_reference)ret;
 }
@@ -3450,7 +3671,7 @@ extern "C" ec_reference ec_create_targetmagic_drain_mana2(actor* caster, actor*
 	ret->targetbone = get_actor_bone_id(target, head_bone); // spell source
 	set_vec3_actor_bone2(ret->position, caster, ret->casterbone);
 	set_vec3_target_bone2(ret->position2, target, ret->targetbone);
-	ret->effect = new ec::TargetMagicEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec::TargetMagicEffect::DRAIN_MANA, &general_obstructions_list, LOD);
+	ret->effect = new ec::TargetMagicEffect(&eye_candy, &ret->dead, &ret->position, &ret->position2, ec::TargetMagicEffect::DRAIN_MANA, ec_get_obstructions(ret, EC_OBSTRUCTIONS_ALONG), LOD);
 	eye_candy.push_back_effect(ret->effect);
 	return (ec_reference)ret;
 }
@@ -3470,7 +3691,7 @@ extern "C" ec_reference ec_create_wind_leaves(float x, float y, float z, float h
 	ret->bounds = *(ec::SmoothPolygonBoundingRange*)bounds;
 	ret->position = ec::Vec3(x, z, -y);
 	ret->position2 = ec::Vec3(prevailing_wind_x, prevailing_wind_z, -(prevailing_wind_y + 0.25));
-	ret->effect = new ec::WindEffect(&eye_candy, &ret->dead, &ret->position, &general_obstructions_list, hue_adjust, saturation_adjust, scale, density, &ret->bounds, ec::WindEffect::LEAVES, ret->position2);
+	ret->effect = new ec::WindEffect(&eye_candy, &ret->dead, &ret->position, ec_get_obstructions(ret, EC_OBSTRUCTIONS_AROUND), hue_adjust, saturation_adjust, scale, density, &ret->bounds, ec::WindEffect::LEAVES, ret->position2);
 	eye_candy.push_back_effect(ret->effect);
 	return (ec_reference)ret;
 }
@@ -3481,7 +3702,7 @@ extern "C" ec_reference ec_create_wind_petals(float x, float y, float z, float h
 	ret->bounds = *(ec::SmoothPolygonBoundingRange*)bounds;
 	ret->position = ec::Vec3(x, z, -y);
 	ret->position2 = ec::Vec3(prevailing_wind_x, prevailing_wind_z, -(prevailing_wind_y + 0.25));
-	ret->effect = new ec::WindEffect(&eye_candy, &ret->dead, &ret->position, &general_obstructions_list, hue_adjust, saturation_adjust, scale, density, &ret->bounds, ec::WindEffect::FLOWER_PETALS, ret->position2);
+	ret->effect = new ec::WindEffect(&eye_candy, &ret->dead, &ret->position, ec_get_obstructions(ret, EC_OBSTRUCTIONS_AROUND), hue_adjust, saturation_adjust, scale, density, &ret->bounds, ec::WindEffect::FLOWER_PETALS, ret->position2);
 	eye_candy.push_back_effect(ret->effect);
 	return (ec_reference)ret;
 }
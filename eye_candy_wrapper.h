@@ -63,6 +63,7 @@ extern int transparency_resolution_fix;
 extern int light_columns_threshold;
 extern int use_fancy_smoke;
 extern int max_idle_cycles_per_second;
+extern int ec_idle_threads;
 #endif
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -84,6 +85,15 @@ extern int max_idle_cycles_per_second;
 #ifdef __cplusplus
 extern "C"
 {
+	// the obstructions an effect collects from the obstruction grid
+	typedef enum ec_obstruction_type
+	{
+		EC_NO_OBSTRUCTIONS = 0,
+		EC_OBSTRUCTIONS_AROUND = 1, // near position, within the bounds
+		EC_OBSTRUCTIONS_ALONG = 2, // between position, position2 and the targets
+		EC_FIRE_OBSTRUCTIONS = 3 // fire related ones near position
+	} ec_obstruction_type;
+
 	typedef class ec_internal_reference
 	{
 		public:
@@ -93,6 +103,7 @@ extern "C"
 				caster = NULL;
 				target = NULL;
 				dead = false;
+				obstruction_type = EC_NO_OBSTRUCTIONS;
 			}
 			;
 			~ec_internal_reference()
@@ -112,8 +123,25 @@ extern "C"
 			int casterbone;
 			int targetbone;
 			int missile_id;
+			int obstruction_type; // which obstructions near the effect to collect
+			std::vector<ec::Obstruction*> obstructions; // the obstructions the effect checks
 	} ec_internal_reference;
 
+	typedef struct ec_obstruction_entry
+	{
+			ec::Obstruction* obstruction;
+			float x; // center of the area of effect on the ground plane
+			float z;
+			float radius;
+			bool fire_related;
+			bool in_grid;
+			int min_cell_x; // the grid cells the entry is stored in
+			int min_cell_z;
+			int max_cell_x;
+			int max_cell_z;
+			Uint32 query_stamp;
+	} ec_obstruction_entry;
+
 	typedef struct ec_object_obstruction
 	{
 			object3d* obj3d;
@@ -133,6 +161,8 @@ extern "C"
 			float cos_rot_z2;
 			bool fire_related;
 			ec::Obstruction* obstruction;
+			ec_obstruction_entry entry;
+			size_t index; // position in object_obstructions
 	} ec_object_obstruction;
 
 	typedef struct ec_actor_obstruction
@@ -140,6 +170,7 @@ extern "C"
 			actor* obstructing_actor;
 			ec::Vec3 center;
 			ec::Obstruction* obstruction;
+			ec_obstruction_entry entry;
 	} ec_actor_obstruction;
 
 	typedef std::vector<ec_object_obstruction*> ec_object_obstructions;
@@ -193,6 +224,10 @@ extern "C"
 	void ec_idle(); //!< \callergraph
 	void ec_heartbeat(); // Once per second.
 	void ec_draw(); //!< \callergraph
+	void ec_reset_stats();
+	void ec_get_stats(char* buffer, size_t len);
+	void ec_math_benchmark(char* buffer, size_t len);
+	void ec_obstruction_benchmark(char* buffer, size_t len);
 	void ec_actor_delete(actor* _actor);
 	void ec_recall_effect(ec_reference ref);
 	void ec_destroy_all_effects();
@@ -39,9 +39,54 @@ typedef struct	{
 	int	spacing;
 	int	texture_id;
 	int	widths[FONTS_ARRAY_SIZE * FONT_CHARS_PER_LINE];
+	int	char_widths[256];	// widths[] + spacing, indexed by raw character
 	char	name[32];
 } font_info;
 
+/* Glyph batching: instead of a glTexCoord/glVertex pair per corner of every
+ * character, the quads of a string are collected here and submitted with
+ * one glDrawArrays per colour run. */
+typedef struct
+{
+	int	first;	// first vertex of the run
+	int	count;	// number of vertices in the run
+	int	has_color;	// if 0, the run uses the current GL colour
+	GLfloat	color[4];
+} glyph_run;
+
+typedef struct
+{
+	GLfloat	*vertices;	// 3 per vertex
+	GLfloat	*uv;	// 2 per vertex
+	int	nr_vertices;
+	int	max_vertices;
+	glyph_run	*runs;
+	int	nr_runs;
+	int	max_runs;
+} glyph_batch;
+
+/* Strings drawn by draw_string_zoomed_width are laid out once, relative to
+ * (0, 0), and replayed from here until the text or the layout parameters
+ * change. Direct mapped on the hash, a collision simply replaces the entry. */
+#define LAYOUT_CACHE_SIZE	256
+#define LAYOUT_CACHE_MAX_LEN	512
+
+typedef struct
+{
+	Uint32	hash;
+	unsigned char	*text;
+	float	zoom;
+	int	max_width;
+	int	max_lines;
+	int	font;
+	int	lines;	// what the layout returned
+	glyph_batch	batch;
+} string_layout;
+
+static glyph_batch font_batch;
+static int batching = 0;
+static string_layout layout_cache[LAYOUT_CACHE_SIZE];
+
 static int font_text = 0;
 
 int	cur_font_num=0;
@@ -56,6 +101,168 @@ int get_font_width(int cur_char);
 int get_nstring_width(const unsigned char *str, int len);
 int set_font_parameters (int num);
 
+static void batch_begin(void)
+{
+	font_batch.nr_vertices = 0;
+	font_batch.nr_runs = 0;
+	batching = 1;
+}
+
+static glyph_run *batch_new_run(glyph_batch *batch)
+{
+	glyph_run *run;
+
+	if (batch->nr_runs >= batch->max_runs)
+	{
+		batch->max_runs = batch->max_runs ? batch->max_runs * 2 : 16;
+		batch->runs = realloc(batch->runs, batch->max_runs * sizeof(glyph_run));
+	}
+	run = &batch->runs[batch->nr_runs++];
+	run->first = batch->nr_vertices;
+	run->count = 0;
+	run->has_color = 0;
+	return run;
+}
+
+static void batch_color(float r, float g, float b, float a)
+{
+	glyph_run *run;
+
+	if (font_batch.nr_runs > 0 && font_batch.runs[font_batch.nr_runs-1].count == 0)
+		run = &font_batch.runs[font_batch.nr_runs-1];
+	else
+		run = batch_new_run(&font_batch);
+	run->has_color = 1;
+	run->color[0] = r;
+	run->color[1] = g;
+	run->color[2] = b;
+	run->color[3] = a;
+}
+
+static void batch_vertex(GLfloat u, GLfloat v, GLfloat x, GLfloat y, GLfloat z)
+{
+	if (font_batch.nr_runs == 0)
+		batch_new_run(&font_batch);
+	if (font_batch.nr_vertices >= font_batch.max_vertices)
+	{
+		font_batch.max_vertices = font_batch.max_vertices ? font_batch.max_vertices * 2 : 1024;
+		font_batch.vertices = realloc(font_batch.vertices, font_batch.max_vertices * 3 * sizeof(GLfloat));
+		font_batch.uv = realloc(font_batch.uv, font_batch.max_vertices * 2 * sizeof(GLfloat));
+	}
+	font_batch.vertices[font_batch.nr_vertices*3+0] = x;
+	font_batch.vertices[font_batch.nr_vertices*3+1] = y;
+	font_batch.vertices[font_batch.nr_vertices*3+2] = z;
+	font_batch.uv[font_batch.nr_vertices*2+0] = u;
+	font_batch.uv[font_batch.nr_vertices*2+1] = v;
+	font_batch.nr_vertices++;
+	font_batch.runs[font_batch.nr_runs-1].count++;
+}
+
+static void draw_glyph_batch(const glyph_batch *batch)
+{
+	int i;
+
+	if (batch->nr_vertices == 0)
+	{
+		// still apply the colour changes, callers may rely on them
+		for (i = 0; i < batch->nr_runs; i++)
+			if (batch->runs[i].has_color)
+				glColor4fv(batch->runs[i].color);
+		return;
+	}
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glVertexPointer(3, GL_FLOAT, 0, batch->vertices);
+	glTexCoordPointer(2, GL_FLOAT, 0, batch->uv);
+	for (i = 0; i < batch->nr_runs; i++)
+	{
+		if (batch->runs[i].has_color)
+			glColor4fv(batch->runs[i].color);
+		if (batch->runs[i].count > 0)
+			glDrawArrays(GL_QUADS, batch->runs[i].first, batch->runs[i].count);
+	}
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+}
+
+static void batch_end(void)
+{
+	batching = 0;
+	draw_glyph_batch(&font_batch);
+}
+
+static void set_glyph_color(float r, float g, float b, float a)
+{
+	if (batching)
+		batch_color(r, g, b, a);
+	else
+		glColor4f(r, g, b, a);
+}
+
+static Uint32 hash_layout(const unsigned char *str, float zoom, int max_width, int max_lines, int *len)
+{
+	// FNV-1a over the text and the parameters
+	Uint32 hash = 2166136261u;
+	union { float f; Uint32 i; } zoom_bits;
+	int i;
+
+	for (i = 0; str[i]; i++)
+		hash = (hash ^ str[i]) * 16777619u;
+	*len = i;
+	zoom_bits.f = zoom;
+	hash = (hash ^ zoom_bits.i) * 16777619u;
+	hash = (hash ^ (Uint32)max_width) * 16777619u;
+	hash = (hash ^ (Uint32)max_lines) * 16777619u;
+	hash = (hash ^ (Uint32)cur_font_num) * 16777619u;
+	return hash;
+}
+
+static void copy_glyph_batch(glyph_batch *dst, const glyph_batch *src)
+{
+	if (dst->max_vertices < src->nr_vertices)
+	{
+		dst->max_vertices = src->nr_vertices;
+		dst->vertices = realloc(dst->vertices, dst->max_vertices * 3 * sizeof(GLfloat));
+		dst->uv = realloc(dst->uv, dst->max_vertices * 2 * sizeof(GLfloat));
+	}
+	if (dst->max_runs < src->nr_runs)
+	{
+		dst->max_runs = src->nr_runs;
+		dst->runs = realloc(dst->runs, dst->max_runs * sizeof(glyph_run));
+	}
+	if (src->nr_vertices > 0)
+	{
+		memcpy(dst->vertices, src->vertices, src->nr_vertices * 3 * sizeof(GLfloat));
+		memcpy(dst->uv, src->uv, src->nr_vertices * 2 * sizeof(GLfloat));
+	}
+	if (src->nr_runs > 0)
+		memcpy(dst->runs, src->runs, src->nr_runs * sizeof(glyph_run));
+	dst->nr_vertices = src->nr_vertices;
+	dst->nr_runs = src->nr_runs;
+}
+
+static void free_glyph_batch(glyph_batch *batch)
+{
+	free(batch->vertices);
+	free(batch->uv);
+	free(batch->runs);
+	memset(batch, 0, sizeof(glyph_batch));
+}
+
+// Forget all cached layouts, needed when the font metrics change.
+static void flush_string_layouts(void)
+{
+	int i;
+
+	for (i = 0; i < LAYOUT_CACHE_SIZE; i++)
+	{
+		if (layout_cache[i].text != NULL)
+			free(layout_cache[i].text);
+		layout_cache[i].text = NULL;
+	}
+}
+
 // CHECK
 int pos_selected(int msg, int ichar, select_info* select)
 {
@@ -187,7 +394,7 @@ int find_font_char (unsigned char cur_char)
 		b = (float) colors_list[color].b1 / 255.0f;
 		//This fixes missing letters in the font on some clients
 		//No idea why going from 3f to 4f helps, but it does
-		glColor4f(r,g,b,1.0);
+		set_glyph_color(r,g,b,1.0);
 		return(-1);	// nothing to do
 	}
 	return(get_font_char(cur_char));
@@ -200,6 +407,7 @@ int	draw_char_scaled(unsigned char cur_char, int cur_x, int cur_y, float display
 	int chr,col,row;
 	int displayed_font_x_width;
 	int	font_bit_width, ignored_bits;
+	int bottom;
 
 	chr= find_font_char(cur_char);
 	if(chr < 0)	// watch for illegal/non-display characters
@@ -228,17 +436,11 @@ int	draw_char_scaled(unsigned char cur_char, int cur_x, int cur_y, float display
 #endif //NEW_TEXTURES
 
 	// and place the text from the graphics on the map
-	glTexCoord2f(u_start,v_start);
-	glVertex3i(cur_x,cur_y,0);
-
-	glTexCoord2f(u_start,v_end);
-	glVertex3i(cur_x,cur_y+(displayed_font_y_size+1),0);
-
-	glTexCoord2f(u_end,v_end);
-	glVertex3i(cur_x+displayed_font_x_width,cur_y+(displayed_font_y_size+1),0);
-
-	glTexCoord2f(u_end,v_start);
-	glVertex3i(cur_x+displayed_font_x_width,cur_y,0);
+	bottom= (int)(cur_y+(displayed_font_y_size+1));
+	batch_vertex(u_start,v_start,cur_x,cur_y,0);
+	batch_vertex(u_start,v_end,cur_x,bottom,0);
+	batch_vertex(u_end,v_end,cur_x+displayed_font_x_width,bottom,0);
+	batch_vertex(u_end,v_start,cur_x+displayed_font_x_width,cur_y,0);
 
 	return(displayed_font_x_width);	// return how far to move for the next character
 }
@@ -356,7 +558,7 @@ void draw_messages (int x, int y, text_message *msgs, int msgs_size, Uint8 filte
 	i = 0;
 	cur_x = x;
 	cur_y = y;
-	glBegin (GL_QUADS);
+	batch_begin();
 	while (1)
 	{
 		if (i == cursor)
@@ -419,7 +621,7 @@ void draw_messages (int x, int y, text_message *msgs, int msgs_size, Uint8 filte
 		{
 			if (!in_select)
 			{
-				glColor3f (selection_red, selection_green, selection_blue);
+				set_glyph_color (selection_red, selection_green, selection_blue, 1.0f);
 				in_select = 1;
 			}
 		}
@@ -432,7 +634,7 @@ void draw_messages (int x, int y, text_message *msgs, int msgs_size, Uint8 filte
 				else if (msgs[imsg].r < 0)
 					find_font_char (to_color_char (c_grey1));
 				else
-					glColor3f (msgs[imsg].r, msgs[imsg].g, msgs[imsg].b);
+					set_glyph_color (msgs[imsg].r, msgs[imsg].g, msgs[imsg].b, 1.0f);
 
 				in_select = 0;
 			}
@@ -477,7 +679,7 @@ void draw_messages (int x, int y, text_message *msgs, int msgs_size, Uint8 filte
 		draw_char_scaled ('_', cursor_x, cursor_y, displayed_font_x_size, displayed_font_y_size);
 	}
 
-	glEnd();
+	batch_end();
 	glDisable(GL_ALPHA_TEST);
 #ifdef OPENGL_TRACE
 CHECK_GL_ERRORS();
@@ -530,7 +732,8 @@ int draw_string_zoomed (int x, int y, const unsigned char * our_string, int max_
 	return draw_string_zoomed_width (x, y, our_string, window_width, max_lines, text_zoom);
 }
 
-int draw_string_zoomed_width (int x, int y, const unsigned char * our_string, int max_width, int max_lines, float text_zoom)
+// Lays \a our_string out into font_batch, relative to (0, 0).
+static int layout_string_zoomed_width (const unsigned char * our_string, int max_width, int max_lines, float text_zoom)
 {
 	float displayed_font_x_size= 11.0*text_zoom;
 	float displayed_font_y_size= 18.0*text_zoom;
@@ -540,21 +743,10 @@ int draw_string_zoomed_width (int x, int y, const unsigned char * our_string, in
 	int cur_x,cur_y;
 	int current_lines= 1;
 
-#ifdef OPENGL_TRACE
-CHECK_GL_ERRORS();
-#endif //OPENGL_TRACE
-	glEnable(GL_ALPHA_TEST);//enable alpha filtering, so we have some alpha key
-	glAlphaFunc(GL_GREATER,0.1f);
-#ifdef	NEW_TEXTURES
-	bind_texture(font_text);
-#else	/* NEW_TEXTURES */
-	get_and_set_texture_id(font_text);
-#endif	/* NEW_TEXTURES */
-
 	i=0;
-	cur_x=x;
-	cur_y=y;
-	glBegin(GL_QUADS);
+	cur_x=0;
+	cur_y=0;
+	batch_begin();
 	while(1)
 		{
 			cur_char=our_string[i];
@@ -566,15 +758,15 @@ CHECK_GL_ERRORS();
 			else if (cur_char == '\n' || cur_char == '\r')	// newline
 				{
 					cur_y+=displayed_font_y_size;
-					cur_x=x;
+					cur_x=0;
 					i++;
 					current_lines++;
 					if(current_lines>max_lines)break;
 					continue;
 				}
-			else if (cur_x+displayed_font_x_size-x>=max_width){
+			else if (cur_x+displayed_font_x_size>=max_width){
 				cur_y+=displayed_font_y_size;
-				cur_x=x;
+				cur_x=0;
 				current_lines++;
 				if(current_lines>max_lines)break;
 			}
@@ -583,8 +775,62 @@ CHECK_GL_ERRORS();
 
 			i++;
 		}
+	batching = 0;
+
+	return current_lines;
+}
+
+int draw_string_zoomed_width (int x, int y, const unsigned char * our_string, int max_width, int max_lines, float text_zoom)
+{
+	string_layout *layout;
+	const glyph_batch *batch;
+	Uint32 hash;
+	int len;
+	int current_lines;
+
+#ifdef OPENGL_TRACE
+CHECK_GL_ERRORS();
+#endif //OPENGL_TRACE
+	glEnable(GL_ALPHA_TEST);//enable alpha filtering, so we have some alpha key
+	glAlphaFunc(GL_GREATER,0.1f);
+#ifdef	NEW_TEXTURES
+	bind_texture(font_text);
+#else	/* NEW_TEXTURES */
+	get_and_set_texture_id(font_text);
+#endif	/* NEW_TEXTURES */
+
+	hash = hash_layout(our_string, text_zoom, max_width, max_lines, &len);
+	layout = &layout_cache[hash % LAYOUT_CACHE_SIZE];
+	if (layout->text != NULL && layout->hash == hash && layout->zoom == text_zoom
+		&& layout->max_width == max_width && layout->max_lines == max_lines
+		&& layout->font == cur_font_num && !strcmp((const char*)layout->text, (const char*)our_string))
+	{
+		batch = &layout->batch;
+		current_lines = layout->lines;
+	}
+	else
+	{
+		current_lines = layout_string_zoomed_width(our_string, max_width, max_lines, text_zoom);
+		batch = &font_batch;
+		if (len <= LAYOUT_CACHE_MAX_LEN)
+		{
+			layout->text = realloc(layout->text, len + 1);
+			memcpy(layout->text, our_string, len + 1);
+			layout->hash = hash;
+			layout->zoom = text_zoom;
+			layout->max_width = max_width;
+			layout->max_lines = max_lines;
+			layout->font = cur_font_num;
+			layout->lines = current_lines;
+			copy_glyph_batch(&layout->batch, &font_batch);
+		}
+	}
+
+	glPushMatrix();
+	glTranslatef(x, y, 0);
+	draw_glyph_batch(batch);
+	glPopMatrix();
 
-	glEnd();
 	glDisable(GL_ALPHA_TEST);
 #ifdef OPENGL_TRACE
 CHECK_GL_ERRORS();
@@ -622,7 +868,7 @@ void draw_string_zoomed_clipped (int x, int y, const unsigned char* our_string,
 	i = 0;
 	cur_x = x;
 	cur_y = y;
-	glBegin (GL_QUADS);
+	batch_begin();
 	while (1)
 	{
 		if (i == cursor_pos)
@@ -669,7 +915,7 @@ void draw_string_zoomed_clipped (int x, int y, const unsigned char* our_string,
 		draw_char_scaled ('_', cursor_x, cursor_y, displayed_font_x_size, displayed_font_y_size);
 	}
 
-	glEnd();
+	batch_end();
 	glDisable(GL_ALPHA_TEST);
 #ifdef OPENGL_TRACE
 CHECK_GL_ERRORS();
@@ -864,7 +1110,7 @@ CHECK_GL_ERRORS();
 	i=0;
 	cur_x=x;
 	cur_y=y;
-	glBegin(GL_QUADS);
+	batch_begin();
 	while(1)
 		{
 			cur_char=our_string[i];
@@ -888,7 +1134,7 @@ CHECK_GL_ERRORS();
 		}
 
 
-	glEnd();
+	batch_end();
 	glDisable(GL_ALPHA_TEST);
 #ifdef OPENGL_TRACE
 CHECK_GL_ERRORS();
@@ -947,7 +1193,7 @@ void draw_ortho_ingame_string(float x, float y,float z, const unsigned char * ou
 	i=0;
 	cur_x=x;
 	cur_y=y;
-	glBegin(GL_QUADS);
+	batch_begin();
 #ifndef SKY_FPV_OPTIONAL
 	while(1)
 		{
@@ -965,10 +1211,6 @@ void draw_ortho_ingame_string(float x, float y,float z, const unsigned char * ou
 					if(current_lines>=max_lines)break;
 					continue;
 				}
-			else if (is_color (cur_char))
-				{
-					glEnd();	//Ooops - NV bug fix!!
-				}
 			chr=find_font_char(cur_char);
 			if(chr >= 0)
 				{
@@ -993,26 +1235,14 @@ void draw_ortho_ingame_string(float x, float y,float z, const unsigned char * ou
 #endif //NEW_TEXTURES
 					//v_end=(float)1.0f-(col*font_y_size+font_y_size-2)/256.0f;
 
-					glTexCoord2f(u_start,v_start);
-					glVertex3f(cur_x,cur_y+displayed_font_y_size,z);
-
-					glTexCoord2f(u_start,v_end);
-					glVertex3f(cur_x,cur_y,z);
-
-					glTexCoord2f(u_end,v_end);
-					glVertex3f(cur_x+displayed_font_x_width,cur_y,z);
-
-					glTexCoord2f(u_end,v_start);
-					glVertex3f(cur_x+displayed_font_x_width,cur_y+displayed_font_y_size,z);
-
+					batch_vertex(u_start,v_start,cur_x,cur_y+displayed_font_y_size,z);
+					batch_vertex(u_start,v_end,cur_x,cur_y,z);
+					batch_vertex(u_end,v_end,cur_x+displayed_font_x_width,cur_y,z);
+					batch_vertex(u_end,v_start,cur_x+displayed_font_x_width,cur_y+displayed_font_y_size,z);
 
 					//cur_x+=displayed_font_x_size;
 					cur_x+=displayed_font_x_width;
 				}
-			else if (is_color (cur_char))
-				{
-					glBegin(GL_QUADS);	//Ooops - NV bug fix!!
-				}
 
 #else // SKY_FPV_OPTIONAL
 	while(1){
@@ -1028,9 +1258,6 @@ void draw_ortho_ingame_string(float x, float y,float z, const unsigned char * ou
 			current_lines++;
 			if(current_lines>=max_lines)break;
 			continue;
-		} else if (is_color (cur_char)){
-			glEnd();	//Ooops - NV bug fix!!
-			glBegin(GL_QUADS);
 		}
 		chr=find_font_char(cur_char);
 		if(chr >= 0){
@@ -1053,22 +1280,11 @@ void draw_ortho_ingame_string(float x, float y,float z, const unsigned char * ou
 			v_end=(float)1.0f-(col*FONT_Y_SPACING+FONT_Y_SPACING-1)/256.0f;
 #endif //NEW_TEXTURES
 
-			glTexCoord2f(u_start,v_start);
-			glVertex3f(cur_x,cur_y+displayed_font_y_size,z);
-
-			glTexCoord2f(u_start,v_end);
-			glVertex3f(cur_x,cur_y,z);
-
-			glTexCoord2f(u_end,v_end);
-			glVertex3f(cur_x+displayed_font_x_width,cur_y,z);
-
-			glTexCoord2f(u_end,v_start);
-			glVertex3f(cur_x+displayed_font_x_width,cur_y+displayed_font_y_size,z);
-
+			batch_vertex(u_start,v_start,cur_x,cur_y+displayed_font_y_size,z);
+			batch_vertex(u_start,v_end,cur_x,cur_y,z);
+			batch_vertex(u_end,v_end,cur_x+displayed_font_x_width,cur_y,z);
+			batch_vertex(u_end,v_start,cur_x+displayed_font_x_width,cur_y+displayed_font_y_size,z);
 			cur_x+=displayed_font_x_width;
-		} else if(is_color (cur_char)){
-			glEnd();	//Ooops - NV bug fix!!
-			glBegin(GL_QUADS);
 #endif // SKY_FPV_OPTIONAL
 		}
 #ifdef SKY_FPV_OPTIONAL
@@ -1076,7 +1292,7 @@ void draw_ortho_ingame_string(float x, float y,float z, const unsigned char * ou
 	}
 #endif // SKY_FPV_OPTIONAL
 
-	glEnd();
+	batch_end();
 	glDisable(GL_ALPHA_TEST);
 }
 
@@ -1140,7 +1356,7 @@ void draw_ingame_string(float x, float y,const unsigned char * our_string,
 	cur_x=hx;
 	cur_y=hy;
 #endif // SKY_FPV_OPTIONAL
-	glBegin(GL_QUADS);
+	batch_begin();
 #ifndef SKY_FPV_OPTIONAL
 	while(1)
 		{
@@ -1158,10 +1374,6 @@ void draw_ingame_string(float x, float y,const unsigned char * our_string,
 					if(current_lines>=max_lines)break;
 					continue;
 				}
-			else if(is_color (cur_char))
-				{
-					glEnd();	//Ooops - NV bug fix!!
-				}
 			chr=find_font_char(cur_char);
 			if(chr >= 0)
 				{
@@ -1184,24 +1396,12 @@ void draw_ingame_string(float x, float y,const unsigned char * our_string,
 					v_end=(float)1.0f-(col*FONT_Y_SPACING+FONT_Y_SPACING-1)/256.0f;
 #endif //NEW_TEXTURES
 
-					glTexCoord2f(u_start,v_start);
-					glVertex3f(cur_x,0,cur_y+displayed_font_y_size);
-
-					glTexCoord2f(u_start,v_end);
-					glVertex3f(cur_x,0,cur_y);
-
-					glTexCoord2f(u_end,v_end);
-					glVertex3f(cur_x+displayed_font_x_width,0,cur_y);
-
-					glTexCoord2f(u_end,v_start);
-					glVertex3f(cur_x+displayed_font_x_width,0,cur_y+displayed_font_y_size);
-
+					batch_vertex(u_start,v_start,cur_x,0,cur_y+displayed_font_y_size);
+					batch_vertex(u_start,v_end,cur_x,0,cur_y);
+					batch_vertex(u_end,v_end,cur_x+displayed_font_x_width,0,cur_y);
+					batch_vertex(u_end,v_start,cur_x+displayed_font_x_width,0,cur_y+displayed_font_y_size);
 					cur_x+=displayed_font_x_width;
 				}
-			else if (is_color (cur_char))
-				{
-					glBegin(GL_QUADS);	//Ooops - NV bug fix!!
-				}
 #else // SKY_FPV_OPTIONAL
 	while(1){
 		cur_char=our_string[i];
@@ -1217,11 +1417,6 @@ void draw_ingame_string(float x, float y,const unsigned char * our_string,
 			if(current_lines>=max_lines)break;
 			continue;
 		}
-		else if (is_color (cur_char))
-		{
-			glEnd();	//Ooops - NV bug fix!!
-			glBegin(GL_QUADS);
-		}
 		chr=find_font_char(cur_char);
 		if(chr >= 0){
 			col=chr/FONT_CHARS_PER_LINE;
@@ -1243,24 +1438,11 @@ void draw_ingame_string(float x, float y,const unsigned char * our_string,
 			v_end=(float)1.0f-(col*FONT_Y_SPACING+FONT_Y_SPACING-1)/256.0f;
 #endif // NEW_TEXTURES
 
-			glTexCoord2f(u_start,v_start);
-			glVertex3f(cur_x,cur_y+displayed_font_y_size,0);
-
-			glTexCoord2f(u_start,v_end);
-			glVertex3f(cur_x,cur_y,0);
-
-			glTexCoord2f(u_end,v_end);
-			glVertex3f(cur_x+displayed_font_x_width,cur_y,0);
-
-			glTexCoord2f(u_end,v_start);
-			glVertex3f(cur_x+displayed_font_x_width,cur_y+displayed_font_y_size,0);
-
+			batch_vertex(u_start,v_start,cur_x,cur_y+displayed_font_y_size,0);
+			batch_vertex(u_start,v_end,cur_x,cur_y,0);
+			batch_vertex(u_end,v_end,cur_x+displayed_font_x_width,cur_y,0);
+			batch_vertex(u_end,v_start,cur_x+displayed_font_x_width,cur_y+displayed_font_y_size,0);
 			cur_x+=displayed_font_x_width;
-		}
-		else if (is_color (cur_char))
-		{
-			glEnd();	//Ooops - NV bug fix!!
-			glBegin(GL_QUADS);
 #endif // SKY_FPV_OPTIONAL
 		}
 #ifdef SKY_FPV_OPTIONAL
@@ -1268,7 +1450,7 @@ void draw_ingame_string(float x, float y,const unsigned char * our_string,
 	}
 #endif // SKY_FPV_OPTIONAL
 
-	glEnd();
+	batch_end();
 	glDisable(GL_ALPHA_TEST);
 #ifdef SKY_FPV_OPTIONAL
 	glMatrixMode(GL_PROJECTION);
@@ -1296,7 +1478,7 @@ int get_font_width(int cur_char)
 
 int get_char_width(unsigned char cur_char)
 {
-	return get_font_width(get_font_char(cur_char));
+	return fonts[cur_font_num]->char_widths[cur_char];
 }
 
 
@@ -1345,6 +1527,12 @@ void cleanup_fonts(void)
 			free(fonts[i]);
 		}
 	}
+
+	flush_string_layouts();
+	for(i = 0; i < LAYOUT_CACHE_SIZE; i++) {
+		free_glyph_batch(&layout_cache[i].batch);
+	}
+	free_glyph_batch(&font_batch);
 }
 
 #ifndef	NEW_TEXTURES
@@ -1561,6 +1749,14 @@ int set_font_parameters (int num)
 		fonts[num]->spacing=2;
 	}
 
+	// per character widths, so measuring strings skips get_font_char()
+	for(i=0; i<256; i++)
+		{
+			int chr= get_font_char(i);
+			fonts[num]->char_widths[i]= chr < 0 ? 0 : fonts[num]->widths[chr]+fonts[num]->spacing;
+		}
+	flush_string_layouts();
+
 	//and return
 	return num;
 }
@@ -15,10 +15,14 @@
 #include <math.h>
 #include <string.h>
 #include "bbox_tree.h"
+#include "draw_scene.h"
 #include "shadows.h"
 #include "elconfig.h"
 #include "gl_init.h"
 #include "tiles.h"
+#ifdef CLUSTER_INSIDES
+#include "cluster.h"
+#endif // CLUSTER_INSIDES
 
 // We create an enum of the sides so we don't have to call each side 0 or 1.
 // This way it makes it more understandable and readable when dealing with frustum sides.
@@ -508,6 +512,11 @@ void calculate_reflection_frustum(float water_height)
 	set_cur_intersect_type(main_bbox_tree, cur_intersect_type);
 }
 
+static int shadow_cell[3] = {0, 0, 0};		// the camera cell of the shadow casters
+#ifdef CLUSTER_INSIDES
+static short shadow_cluster = 0;
+#endif // CLUSTER_INSIDES
+
 void calculate_shadow_frustum()
 {
 	MATRIX4x4 proj;								// This will hold our projection matrix
@@ -515,9 +524,28 @@ void calculate_shadow_frustum()
 	MATRIX4x4 clip;								// This will hold the clipping planes
 	VECTOR3	ld;
 	unsigned int cur_intersect_type;
+	int cell[3];
+
+	// The light view is moved by whole camera cells, so the casters are
+	// kept until the cell, the sun (see calc_shadow_matrix) or the scene
+	// changes. Dynamic items are merged in by the bbox tree meanwhile.
+	cell[X] = (int)camera_x;
+	cell[Y] = (int)camera_y;
+	cell[Z] = (int)camera_z;
+	if (memcmp(cell, shadow_cell, sizeof(cell)) != 0)
+		main_bbox_tree->intersect[INTERSECTION_TYPE_SHADOW].intersect_update_needed = 1;
+#ifdef CLUSTER_INSIDES
+	if (current_cluster != shadow_cluster)
+		main_bbox_tree->intersect[INTERSECTION_TYPE_SHADOW].intersect_update_needed = 1;
+#endif // CLUSTER_INSIDES
 
 	if (main_bbox_tree->intersect[INTERSECTION_TYPE_SHADOW].intersect_update_needed == 0) return;
 
+	memcpy(shadow_cell, cell, sizeof(cell));
+#ifdef CLUSTER_INSIDES
+	shadow_cluster = current_cluster;
+#endif // CLUSTER_INSIDES
+
 	// glGetFloatv() is used to extract information about our OpenGL world.
 	// Below, we pass in GL_PROJECTION_MATRIX to abstract our projection matrix.
 	// It then stores the matrix into an array of [16].
@@ -555,7 +583,9 @@ void calculate_shadow_frustum()
 	set_cur_intersect_type(main_bbox_tree, INTERSECTION_TYPE_SHADOW);
 	VMake(ld, sun_position[X], sun_position[Y], sun_position[Z]);
 	set_frustum(main_bbox_tree, shadow_frustum, 63);
-	check_bbox_tree_shadow(main_bbox_tree, shadow_frustum, 63, main_frustum, 63, ld);
+	// test the shadow lines against the light view instead of the camera
+	// view, so the list stays valid while the camera turns and zooms
+	check_bbox_tree_shadow(main_bbox_tree, shadow_frustum, 63, shadow_frustum, 63, ld);
 	set_cur_intersect_type(main_bbox_tree, cur_intersect_type);
 }
 
@@ -1058,7 +1058,7 @@ int display_game_handler (window_info *win)
 	if (new_zoom_level != zoom_level)
 	{
 		if (new_zoom_level > zoom_level)
-			set_all_intersect_update_needed(main_bbox_tree);
+			set_view_intersect_update_needed(main_bbox_tree);
 		zoom_level = new_zoom_level;
 		resize_root_window ();
 	}
@@ -3,20 +3,180 @@
 #include <string.h>
 #include <stdlib.h>
 
+#define HASH_MIN_SIZE 8
+// grow when more than 3/4 of the slots are used
+#define HASH_MAX_ITEMS(size) ((size) - (size) / 4)
 
-hash_table *create_hash_table(int size, 
-			     unsigned long int (*hashfn)(void *), 
+// the int and string tables are the common case, avoid the calls for them
+#define HASH_KEYS_EQUAL(table, key1, key2) \
+	((table)->key_cmp == cmp_fn_int ? (key1) == (key2) : \
+	(table)->key_cmp == cmp_fn_str ? !strcmp((char*)(key1), (char*)(key2)) : \
+	(table)->key_cmp((key1), (key2)) != 0)
+
+static Uint32 get_hash(const hash_table *table, void *key)
+{
+	unsigned long int raw;
+	Uint32 hash;
+
+	if (table->hash_fun == hash_fn_int)
+		raw = (unsigned long int)key;
+	else
+		raw = table->hash_fun(key);
+
+	// the slot is taken from the low bits, so mix the high bits in
+	// (hash_fn_int returns the key itself)
+	hash = (Uint32)raw ^ (Uint32)((raw >> 16) >> 16);
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6bu;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35u;
+	hash ^= hash >> 16;
+
+	// 0 marks an empty slot
+	return hash != 0 ? hash : 1;
+}
+
+static Uint32 get_distance(const hash_table *table, Uint32 pos)
+{
+	Uint32 mask = table->size - 1;
+
+	return (pos - (table->hashes[pos] & mask)) & mask;
+}
+
+static void insert_entry(hash_table *table, Uint32 hash, void *key, void *item)
+{
+	Uint32 mask = table->size - 1;
+	Uint32 pos = hash & mask;
+	Uint32 dist = 0, cur_dist, tmp_hash;
+	hash_entry tmp;
+
+	while (table->hashes[pos] != 0)
+	{
+		// take the slot from entries closer to their home slot, and from
+		// entries with the same key: these come later in the probe order,
+		// so the entry carried along is always the newer one
+		cur_dist = get_distance(table, pos);
+		if (cur_dist < dist || (cur_dist == dist && table->hashes[pos] == hash
+			&& table->key_cmp && HASH_KEYS_EQUAL(table, key, table->store[pos].key)))
+		{
+			tmp = table->store[pos];
+			tmp_hash = table->hashes[pos];
+			table->store[pos].key = key;
+			table->store[pos].item = item;
+			table->hashes[pos] = hash;
+			key = tmp.key;
+			item = tmp.item;
+			hash = tmp_hash;
+			dist = cur_dist;
+		}
+		pos = (pos + 1) & mask;
+		dist++;
+	}
+
+	table->store[pos].key = key;
+	table->store[pos].item = item;
+	table->hashes[pos] = hash;
+}
+
+static int find_entry(const hash_table *table, void *key, Uint32 hash)
+{
+	Uint32 mask = table->size - 1;
+	Uint32 pos = hash & mask;
+	Uint32 dist = 0;
+
+	while (table->hashes[pos] != 0)
+	{
+		// the key would have taken this slot
+		if (get_distance(table, pos) < dist)
+			return -1;
+		if (table->hashes[pos] == hash && HASH_KEYS_EQUAL(table, key, table->store[pos].key))
+			return pos;
+		pos = (pos + 1) & mask;
+		dist++;
+	}
+	return -1;
+}
+
+static void remove_entry(hash_table *table, Uint32 pos)
+{
+	Uint32 mask = table->size - 1;
+	Uint32 next = (pos + 1) & mask;
+
+	// shift the following entries back instead of leaving a tombstone
+	while (table->hashes[next] != 0 && get_distance(table, next) != 0)
+	{
+		table->store[pos] = table->store[next];
+		table->hashes[pos] = table->hashes[next];
+		pos = next;
+		next = (next + 1) & mask;
+	}
+
+	table->store[pos].key = NULL;
+	table->store[pos].item = NULL;
+	table->hashes[pos] = 0;
+}
+
+static int alloc_store(hash_table *table, int size)
+{
+	table->store = (hash_entry*)calloc(size, sizeof(hash_entry));
+	table->hashes = (Uint32*)calloc(size, sizeof(Uint32));
+	if (!table->store || !table->hashes)
+	{
+		free(table->store);
+		free(table->hashes);
+		table->store = NULL;
+		table->hashes = NULL;
+		return 0;
+	}
+	table->size = size;
+	return 1;
+}
+
+static int resize_hash_table(hash_table *table, int size)
+{
+	hash_entry *old_store = table->store;
+	Uint32 *old_hashes = table->hashes;
+	int old_size = table->size;
+	int empty, i, pos;
+
+	if (!alloc_store(table, size))
+	{
+		table->store = old_store;
+		table->hashes = old_hashes;
+		return 0;
+	}
+
+	// go backwards from an empty slot, so entries with the same key are
+	// added oldest first and the newest one ends up in front again
+	for (empty = 0; old_hashes[empty] != 0; empty++)
+		/* nothing */;
+	for (i = 1; i < old_size; i++)
+	{
+		pos = (empty - i) & (old_size - 1);
+		if (old_hashes[pos] != 0)
+			insert_entry(table, old_hashes[pos], old_store[pos].key, old_store[pos].item);
+	}
+
+	free(old_store);
+	free(old_hashes);
+	return 1;
+}
+
+hash_table *create_hash_table(int size,
+			     unsigned long int (*hashfn)(void *),
 			     int (*keyfn)(void *, void*),
 			     void (*freefn)(void *)){
 	hash_table *new_table;
-	
+	int slots;
+
 	new_table=(hash_table*)calloc(1,sizeof(hash_table));
 	if(!new_table) return NULL;
 
-	new_table->store=(hash_entry**)calloc(size,sizeof(hash_entry*));
-	if(!new_table->store) { free(new_table); return NULL;}
-	
-	new_table->size=size;
+	// room for size items before the first resize
+	for (slots = HASH_MIN_SIZE; HASH_MAX_ITEMS(slots) < size; slots *= 2)
+		/* nothing */;
+	if (!alloc_store(new_table, slots)) { free(new_table); return NULL;}
+
 	new_table->items=0;
 	new_table->hash_fun=hashfn;
 	new_table->key_cmp=keyfn;
@@ -27,21 +187,16 @@ hash_table *create_hash_table(int size,
 
 int destroy_hash_table(hash_table *table){
 	int i;
-	hash_entry *he=NULL, *ht=NULL;
 
 	if(table){
 		if(table->store) {
 			if (table->free_fun)
 				for(i=0;i<table->size;i++){
-					he=table->store[i];
-					while(he){
-						ht=he->next;
-						table->free_fun(he->item);
-						free(he);
-						he=ht;
-					}
+					if (table->hashes[i])
+						table->free_fun(table->store[i].item);
 				}
 			free(table->store);
+			free(table->hashes);
 		}
 		free(table);
 		return 1;
@@ -50,97 +205,67 @@ int destroy_hash_table(hash_table *table){
 }
 
 hash_entry *hash_get(hash_table *table, void* key){
-	unsigned int pos;
-	hash_entry *he=NULL;
+	int pos;
 
 	if(!table||!table->hash_fun||!table->key_cmp) return NULL;
-	
-	pos=(table->hash_fun(key))%table->size;
 
-	he=table->store[pos];
-	while(he){
-		if(table->key_cmp(key,he->key)!=0) break;
-		he=he->next;
-	}
-	return he;
+	pos = find_entry(table, key, get_hash(table, key));
+	return pos >= 0 ? &table->store[pos] : NULL;
 }
 
 int hash_add(hash_table *table, void* key, void *item){
-	unsigned int pos;
-	hash_entry *he=NULL;
-
 	if(!table||!table->hash_fun) return 0;
-	
-	pos=table->hash_fun(key)%table->size;
-	
-	he=(hash_entry*)calloc(1,sizeof(hash_entry));
-	if(!he) return 0;
-	he->key=key;
-	he->item=item;
-	he->next=table->store[pos];
-	table->store[pos]=he;
+
+	if (table->items + 1 > HASH_MAX_ITEMS(table->size) &&
+		!resize_hash_table(table, table->size * 2))
+		return 0;
+
+	// insert_entry puts it in front of older items with the same key, so
+	// hash_get finds it first
+	insert_entry(table, get_hash(table, key), key, item);
 	table->items++;
 	return 1;
 }
 
 int hash_delete(hash_table *table, void *key){
-
-	hash_entry *he,*ht,*hp;
+	Uint32 hash;
 	int del=0,pos;
 
 	if(!table||!table->hash_fun||!table->key_cmp) return del;
-	
-	pos=table->hash_fun(key)%table->size;
-	he=table->store[pos];
-	ht=NULL;
-	while(he){
-		hp=he->next;
-		if(table->key_cmp(key,he->key)!=0) {
-			if (ht) ht->next=he->next;
-			else table->store[pos]=he->next;
-			if (table->free_fun) 
-				table->free_fun(he->item);			
-			free(he);
-			del++;
-			table->items--;	
-		} else ht=he;
-		he=hp;
+
+	hash = get_hash(table, key);
+	while ((pos = find_entry(table, key, hash)) >= 0)
+	{
+		if (table->free_fun)
+			table->free_fun(table->store[pos].item);
+		remove_entry(table, pos);
+		del++;
+		table->items--;
 	}
 	return del;
 }
 
 
-void hash_start_iterator(hash_table *table){ 
+void hash_start_iterator(hash_table *table){
 	if(!table) return;
-	table->cur=table->store[0];
-	table->where=-1;
+	table->where=0;
 }
 
 hash_entry *hash_get_next(hash_table *table){
+	if(!table) return NULL;
 
-	if(!table||table->where>=table->size) {
-		return NULL;
-	}
-
-	if(table->where==-1&&table->cur&&table->cur==table->store[0]) {
-		table->where++;
-		return table->store[0];
-	}
+	return hash_iterate(table, &table->where);
+}
 
-	if(table->cur&&table->cur->next){
-			return (table->cur = table->cur->next);
-			}
+hash_entry *hash_iterate(const hash_table *table, int *pos){
+	if(!table||!pos) return NULL;
 
-	table->cur=NULL;
-	table->where++;
-	while(table->where<table->size){
-		if(table->store[table->where]){
-			table->cur=table->store[table->where];
-			break;
-		}
-		table->where++;	  
+	while (*pos < table->size)
+	{
+		if (table->hashes[(*pos)++])
+			return &table->store[*pos - 1];
 	}
-	return table->cur;
+	return NULL;
 }
 
 
@@ -183,4 +308,3 @@ Uint32 mem_hash(const void* str, const Uint32 len)
 
 	return hash;
 }
-
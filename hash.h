@@ -6,37 +6,55 @@
 typedef struct _hash_entry{
 	void *key;
 	void *item;
-	struct _hash_entry *next;
 } hash_entry;
 
+/*
+ * Open addressing with Robin Hood probing. The entries are kept in one
+ * array together with their (mixed) hash values, a hash of 0 marks an
+ * empty slot. The table grows when it gets too full, the size given to
+ * create_hash_table is only the initial size.
+ */
 typedef struct _hash_table{
-	int size;
+	int size;		// number of slots, always a power of two
 	int items;
-	hash_entry **store;
+	hash_entry *store;
+	Uint32 *hashes;
+
+	int where;		// position of the built-in iterator
 
-	hash_entry *cur;
-	int where;
-	
 	unsigned long int (*hash_fun)(void *);
 	int (*key_cmp)(void *, void *);
 	void (*free_fun)(void *);
 } hash_table;
 
 
-hash_table *create_hash_table(int size, 
-			     unsigned long int (*hashfn)(void *), 
+hash_table *create_hash_table(int size,
+			     unsigned long int (*hashfn)(void *),
 			     int (*keyfn)(void *, void*),
 			     void (*freefn)(void *)
 );
 
 int destroy_hash_table(hash_table *table);
 
+/*
+ * The returned entry is only valid until the next hash_add or
+ * hash_delete on the table. When a key was added more than once, the
+ * most recently added item is returned.
+ */
 hash_entry *hash_get(hash_table *table, void* key);
 int hash_add(hash_table *table, void* key, void *item);
 int hash_delete(hash_table *table, void *key);
+
+// iterate using the state stored in the table
 void hash_start_iterator(hash_table *table);
 hash_entry *hash_get_next(hash_table *table);
 
+/*
+ * Re-entrant iteration, the caller keeps the position. Start with *pos
+ * set to 0, returns NULL after the last entry.
+ */
+hash_entry *hash_iterate(const hash_table *table, int *pos);
+
 
 //HASH & KEY_CMP
 unsigned long int hash_fn_int(void *key);
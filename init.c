@@ -9,6 +9,7 @@
 #include <errno.h>
 #include <ctype.h>
 #include <time.h>
+#include <libxml/parser.h>
 #include "astrology.h"
 #include "init.h"
 #include "2d_objects.h"
@@ -704,7 +705,7 @@ void init_e3d_cache()
 	cache_e3d = cache_init("E3d cache", 1500, NULL);	//no aut- free permitted
 	cache_set_compact(cache_e3d, &free_e3d_va);	// to compact, free VA arrays
 	cache_set_time_limit(cache_e3d, 5*60*1000);
-	cache_set_size_limit(cache_e3d, 8*1024*1024);
+	cache_set_budget(cache_e3d, &e3d_cache_budget);
 }
 
 #ifndef FASTER_MAP_LOAD
@@ -714,6 +715,38 @@ void init_2d_obj_cache()
 }
 #endif
 
+static Uint32 init_stage_start = 0;
+
+/* Logs how long the startup stage that ends now took */
+static void init_stage_done(const char *stage)
+{
+	Uint32 now = SDL_GetTicks();
+
+	LOG_INFO("Init stage %s took %u ms", stage, now - init_stage_start);
+	init_stage_start = now;
+}
+
+/* Loads the data that needs neither the GL context nor the console while
+ * the main thread sets up the video and loads the textures. Only add
+ * loaders here that don't touch anything the main thread uses before
+ * init_stuff waits for this thread. */
+static int init_data_thread(void *data)
+{
+	Uint32 start;
+
+	init_thread_log("init_data");
+
+	start = SDL_GetTicks();
+
+	load_harvestable_list();
+	load_entrable_list();
+	load_knowledge_list();
+	missiles_init_defs();
+
+	*(Uint32*)data = SDL_GetTicks() - start;
+	return 0;
+}
+
 void init_stuff()
 {
 	int seed;
@@ -721,14 +754,23 @@ void init_stuff()
 	int i;
 	char config_location[300];
 	const char * cfgdir;
+	SDL_Thread *data_thread;
+	Uint32 data_thread_time = 0, init_start;
 
 	if (chdir(datadir) != 0)
 	{
 		LOG_ERROR("%s() chdir(\"%s\") failed: %s\n", __FUNCTION__, datadir, strerror(errno));
 	}
 
+	// SDL_Init starts the clock of SDL_GetTicks, so the stage times can
+	// only be taken after it. The video is set up further down.
+	//SDL_Init(SDL_INIT_NOPARACHUTE | SDL_INIT_EVENTTHREAD);	// experimental
+	SDL_Init(SDL_INIT_NOPARACHUTE);
+	init_start = init_stage_start = SDL_GetTicks();
+
 	init_crc_tables();
 	init_zip_archives();
+	init_stage_done("archives");
 
 	// initialize the text buffers - needed early for logging
 	init_text_buffers ();
@@ -748,6 +790,7 @@ void init_stuff()
 
 	// all options loaded
 	options_loaded();
+	init_stage_done("config");
 
 	// Check if our datadir is valid and if not failover to ./
 	file_check_datadir();
@@ -780,9 +823,13 @@ void init_stuff()
 
 	//Good, we should be in the right working directory - load all translatables from their files
 	load_translatables();
+	init_stage_done("fonts and translatables");
+
+	// libxml2 has to be initialised before it's used from several threads
+	xmlInitParser();
+	data_thread = SDL_CreateThread(init_data_thread, &data_thread_time);
 
-	//if(SDL_Init(SDL_INIT_VIDEO | SDL_INIT_NOPARACHUTE | SDL_INIT_EVENTTHREAD) == -1)	// experimental
-	if(SDL_Init(SDL_INIT_VIDEO | SDL_INIT_NOPARACHUTE) == -1)
+	if(SDL_InitSubSystem(SDL_INIT_VIDEO) == -1)
 		{
 			LOG_ERROR("%s: %s\n", no_sdl_str, SDL_GetError());
 			fprintf(stderr, "%s: %s\n", no_sdl_str, SDL_GetError());
@@ -790,6 +837,7 @@ void init_stuff()
 			exit(1);
 		}
 	init_video();
+	init_stage_done("video");
 
 #ifdef MAP_EDITOR2
 	SDL_WM_SetCaption( "Map Editor", "mapeditor" );
@@ -818,6 +866,7 @@ void init_stuff()
 		exit(1);
 	}
 	CHECK_GL_ERRORS();
+	init_stage_done("caches and font textures");
 
 	// read the continent map info
 	read_mapinfo();
@@ -844,6 +893,7 @@ void init_stuff()
 	LOG_DEBUG("Init eyecandy");
 	ec_init();
 	LOG_DEBUG("Init eyecandy done");
+	init_stage_done("GL extensions and eye candy");
 
 #ifdef  CUSTOM_UPDATE
 	init_custom_update();
@@ -861,9 +911,6 @@ void init_stuff()
 	update_loading_win(load_filters_str, 2);
 	load_filters();
 	update_loading_win(load_lists_str, 2);
-	load_harvestable_list();
-	load_entrable_list();
-	load_knowledge_list();
 	load_mines_config();
 	update_loading_win(load_cursors_str, 5);
 	load_cursors();
@@ -871,7 +918,7 @@ void init_stuff()
 	change_cursor(CURSOR_ARROW);
 	update_loading_win(bld_glow_str, 3);
 	build_glow_color_table();
-
+	init_stage_done("lists and cursors");
 
 	update_loading_win(init_lists_str, 2);
 	init_actors_lists();
@@ -884,6 +931,7 @@ void init_stuff()
 	update_loading_win(init_audio_str, 1);
 	load_sound_config_data(SOUND_CONFIG_PATH);
 #endif // NEW_SOUND
+	init_stage_done("particles and sound");
 	update_loading_win(init_actor_defs_str, 4);
 	memset(actors_defs, 0, sizeof(actors_defs));
 
@@ -891,8 +939,7 @@ void init_stuff()
 	init_actor_defs();
 	LOG_DEBUG("Init actor defs done");
 	read_emotes_defs("", "emotes.xml");
-
-	missiles_init_defs();
+	init_stage_done("actor defs");
 
 	update_loading_win(load_map_tiles_str, 4);
 	load_map_tiles();
@@ -915,6 +962,7 @@ void init_stuff()
  	update_loading_win(init_weather_str, 3);
 	weather_init();
 	build_levels_table();//for some HUD stuff
+	init_stage_done("map tiles, lights and weather");
 
 	update_loading_win(load_icons_str, 4);
 	//load the necesary textures
@@ -1002,6 +1050,21 @@ void init_stuff()
 	ground_detail_text=load_texture_cache("./textures/ground_detail.bmp",255);
 #endif	/* NEW_TEXTURES */
 	CHECK_GL_ERRORS();
+	init_stage_done("textures");
+
+	// everything after this may use the data loaded by the thread
+	if (data_thread != NULL)
+	{
+		SDL_WaitThread(data_thread, NULL);
+		init_stage_done("waiting for data thread");
+	}
+	else
+	{
+		init_data_thread(&data_thread_time);
+		init_stage_done("data (no thread)");
+	}
+	LOG_INFO("Init stage data took %u ms in its own thread", data_thread_time);
+
 	init_login_screen ();
 	init_spells ();
 
@@ -1026,6 +1089,7 @@ void init_stuff()
 		SDL_Quit();
 	 	exit(1);
 	}
+	init_stage_done("spells, network and timers");
 	update_loading_win(load_encyc_str, 5);
 	safe_snprintf(file_name, sizeof(file_name), "languages/%s/Encyclopedia/index.xml", lang);
 	if (!el_file_exists(file_name))
@@ -1064,6 +1128,7 @@ void init_stuff()
 
 	//Read the books for i.e. the new char window
 	init_books();
+	init_stage_done("encyclopedia, rules and books");
 
 	update_loading_win(init_display_str, 5);
 	if (!disable_gamma_adjust)
@@ -1126,6 +1191,8 @@ void init_stuff()
 
 	skybox_init_gl();
 	popup_init();
+	init_stage_done("windows");
 
+	LOG_INFO("Init took %u ms", SDL_GetTicks() - init_start);
 	LOG_DEBUG("Init done!");
 }
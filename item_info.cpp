@@ -10,9 +10,9 @@
 	image id are used then the values may not be unique.  The get_item_count()
 	function allows you to check for uniqueness.
 
-	The description, emu and count functions all cached last result to speed
-	up the look-up, otherwise, the return time is dependant on the position
-	in the list (but still not that slow).
+	Items are indexed by their ids when the file is loaded, and the
+	descriptions by the three character sequences they contain, so the
+	storage filter only has to check the items that may match.
 
 	Author bluap/pjbroad February 2013
 */
@@ -44,13 +44,19 @@ namespace Item_Info
 			~Item(void) {}
 			bool is_valid(void) const { return valid; }
 			const std::string &get_description(void) const { return description; }
+			const std::string &get_lower_description(void) const { return lower_description; }
 			int get_emu(void) const { return emu; }
-			const bool compare(Uint16 the_item_id, int the_image_id) const;
+			Uint16 get_item_id(void) const { return item_id; }
+			int get_image_id(void) const { return image_id; }
+			size_t get_index(void) const { return index; }
+			void set_index(size_t the_index) { index = the_index; }
 		private:
 			Uint16 item_id;
 			int image_id;
 			int emu;
 			std::string description;
+			std::string lower_description;
+			size_t index;
 			bool valid;
 	};
 
@@ -76,28 +82,18 @@ namespace Item_Info
 		description.erase(std::find_if(description.rbegin(), description.rend(), std::not1(std::ptr_fun<int, int>(std::isspace))).base(), description.end());
 		if (description.empty())
 			return;
+		lower_description = description;
+		std::transform(lower_description.begin(), lower_description.end(), lower_description.begin(), tolower);
 		valid = true;
 	}
 
 
-	//	Return true of the item matches the ids, allowing for unset unique ids
-	//
-	const bool Item::compare(Uint16 the_item_id, int the_image_id) const
-	{
-		if ((the_item_id == unset_item_uid) && (the_image_id == image_id))
-			return true;
-		if ((the_item_id == item_id) && (the_image_id == image_id))
-			return true;
-		return false;
-	}
-
-
 	//	Class to hold the list of items
 	//
 	class List
 	{
 		public:
-			List(void) : load_tried(false), shown_help(false), last_item(0) {}
+			List(void) : load_tried(false), shown_help(false) {}
 			~List(void);
 			const std::string &get_description(Uint16 item_id, int image_id);
 			int get_emu(Uint16 item_id, int image_id);
@@ -106,26 +102,30 @@ namespace Item_Info
 			void help_if_needed(void);
 			void filter_by_description(Uint8 *storage_items_filter, const ground_item *storage_items, const char *filter_item_text, int no_storage);
 		private:
+			typedef std::pair<Uint16, int> Ids;
+			//	The first item with the ids, and the number of items with them
+			class Entry
+			{
+				public:
+					Entry(void) : item(0), count(0) {}
+					Item *item;
+					int count;
+			};
 			Item *get_item(Uint16 item_id, int image_id);
+			const Entry *get_entry(Uint16 item_id, int image_id);
+			void add_trigrams(const Item *item);
+			void match_description(const std::string &needle);
 			void load(void);
+			static Uint32 trigram(const std::string &text, size_t pos)
+				{ return (static_cast<Uint8>(text[pos]) << 16) | (static_cast<Uint8>(text[pos+1]) << 8) | static_cast<Uint8>(text[pos+2]); }
 			std::vector<Item *> the_list;
+			std::map<Ids, Entry> by_ids;
+			std::map<int, Entry> by_image_id;
+			std::map<Uint32, std::vector<size_t> > trigrams;
+			std::string last_needle;
+			std::vector<Uint8> matches;
 			static std::string empty_str;
 			bool load_tried, shown_help;
-			Item *last_item;
-			class Count
-			{
-				public:
-					Count(void) : count(-1) {}
-					bool matches(Uint16 item_id, int image_id) const
-						{ return ((count >= 0) && (this->item_id == item_id) && (this->image_id == image_id)); }
-					int get_count(void) const { return count; }
-					void set(Uint16 item_id, int image_id, int count)
-						{ this->item_id = item_id; this->image_id = image_id; this->count = count; }
-				private:
-					Uint16 item_id; int image_id; int count;
-			};
-			Count last_count;
-
 	};
 
 
@@ -142,20 +142,27 @@ namespace Item_Info
 	}
 
 
+	//	Find the index entry for the ids, allowing for unset unique ids
+	//
+	const List::Entry *List::get_entry(Uint16 item_id, int image_id)
+	{
+		info_available();
+		if (item_id == unset_item_uid)
+		{
+			std::map<int, Entry>::const_iterator iter = by_image_id.find(image_id);
+			return (iter != by_image_id.end()) ? &iter->second : 0;
+		}
+		std::map<Ids, Entry>::const_iterator iter = by_ids.find(Ids(item_id, image_id));
+		return (iter != by_ids.end()) ? &iter->second : 0;
+	}
+
+
 	//	Find and item by the ids
 	//
 	Item *List::get_item(Uint16 item_id, int image_id)
 	{
-		info_available();
-		if (last_item && last_item->compare(item_id, image_id))
-			return last_item;
-		for (size_t i=0; i<the_list.size(); ++i)
-			if (the_list[i]->compare(item_id, image_id))
-			{
-				last_item = the_list[i];
-				return last_item;
-			}
-		return 0;
+		const Entry *entry = get_entry(item_id, image_id);
+		return (entry) ? entry->item : 0;
 	}
 
 
@@ -185,15 +192,59 @@ namespace Item_Info
 	//
 	int List::get_count(Uint16 item_id, int image_id)
 	{
-		info_available();
-		if (last_count.matches(item_id, image_id))
-			return last_count.get_count();
-		int match_count = 0;
-		for (size_t i=0; i<the_list.size(); ++i)
-			if (the_list[i]->compare(item_id, image_id))
-				match_count++;
-		last_count.set(item_id, image_id, match_count);
-		return last_count.get_count();
+		const Entry *entry = get_entry(item_id, image_id);
+		return (entry) ? entry->count : 0;
+	}
+
+
+	//	Add the item to the lists of the three character sequences in its description
+	//
+	void List::add_trigrams(const Item *item)
+	{
+		const std::string &text = item->get_lower_description();
+		for (size_t pos = 0; pos + 3 <= text.size(); pos++)
+		{
+			std::vector<size_t> &items = trigrams[trigram(text, pos)];
+			// items are added in order, so duplicates are next to each other
+			if (items.empty() || items.back() != item->get_index())
+				items.push_back(item->get_index());
+		}
+	}
+
+
+	//	Flag the items whose description contains the lower case needle
+	//
+	void List::match_description(const std::string &needle)
+	{
+		if ((needle == last_needle) && (matches.size() == the_list.size()))
+			return;
+		last_needle = needle;
+		matches.assign(the_list.size(), 0);
+
+		if (needle.size() < 3)
+		{
+			for (size_t i=0; i<the_list.size(); i++)
+				matches[i] = (the_list[i]->get_lower_description().find(needle) != std::string::npos);
+			return;
+		}
+
+		//	Only items having every sequence of the needle can contain it,
+		//	so start from the shortest list and check those items
+		const std::vector<size_t> *shortest = 0;
+		for (size_t pos = 0; pos + 3 <= needle.size(); pos++)
+		{
+			std::map<Uint32, std::vector<size_t> >::const_iterator iter = trigrams.find(trigram(needle, pos));
+			if (iter == trigrams.end())
+				return;
+			if (!shortest || (iter->second.size() < shortest->size()))
+				shortest = &iter->second;
+		}
+		for (size_t i=0; i<shortest->size(); i++)
+		{
+			size_t index = (*shortest)[i];
+			if (the_list[index]->get_lower_description().find(needle) != std::string::npos)
+				matches[index] = 1;
+		}
 	}
 
 	//	Match passed string against specified item descriptions and return details for matches
@@ -205,17 +256,11 @@ namespace Item_Info
 			return;
 		std::string needle(filter_item_text);
 		std::transform(needle.begin(), needle.end(), needle.begin(), tolower);
+		match_description(needle);
 		for (size_t i=0; i<static_cast<size_t>(no_storage); i++)
 		{
-			storage_items_filter[i] = 1;
 			Item *item = get_item(storage_items[i].id, storage_items[i].image_id);
-			if (item)
-			{
-				std::string haystack(item->get_description());
-				std::transform(haystack.begin(), haystack.end(), haystack.begin(), tolower);
-				if (haystack.find(needle) != std::string::npos)
-					storage_items_filter[i] = 0;
-			}
+			storage_items_filter[i] = (item && matches[item->get_index()]) ? 0 : 1;
 		}
 	}
 
@@ -239,10 +284,23 @@ namespace Item_Info
 		while (std::getline(in, line))
 		{
 			Item *new_item = new Item(line);
-			if (new_item->is_valid())
-				the_list.push_back(new_item);
-			else
+			if (!new_item->is_valid())
+			{
 				delete new_item;
+				continue;
+			}
+			new_item->set_index(the_list.size());
+			the_list.push_back(new_item);
+			//	the first item in the file wins when ids are repeated
+			Entry &exact = by_ids[Ids(new_item->get_item_id(), new_item->get_image_id())];
+			if (!exact.item)
+				exact.item = new_item;
+			exact.count++;
+			Entry &image = by_image_id[new_item->get_image_id()];
+			if (!image.item)
+				image.item = new_item;
+			image.count++;
+			add_trigrams(new_item);
 		}
 	}
 
@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include "lights.h"
 #include "bbox_tree.h"
@@ -111,10 +112,263 @@ CHECK_GL_ERRORS();
 #endif //OPENGL_TRACE
 }
 
-void draw_lights()
+// Local lights are kept in a grid of cells, each light in the cells it
+// noticeably lights. Objects and actors drawn in the main view use the
+// strongest lights of their cell, everything else the lights near the camera.
+#define MAX_LOCAL_LIGHTS		4	// GL_LIGHT0 to GL_LIGHT3
+#define LIGHT_LINEAR_ATTENUATION	1.41f
+#define LIGHT_GRID_CELL_SIZE		8.0f
+#define LIGHT_GRID_SIZE			64	// cells per side, wraps around
+#define LIGHT_GRID_MASK			(LIGHT_GRID_SIZE - 1)
+#define LIGHT_GRID_MIN_INFLUENCE	0.05f
+#define LIGHT_GRID_MAX_RADIUS		(3 * LIGHT_GRID_CELL_SIZE)
+
+typedef struct
+{
+	Uint16 *lights;
+	Uint32 count;
+	Uint32 size;
+} light_grid_cell;
+
+typedef struct
+{
+	int in_grid;
+	int min_x, min_y, max_x, max_y;
+} light_grid_area;
+
+static light_grid_cell light_grid[LIGHT_GRID_SIZE][LIGHT_GRID_SIZE];
+// the cells of each light, lights freed outside destroy_light leave their
+// entries until the slot is reused
+static light_grid_area light_grid_areas[MAX_LIGHTS];
+
+static int scene_lights[MAX_LOCAL_LIGHTS];
+static int scene_light_count = 0;
+// the lights set for GL_LIGHT0 to GL_LIGHT3, -1 for a dark one and
+// LOCAL_LIGHT_UNKNOWN when the colour has to be set again
+#define LOCAL_LIGHT_UNKNOWN -2
+static int cur_local_lights[MAX_LOCAL_LIGHTS] = { -1, -1, -1, -1 };
+
+static void forget_local_light(int id)
+{
+	int j;
+
+	for (j = 0; j < MAX_LOCAL_LIGHTS; j++)
+	{
+		if (id < 0 || cur_local_lights[j] == id)
+			cur_local_lights[j] = LOCAL_LIGHT_UNKNOWN;
+	}
+}
+
+static int get_light_grid_cell(float pos)
+{
+	return (int)floorf(pos / LIGHT_GRID_CELL_SIZE);
+}
+
+static float get_light_brightness(const light *l)
+{
+	return max2f(l->r, max2f(l->g, l->b));
+}
+
+static float get_light_influence(const light *l, float x, float y, float z)
+{
+	float dx, dy, dz;
+
+	dx = l->pos_x - x;
+	dy = l->pos_y - y;
+	dz = l->pos_z - z;
+
+	return get_light_brightness(l) / (1.0f + LIGHT_LINEAR_ATTENUATION * sqrtf(dx * dx + dy * dy + dz * dz));
+}
+
+static void remove_light_from_grid(int id)
+{
+	light_grid_area *area = &light_grid_areas[id];
+	light_grid_cell *cell;
+	int x, y;
+	Uint32 i;
+
+	if (!area->in_grid) return;
+	area->in_grid = 0;
+
+	for (y = area->min_y; y <= area->max_y; y++)
+	{
+		for (x = area->min_x; x <= area->max_x; x++)
+		{
+			cell = &light_grid[y & LIGHT_GRID_MASK][x & LIGHT_GRID_MASK];
+			for (i = 0; i < cell->count; i++)
+			{
+				if (cell->lights[i] == id)
+				{
+					cell->lights[i] = cell->lights[--cell->count];
+					break;
+				}
+			}
+		}
+	}
+}
+
+static void add_light_to_grid(int id)
+{
+	light_grid_area *area = &light_grid_areas[id];
+	light_grid_cell *cell;
+	const light *l = lights_list[id];
+	float radius;
+	int x, y;
+
+	remove_light_from_grid(id);
+
+	// where the light falls below LIGHT_GRID_MIN_INFLUENCE
+	radius = (get_light_brightness(l) / LIGHT_GRID_MIN_INFLUENCE - 1.0f) / LIGHT_LINEAR_ATTENUATION;
+	radius = max2f(0.0f, min2f(radius, LIGHT_GRID_MAX_RADIUS));
+
+	area->in_grid = 1;
+	area->min_x = get_light_grid_cell(l->pos_x - radius);
+	area->min_y = get_light_grid_cell(l->pos_y - radius);
+	area->max_x = get_light_grid_cell(l->pos_x + radius);
+	area->max_y = get_light_grid_cell(l->pos_y + radius);
+
+	for (y = area->min_y; y <= area->max_y; y++)
+	{
+		for (x = area->min_x; x <= area->max_x; x++)
+		{
+			cell = &light_grid[y & LIGHT_GRID_MASK][x & LIGHT_GRID_MASK];
+			if (cell->count >= cell->size)
+			{
+				cell->size = cell->size ? cell->size * 2 : 4;
+				cell->lights = realloc(cell->lights, cell->size * sizeof(Uint16));
+			}
+			cell->lights[cell->count++] = id;
+		}
+	}
+}
+
+static void clear_light_grid(void)
+{
+	int x, y;
+
+	for (y = 0; y < LIGHT_GRID_SIZE; y++)
+	{
+		for (x = 0; x < LIGHT_GRID_SIZE; x++)
+		{
+			free(light_grid[y][x].lights);
+			light_grid[y][x].lights = NULL;
+			light_grid[y][x].count = 0;
+			light_grid[y][x].size = 0;
+		}
+	}
+	memset(light_grid_areas, 0, sizeof(light_grid_areas));
+	// the map code frees the lights themselves, the slots get new colours
+	forget_local_light(-1);
+}
+
+static void set_local_lights(const int *ids, int count)
 {
-	unsigned int i, j, l, start, stop;
 	VECTOR4 vec4;
+	int j;
+
+	for (j = 0; j < MAX_LOCAL_LIGHTS; j++)
+	{
+		if (j < count)
+		{
+			// the position depends on the modelview matrix, always set it
+			vec4[0] = lights_list[ids[j]]->pos_x;
+			vec4[1] = lights_list[ids[j]]->pos_y;
+			vec4[2] = lights_list[ids[j]]->pos_z;
+			vec4[3] = 1.0f;
+			glLightfv(GL_LIGHT0+j, GL_POSITION, vec4);
+			if (cur_local_lights[j] == ids[j]) continue;
+			vec4[0] = lights_list[ids[j]]->r;
+			vec4[1] = lights_list[ids[j]]->g;
+			vec4[2] = lights_list[ids[j]]->b;
+			vec4[3] = 1.0f;
+			glLightfv(GL_LIGHT0+j, GL_DIFFUSE, vec4);
+			cur_local_lights[j] = ids[j];
+		}
+		else if (cur_local_lights[j] != -1)
+		{
+			vec4[0] = vec4[1] = vec4[2] = vec4[3] = 0.0f;
+			glLightfv(GL_LIGHT0+j, GL_DIFFUSE, vec4);
+			cur_local_lights[j] = -1;
+		}
+	}
+
+#ifdef OPENGL_TRACE
+CHECK_GL_ERRORS();
+#endif //OPENGL_TRACE
+}
+
+static int same_local_lights(const int *ids, int count)
+{
+	int j;
+
+	for (j = 0; j < MAX_LOCAL_LIGHTS; j++)
+	{
+		if (cur_local_lights[j] != ((j < count) ? ids[j] : -1))
+			return 0;
+	}
+	return 1;
+}
+
+void select_local_lights(float x, float y, float z)
+{
+	const light_grid_cell *cell;
+	float influence[MAX_LOCAL_LIGHTS];
+	int ids[MAX_LOCAL_LIGHTS];
+	int count, j, k, id;
+	float cur;
+	Uint32 i;
+#ifdef CLUSTER_INSIDES_OLD
+	short cluster = get_actor_cluster ();
+#endif
+
+	if ((show_lights < 0) || (get_cur_intersect_type(main_bbox_tree) != INTERSECTION_TYPE_DEFAULT))
+		return;
+
+	count = 0;
+	cell = &light_grid[get_light_grid_cell(y) & LIGHT_GRID_MASK][get_light_grid_cell(x) & LIGHT_GRID_MASK];
+	for (i = 0; i < cell->count; i++)
+	{
+		id = cell->lights[i];
+		if (!lights_list[id]
+#ifdef CLUSTER_INSIDES_OLD
+		   || (lights_list[id]->cluster && lights_list[id]->cluster != cluster)
+#endif
+		)
+		{
+			continue;
+		}
+
+		// keep the strongest ones, sorted
+		cur = get_light_influence(lights_list[id], x, y, z);
+		for (j = count; (j > 0) && (influence[j - 1] < cur); j--);
+		if (j >= MAX_LOCAL_LIGHTS)
+			continue;
+		if (count < MAX_LOCAL_LIGHTS)
+			count++;
+		for (k = count - 1; k > j; k--)
+		{
+			influence[k] = influence[k - 1];
+			ids[k] = ids[k - 1];
+		}
+		influence[j] = cur;
+		ids[j] = id;
+	}
+
+	if (!same_local_lights(ids, count))
+		set_local_lights(ids, count);
+}
+
+void restore_scene_lights(void)
+{
+	if ((show_lights < 0) || same_local_lights(scene_lights, scene_light_count))
+		return;
+
+	set_local_lights(scene_lights, scene_light_count);
+}
+
+void draw_lights()
+{
+	unsigned int i, l, start, stop;
 #ifdef CLUSTER_INSIDES_OLD
 	short cluster = get_actor_cluster ();
 #endif
@@ -129,10 +383,10 @@ void draw_lights()
 	}
 	if(max_enabled >= 0 && show_lights != max_enabled)	enable_local_lights();
 	
-	j= 0;
+	scene_light_count= 0;
 	
 	get_intersect_start_stop(main_bbox_tree, TYPE_LIGHT, &start, &stop);
-	for(i=start; i<stop; i++)
+	for(i=start; (i<stop) && (scene_light_count < MAX_LOCAL_LIGHTS); i++)
 	{
 		l= get_intersect_item_ID(main_bbox_tree, i);
 		// and make sure it's a valid light
@@ -147,23 +401,10 @@ void draw_lights()
 #endif
 			continue;
 		}
-		vec4[0] = lights_list[l]->pos_x;
-		vec4[1] = lights_list[l]->pos_y;
-		vec4[2] = lights_list[l]->pos_z;
-		vec4[3] = 1.0f;
-		glLightfv(GL_LIGHT0+j, GL_POSITION, vec4);
-		vec4[0] = lights_list[l]->r;
-		vec4[1] = lights_list[l]->g;
-		vec4[2] = lights_list[l]->b;
-		vec4[3] = 1.0f;
-		glLightfv(GL_LIGHT0+j, GL_DIFFUSE, vec4);
-		if (j >= 4) break;
-		else j++;
+		scene_lights[scene_light_count++] = l;
 	}
 
-#ifdef OPENGL_TRACE
-CHECK_GL_ERRORS();
-#endif //OPENGL_TRACE
+	set_local_lights(scene_lights, scene_light_count);
 }
 
 void destroy_light(int i)
@@ -171,6 +412,7 @@ void destroy_light(int i)
 	if((i < 0) || (i >= MAX_LIGHTS)) return;
 	if(lights_list[i] == NULL) return;
 	delete_light_from_abt(main_bbox_tree, i);
+	remove_light_from_grid(i);
 	free(lights_list[i]);
 	lights_list[i]= NULL;
 }
@@ -197,6 +439,8 @@ int add_light(GLfloat x, GLfloat y, GLfloat z, GLfloat r, GLfloat g, GLfloat b,
 		return i;
 		
 	new_light = calloc(1, sizeof(light));
+	// a freed light may still be set with its old colour
+	forget_local_light(i);
 
 	new_light->pos_x= x;
 	new_light->pos_y= y;
@@ -217,6 +461,7 @@ int add_light(GLfloat x, GLfloat y, GLfloat z, GLfloat r, GLfloat g, GLfloat b,
 
 	lights_list[i] = new_light;
 	if (i >= num_lights) num_lights = i+1;	
+	add_light_to_grid(i);
 	calc_light_aabb(&bbox, x, y, z, r*intensity, g*intensity, b*intensity, 1.41f, 1.0f, 0.004f); // 0.004 ~ 1/256
 	if ((main_bbox_tree_items != NULL) && (dynamic == 0)) add_light_to_list(main_bbox_tree_items, i, bbox);
 	else add_light_to_abt(main_bbox_tree, i, bbox, dynamic);
@@ -234,6 +479,7 @@ void cleanup_lights(void)
 			lights_list[i]= NULL;
 		}
 	}
+	clear_light_grid();
 }
 
 //get the lights visible in the scene
@@ -91,6 +91,31 @@ void disable_local_lights();
  */
 void draw_lights();
 
+/*!
+ * \ingroup lights
+ * \brief   Sets the local lights for something drawn at the given position.
+ *
+ *      Sets the strongest lights of the light grid cell at the position
+ *      instead of the lights near the camera. Only done in the main view,
+ *      the modelview matrix must be the one of the camera.
+ *
+ * \param x             x coordinate of the position
+ * \param y             y coordinate of the position
+ * \param z             z coordinate of the position
+ *
+ * \sa restore_scene_lights
+ */
+void select_local_lights(float x, float y, float z);
+
+/*!
+ * \ingroup lights
+ * \brief   Sets the local lights near the camera again.
+ *
+ *      Undoes \ref select_local_lights, for the things drawn with the lights
+ *      set by \ref draw_lights.
+ */
+void restore_scene_lights(void);
+
 /*
  * \ingroup	lights
  * \brief	Destroys the light at position i in the lights_list
@@ -25,6 +25,7 @@
 #include "bbox_tree.h"
 #include "books.h"
 #include "buddy.h"
+#include "chat_log.h"
 #include "console.h"
 #include "counters.h"
 #include "cursors.h"
@@ -48,6 +49,7 @@
 #include "minimap.h"
 #include "multiplayer.h"
 #include "particles.h"
+#include "pathfinder.h"
 #include "pm_log.h"
 #include "questlog.h"
 #include "queue.h"
@@ -100,6 +102,7 @@ void cleanup_mem(void)
 	queue_destroy(buddy_request_queue);
 	cleanup_manufacture();
 	cleanup_text_buffers();
+	chat_log_close();
 	cleanup_fonts();
 	destroy_all_actors();
 	end_actors_lists();
@@ -227,6 +230,10 @@ int start_rendering()
 
 			//cache handling
 			if(cache_system)cache_system_maint();
+#ifdef	NEW_TEXTURES
+			update_texture_streaming();
+#endif	/* NEW_TEXTURES */
+			unload_unused_actor_defs();
 			//see if we need to exit
 			if(exit_now) {
 				done = 1;
@@ -253,6 +260,7 @@ int start_rendering()
 	clear_sound_data();		// Cleans up the config data
 #endif // NEW_SOUND
 	ec_destroy_all_effects();
+	pf_shutdown();
 	if (have_a_map)
 	{
 		destroy_map();
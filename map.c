@@ -552,8 +552,7 @@ void free_buffers()
 {
 	if (water_tile_buffer)
 		free(water_tile_buffer);
-	if (terrain_tile_buffer)
-		free(terrain_tile_buffer);
+	free_terrain_buffers();
 	if (reflection_portals)
 		free(reflection_portals);
 }
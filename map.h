@@ -104,7 +104,8 @@ void remove_3d_object_from_server (int id);
  * @ingroup maps
  * @brief Inits the buffer used for terrain.
  *
- * Inits the buffer used for terrain. Must be called every time map
+ * Builds the vertices of all terrain tiles of the map, they stay in a
+ * static vertex buffer until the next map is loaded. Must be called every time map
  * size increase, but also should be called every time time map size decrease.
  *
  * @param terrain_buffer_size The new size of the buffer in number of elements.
@@ -112,6 +113,16 @@ void remove_3d_object_from_server (int id);
  */
 void init_terrain_buffers(int terrain_buffer_size);
 
+/**
+ * @ingroup maps
+ * @brief Frees the buffers used for terrain.
+ *
+ * Frees the terrain vertices and the index list of the visible tiles.
+ *
+ * @callgraph
+ */
+void free_terrain_buffers(void);
+
 /**
  * @ingroup maps
  * @brief Inits the buffer and the portals.
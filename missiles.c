@@ -19,6 +19,7 @@
 #include "tiles.h"
 #include "translate.h"
 #include "vmath.h"
+#include "xml_cache.h"
 
 #include <math.h>
 #include <stdarg.h>
@@ -235,13 +236,90 @@ void missiles_remove(int missile_id)
 	}
 }
 
+#ifdef MISSILES_DEBUG
+#ifndef WINDOWS
+#include <sys/time.h>
+#endif
+
+static Uint64 missiles_get_usec(void)
+{
+#ifdef WINDOWS
+	FILETIME ft;
+	Uint64 t;
+
+	GetSystemTimeAsFileTime(&ft);
+	t = ft.dwHighDateTime;
+	t <<= 32;
+	t |= ft.dwLowDateTime;
+	return t / 10;
+#else
+	struct timeval t;
+
+	gettimeofday(&t, NULL);
+	return ((Uint64)t.tv_sec)*1000000ul + (Uint64)t.tv_usec;
+#endif
+}
+
+/* the time spent on the missiles while a stress test is running */
+static int stress_missiles = 0;
+static int stress_frames = 0;
+static Uint64 stress_update_time = 0;
+static Uint64 stress_draw_time = 0;
+
+int missiles_stress_test(int count)
+{
+	actor *me = get_our_actor();
+	float origin[3], target[3];
+	int i, added = 0;
+
+	if (!me || count <= 0)
+		return 0;
+
+	cal_get_actor_bone_absolute_position(me, get_actor_bone_id(me, body_top_bone), NULL, target);
+	for (i = 0; i < count && missiles_count < MAX_MISSILES; i++)
+	{
+		float angle = 2.0 * M_PI * i / count;
+		float dist = 5.0 + (i % 7);
+
+		origin[0] = target[0] + cosf(angle) * dist;
+		origin[1] = target[1] + sinf(angle) * dist;
+		origin[2] = target[2] + 0.5;
+		// a mix of missed, normal and critical arrows
+		if (missiles_add(0, origin, target, 0.0, (MissileShotType)(i % 3)) < MAX_MISSILES)
+			added++;
+	}
+
+	stress_missiles = added;
+	stress_frames = 0;
+	stress_update_time = stress_draw_time = 0;
+	missiles_log_message("stress test: %d missiles added", added);
+	return added;
+}
+
+static void missiles_stress_report(void)
+{
+	if (stress_missiles <= 0 || missiles_count > 0)
+		return;
+
+	missiles_log_message("stress test: %d missiles, %d frames, update %u us, draw %u us per frame",
+		stress_missiles, stress_frames,
+		stress_frames ? (Uint32)(stress_update_time / stress_frames) : 0,
+		stress_frames ? (Uint32)(stress_draw_time / stress_frames) : 0);
+	stress_missiles = 0;
+}
+#endif // MISSILES_DEBUG
+
 void missiles_update()
 {
 	int i;
 	static int last_update = 0;
 	float time_diff = (cur_time - last_update) / 1000.0;
-        
-	for (i = 0; i < missiles_count; ) {
+#ifdef MISSILES_DEBUG
+	Uint64 start = missiles_get_usec();
+#endif // MISSILES_DEBUG
+
+	// move everything first, the removals below reorder the list
+	for (i = 0; i < missiles_count; ++i) {
 		missile *mis = &missiles_list[i];
 		float dist = mis->speed * time_diff;
 		mis->position[0] += mis->direction[0] * dist;
@@ -249,7 +327,10 @@ void missiles_update()
 		mis->position[2] += mis->direction[2] * dist;
 		mis->covered_distance += dist;
 		mis->remaining_distance -= dist;
-		if (mis->remaining_distance < -mis->trace_length)
+	}
+
+	for (i = 0; i < missiles_count; ) {
+		if (missiles_list[i].remaining_distance < -missiles_list[i].trace_length)
 			missiles_remove(i);
 		else
 			++i;
@@ -265,90 +346,149 @@ void missiles_update()
 	}
 
 	last_update = cur_time;
+
+#ifdef MISSILES_DEBUG
+	if (stress_missiles > 0)
+	{
+		stress_update_time += missiles_get_usec() - start;
+		stress_frames++;
+		missiles_stress_report();
+	}
+#endif // MISSILES_DEBUG
 }
 
-void missiles_draw_single(missile *mis, const float color[4])
+/*
+ * All the lines of a frame are put in one vertex array and drawn with a
+ * glDrawArrays call per line style. A missile is drawn as a line from the
+ * end of its trace to its head, the alpha of both ends only depends on the
+ * missile, the color on the line style.
+ */
+typedef struct
 {
-	float z_shift = 0.0;
+	float position[3];
+	float color[4];
+} missile_vertex;
 
-/* 	if (mis->shot_type == MISSED_SHOT) */
-/* 		z_shift = cosf(mis->covered_distance*M_PI/2.0)/10.0; */
+/* criticals are drawn in three styles, the others in one */
+static missile_vertex missiles_vertices[MAX_MISSILES * 2 * 3];
 
-    if (mis->covered_distance < mis->trace_length) {
-        glColor4f(color[0], color[1], color[2],
-                  color[3] * (mis->trace_length - mis->covered_distance) / mis->trace_length);
-        glVertex3f(mis->position[0] - mis->covered_distance * mis->direction[0],
-                   mis->position[1] - mis->covered_distance * mis->direction[1],
-                   mis->position[2] - mis->covered_distance * mis->direction[2]);
-    }
-    else {
-        glColor4f(color[0], color[1], color[2], 0.0);
-        glVertex3f(mis->position[0] - mis->trace_length * mis->direction[0],
-                   mis->position[1] - mis->trace_length * mis->direction[1],
-                   mis->position[2] - mis->trace_length * mis->direction[2]);
-    }
-    if (mis->remaining_distance < 0.0) {
-        glColor4f(color[0], color[1], color[2],
-                  color[3] * (mis->trace_length + mis->remaining_distance) / mis->trace_length);
-        glVertex3f(mis->position[0] + mis->remaining_distance * mis->direction[0],
-                   mis->position[1] + mis->remaining_distance * mis->direction[1],
-                   mis->position[2] + mis->remaining_distance * mis->direction[2] + z_shift);
-    }
-    else {
-        glColor4f(color[0], color[1], color[2], color[3]);
-        glVertex3f(mis->position[0], mis->position[1], mis->position[2] + z_shift);
-    }
+static missile_vertex *missiles_add_line(missile_vertex *v, const missile *mis, const float color[4])
+{
+	float tail, tail_alpha, head, head_alpha;
+
+	if (mis->covered_distance < mis->trace_length) {
+		tail = mis->covered_distance;
+		tail_alpha = color[3] * (mis->trace_length - mis->covered_distance) / mis->trace_length;
+	}
+	else {
+		tail = mis->trace_length;
+		tail_alpha = 0.0;
+	}
+	if (mis->remaining_distance < 0.0) {
+		head = mis->remaining_distance;
+		head_alpha = color[3] * (mis->trace_length + mis->remaining_distance) / mis->trace_length;
+	}
+	else {
+		head = 0.0;
+		head_alpha = color[3];
+	}
+
+	v[0].position[0] = mis->position[0] - tail * mis->direction[0];
+	v[0].position[1] = mis->position[1] - tail * mis->direction[1];
+	v[0].position[2] = mis->position[2] - tail * mis->direction[2];
+	v[0].color[0] = color[0];
+	v[0].color[1] = color[1];
+	v[0].color[2] = color[2];
+	v[0].color[3] = tail_alpha;
+
+	v[1].position[0] = mis->position[0] + head * mis->direction[0];
+	v[1].position[1] = mis->position[1] + head * mis->direction[1];
+	v[1].position[2] = mis->position[2] + head * mis->direction[2];
+	v[1].color[0] = color[0];
+	v[1].color[1] = color[1];
+	v[1].color[2] = color[2];
+	v[1].color[3] = head_alpha;
+
+	return v + 2;
 }
 
 void missiles_draw()
 {
-	int i;
+	missile_vertex *v = missiles_vertices;
+	int i, critical_border, border, line, end;
+#ifdef MISSILES_DEBUG
+	Uint64 start = missiles_get_usec();
+#endif // MISSILES_DEBUG
 
-	glPushAttrib(GL_ALL_ATTRIB_BITS);
-	glEnable(GL_BLEND);
-	glEnable(GL_COLOR_MATERIAL);
-	glDisable(GL_LIGHTING);
-	glDisable(GL_TEXTURE_2D);
+	if (missiles_count == 0)
+		return;
 
-	glLineWidth(7.0);
-	glBegin(GL_LINES);
 	for (i = missiles_count; i--;) {
 		if (missiles_list[i].shot_type == CRITICAL_SHOT)
-			missiles_draw_single(&missiles_list[i], critical_border2_color);
+			v = missiles_add_line(v, &missiles_list[i], critical_border2_color);
 	}
-	glEnd();
-
-	glLineWidth(3.0);
-	glBegin(GL_LINES);
+	critical_border = v - missiles_vertices;
 	for (i = missiles_count; i--;) {
 		if (missiles_list[i].shot_type == NORMAL_SHOT)
-			missiles_draw_single(&missiles_list[i], arrow_border_color);
+			v = missiles_add_line(v, &missiles_list[i], arrow_border_color);
 		else if (missiles_list[i].shot_type == CRITICAL_SHOT)
-			missiles_draw_single(&missiles_list[i], critical_border1_color);
+			v = missiles_add_line(v, &missiles_list[i], critical_border1_color);
 	}
-	glEnd();
-
-	glLineWidth(1.0);
-	glBegin(GL_LINES);
+	border = v - missiles_vertices;
 	for (i = missiles_count; i--;) {
 		if (missiles_list[i].shot_type == NORMAL_SHOT)
-			missiles_draw_single(&missiles_list[i], arrow_color);
+			v = missiles_add_line(v, &missiles_list[i], arrow_color);
 		else if (missiles_list[i].shot_type == CRITICAL_SHOT)
-			missiles_draw_single(&missiles_list[i], critical_color);
+			v = missiles_add_line(v, &missiles_list[i], critical_color);
 	}
-	glEnd();
-
-	glLineWidth(2.0);
-	glLineStipple(1, 0x003F);
-	glEnable(GL_LINE_STIPPLE);
-	glBegin(GL_LINES);
-	for (i = missiles_count; i--;)
+	line = v - missiles_vertices;
+	for (i = missiles_count; i--;) {
 		if (missiles_list[i].shot_type == MISSED_SHOT)
-			missiles_draw_single(&missiles_list[i], miss_color);
-	glEnd();
-	glDisable(GL_LINE_STIPPLE);
+			v = missiles_add_line(v, &missiles_list[i], miss_color);
+	}
+	end = v - missiles_vertices;
+
+	glPushAttrib(GL_ALL_ATTRIB_BITS);
+	glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+	glEnable(GL_BLEND);
+	glEnable(GL_COLOR_MATERIAL);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_TEXTURE_2D);
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glVertexPointer(3, GL_FLOAT, sizeof(missile_vertex), missiles_vertices[0].position);
+	glColorPointer(4, GL_FLOAT, sizeof(missile_vertex), missiles_vertices[0].color);
+
+	if (critical_border > 0) {
+		glLineWidth(7.0);
+		glDrawArrays(GL_LINES, 0, critical_border);
+	}
+	if (border > critical_border) {
+		glLineWidth(3.0);
+		glDrawArrays(GL_LINES, critical_border, border - critical_border);
+	}
+	if (line > border) {
+		glLineWidth(1.0);
+		glDrawArrays(GL_LINES, border, line - border);
+	}
+	if (end > line) {
+		glLineWidth(2.0);
+		glLineStipple(1, 0x003F);
+		glEnable(GL_LINE_STIPPLE);
+		glDrawArrays(GL_LINES, line, end - line);
+		glDisable(GL_LINE_STIPPLE);
+	}
 
+	glPopClientAttrib();
 	glPopAttrib();
+
+#ifdef MISSILES_DEBUG
+	if (stress_missiles > 0)
+		stress_draw_time += missiles_get_usec() - start;
+#endif // MISSILES_DEBUG
 }
 
 float missiles_compute_actor_rotation(float *out_h_rot, float *out_v_rot,
@@ -491,8 +631,10 @@ void missiles_rotate_actor_bones(actor *a)
 {
 	struct CalSkeleton *skel;
 	struct CalBone *bone;
-	struct CalQuaternion *bone_rot, *bone_rot_abs, *hrot_quat, *vrot_quat;
-	struct CalVector *vect;
+	struct CalQuaternion *bone_rot, *bone_rot_abs;
+	// called every frame for every aiming actor, keep the temporaries
+	static struct CalQuaternion *hrot_quat = NULL, *vrot_quat = NULL;
+	static struct CalVector *vect = NULL;
 	skeleton_types *skt = &skeletons_defs[actors_defs[a->actor_type].skeleton_type];
 	float *tmp_vect;
 	float hrot, vrot, tmp;
@@ -532,10 +674,11 @@ void missiles_rotate_actor_bones(actor *a)
 		}
 	}
 
-	vect = CalVector_New();
-
-	hrot_quat = CalQuaternion_New();
-	vrot_quat = CalQuaternion_New();
+	if (vect == NULL) {
+		vect = CalVector_New();
+		hrot_quat = CalQuaternion_New();
+		vrot_quat = CalQuaternion_New();
+	}
 
 	// get the rotation of the parent bone
 	bone = CalSkeleton_GetBone(skel, 0);
@@ -605,10 +748,6 @@ void missiles_rotate_actor_bones(actor *a)
 	CalQuaternion_Multiply(bone_rot, vrot_quat);
 	CalBone_CalculateState(bone);
 
-	CalVector_Delete(vect);
-	CalQuaternion_Delete(hrot_quat);
-	CalQuaternion_Delete(vrot_quat);
-
     a->cal_last_rotation_time = cur_time;
 }
 
@@ -957,12 +1096,22 @@ int missiles_read_defs(const char *file_name)
 	return ok;
 }
 
+// change when missile_type changes
+#define MISSILES_CACHE_VERSION	1
+
 void missiles_init_defs()
 {
+	const char *file_name = "actor_defs/missile_defs.xml";
+	xml_cache_section section = { missiles_defs, sizeof(missile_type), MAX_MISSILES_DEFS, MAX_MISSILES_DEFS };
+
 	// initialize the whole thing to zero
 	memset(missiles_defs, 0, sizeof(missiles_defs));
 
-	missiles_read_defs("actor_defs/missile_defs.xml");
+	if (xml_cache_load("missile_defs", MISSILES_CACHE_VERSION, file_name, &section, 1))
+		return;
+
+	if (missiles_read_defs(file_name))
+		xml_cache_save("missile_defs", MISSILES_CACHE_VERSION, file_name, &section, 1);
 }
 
 /**********************************************/
@@ -103,6 +103,19 @@ void missiles_update();
  */
 void missiles_draw();
 
+#ifdef MISSILES_DEBUG
+/*!
+ * \brief Fires many arrows at our actor at once
+ *
+ * The average time spent per frame updating and drawing the missiles is
+ * written to the missiles log once they are all gone.
+ *
+ * \param count the number of arrows
+ * \return the number of arrows that were added
+ */
+int missiles_stress_test(int count);
+#endif // MISSILES_DEBUG
+
 /*!
  * \brief Adds a new arrow (calls add_missile)
  * \param a the actor throwing the arrow
@@ -231,9 +231,15 @@ void move_to (short int x, short int y, int try_pathfinder)
 		actor *me = get_our_actor();
 		/* check distance */
 		if (me && (abs(me->x_tile_pos-x)+abs(me->y_tile_pos-y)) > 2)
-			/* if path finder fails, try standard move */
-			if (pf_find_path(x,y))
+		{
+			int target[1][2];
+
+			target[0][0] = x;
+			target[0][1] = y;
+			/* if path finder fails, it does a standard move */
+			if (pf_start_search(target, 1, 1))
 				return;
+		}
 	}
 
 	str[0]= MOVE_TO;
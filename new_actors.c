@@ -705,6 +705,7 @@ void add_enhanced_actor_from_server (const char *in_data, int len)
 		LOG_ERROR(str);
 		return;		// We cannot load an actor without a def (seg fault) so bail here.
 	}
+	load_actor_def(actor_type);
 
 	frame=*(in_data+22);
 	max_health=SDL_SwapLE16(*((short *)(in_data+23)));
@@ -1283,6 +1284,8 @@ actor * add_actor_interface(float x, float y, float z_rot, float scale, int acto
 	enhanced_actor * this_actor=calloc(1,sizeof(enhanced_actor));
 	actor * a;
 
+	load_actor_def(actor_type);
+
 	//get the torso
 	my_strncp(this_actor->arms_tex,actors_defs[actor_type].shirt[shirt].arms_name,sizeof(this_actor->arms_tex));
 	my_strncp(this_actor->arms_mask,actors_defs[actor_type].shirt[shirt].arms_mask,sizeof(this_actor->arms_mask));
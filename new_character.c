@@ -188,6 +188,8 @@ void change_actor (void)
 {
 	// We only need to reload the core model, and attach all the correct mesh types.
 	if (our_actor.our_model){
+		load_actor_def(our_actor.race);
+
 		if(our_actor.our_model->calmodel!=NULL)
 			model_delete(our_actor.our_model->calmodel);
 		
@@ -1,22 +1,87 @@
 #include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+#include <SDL_thread.h>
 #include "pathfinder.h"
 #include "actors.h"
+#include "errors.h"
 #include "events.h"
 #include "gl_init.h"
 #include "hud.h"
 #include "interface.h"
 #include "multiplayer.h"
+#include "threads.h"
 #include "tiles.h"
 
+/*
+ * The search runs in a worker thread on a copy of the tile heights taken
+ * when the search is started, using its own tile map, so the map can
+ * change and the main thread can go on while it runs. The result is
+ * handed back as a list of tiles, which pf_move picks up when the
+ * movement timer (or the worker itself) sends EVENT_MOVEMENT_TIMER.
+ */
+
+/* How many tiles are expanded between checks whether the search was
+ * cancelled, and before a search that is taking long reports the best
+ * partial path so far. */
+#define PF_CHECK_INTERVAL	1024
+#define PF_PARTIAL_ATTEMPTS	8192
+
+typedef struct
+{
+	Sint16 x;
+	Sint16 y;
+} PF_POINT;
+
+typedef struct
+{
+	Uint32 id;		/* 0 if there is no query */
+	Uint8 *heights;		/* copy of the tile heights, freed by whoever runs the query */
+	int size_x;
+	int size_y;
+	int src_x;
+	int src_y;
+	int targets[PF_MAX_TARGETS][2];
+	int num_targets;
+} PF_QUERY;
+
 PF_TILE *pf_tile_map = NULL;
 PF_TILE *pf_dst_tile;
 int pf_follow_path = 0;
 
-static PF_OPEN_LIST pf_open;
-static PF_TILE *pf_src_tile, *pf_cur_tile;
 static int pf_visited_squares[20];
 static SDL_TimerID pf_movement_timer = NULL;
 
+/* the path being followed, main thread only */
+static PF_POINT *pf_path = NULL;	/* from the end of the path back to the start */
+static int pf_path_len = 0;
+static int pf_path_size = 0;
+static int pf_path_state = PF_QUERY_NONE;
+static Uint32 pf_path_query = 0;
+static Uint32 pf_last_query = 0;
+static int pf_move_on_failure = 0;
+static int pf_targets[PF_MAX_TARGETS][2];
+
+/* shared with the worker, protected by pf_mutex */
+static SDL_mutex *pf_mutex = NULL;
+static SDL_cond *pf_wake = NULL;
+static SDL_Thread *pf_thread = NULL;
+static int pf_running = 0;
+static PF_QUERY pf_pending;		/* waiting for the worker */
+static Uint32 pf_wanted_query = 0;	/* older queries are abandoned */
+static PF_POINT *pf_result = NULL;
+static int pf_result_len = 0;
+static int pf_result_size = 0;
+static int pf_result_state = PF_QUERY_NONE;
+static Uint32 pf_result_query = 0;
+static int pf_result_target = -1;
+
+/* the search itself, only used by whoever runs the query */
+static PF_TILE *pf_search_map = NULL;
+static int pf_search_size_x = 0, pf_search_size_y = 0;
+static PF_OPEN_LIST pf_open;
+static PF_TILE *pf_src_tile, *pf_goal_tile;
+
 #define PF_DIFF(a, b) ((a > b) ? a - b : b - a)
 #define PF_HEUR(a, b) pf_heuristic(a->x-b->x, a->y-b->y);
 #define PF_SWAP(i, j) {\
@@ -51,9 +116,19 @@ static __inline__ PF_TILE *pf_get_tile(int x, int y)
 	}
 	return &pf_tile_map[y*tile_map_size_x*6+x];
 }
+
+static __inline__ PF_TILE *pf_get_search_tile(int x, int y)
+{
+	if (x >= pf_search_size_x || y >= pf_search_size_y || x < 0 || y < 0) {
+		return NULL;
+	}
+	return &pf_search_map[y*pf_search_size_x+x];
+}
 #else
 #define pf_get_tile(x, y) \
 	(((x) >= tile_map_size_x*6 || (y) >= tile_map_size_y*6 || ((Sint32)(x)) < 0 || ((Sint32)(y)) < 0) ? NULL : &pf_tile_map[(y)*tile_map_size_x*6+(x)])
+#define pf_get_search_tile(x, y) \
+	(((x) >= pf_search_size_x || (y) >= pf_search_size_y || ((Sint32)(x)) < 0 || ((Sint32)(y)) < 0) ? NULL : &pf_search_map[(y)*pf_search_size_x+(x)])
 #endif
 
 static PF_TILE *pf_get_next_open_tile()
@@ -105,7 +180,7 @@ static void pf_add_tile_to_open_list(PF_TILE *current, PF_TILE *neighbour)
 #else	//FUZZY_PATHS
 		g = current->g + (diagonal ? 14 : 10);
 #endif	//FUZZY_PATHS
-		h = PF_HEUR(neighbour, pf_dst_tile);
+		h = PF_HEUR(neighbour, pf_goal_tile);
 		f = g + h;
 
 		if (neighbour->state == PF_STATE_OPEN && f >= neighbour->f)
@@ -117,7 +192,7 @@ static void pf_add_tile_to_open_list(PF_TILE *current, PF_TILE *neighbour)
 	}
 	else
 	{
-		neighbour->f = PF_HEUR(pf_src_tile, pf_dst_tile);
+		neighbour->f = PF_HEUR(pf_src_tile, pf_goal_tile);
 		neighbour->g = 0;
 		neighbour->parent = NULL;
 	}
@@ -157,60 +232,361 @@ static Uint32 pf_movement_timer_callback(Uint32 interval, void* UNUSED(param))
 		return interval;
 }
 
-int pf_find_path(int x, int y)
+/* Copies the tile heights of a query into the search map. */
+static int pf_prepare_search_map(const PF_QUERY *query)
 {
-	actor *me;
-	int i;
-	int attempts= 0;
+	int x, y, i;
 
-	pf_destroy_path();
+	if (query->size_x != pf_search_size_x || query->size_y != pf_search_size_y)
+	{
+		free(pf_search_map);
+		free(pf_open.tiles);
+		pf_search_map = calloc(query->size_x * query->size_y, sizeof(PF_TILE));
+		pf_open.tiles = calloc(query->size_x * query->size_y, sizeof(PF_TILE*));
+		if (!pf_search_map || !pf_open.tiles)
+		{
+			free(pf_search_map);
+			free(pf_open.tiles);
+			pf_search_map = NULL;
+			pf_open.tiles = NULL;
+			pf_search_size_x = pf_search_size_y = 0;
+			return 0;
+		}
+		pf_search_size_x = query->size_x;
+		pf_search_size_y = query->size_y;
 
-	me = get_our_actor();
-	if (!me)
-		return -1;
+		for (y = i = 0; y < pf_search_size_y; y++)
+		{
+			for (x = 0; x < pf_search_size_x; x++, i++)
+			{
+				pf_search_map[i].x = x;
+				pf_search_map[i].y = y;
+			}
+		}
+	}
 
-	pf_src_tile = pf_get_tile(me->x_tile_pos, me->y_tile_pos);
-	pf_dst_tile = pf_get_tile(x, y);
+	for (i = 0; i < pf_search_size_x * pf_search_size_y; i++)
+		pf_search_map[i].z = query->heights[i];
 
-	if (!pf_dst_tile || pf_dst_tile->z == 0)
-		return 0;
+	return 1;
+}
+
+static int pf_is_query_wanted(Uint32 id)
+{
+	int wanted;
+
+	CHECK_AND_LOCK_MUTEX(pf_mutex);
+	wanted = pf_wanted_query == id;
+	CHECK_AND_UNLOCK_MUTEX(pf_mutex);
+
+	return wanted;
+}
 
-	for (i = 0; i < tile_map_size_x*tile_map_size_y*6*6; i++)
+/* Hands a (partial) path ending at tile, or a failure when tile is NULL,
+ * to the main thread. */
+static void pf_publish_result(Uint32 id, PF_TILE *tile, int state, int target)
+{
+	PF_TILE *t;
+	SDL_Event e;
+	int len;
+
+	CHECK_AND_LOCK_MUTEX(pf_mutex);
+	if (pf_wanted_query != id)
+	{
+		CHECK_AND_UNLOCK_MUTEX(pf_mutex);
+		return;
+	}
+
+	for (len = 0, t = tile; t; t = t->parent)
+		len++;
+	if (len > pf_result_size)
 	{
-		pf_tile_map[i].state = PF_STATE_NONE;
-		pf_tile_map[i].parent = NULL;
+		pf_result_size = len;
+		pf_result = realloc(pf_result, pf_result_size * sizeof(PF_POINT));
 	}
+	for (len = 0, t = tile; t; t = t->parent, len++)
+	{
+		pf_result[len].x = t->x;
+		pf_result[len].y = t->y;
+	}
+	pf_result_len = len;
+	pf_result_state = state;
+	pf_result_query = id;
+	pf_result_target = target;
+	CHECK_AND_UNLOCK_MUTEX(pf_mutex);
 
-	pf_open.tiles = calloc(tile_map_size_x*tile_map_size_y*6*6, sizeof(PF_TILE*));
+	// let pf_move pick it up right away
+	e.type = SDL_USEREVENT;
+	e.user.code = EVENT_MOVEMENT_TIMER;
+	SDL_PushEvent(&e);
+}
+
+static int pf_search(const PF_QUERY *query, int target)
+{
+	PF_TILE *cur, *best, *reported = NULL;
+	int i, attempts = 0;
+
+	pf_src_tile = pf_get_search_tile(query->src_x, query->src_y);
+	pf_goal_tile = pf_get_search_tile(query->targets[target][0], query->targets[target][1]);
+
+	if (!pf_src_tile || !pf_goal_tile || pf_goal_tile->z == 0)
+		return PF_QUERY_FAILED;
+
+	for (i = 0; i < pf_search_size_x * pf_search_size_y; i++)
+	{
+		pf_search_map[i].state = PF_STATE_NONE;
+		pf_search_map[i].parent = NULL;
+	}
 	pf_open.count = 0;
 
 	pf_add_tile_to_open_list(NULL, pf_src_tile);
+	best = pf_src_tile;
 
-	while ((pf_cur_tile = pf_get_next_open_tile()) && attempts++ < MAX_PATHFINDER_ATTEMPTS)
+	while ((cur = pf_get_next_open_tile()) && attempts++ < MAX_PATHFINDER_ATTEMPTS)
 	{
-		if (pf_cur_tile == pf_dst_tile)
+		if (cur == pf_goal_tile)
 		{
-			pf_follow_path = 1;
+			pf_publish_result(query->id, cur, PF_QUERY_FOUND, target);
+			return PF_QUERY_FOUND;
+		}
 
-			pf_movement_timer_callback(0, NULL);
-			pf_movement_timer = SDL_AddTimer(me->step_duration * 10,
-				pf_movement_timer_callback, NULL);
-			break;
+		// f - g is the estimated distance left
+		if (cur->f - cur->g < best->f - best->g)
+			best = cur;
+
+		if (attempts % PF_CHECK_INTERVAL == 0)
+		{
+			if (!pf_is_query_wanted(query->id))
+				return PF_QUERY_CANCELLED;
+			// let the actor start walking towards the target
+			if (attempts >= PF_PARTIAL_ATTEMPTS && best != reported && best != pf_src_tile)
+			{
+				pf_publish_result(query->id, best, PF_QUERY_SEARCHING, target);
+				reported = best;
+			}
+		}
+
+		pf_add_tile_to_open_list(cur, pf_get_search_tile(cur->x,   cur->y+1));
+		pf_add_tile_to_open_list(cur, pf_get_search_tile(cur->x+1, cur->y+1));
+		pf_add_tile_to_open_list(cur, pf_get_search_tile(cur->x+1, cur->y));
+		pf_add_tile_to_open_list(cur, pf_get_search_tile(cur->x+1, cur->y-1));
+		pf_add_tile_to_open_list(cur, pf_get_search_tile(cur->x,   cur->y-1));
+		pf_add_tile_to_open_list(cur, pf_get_search_tile(cur->x-1, cur->y-1));
+		pf_add_tile_to_open_list(cur, pf_get_search_tile(cur->x-1, cur->y));
+		pf_add_tile_to_open_list(cur, pf_get_search_tile(cur->x-1, cur->y+1));
+	}
+
+	return PF_QUERY_FAILED;
+}
+
+/* Tries the targets in order until one can be reached. */
+static void pf_run_query(PF_QUERY *query)
+{
+	int i, state = PF_QUERY_FAILED;
+
+	if (pf_prepare_search_map(query))
+	{
+		for (i = 0; i < query->num_targets && state == PF_QUERY_FAILED; i++)
+			state = pf_search(query, i);
+	}
+	if (state == PF_QUERY_FAILED)
+		pf_publish_result(query->id, NULL, PF_QUERY_FAILED, -1);
+
+	free(query->heights);
+	query->heights = NULL;
+}
+
+static int pf_worker(void *UNUSED(data))
+{
+	PF_QUERY query;
+
+	CHECK_AND_LOCK_MUTEX(pf_mutex);
+	while (pf_running)
+	{
+		if (pf_pending.id == 0)
+		{
+			SDL_CondWait(pf_wake, pf_mutex);
+			continue;
 		}
+		query = pf_pending;
+		pf_pending.id = 0;
+		pf_pending.heights = NULL;
+		CHECK_AND_UNLOCK_MUTEX(pf_mutex);
+
+		pf_run_query(&query);
+
+		CHECK_AND_LOCK_MUTEX(pf_mutex);
+	}
+	CHECK_AND_UNLOCK_MUTEX(pf_mutex);
+
+	return 0;
+}
+
+static int pf_start_worker(void)
+{
+	if (pf_mutex == NULL)
+	{
+		pf_mutex = SDL_CreateMutex();
+		pf_wake = SDL_CreateCond();
+	}
+	if (pf_thread != NULL)
+		return 1;
 
-		pf_add_tile_to_open_list(pf_cur_tile, pf_get_tile(pf_cur_tile->x,   pf_cur_tile->y+1));
-		pf_add_tile_to_open_list(pf_cur_tile, pf_get_tile(pf_cur_tile->x+1, pf_cur_tile->y+1));
-		pf_add_tile_to_open_list(pf_cur_tile, pf_get_tile(pf_cur_tile->x+1, pf_cur_tile->y));
-		pf_add_tile_to_open_list(pf_cur_tile, pf_get_tile(pf_cur_tile->x+1, pf_cur_tile->y-1));
-		pf_add_tile_to_open_list(pf_cur_tile, pf_get_tile(pf_cur_tile->x,   pf_cur_tile->y-1));
-		pf_add_tile_to_open_list(pf_cur_tile, pf_get_tile(pf_cur_tile->x-1, pf_cur_tile->y-1));
-		pf_add_tile_to_open_list(pf_cur_tile, pf_get_tile(pf_cur_tile->x-1, pf_cur_tile->y));
-		pf_add_tile_to_open_list(pf_cur_tile, pf_get_tile(pf_cur_tile->x-1, pf_cur_tile->y+1));
+	pf_running = 1;
+	pf_thread = SDL_CreateThread(pf_worker, NULL);
+	if (pf_thread == NULL)
+	{
+		// still find paths, just on the main thread
+		LOG_ERROR("Unable to start the pathfinder thread: %s", SDL_GetError());
+		pf_running = 0;
+		return 0;
+	}
+	return 1;
+}
+
+void pf_shutdown(void)
+{
+	pf_destroy_path();
+
+	if (pf_thread != NULL)
+	{
+		CHECK_AND_LOCK_MUTEX(pf_mutex);
+		pf_running = 0;
+		SDL_CondSignal(pf_wake);
+		CHECK_AND_UNLOCK_MUTEX(pf_mutex);
+		SDL_WaitThread(pf_thread, NULL);
+		pf_thread = NULL;
+	}
+	if (pf_mutex != NULL)
+	{
+		SDL_DestroyCond(pf_wake);
+		SDL_DestroyMutex(pf_mutex);
+		pf_wake = NULL;
+		pf_mutex = NULL;
 	}
 
+	free(pf_pending.heights);
+	free(pf_search_map);
 	free(pf_open.tiles);
+	free(pf_result);
+	free(pf_path);
+	memset(&pf_pending, 0, sizeof(pf_pending));
+	pf_search_map = NULL;
+	pf_open.tiles = NULL;
+	pf_result = NULL;
+	pf_path = NULL;
+	pf_search_size_x = pf_search_size_y = 0;
+	pf_result_size = pf_result_len = 0;
+	pf_path_size = pf_path_len = 0;
+}
 
-	return pf_follow_path;
+Uint32 pf_start_search(const int targets[][2], int count, int move_on_failure)
+{
+	PF_QUERY query;
+	actor *me;
+	int i;
+
+	pf_destroy_path();
+
+	me = get_our_actor();
+	if (!me || !pf_tile_map)
+		return 0;
+
+	memset(&query, 0, sizeof(query));
+	for (i = 0; i < count && query.num_targets < PF_MAX_TARGETS; i++)
+	{
+		PF_TILE *tile = pf_get_tile(targets[i][0], targets[i][1]);
+
+		if (tile && tile->z != 0)
+		{
+			query.targets[query.num_targets][0] = targets[i][0];
+			query.targets[query.num_targets][1] = targets[i][1];
+			query.num_targets++;
+		}
+	}
+	if (query.num_targets == 0)
+		return 0;
+
+	query.size_x = tile_map_size_x * 6;
+	query.size_y = tile_map_size_y * 6;
+	query.heights = malloc(query.size_x * query.size_y);
+	if (!query.heights)
+		return 0;
+	for (i = 0; i < query.size_x * query.size_y; i++)
+		query.heights[i] = pf_tile_map[i].z;
+	query.src_x = me->x_tile_pos;
+	query.src_y = me->y_tile_pos;
+
+	if (++pf_last_query == 0)
+		pf_last_query = 1;
+	query.id = pf_last_query;
+
+	pf_path_query = query.id;
+	pf_path_state = PF_QUERY_SEARCHING;
+	pf_path_len = 0;
+	pf_move_on_failure = move_on_failure;
+	memcpy(pf_targets, query.targets, sizeof(pf_targets));
+	pf_dst_tile = pf_get_tile(query.targets[0][0], query.targets[0][1]);
+	pf_follow_path = 1;
+
+	if (pf_start_worker())
+	{
+		CHECK_AND_LOCK_MUTEX(pf_mutex);
+		// a query the worker didn't get to yet is simply replaced
+		free(pf_pending.heights);
+		pf_pending = query;
+		pf_wanted_query = query.id;
+		SDL_CondSignal(pf_wake);
+		CHECK_AND_UNLOCK_MUTEX(pf_mutex);
+	}
+	else
+	{
+		CHECK_AND_LOCK_MUTEX(pf_mutex);
+		pf_wanted_query = query.id;
+		CHECK_AND_UNLOCK_MUTEX(pf_mutex);
+		pf_run_query(&query);
+	}
+
+	pf_movement_timer = SDL_AddTimer(me->step_duration * 10,
+		pf_movement_timer_callback, NULL);
+
+	return query.id;
+}
+
+int pf_poll_search(Uint32 handle)
+{
+	if (handle == 0 || handle != pf_path_query)
+		return PF_QUERY_NONE;
+
+	CHECK_AND_LOCK_MUTEX(pf_mutex);
+	if (pf_result_query == handle && pf_result_state != PF_QUERY_NONE)
+	{
+		if (pf_result_len > pf_path_size)
+		{
+			pf_path_size = pf_result_len;
+			pf_path = realloc(pf_path, pf_path_size * sizeof(PF_POINT));
+		}
+		memcpy(pf_path, pf_result, pf_result_len * sizeof(PF_POINT));
+		pf_path_len = pf_result_len;
+		pf_path_state = pf_result_state;
+		// a later target may have been reached instead of the first one
+		if (pf_result_target >= 0)
+			pf_dst_tile = pf_get_tile(pf_targets[pf_result_target][0], pf_targets[pf_result_target][1]);
+		pf_result_state = PF_QUERY_NONE;
+	}
+	CHECK_AND_UNLOCK_MUTEX(pf_mutex);
+
+	return pf_path_state;
+}
+
+int pf_find_path(int x, int y)
+{
+	int target[1][2];
+
+	target[0][0] = x;
+	target[0][1] = y;
+
+	return pf_start_search(target, 1, 0) != 0;
 }
 
 void pf_destroy_path()
@@ -222,6 +598,19 @@ void pf_destroy_path()
 		SDL_RemoveTimer(pf_movement_timer);
 		pf_movement_timer = NULL;
 	}
+	if (pf_path_query != 0 && pf_mutex != NULL)
+	{
+		// stops the worker at its next check
+		CHECK_AND_LOCK_MUTEX(pf_mutex);
+		pf_wanted_query = 0;
+		free(pf_pending.heights);
+		pf_pending.heights = NULL;
+		pf_pending.id = 0;
+		CHECK_AND_UNLOCK_MUTEX(pf_mutex);
+	}
+	pf_path_query = 0;
+	pf_path_state = PF_QUERY_NONE;
+	pf_path_len = 0;
 	pf_follow_path = 0;
 	for (i = 0; i < 20; i++)
 		pf_visited_squares[i]=-1;
@@ -291,66 +680,84 @@ static int pf_is_tile_occupied(int x, int y)
 	return 0;
 }
 
+static void pf_send_move_to(int x, int y)
+{
+	Uint8 str[5];
+
+	str[0] = MOVE_TO;
+	*((short *)(str+1)) = SDL_SwapLE16((short)x);
+	*((short *)(str+3)) = SDL_SwapLE16((short)y);
+	my_tcp_send(my_socket, str, 5);
+}
+
 void pf_move()
 {
-	int x, y;
+	int x, y, state;
+	int i, in_reach = 0;
 	actor *me;
 
 	if (!pf_follow_path || !(me = get_our_actor())) {
 		return;
 	}
 
+	state = pf_poll_search(pf_path_query);
+	if (state == PF_QUERY_FAILED) {
+		if (pf_move_on_failure) {
+			pf_send_move_to(pf_targets[0][0], pf_targets[0][1]);
+		}
+		pf_destroy_path();
+		return;
+	}
+
 	x = me->x_tile_pos;
 	y = me->y_tile_pos;
 
 	if (PF_DIFF(x, pf_dst_tile->x) < 2 && PF_DIFF(y, pf_dst_tile->y) < 2) {
 		pf_destroy_path();
-	} else {
-		PF_TILE *t = pf_get_tile(x, y);
-		int i = 0, j = 0;
+		return;
+	}
 
-		for (pf_cur_tile = pf_dst_tile; pf_cur_tile; pf_cur_tile = pf_cur_tile->parent) {
-			if (pf_cur_tile == t) {
-				break;
-			}
-			i++;
+	// nothing to walk along yet
+	if (pf_path_len == 0) {
+		return;
+	}
+
+	for (i = 0; i < pf_path_len; i++) {
+		if (pf_path[i].x == x && pf_path[i].y == y) {
+			break;
 		}
+	}
 
-		if (pf_cur_tile == t) {
+	if (i < pf_path_len) {
 #ifdef	FUZZY_PATHS
-			int	limit= i-(10+rand()%3);
+		int	limit= i-(10+rand()%3);
 #else	//FUZZY_PATHS
-			int	limit= i-12;
+		int	limit= i-12;
 #endif	//FUZZY_PATHS
-			for (pf_cur_tile = pf_dst_tile; pf_cur_tile; pf_cur_tile = pf_cur_tile->parent) {
-				if (j++ == limit) {
-					break;
-				}
-			}
-			if (pf_cur_tile) {
-				Uint8 str[5];
-
-				str[0] = MOVE_TO;
-				*((short *)(str+1)) = SDL_SwapLE16((short)pf_cur_tile->x);
-				*((short *)(str+3)) = SDL_SwapLE16((short)pf_cur_tile->y);
-				my_tcp_send(my_socket, str, 5);
+		if (limit >= 0) {
+			pf_send_move_to(pf_path[limit].x, pf_path[limit].y);
+			return;
+		}
+	}
 
+	for (i = 0; i < pf_path_len; i++) {
+		if (PF_DIFF(x, pf_path[i].x) <= 12 && PF_DIFF(y, pf_path[i].y) <= 12) {
+			in_reach = 1;
+			if (!pf_is_tile_occupied(pf_path[i].x, pf_path[i].y)) {
+				pf_send_move_to(pf_path[i].x, pf_path[i].y);
 				return;
 			}
 		}
+	}
 
-		for (pf_cur_tile = pf_dst_tile; pf_cur_tile; pf_cur_tile = pf_cur_tile->parent) {
-			if (PF_DIFF(x, pf_cur_tile->x) <= 12 && PF_DIFF(y, pf_cur_tile->y) <= 12
-			&& !pf_is_tile_occupied(pf_cur_tile->x, pf_cur_tile->y)) {
-				Uint8 str[5];
+	// we followed a partial path that the full one doesn't share, look
+	// again from here
+	if (!in_reach && state == PF_QUERY_FOUND) {
+		int target[1][2];
 
-				str[0] = MOVE_TO;
-				*((short *)(str+1)) = SDL_SwapLE16((short)pf_cur_tile->x);
-				*((short *)(str+3)) = SDL_SwapLE16((short)pf_cur_tile->y);
-				my_tcp_send(my_socket, str, 5);
-				break;
-			}
-		}
+		target[0][0] = pf_dst_tile->x;
+		target[0][1] = pf_dst_tile->y;
+		pf_start_search(target, 1, 0);
 	}
 }
 
@@ -385,28 +792,32 @@ int pf_get_mouse_position_extended(int mouse_x, int mouse_y, int * px, int * py,
 void pf_move_to_mouse_position()
 {
 	int x, y, clicked_x, clicked_y;
-	int tries;
+	int targets[PF_MAX_TARGETS][2];
+	int count;
+	PF_TILE *tile;
 
 	if (!pf_get_mouse_position(mouse_x, mouse_y, &clicked_x, &clicked_y)) return;
-	x = clicked_x; y = clicked_y;
 
-	if (pf_find_path(x, y))
-		return;
-
-	for (x= clicked_x-3, tries= 0; x <= clicked_x+3 && tries < 4 ; x++)
+	// the clicked tile first, then a few walkable ones around it
+	targets[0][0] = clicked_x;
+	targets[0][1] = clicked_y;
+	count = 1;
+	for (x= clicked_x-3; x <= clicked_x+3 && count < PF_MAX_TARGETS; x++)
 	{
-		for (y= clicked_y-3; y <= clicked_y+3 && tries < 4; y++)
+		for (y= clicked_y-3; y <= clicked_y+3 && count < PF_MAX_TARGETS; y++)
 		{
 			if (x == clicked_x && y == clicked_y)
 				continue;
 
-			pf_dst_tile = pf_get_tile(x, y);
-			if (pf_dst_tile && pf_dst_tile->z > 0)
+			tile = pf_get_tile(x, y);
+			if (tile && tile->z > 0)
 			{
-				if (pf_find_path(x, y))
-					return;
-				tries++;
+				targets[count][0] = x;
+				targets[count][1] = y;
+				count++;
 			}
 		}
 	}
+
+	pf_start_search(targets, count, 0);
 }
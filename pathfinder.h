@@ -32,6 +32,22 @@ enum {
 };
 /*! @} */
 
+/*!
+ * \name Path search states
+ * @{
+ *      The states of a search started with \ref pf_start_search.
+ */
+enum {
+	PF_QUERY_NONE=0,	/*!< no such search */
+	PF_QUERY_SEARCHING,	/*!< still searching, there may be a partial path already */
+	PF_QUERY_FOUND,		/*!< the path is complete */
+	PF_QUERY_FAILED,	/*!< none of the targets can be reached */
+	PF_QUERY_CANCELLED	/*!< a newer search was started or the path was destroyed */
+};
+/*! @} */
+
+#define PF_MAX_TARGETS 5 /*!< the maximum number of targets for one search */
+
 /*!
  * a structure to store the data of tiles related to pathfinding
  */
@@ -62,15 +78,48 @@ extern PF_TILE *pf_tile_map; /*!< a list of \see PF_TILE structures that form th
 extern PF_TILE *pf_dst_tile; /*!< the \see PF_TILE struct that defines our destination tile of the path */
 extern int pf_follow_path; /*!< flag, that indicates whether we should follow the path or not */
 
+/*!
+ * \ingroup move_actors
+ * \brief Starts looking for a path to one of several positions
+ *
+ *      Starts a search from the current position in the pathfinder
+ *      thread, on a copy of the tile heights. The targets are tried in
+ *      order and the first one that can be reached is used. Any search
+ *      or path from before is cancelled. The result is picked up by
+ *      \ref pf_move, a search that takes long already returns the most
+ *      promising partial path so the actor can start walking.
+ *
+ * \param targets          the x and y coordinates of the targets
+ * \param count            the number of targets, at most \ref PF_MAX_TARGETS are used
+ * \param move_on_failure  if none of the targets can be reached, send a plain move to the first one
+ * \retval Uint32          the handle of the search, 0 if no search was started
+ * \callgraph
+ */
+Uint32 pf_start_search(const int targets[][2], int count, int move_on_failure);
+
+/*!
+ * \ingroup move_actors
+ * \brief Checks a search for new results
+ *
+ *      Takes over the latest (partial) path the pathfinder thread found
+ *      for the search.
+ *
+ * \param handle  the handle returned by \ref pf_start_search
+ * \retval int    one of the path search states, \ref PF_QUERY_NONE if the
+ *                search is not the current one any more
+ */
+int pf_poll_search(Uint32 handle);
+
 /*!
  * \ingroup move_actors
  * \brief Finds a path to the given position
  *
- *      Finds a path from the current position to the given target position (x,y).
+ *      Starts looking for a path from the current position to the given
+ *      target position (x,y), see \ref pf_start_search.
  *
  * \param x     x coordinate of the target position
  * \param y     y coordinate of the target position
- * \retval int
+ * \retval int  1 if the search was started, 0 if the position can't be walked on
  * \callgraph
  */
 int pf_find_path(int x, int y);
@@ -79,11 +128,18 @@ int pf_find_path(int x, int y);
  * \ingroup move_actors
  * \brief Clears the current path and frees up the memory used
  *
- *      Clears the current path and frees up the memory used
+ *      Clears the current path and frees up the memory used. A search that
+ *      is still running is cancelled.
  *
  */
 void pf_destroy_path();
 
+/*!
+ * \ingroup move_actors
+ * \brief Stops the pathfinder thread and frees its memory
+ */
+void pf_shutdown(void);
+
 /*!
  * \ingroup move_actors
  * \brief Moves the actor along the calculated path
@@ -1861,13 +1861,20 @@ int AMXAPI amx_PushString(AMX *amx, cell *amx_addr, cell **phys_addr, const char
 #define CHKSTACK()      if (stk>amx->stp) return AMX_ERR_STACKLOW
 #define CHKHEAP()       if (hea<amx->hlw) return AMX_ERR_HEAPLOW
 
+#if defined PAWN_BENCHMARK
+  unsigned long amx_opcode_count = 0;
+  #define COUNT_OPCODE()  (amx_opcode_count++)
+#else
+  #define COUNT_OPCODE()  ((void)0)
+#endif
+
 #if (defined __GNUC__ || defined __ICC) && !(defined ASM32 || defined JIT)
     /* GNU C version uses the "labels as values" extension to create
      * fast "indirect threaded" interpreter. The Intel C/C++ compiler
      * supports this too.
      */
 
-#define NEXT(cip)       goto **cip++
+#define NEXT(cip)       goto *(void *)(COUNT_OPCODE(), *cip++)
 
 int AMXAPI amx_Exec(AMX *amx, cell *retval, int index)
 {
@@ -3214,6 +3221,7 @@ int AMXAPI amx_Exec(AMX *amx, cell *retval, int index)
 
   for ( ;; ) {
     op=(OPCODE) _RCODE();
+    COUNT_OPCODE();
     switch (op) {
     case OP_LOAD_PRI:
       GETPARAM(offs);
@@ -425,6 +425,10 @@ int AMXAPI amx_Callback(AMX *amx, cell index, cell *result, const cell *params);
 int AMXAPI amx_Cleanup(AMX *amx);
 int AMXAPI amx_Clone(AMX *amxClone, AMX *amxSource, void *data);
 int AMXAPI amx_Exec(AMX *amx, cell *retval, int index);
+#if defined PAWN_BENCHMARK
+  /* number of opcodes executed by all machines, for the script benchmarks */
+  extern unsigned long amx_opcode_count;
+#endif
 int AMXAPI amx_FindNative(AMX *amx, const char *name, int *index);
 int AMXAPI amx_FindPublic(AMX *amx, const char *funcname, int *index);
 int AMXAPI amx_FindPubVar(AMX *amx, const char *varname, cell *amx_addr);
@@ -40,6 +40,9 @@ static cell AMX_NATIVE_CALL n_set_object_rotation (AMX *amx, const cell *params)
 	int id = (int) params[1];
 	object3d *obj;
 	
+	if (defer_pawn_native (n_set_object_rotation, params))
+		return 0;
+
 	if (id < 0 || id >= MAX_OBJ_3D || objects_list[id] == NULL)
 		// invalid object ID
 		return 1;
@@ -61,6 +64,9 @@ static cell AMX_NATIVE_CALL n_rotate_object (AMX *amx, const cell *params)
 	object3d *obj;
 	MATRIX4x4D matrix;
 
+	if (defer_pawn_native (n_rotate_object, params))
+		return 0;
+
 	if (id < 0 || id >= MAX_OBJ_3D || objects_list[id] == NULL)
 		// invalid object ID
 		return 1;
@@ -96,6 +102,9 @@ static cell AMX_NATIVE_CALL n_rotate_object_add (AMX *amx, const cell *params)
 	int id = (int) params[1];
 	object3d *obj;
 
+	if (defer_pawn_native (n_rotate_object_add, params))
+		return 0;
+
 	if (id < 0 || id >= MAX_OBJ_3D || objects_list[id] == NULL)
 		// invalid object ID
 		return 1;
@@ -128,6 +137,9 @@ static cell AMX_NATIVE_CALL n_set_object_position (AMX *amx, const cell *params)
 	int id = (int) params[1];
 	object3d *obj;
 	
+	if (defer_pawn_native (n_set_object_position, params))
+		return 0;
+
 	if (id < 0 || id >= MAX_OBJ_3D || objects_list[id] == NULL)
 		// invalid object ID
 		return 1;
@@ -148,6 +160,9 @@ static cell AMX_NATIVE_CALL n_translate_object (AMX *amx, const cell *params)
 	int id = (int) params[1];
 	object3d *obj;
 	
+	if (defer_pawn_native (n_translate_object, params))
+		return 0;
+
 	if (id < 0 || id >= MAX_OBJ_3D || objects_list[id] == NULL)
 		// invalid object ID
 		return 1;
@@ -165,6 +180,9 @@ static cell AMX_NATIVE_CALL n_translate_object (AMX *amx, const cell *params)
 
 static cell AMX_NATIVE_CALL n_add_sound_object (AMX *amx, const cell *params)
 {
+	if (defer_pawn_native (n_add_sound_object, params))
+		return 0;
+
 #ifdef NEW_SOUND
 	add_sound_object (params[1], params[2], params[3], 0);
 #else
@@ -196,17 +214,24 @@ static cell AMX_NATIVE_CALL n_clear_timers (AMX *amx, const cell *params)
 static cell AMX_NATIVE_CALL n_get_position (AMX *amx, const cell *params)
 {
 	cell *x_addr, *y_addr;
-	actor *me = get_our_actor ();
-	
+	actor *me;
+
+	// timer callbacks may run on the script thread
+	LOCK_ACTORS_LISTS ();
+	me = get_our_actor ();
 	if (!me)
+	{
 		// Uh oh, we don't exist!
+		UNLOCK_ACTORS_LISTS ();
 		return 1;
+	}
 	
 	amx_GetAddr (amx, params[1], &x_addr);
 	amx_GetAddr (amx, params[2], &y_addr);
 	
 	*x_addr = (cell) me->x_tile_pos;
 	*y_addr = (cell) me->y_tile_pos;
+	UNLOCK_ACTORS_LISTS ();
 	
 	return 0;
 }
@@ -246,6 +271,9 @@ static cell AMX_NATIVE_CALL n_add_local_actor_command (AMX *amx, const cell* par
 	int idx = params[1];
 	unsigned char cmd = params[2];
 
+	if (defer_pawn_native (n_add_local_actor_command, params))
+		return 0;
+
 	if (idx < 0 || idx >= max_actors || !actors_list[idx])
 		return -1;
 
@@ -310,7 +338,8 @@ static cell AMX_NATIVE_CALL n_log_to_console (AMX *amx, const cell *params)
 	int nr_params = params[0] / sizeof (cell) - 1;
 	const char* msg = format_log_message (amx, params[1], params+2, nr_params);
 
-	LOG_TO_CONSOLE (c_red1, msg);
+	if (!defer_pawn_console_message (msg))
+		LOG_TO_CONSOLE (c_red1, msg);
 
 	return 0;
 }
@@ -1,13 +1,18 @@
 #ifdef PAWN
 
 #include <SDL_timer.h>
+#include <SDL_thread.h>
 
 #include "elpawn.h"
 #include "amx.h"
 #include "amxaux.h"
 
+#include "../asc.h"
 #include "../errors.h"
 #include "../events.h"
+#include "../font.h"
+#include "../text.h"
+#include "../threads.h"
 
 // includes for our native functions
 #include "amxcons.h"
@@ -33,12 +38,36 @@ typedef struct _pawn_timer_queue
 	struct _pawn_timer_queue *next;
 } pawn_timer_queue;
 
+// Messages from the script thread to the main thread. Either a native
+// function to run with a copy of its parameters, or a console message.
+typedef struct _pawn_message
+{
+	AMX_NATIVE native;
+	cell *params;
+	char *text;
+	struct _pawn_message *next;
+} pawn_message;
+
 // the machines themselves
 static pawn_machine srv_amx = {0, 0, NULL};
 static pawn_machine map_amx = {0, 0, NULL};
 
 static pawn_timer_queue *map_timer_queue = NULL;
 
+int pawn_timer_thread = 0;
+
+// Guards the map machine and its timer queue. SDL mutexes are recursive,
+// so a timer callback can add timers or call other map functions.
+static SDL_mutex *map_amx_mutex = NULL;
+static SDL_cond *map_timer_cond = NULL;
+static SDL_Thread *map_timer_thread = NULL;
+static Uint32 map_timer_thread_id = 0;
+static int map_timer_thread_running = 0;
+
+static SDL_mutex *message_mutex = NULL;
+static pawn_message *message_head = NULL;
+static pawn_message *message_tail = NULL;
+
 static __inline__ int ticks_less (Uint32 ticks, Uint32 limit)
 {
 	// try to adjust for timer wrap around. We'll assume that no events are
@@ -120,14 +149,14 @@ int initialize_pawn_machine (pawn_machine *machine, const char* fname)
 	memsize = aux_ProgramSize (fname);
 	if (memsize == 0)
 	{
-		log_error ("Unable to determine memory size for Pawn file %s", fname);
+		LOG_ERROR ("Unable to determine memory size for Pawn file %s", fname);
 		return 0;
 	}
 
 	buffer = malloc (memsize);
 	if (buffer == NULL)
 	{
-		log_error ("unable to allocate memory for Pawn file %s", fname);
+		LOG_ERROR ("unable to allocate memory for Pawn file %s", fname);
 		return 0;
 	}
 
@@ -135,7 +164,7 @@ int initialize_pawn_machine (pawn_machine *machine, const char* fname)
 	if (err != AMX_ERR_NONE)
 	{
 		free (buffer);
-		log_error ("unable to load Pawn file %s", fname);
+		LOG_ERROR ("unable to load Pawn file %s", fname);
 		return 0;
 	}
 
@@ -149,7 +178,7 @@ int initialize_pawn_machine (pawn_machine *machine, const char* fname)
 	if (err != AMX_ERR_NONE)
 	{
 		free (buffer);
-		log_error ("Unable to initialize all native functions for Pawn file %s", fname);
+		LOG_ERROR ("Unable to initialize all native functions for Pawn file %s", fname);
 		return 0;
 	}
 
@@ -160,10 +189,97 @@ int initialize_pawn_machine (pawn_machine *machine, const char* fname)
 	return 1;
 }
 
+static __inline__ void lock_map_machine ()
+{
+	if (map_amx_mutex)
+		CHECK_AND_LOCK_MUTEX (map_amx_mutex);
+}
+
+static __inline__ void unlock_map_machine ()
+{
+	if (map_amx_mutex)
+		CHECK_AND_UNLOCK_MUTEX (map_amx_mutex);
+}
+
+static void run_map_timers (Uint32 now);
+
+static int map_timer_thread_func (void *data)
+{
+	init_thread_log ("pawn_timers");
+
+	lock_map_machine ();
+	map_timer_thread_id = SDL_ThreadID ();
+	while (map_timer_thread_running)
+	{
+		Uint32 now = SDL_GetTicks ();
+
+		run_map_timers (now);
+
+		// sleep until the next timer is due, or until the queue changes
+		if (!map_timer_queue)
+			SDL_CondWait (map_timer_cond, map_amx_mutex);
+		else if (ticks_less (now, map_timer_queue->ticks))
+			SDL_CondWaitTimeout (map_timer_cond, map_amx_mutex, map_timer_queue->ticks - now);
+	}
+	unlock_map_machine ();
+
+	return 0;
+}
+
+static void start_map_timer_thread ()
+{
+	if (map_timer_thread || !map_amx_mutex)
+		return;
+
+	map_timer_thread_running = 1;
+	map_timer_thread = SDL_CreateThread (map_timer_thread_func, NULL);
+	if (!map_timer_thread)
+	{
+		// fall back to running the timers on the main thread
+		LOG_ERROR ("Unable to start the Pawn timer thread: %s", SDL_GetError ());
+		map_timer_thread_running = 0;
+		pawn_timer_thread = 0;
+	}
+}
+
+static void stop_map_timer_thread ()
+{
+	if (!map_timer_thread)
+		return;
+
+	lock_map_machine ();
+	map_timer_thread_running = 0;
+	SDL_CondSignal (map_timer_cond);
+	unlock_map_machine ();
+	SDL_WaitThread (map_timer_thread, NULL);
+	map_timer_thread = NULL;
+	map_timer_thread_id = 0;
+}
+
+void set_pawn_timer_thread (int enable)
+{
+	pawn_timer_thread = enable;
+	// before initialize_pawn() only remember the setting
+	if (enable)
+		start_map_timer_thread ();
+	else
+		stop_map_timer_thread ();
+}
+
 int initialize_pawn ()
 {
-	int srv_ok = initialize_pawn_machine (&srv_amx, "pawn_scripts/pawn_test.amx");
-	int map_ok = initialize_pawn_machine (&map_amx, "pawn_scripts/pawn_test.amx");
+	int srv_ok, map_ok;
+
+	map_amx_mutex = SDL_CreateMutex ();
+	map_timer_cond = SDL_CreateCond ();
+	message_mutex = SDL_CreateMutex ();
+
+	srv_ok = initialize_pawn_machine (&srv_amx, "pawn_scripts/pawn_test.amx");
+	map_ok = initialize_pawn_machine (&map_amx, "pawn_scripts/pawn_test.amx");
+
+	if (map_ok && pawn_timer_thread)
+		start_map_timer_thread ();
+
 	return srv_ok && map_ok;
 } 
 
@@ -187,10 +303,44 @@ void cleanup_pawn_machine (pawn_machine *machine)
 	}
 }
 
+static void free_messages (pawn_message *msg)
+{
+	while (msg)
+	{
+		pawn_message *next = msg->next;
+		free (msg->params);
+		free (msg->text);
+		free (msg);
+		msg = next;
+	}
+}
+
 void cleanup_pawn ()
 {
+	stop_map_timer_thread ();
+	clear_map_timers ();
+
 	cleanup_pawn_machine (&srv_amx);
 	cleanup_pawn_machine (&map_amx);
+
+	free_messages (message_head);
+	message_head = message_tail = NULL;
+
+	if (map_amx_mutex)
+	{
+		SDL_DestroyMutex (map_amx_mutex);
+		map_amx_mutex = NULL;
+	}
+	if (map_timer_cond)
+	{
+		SDL_DestroyCond (map_timer_cond);
+		map_timer_cond = NULL;
+	}
+	if (message_mutex)
+	{
+		SDL_DestroyMutex (message_mutex);
+		message_mutex = NULL;
+	}
 }
 
 int run_pawn_function (pawn_machine *machine, const char* fun, const char* fmt, va_list ap)
@@ -202,20 +352,19 @@ int run_pawn_function (pawn_machine *machine, const char* fun, const char* fmt,
 
 	if (!machine->initialized)
 	{
-		log_error ("Unable to execute Pawn function: machine not initialized");
+		LOG_ERROR ("Unable to execute Pawn function: machine not initialized");
 		return 0;
 	}
 
 	err = amx_FindPublic (&(machine->amx), fun, &index);
 	if (err != AMX_ERR_NONE)
 	{
-		log_error ("Unable to locate Pawn function %s", fun);
+		LOG_ERROR ("Unable to locate Pawn function %s", fun);
 		return 0;
 	}
 
 	if (fmt != NULL && (nr_args = strlen (fmt)) > 0)
 	{
-		char c;
 		const char *s;
 		int i;
 		REAL f;
@@ -241,7 +390,7 @@ int run_pawn_function (pawn_machine *machine, const char* fun, const char* fmt,
 					args[iarg] = (cell) s;
 					break;
 				default:
-					log_error ("unknown format specifier '%c' in Pawn call", c);
+					LOG_ERROR ("unknown format specifier '%c' in Pawn call", fmt[iarg]);
 					free (args);
 					return 1;
 			}
@@ -273,7 +422,7 @@ int run_pawn_function (pawn_machine *machine, const char* fun, const char* fmt,
 	err = amx_Exec (&(machine->amx), NULL, index);
 	if (err != AMX_ERR_NONE)
 	{
-		log_error ("Error %d executing Pawn function %s", err, fun);
+		LOG_ERROR ("Error %d executing Pawn function %s", err, fun);
 		return 0;
 	}
 
@@ -306,26 +455,40 @@ int run_pawn_map_function (const char* fun, const char* fmt, ...)
 	va_list ap;
 	
 	va_start (ap, fmt);
+	lock_map_machine ();
 	res = run_pawn_function (&map_amx, fun, fmt, ap);
+	unlock_map_machine ();
 	va_end (ap);
 	
 	return res;
 }
 
+static void push_pawn_timer_event ()
+{
+	SDL_Event event;
+	event.type = SDL_USEREVENT;
+	event.user.code = EVENT_PAWN_TIMER;
+	SDL_PushEvent (&event);
+}
+
 void check_pawn_timers ()
 {
-	if (map_timer_queue && ticks_less_equal (map_timer_queue->ticks, SDL_GetTicks ()))
-	{
-		SDL_Event event;
-		event.type = SDL_USEREVENT;
-		event.user.code = EVENT_PAWN_TIMER;
-		SDL_PushEvent (&event);
-	}
+	int due;
+
+	if (map_timer_thread)
+		return;
+
+	lock_map_machine ();
+	due = map_timer_queue && ticks_less_equal (map_timer_queue->ticks, SDL_GetTicks ());
+	unlock_map_machine ();
+
+	if (due)
+		push_pawn_timer_event ();
 }
 
-void handle_pawn_timers ()
+// Run the callbacks that are due. Called with the map machine locked.
+static void run_map_timers (Uint32 now)
 {
-	Uint32 now = SDL_GetTicks ();
 	while (map_timer_queue && ticks_less_equal (map_timer_queue->ticks, now))
 	{
 		int ok = run_pawn_map_function (map_timer_queue->function, NULL);
@@ -336,15 +499,143 @@ void handle_pawn_timers ()
 	}
 }
 
+static void run_pawn_messages ()
+{
+	pawn_message *head, *msg;
+
+	if (!message_mutex)
+		return;
+
+	CHECK_AND_LOCK_MUTEX (message_mutex);
+	head = message_head;
+	message_head = message_tail = NULL;
+	CHECK_AND_UNLOCK_MUTEX (message_mutex);
+
+	for (msg = head; msg; msg = msg->next)
+	{
+		if (msg->text)
+			LOG_TO_CONSOLE (c_red1, msg->text);
+		else
+			msg->native (&(map_amx.amx), msg->params);
+	}
+
+	free_messages (head);
+}
+
+void handle_pawn_timers ()
+{
+	run_pawn_messages ();
+
+	if (!map_timer_thread)
+	{
+		lock_map_machine ();
+		run_map_timers (SDL_GetTicks ());
+		unlock_map_machine ();
+	}
+}
+
+static int post_pawn_message (AMX_NATIVE native, const cell *params, const char *text)
+{
+	pawn_message *msg;
+
+	if (!map_timer_thread || SDL_ThreadID () != map_timer_thread_id)
+		return 0;
+
+	msg = calloc (1, sizeof (pawn_message));
+	msg->native = native;
+	if (params)
+	{
+		// params[0] holds the size of the arguments in bytes
+		msg->params = malloc (params[0] + sizeof (cell));
+		memcpy (msg->params, params, params[0] + sizeof (cell));
+	}
+	if (text)
+		msg->text = strdup (text);
+
+	CHECK_AND_LOCK_MUTEX (message_mutex);
+	if (message_tail)
+		message_tail->next = msg;
+	else
+		message_head = msg;
+	message_tail = msg;
+	CHECK_AND_UNLOCK_MUTEX (message_mutex);
+
+	push_pawn_timer_event ();
+
+	return 1;
+}
+
+int defer_pawn_native (AMX_NATIVE native, const cell *params)
+{
+	return post_pawn_message (native, params, NULL);
+}
+
+int defer_pawn_console_message (const char *text)
+{
+	return post_pawn_message (NULL, NULL, text);
+}
+
 void add_map_timer (Uint32 offset, const char* name, Uint32 interval)
 {
+	lock_map_machine ();
 	push_timer_queue (&map_timer_queue, SDL_GetTicks () + offset, name, interval);
+	if (map_timer_cond)
+		SDL_CondSignal (map_timer_cond);
+	unlock_map_machine ();
 }
 
 void clear_map_timers ()
 {
+	lock_map_machine ();
 	while (map_timer_queue)
 		pop_timer_queue (&map_timer_queue);
+	unlock_map_machine ();
+}
+
+#ifdef PAWN_BENCHMARK
+void run_pawn_benchmarks (int iterations, void (*report)(const char *line))
+{
+	char *name, line[256];
+	int nr_publics, name_len, index;
+
+	if (!map_amx.initialized || amx_NumPublics (&(map_amx.amx), &nr_publics) != AMX_ERR_NONE
+		|| amx_NameLength (&(map_amx.amx), &name_len) != AMX_ERR_NONE)
+	{
+		report ("The map Pawn machine is not initialized");
+		return;
+	}
+	name = malloc (name_len + 1);
+
+	lock_map_machine ();
+	for (index = 0; index < nr_publics; index++)
+	{
+		unsigned long opcodes;
+		Uint32 start, time;
+		cell retval;
+		int err;
+
+		if (amx_GetPublic (&(map_amx.amx), index, name) != AMX_ERR_NONE
+			|| strncmp (name, "bench_", 6) != 0)
+			continue;
+
+		amx_Push (&(map_amx.amx), iterations);
+		opcodes = amx_opcode_count;
+		start = SDL_GetTicks ();
+		err = amx_Exec (&(map_amx.amx), &retval, index);
+		time = SDL_GetTicks () - start;
+		opcodes = amx_opcode_count - opcodes;
+
+		if (err != AMX_ERR_NONE)
+			safe_snprintf (line, sizeof (line), "%s: error %d", name, err);
+		else
+			safe_snprintf (line, sizeof (line), "%s: %lu opcodes in %u ms, %.1f million opcodes/s",
+				name, opcodes, time, time ? opcodes / (time * 1000.0) : 0.0);
+		report (line);
+	}
+	unlock_map_machine ();
+
+	free (name);
 }
+#endif // PAWN_BENCHMARK
 
 #endif // PAWN
@@ -4,6 +4,13 @@
 #define ELPAWNRUN_H
 
 #include <SDL_types.h>
+#include "amx.h"
+
+/*!
+ * If non-zero, the timer callbacks of the map machine are run on a
+ * dedicated script thread instead of the main thread.
+ */
+extern int pawn_timer_thread;
 
 /*!
  * \brief Initialize the Pawn Abstract Machines
@@ -60,6 +67,17 @@ int run_pawn_server_function (const char* fun, const char* fmt, ...);
  */
 int run_pawn_map_function (const char* fun, const char* fmt, ...);
 
+/*!
+ * \brief Run the map timers on their own thread or on the main thread
+ *
+ * Start or stop the script thread that runs the timer callbacks of the map
+ * machine. Natives called on that thread that change the game state are
+ * passed on to the main thread through defer_pawn_native(). When called
+ * before initialize_pawn(), only the setting is stored.
+ * \param enable 1 to use the script thread, 0 to run timers on the main thread
+ */
+void set_pawn_timer_thread (int enable);
+
 /*!
  * \brief Checks the Pawn timer queue to see if a callback needs to be executed
  *
@@ -73,7 +91,8 @@ void check_pawn_timers ();
  * \brief Execute all necessary timer callbacks.
  *
  * Execute all timer call backs on the queue for which the scheduled time has
- * passed.
+ * passed, and the native calls deferred by the script thread. Only the
+ * deferred calls are run when the timers have their own thread.
  */
 void handle_pawn_timers ();
 
@@ -98,6 +117,41 @@ void add_map_timer (Uint32 offset, const char* name, Uint32 interval);
  */
 void clear_map_timers ();
 
+/*!
+ * \brief Pass a native call on to the main thread
+ *
+ * When called on the Pawn script thread, queue a call of \a native with a
+ * copy of \a params, to be executed on the main thread. Natives that
+ * change the game state call this first and return if it succeeds. The
+ * parameters must not refer to the memory of the abstract machine.
+ * \param native The native function
+ * \param params The parameters of the call
+ * \retval int 1 if the call was queued, 0 if we are not on the script thread
+ */
+int defer_pawn_native (AMX_NATIVE native, const cell *params);
+
+/*!
+ * \brief Pass a console message on to the main thread
+ *
+ * Like defer_pawn_native(), but for a message to show in the console.
+ * \param text The message
+ * \retval int 1 if the message was queued, 0 if we are not on the script thread
+ */
+int defer_pawn_console_message (const char *text);
+
+#ifdef PAWN_BENCHMARK
+/*!
+ * \brief Run the script benchmarks
+ *
+ * Call every public function of the map machine whose name starts with
+ * \c bench_ with \a iterations as its argument, and report the number of
+ * opcodes executed per second for each of them.
+ * \param iterations The argument passed to the benchmark functions
+ * \param report     Function called with a line of text for each benchmark
+ */
+void run_pawn_benchmarks (int iterations, void (*report)(const char *line));
+#endif // PAWN_BENCHMARK
+
 #endif
 
 #endif // PAWN
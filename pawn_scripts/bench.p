@@ -0,0 +1,49 @@
+// Script benchmarks, run with the #pawn_bench console command when the
+// client is built with PAWN_BENCHMARK. Every public function whose name
+// starts with bench_ is called with the number of iterations to run.
+
+fib (n)
+{
+	if (n < 2)
+		return n
+	return fib (n-1) + fib (n-2)
+}
+
+public bench_loop (n)
+{
+	new i, sum = 0
+
+	for (i = 0; i < n; i++)
+		sum += i & 7
+	return sum
+}
+
+public bench_array (n)
+{
+	new values[64], i, sum = 0
+
+	for (i = 0; i < n; i++)
+		values[i & 63] += i
+	for (i = 0; i < 64; i++)
+		sum += values[i]
+	return sum
+}
+
+public bench_float (n)
+{
+	new Float:x = 0.0, i
+
+	for (i = 0; i < n; i++)
+		x = x * 0.5 + float (i & 15)
+	return floatround (x)
+}
+
+public bench_calls (n)
+{
+	new i, sum = 0
+
+	// fib (10) makes 177 calls
+	for (i = 0; i < n / 100; i++)
+		sum += fib (10)
+	return sum
+}
@@ -1,4 +1,7 @@
 #include "maps.p"
+#if defined PAWN_BENCHMARK
+#include "bench.p"
+#endif
 
 public pawn_test (const msg[]) 
 {
@@ -106,6 +106,7 @@ void calc_light_frustum(float light_xrot)
 
 void calc_shadow_matrix()
 {
+	static float last_light_pos[4] = {0.0f, 0.0f, 0.0f, 0.0f};
 	float light_pos[4];
 
 	if (!is_day && lightning_falling)
@@ -113,6 +114,13 @@ void calc_shadow_matrix()
 	else
 		memcpy(light_pos, sun_position, 4*sizeof(float));
 
+	// the shadow casters are only searched again when the light moved
+	if (memcmp(light_pos, last_light_pos, sizeof(light_pos)) != 0)
+	{
+		main_bbox_tree->intersect[INTERSECTION_TYPE_SHADOW].intersect_update_needed = 1;
+		memcpy(last_light_pos, light_pos, sizeof(light_pos));
+	}
+
 	if(use_shadow_mapping)
 		{
 			float xrot,zrot;
@@ -188,7 +196,6 @@ void calc_shadow_matrix()
 			proj_on_ground[11] = 0.0f - light_pos[3] * ground_plane[2];
 			proj_on_ground[15] = dot - light_pos[3] * ground_plane[3];
 		}
-	main_bbox_tree->intersect[INTERSECTION_TYPE_SHADOW].intersect_update_needed = 1;
 #ifdef OPENGL_TRACE
 CHECK_GL_ERRORS();
 #endif //OPENGL_TRACE
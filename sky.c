@@ -114,6 +114,17 @@ GLfloat *dome_clouds_detail_colors_bis = NULL;
 GLfloat *dome_clouds_tex_coords_bis = NULL;
 GLfloat *fog_colors = NULL;
 
+// the local weather at each vertex of the domes, see compute_dome_weather()
+typedef struct
+{
+	float rain;
+	float lightning;
+	float color[4];
+} sky_vertex_weather;
+
+sky_vertex_weather *dome_sky_weather = NULL;
+sky_vertex_weather *dome_clouds_weather = NULL;
+
 sky_sphere moon_mesh = {0, 0, NULL, NULL, NULL};
 
 GLfloat moon1_direction[3];
@@ -1008,16 +1019,37 @@ void update_cloudy_sky_colors()
 	moon2_color[2] *= (0.5 + 0.5*day_alpha)*(1.0-rain_coef);
 }
 
+/* Computes the weather above each vertex of a dome once, instead of for
+ * every layer that is drawn on the dome. */
+static void compute_dome_weather(sky_dome *dome, sky_vertex_weather *weather)
+{
+	float ratios[MAX_WEATHER_TYPES];
+	float x, y;
+	int i;
+
+	for (i = 0; i < dome->vertices_count; ++i)
+	{
+		skybox_vertex_to_ground_coords(dome, i, &x, &y);
+		x -= camera_x;
+		y -= camera_y;
+		weather[i].lightning = weather_get_lightning_intensity(x, y);
+		weather_compute_ratios(ratios, x, y);
+		weather[i].rain = weather_get_density_from_ratios(ratios);
+		weather_get_color_from_ratios(weather[i].color, ratios);
+	}
+}
+
 void update_cloudy_sky_local_colors()
 {
     int i, idx, end;
 	GLfloat color_sun[4];
 	GLfloat color_sky[4];
 	GLfloat color[4];
-	GLfloat local_color[4];
+	GLfloat sky_now[4], sun_now[4], rainy_now[4];
+	const float *local_color;
 	float abs_light;
 	float ratios[MAX_WEATHER_TYPES];
-	float *normal, ml1, ml2, x, y, lg;
+	float *normal, ml1, ml2, lg;
 
 	abs_light = light_level;
 	if(light_level > 59)
@@ -1068,25 +1100,27 @@ void update_cloudy_sky_local_colors()
 	skybox_fog_density = skybox_fog_color[3];
 	skybox_fog_color[3] = 1.0;
 
+	// the weather doesn't change between the layers drawn on the same dome
+	compute_dome_weather(&dome_sky, dome_sky_weather);
+	compute_dome_weather(&dome_clouds, dome_clouds_weather);
+
     // we compute the colors of the fog around the dome according to the sun and moons positions
+	skybox_get_current_color(sun_now, skybox_fog_sunny);
+	skybox_get_current_color(rainy_now, skybox_fog_rainy);
     for (i = 0; i < dome_sky.slices_count; ++i)
     {
 		normal = &dome_sky.normals[i*3];
 		ml1 = get_moonlight1(normal)*0.15*day_alpha;
 		ml2 = get_moonlight2(normal)*0.1*day_alpha;
 
-		skybox_vertex_to_ground_coords(&dome_sky, i, &x, &y);
-		x -= camera_x;
-		y -= camera_y;
-		lg = weather_get_lightning_intensity(x, y);
-		weather_compute_ratios(ratios, x, y);
-		rain_coef = weather_get_density_from_ratios(ratios);
-		weather_get_color_from_ratios(local_color, ratios);
+		rain_coef = dome_sky_weather[i].rain;
+		local_color = dome_sky_weather[i].color;
+		lg = dome_sky_weather[i].lightning;
 
 		ml1 *= 1.0 - rain_coef;
 		ml2 *= 1.0 - rain_coef;
 
-		skybox_blend_current_colors(color_sun, skybox_fog_sunny, skybox_fog_rainy, rain_coef);
+		blend_colors(color_sun, sun_now, rainy_now, rain_coef, 4);
 		blend_colors(color, skybox_fog_color, color_sun, get_fog_sunlight(normal), 3);
 
 		color[0] *= (1.0 - rain_coef) + rain_coef*local_color[0];
@@ -1105,25 +1139,24 @@ void update_cloudy_sky_local_colors()
 	i = idx = 0;
 
 	// clouds color
+	skybox_get_current_color(sky_now, skybox_clouds);
+	skybox_get_current_color(sun_now, skybox_clouds_sunny);
+	skybox_get_current_color(rainy_now, skybox_clouds_rainy);
     while (i < dome_clouds.slices_count * 2)
     {
 		normal = &dome_clouds.normals[i*3];
 		ml1 = get_moonlight1(normal)*0.3*day_alpha;
 		ml2 = get_moonlight2(normal)*0.2*day_alpha;
 
-		skybox_vertex_to_ground_coords(&dome_clouds, i, &x, &y);
-		x -= camera_x;
-		y -= camera_y;
-		lg = weather_get_lightning_intensity(x, y);
-		weather_compute_ratios(ratios, x, y);
-		rain_coef = weather_get_density_from_ratios(ratios);
-		weather_get_color_from_ratios(local_color, ratios);
+		rain_coef = dome_clouds_weather[i].rain;
+		local_color = dome_clouds_weather[i].color;
+		lg = dome_clouds_weather[i].lightning;
 
 		ml1 *= 1.0 - rain_coef;
 		ml2 *= 1.0 - rain_coef;
 
-		skybox_blend_current_colors(color_sky, skybox_clouds, skybox_clouds_rainy, rain_coef);
-		skybox_blend_current_colors(color_sun, skybox_clouds_sunny, skybox_clouds_rainy, rain_coef);
+		blend_colors(color_sky, sky_now, rainy_now, rain_coef, 4);
+		blend_colors(color_sun, sun_now, rainy_now, rain_coef, 4);
 
 		blend_colors(color, color_sky, color_sun, get_clouds_sunlight(normal), 3);
 
@@ -1151,19 +1184,15 @@ void update_cloudy_sky_local_colors()
 		ml1 = get_moonlight1(normal)*0.3*day_alpha;
 		ml2 = get_moonlight2(normal)*0.2*day_alpha;
 
-		skybox_vertex_to_ground_coords(&dome_clouds, i, &x, &y);
-		x -= camera_x;
-		y -= camera_y;
-		lg = weather_get_lightning_intensity(x, y);
-		weather_compute_ratios(ratios, x, y);
-		rain_coef = weather_get_density_from_ratios(ratios);
-		weather_get_color_from_ratios(local_color, ratios);
+		rain_coef = dome_clouds_weather[i].rain;
+		local_color = dome_clouds_weather[i].color;
+		lg = dome_clouds_weather[i].lightning;
 
 		ml1 *= 1.0 - rain_coef;
 		ml2 *= 1.0 - rain_coef;
 
-		skybox_blend_current_colors(color_sky, skybox_clouds, skybox_clouds_rainy, rain_coef);
-		skybox_blend_current_colors(color_sun, skybox_clouds_sunny, skybox_clouds_rainy, rain_coef);
+		blend_colors(color_sky, sky_now, rainy_now, rain_coef, 4);
+		blend_colors(color_sun, sun_now, rainy_now, rain_coef, 4);
 
 		blend_colors(color, color_sky, color_sun, get_clouds_sunlight(normal), 3);
 
@@ -1189,17 +1218,16 @@ void update_cloudy_sky_local_colors()
 	i = idx = 0;
 
 	// clouds detail color
+	skybox_get_current_color(sky_now, skybox_clouds_detail);
+	skybox_get_current_color(sun_now, skybox_clouds_detail_sunny);
+	skybox_get_current_color(rainy_now, skybox_clouds_detail_rainy);
     while (i < dome_clouds.slices_count * 2)
     {
-		skybox_vertex_to_ground_coords(&dome_clouds, i, &x, &y);
-		x -= camera_x;
-		y -= camera_y;
-		weather_compute_ratios(ratios, x, y);
-		rain_coef = weather_get_density_from_ratios(ratios);
-		weather_get_color_from_ratios(local_color, ratios);
+		rain_coef = dome_clouds_weather[i].rain;
+		local_color = dome_clouds_weather[i].color;
 
-		skybox_blend_current_colors(color_sky, skybox_clouds_detail, skybox_clouds_detail_rainy, rain_coef);
-		skybox_blend_current_colors(color_sun, skybox_clouds_detail_sunny, skybox_clouds_detail_rainy, rain_coef);
+		blend_colors(color_sky, sky_now, rainy_now, rain_coef, 4);
+		blend_colors(color_sun, sun_now, rainy_now, rain_coef, 4);
 
 		blend_colors(color, color_sky, color_sun, get_clouds_sunlight(&dome_clouds.normals[i*3]), 3);
 
@@ -1219,15 +1247,11 @@ void update_cloudy_sky_local_colors()
     }
     while (i < dome_clouds.vertices_count)
     {
-		skybox_vertex_to_ground_coords(&dome_clouds, i, &x, &y);
-		x -= camera_x;
-		y -= camera_y;
-		weather_compute_ratios(ratios, x, y);
-		rain_coef = weather_get_density_from_ratios(ratios);
-		weather_get_color_from_ratios(local_color, ratios);
+		rain_coef = dome_clouds_weather[i].rain;
+		local_color = dome_clouds_weather[i].color;
 
-		skybox_blend_current_colors(color_sky, skybox_clouds_detail, skybox_clouds_detail_rainy, rain_coef);
-		skybox_blend_current_colors(color_sun, skybox_clouds_detail_sunny, skybox_clouds_detail_rainy, rain_coef);
+		blend_colors(color_sky, sky_now, rainy_now, rain_coef, 4);
+		blend_colors(color_sun, sun_now, rainy_now, rain_coef, 4);
 
 		blend_colors(color, color_sky, color_sun, get_clouds_sunlight(&dome_clouds.normals[i*3]), 3);
 
@@ -1250,25 +1274,24 @@ void update_cloudy_sky_local_colors()
 
 	// sky color
 	end = dome_sky.slices_count;
+	skybox_get_current_color(sky_now, skybox_sky1);
+	skybox_get_current_color(sun_now, skybox_sky1_sunny);
+	skybox_get_current_color(rainy_now, skybox_fog_rainy);
     while (i < end)
     {
 		normal = &dome_sky.normals[i*3];
 		ml1 = get_moonlight1(normal)*0.15*day_alpha;
 		ml2 = get_moonlight2(normal)*0.1*day_alpha;
 
-		skybox_vertex_to_ground_coords(&dome_sky, i, &x, &y);
-		x -= camera_x;
-		y -= camera_y;
-		lg = weather_get_lightning_intensity(x, y);
-		weather_compute_ratios(ratios, x, y);
-		rain_coef = weather_get_density_from_ratios(ratios);
-		weather_get_color_from_ratios(local_color, ratios);
+		rain_coef = dome_sky_weather[i].rain;
+		local_color = dome_sky_weather[i].color;
+		lg = dome_sky_weather[i].lightning;
 
 		ml1 *= 1.0 - rain_coef;
 		ml2 *= 1.0 - rain_coef;
 
-		skybox_blend_current_colors(color_sky, skybox_sky1, skybox_fog_rainy, rain_coef);
-		skybox_blend_current_colors(color_sun, skybox_sky1_sunny, skybox_fog_rainy, rain_coef);
+		blend_colors(color_sky, sky_now, rainy_now, rain_coef, 4);
+		blend_colors(color_sun, sun_now, rainy_now, rain_coef, 4);
 
 		blend_colors(color, color_sky, color_sun, get_sky_sunlight(normal), 3);
 
@@ -1288,25 +1311,24 @@ void update_cloudy_sky_local_colors()
     }
 
 	end += dome_sky.slices_count;
+	skybox_get_current_color(sky_now, skybox_sky2);
+	skybox_get_current_color(sun_now, skybox_sky2_sunny);
+	skybox_get_current_color(rainy_now, skybox_fog_rainy);
     while (i < end)
     {
 		normal = &dome_sky.normals[i*3];
 		ml1 = get_moonlight1(normal)*0.15*day_alpha;
 		ml2 = get_moonlight2(normal)*0.1*day_alpha;
 
-		skybox_vertex_to_ground_coords(&dome_sky, i, &x, &y);
-		x -= camera_x;
-		y -= camera_y;
-		lg = weather_get_lightning_intensity(x, y);
-		weather_compute_ratios(ratios, x, y);
-		rain_coef = weather_get_density_from_ratios(ratios);
-		weather_get_color_from_ratios(local_color, ratios);
+		rain_coef = dome_sky_weather[i].rain;
+		local_color = dome_sky_weather[i].color;
+		lg = dome_sky_weather[i].lightning;
 
 		ml1 *= 1.0 - rain_coef;
 		ml2 *= 1.0 - rain_coef;
 
-		skybox_blend_current_colors(color_sky, skybox_sky2, skybox_fog_rainy, rain_coef);
-		skybox_blend_current_colors(color_sun, skybox_sky2_sunny, skybox_fog_rainy, rain_coef);
+		blend_colors(color_sky, sky_now, rainy_now, rain_coef, 4);
+		blend_colors(color_sun, sun_now, rainy_now, rain_coef, 4);
 
 		blend_colors(color, color_sky, color_sun, get_sky_sunlight(normal), 3);
 
@@ -1326,25 +1348,24 @@ void update_cloudy_sky_local_colors()
     }
 
 	end += dome_sky.slices_count;
+	skybox_get_current_color(sky_now, skybox_sky3);
+	skybox_get_current_color(sun_now, skybox_sky3_sunny);
+	skybox_get_current_color(rainy_now, skybox_fog_rainy);
     while (i < end)
     {
 		normal = &dome_sky.normals[i*3];
 		ml1 = get_moonlight1(normal)*0.15*day_alpha;
 		ml2 = get_moonlight2(normal)*0.1*day_alpha;
 
-		skybox_vertex_to_ground_coords(&dome_sky, i, &x, &y);
-		x -= camera_x;
-		y -= camera_y;
-		lg = weather_get_lightning_intensity(x, y);
-		weather_compute_ratios(ratios, x, y);
-		rain_coef = weather_get_density_from_ratios(ratios);
-		weather_get_color_from_ratios(local_color, ratios);
+		rain_coef = dome_sky_weather[i].rain;
+		local_color = dome_sky_weather[i].color;
+		lg = dome_sky_weather[i].lightning;
 
 		ml1 *= 1.0 - rain_coef;
 		ml2 *= 1.0 - rain_coef;
 
-		skybox_blend_current_colors(color_sky, skybox_sky3, skybox_fog_rainy, rain_coef);
-		skybox_blend_current_colors(color_sun, skybox_sky3_sunny, skybox_fog_rainy, rain_coef);
+		blend_colors(color_sky, sky_now, rainy_now, rain_coef, 4);
+		blend_colors(color_sun, sun_now, rainy_now, rain_coef, 4);
 
 		blend_colors(color, color_sky, color_sun, get_sky_sunlight(normal), 3);
 
@@ -1364,25 +1385,24 @@ void update_cloudy_sky_local_colors()
     }
 
 	end += dome_sky.slices_count;
+	skybox_get_current_color(sky_now, skybox_sky4);
+	skybox_get_current_color(sun_now, skybox_sky4_sunny);
+	skybox_get_current_color(rainy_now, skybox_fog_rainy);
     while (i < end)
     {
 		normal = &dome_sky.normals[i*3];
 		ml1 = get_moonlight1(normal)*0.15*day_alpha;
 		ml2 = get_moonlight2(normal)*0.1*day_alpha;
 
-		skybox_vertex_to_ground_coords(&dome_sky, i, &x, &y);
-		x -= camera_x;
-		y -= camera_y;
-		lg = weather_get_lightning_intensity(x, y);
-		weather_compute_ratios(ratios, x, y);
-		rain_coef = weather_get_density_from_ratios(ratios);
-		weather_get_color_from_ratios(local_color, ratios);
+		rain_coef = dome_sky_weather[i].rain;
+		local_color = dome_sky_weather[i].color;
+		lg = dome_sky_weather[i].lightning;
 
 		ml1 *= 1.0 - rain_coef;
 		ml2 *= 1.0 - rain_coef;
 
-		skybox_blend_current_colors(color_sky, skybox_sky4, skybox_fog_rainy, rain_coef);
-		skybox_blend_current_colors(color_sun, skybox_sky4_sunny, skybox_fog_rainy, rain_coef);
+		blend_colors(color_sky, sky_now, rainy_now, rain_coef, 4);
+		blend_colors(color_sun, sun_now, rainy_now, rain_coef, 4);
 	
 		blend_colors(color, color_sky, color_sun, get_sky_sunlight(normal), 3);
 
@@ -1401,25 +1421,24 @@ void update_cloudy_sky_local_colors()
 		++i;
     }
 
+	skybox_get_current_color(sky_now, skybox_sky5);
+	skybox_get_current_color(sun_now, skybox_sky5_sunny);
+	skybox_get_current_color(rainy_now, skybox_fog_rainy);
     while (i < dome_sky.vertices_count)
     {
 		normal = &dome_sky.normals[i*3];
 		ml1 = get_moonlight1(normal)*0.15*day_alpha;
 		ml2 = get_moonlight2(normal)*0.1*day_alpha;
 
-		skybox_vertex_to_ground_coords(&dome_sky, i, &x, &y);
-		x -= camera_x;
-		y -= camera_y;
-		lg = weather_get_lightning_intensity(x, y);
-		weather_compute_ratios(ratios, x, y);
-		rain_coef = weather_get_density_from_ratios(ratios);
-		weather_get_color_from_ratios(local_color, ratios);
+		rain_coef = dome_sky_weather[i].rain;
+		local_color = dome_sky_weather[i].color;
+		lg = dome_sky_weather[i].lightning;
 
 		ml1 *= 1.0 - rain_coef;
 		ml2 *= 1.0 - rain_coef;
 
-		skybox_blend_current_colors(color_sky, skybox_sky5, skybox_fog_rainy, rain_coef);
-		skybox_blend_current_colors(color_sun, skybox_sky5_sunny, skybox_fog_rainy, rain_coef);
+		blend_colors(color_sky, sky_now, rainy_now, rain_coef, 4);
+		blend_colors(color_sun, sun_now, rainy_now, rain_coef, 4);
 	
 		blend_colors(color, color_sky, color_sun, get_sky_sunlight(normal), 3);
 
@@ -2633,6 +2652,8 @@ void skybox_init_gl()
 	if (dome_clouds_detail_colors_bis) free(dome_clouds_detail_colors_bis);
 	if (dome_clouds_tex_coords_bis) free(dome_clouds_tex_coords_bis);
 	if (fog_colors) free(fog_colors);
+	if (dome_sky_weather) free(dome_sky_weather);
+	if (dome_clouds_weather) free(dome_clouds_weather);
 
 	dome_sky = create_dome(24, 12, 500.0, 80.0, 90.0, 3.5, 1.0);
 	dome_clouds = create_dome(24, 12, 500.0, 80.0, 90.0, 2.0, 1.0);
@@ -2642,6 +2663,8 @@ void skybox_init_gl()
 	dome_clouds_detail_colors_bis = (GLfloat*)malloc(4*dome_clouds.vertices_count*sizeof(GLfloat));
 	dome_clouds_tex_coords_bis = (GLfloat*)malloc(2*dome_clouds.vertices_count*sizeof(GLfloat));
 	fog_colors = (GLfloat*)malloc(3*dome_sky.slices_count*sizeof(GLfloat));
+	dome_sky_weather = (sky_vertex_weather*)malloc(dome_sky.vertices_count*sizeof(sky_vertex_weather));
+	dome_clouds_weather = (sky_vertex_weather*)malloc(dome_clouds.vertices_count*sizeof(sky_vertex_weather));
 
 	for (i = dome_clouds.vertices_count; i--; )
 	{
@@ -2661,5 +2684,7 @@ void free_skybox()
 	if (dome_clouds_detail_colors_bis) free(dome_clouds_detail_colors_bis);
 	if (dome_clouds_tex_coords_bis) free(dome_clouds_tex_coords_bis);
 	if (fog_colors) free(fog_colors);
+	if (dome_sky_weather) free(dome_sky_weather);
+	if (dome_clouds_weather) free(dome_clouds_weather);
 }
 
@@ -23,6 +23,7 @@
 #include "io/elpathwrapper.h"
 #include "io/elfilewrapper.h"
 #include "threads.h"
+#include "xml_cache.h"
 
 #if defined _EXTRA_SOUND_DEBUG && OSX
  #define printf LOG_ERROR
@@ -93,6 +94,8 @@ int last_line = 0;
 #define MAX_SOUND_WARNINGS 50		// The number of user defined sound warnings
 #define MAX_SND_WARNING_STRING 256	// Max size of warning string
 
+#define SOUND_CACHE_VERSION 1		// Increase when one of the structures stored in the sound config cache changes
+
 typedef enum
 {
 	STAGE_UNUSED = -1, STAGE_INTRO, STAGE_MAIN, STAGE_OUTRO, num_STAGES, STAGE_STREAM
@@ -5793,6 +5796,121 @@ int parse_sound_defs(const xmlNode *node)
 	return ok;
 }
 
+// Sections of the sound config cache file. The part pointers of the sound
+// types can't be stored, they are saved as indices into sound_files instead.
+#define SOUND_CACHE_SECTIONS 11
+static int sound_cache_parts[MAX_SOUNDS * MAX_SOUND_VARIANTS * num_STAGES];
+static int sound_cache_defaults[2];
+
+static void get_sound_cache_sections(xml_cache_section *sections)
+{
+	xml_cache_section tmp[SOUND_CACHE_SECTIONS] = {
+		{ NULL, sizeof(sound_type), 0, MAX_SOUNDS },
+		{ sound_cache_parts, sizeof(int), 0, MAX_SOUNDS * MAX_SOUND_VARIANTS * num_STAGES },
+		{ NULL, sizeof(sound_file), 0, MAX_SOUND_FILES },
+		{ NULL, sizeof(background_default), 0, MAX_BACKGROUND_DEFAULTS },
+		{ sound_cache_defaults, sizeof(int), 2, 2 },
+		{ NULL, sizeof(map_sound_data), 0, MAX_SOUND_MAPS },
+		{ NULL, sizeof(effect_sound_data), 0, MAX_SOUND_EFFECTS },
+		{ NULL, sizeof(particle_sound_data), 0, MAX_SOUND_PARTICLES },
+		{ NULL, sizeof(item_sound_data), 0, MAX_SOUND_ITEMS },
+		{ NULL, sizeof(tile_sound_data), 0, MAX_SOUND_TILE_TYPES },
+		{ NULL, sizeof(int), NUM_ACTIVE_SPELLS, NUM_ACTIVE_SPELLS }
+	};
+
+	// not constant, so they can't go into the initializer
+	tmp[0].data = sound_type_data;
+	tmp[0].count = num_types;
+	tmp[2].data = sound_files;
+	tmp[2].count = num_sound_files;
+	tmp[3].data = sound_background_defaults;
+	tmp[3].count = sound_num_background_defaults;
+	tmp[5].data = sound_map_data;
+	tmp[5].count = sound_num_maps;
+	tmp[6].data = sound_effect_data;
+	tmp[6].count = sound_num_effects;
+	tmp[7].data = sound_particle_data;
+	tmp[7].count = sound_num_particles;
+	tmp[8].data = sound_item_data;
+	tmp[8].count = sound_num_items;
+	tmp[9].data = sound_tile_data;
+	tmp[9].count = sound_num_tile_types;
+	tmp[10].data = sound_spell_data;
+	memcpy(sections, tmp, sizeof(tmp));
+}
+
+static int load_sound_config_cache(const char *file)
+{
+	xml_cache_section sections[SOUND_CACHE_SECTIONS];
+	int i, j, k, idx;
+
+	get_sound_cache_sections(sections);
+	if (!xml_cache_load("sound_config", SOUND_CACHE_VERSION, file, sections, SOUND_CACHE_SECTIONS))
+		return 0;
+
+	num_types = sections[0].count;
+	num_sound_files = sections[2].count;
+	sound_num_background_defaults = sections[3].count;
+	crowd_default = sound_cache_defaults[0];
+	walking_default = sound_cache_defaults[1];
+	sound_num_maps = sections[5].count;
+	sound_num_effects = sections[6].count;
+	sound_num_particles = sections[7].count;
+	sound_num_items = sections[8].count;
+	sound_num_tile_types = sections[9].count;
+
+	for (i = 0; i < num_sound_files; i++)
+		sound_files[i].sample_num = -1;
+
+	idx = 0;
+	for (i = 0; i < num_types; i++)
+	{
+		for (j = 0; j < MAX_SOUND_VARIANTS; j++)
+		{
+			for (k = 0; k < num_STAGES; k++, idx++)
+			{
+				if (idx >= sections[1].count || sound_cache_parts[idx] >= num_sound_files)
+				{
+					LOG_ERROR("%s: Invalid sound file in cache for '%s'", snd_config_error, file);
+					clear_sound_data();
+					return 0;
+				}
+				if (sound_cache_parts[idx] < 0)
+					sound_type_data[i].variant[j].part[k] = NULL;
+				else
+					sound_type_data[i].variant[j].part[k] = &sound_files[sound_cache_parts[idx]];
+			}
+		}
+	}
+
+	return 1;
+}
+
+static void save_sound_config_cache(const char *file)
+{
+	xml_cache_section sections[SOUND_CACHE_SECTIONS];
+	int i, j, k, idx;
+
+	idx = 0;
+	for (i = 0; i < num_types; i++)
+	{
+		for (j = 0; j < MAX_SOUND_VARIANTS; j++)
+		{
+			for (k = 0; k < num_STAGES; k++, idx++)
+			{
+				const sound_file *part = sound_type_data[i].variant[j].part[k];
+				sound_cache_parts[idx] = part ? part - sound_files : -1;
+			}
+		}
+	}
+	sound_cache_defaults[0] = crowd_default;
+	sound_cache_defaults[1] = walking_default;
+
+	get_sound_cache_sections(sections);
+	sections[1].count = idx;
+	xml_cache_save("sound_config", SOUND_CACHE_VERSION, file, sections, SOUND_CACHE_SECTIONS);
+}
+
 void load_sound_config_data (const char *file)
 {
 	xmlDoc *doc;
@@ -5804,6 +5922,18 @@ void load_sound_config_data (const char *file)
 	if (!el_file_exists(file))
 		return;
 
+	clear_sound_data();
+	if (load_sound_config_cache(file))
+	{
+		have_sound_config = 1;
+		parse_server_sounds();
+		load_sound_warnings_list(SOUND_WARNINGS_PATH);
+#ifdef DEBUG
+		print_sound_types();
+#endif // DEBUG
+		return;
+	}
+
 	if ((doc = xmlReadFile(file, NULL, XML_PARSE_NOENT)) == NULL)
 	{
 		char str[200];
@@ -5825,8 +5955,8 @@ void load_sound_config_data (const char *file)
 	else
 	{
 		have_sound_config = 1;
-		clear_sound_data();
-		parse_sound_defs(root);
+		if (parse_sound_defs(root))
+			save_sound_config_cache(file);
 		parse_server_sounds();
 		load_sound_warnings_list(SOUND_WARNINGS_PATH);
 	}
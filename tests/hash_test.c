@@ -0,0 +1,102 @@
+/*
+ * Checks that hash_get returns the most recently added item of a key, with
+ * lots of duplicate keys, collisions, deletes and resizes.
+ *
+ * Build and run with "make -f Makefile.linux hash_test".
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "../hash.h"
+
+#define NR_KEYS 300
+#define NR_OPS 20000
+
+static int errors = 0;
+
+// few distinct hash values, so the probe runs get long
+static unsigned long int hash_fn_bad(void *key)
+{
+	return (unsigned long int)key % 7;
+}
+
+static void check(hash_table *table, const long *latest, const int *count)
+{
+	hash_entry *entry;
+	int key, items = 0;
+
+	for (key = 1; key <= NR_KEYS; key++)
+	{
+		entry = hash_get(table, (void*)(long)key);
+		items += count[key];
+		if (count[key] == 0 && entry != NULL)
+		{
+			printf("key %d: deleted, but found item %ld\n", key, (long)entry->item);
+			errors++;
+		}
+		else if (count[key] > 0 && (entry == NULL || (long)entry->item != latest[key]))
+		{
+			printf("key %d: expected item %ld, got %ld\n", key, latest[key],
+				entry ? (long)entry->item : -1L);
+			errors++;
+		}
+	}
+	if (table->items != items)
+	{
+		printf("expected %d items, table has %d\n", items, table->items);
+		errors++;
+	}
+}
+
+static void run(unsigned long int (*hashfn)(void *), int size, int deletes)
+{
+	hash_table *table;
+	long latest[NR_KEYS + 1];
+	int count[NR_KEYS + 1];
+	int i, key;
+
+	table = create_hash_table(size, hashfn, cmp_fn_int, NULL);
+	for (key = 0; key <= NR_KEYS; key++)
+	{
+		latest[key] = 0;
+		count[key] = 0;
+	}
+
+	for (i = 1; i <= NR_OPS; i++)
+	{
+		key = rand() % NR_KEYS + 1;
+		if (deletes && rand() % 4 == 0)
+		{
+			hash_delete(table, (void*)(long)key);
+			count[key] = 0;
+		}
+		else
+		{
+			hash_add(table, (void*)(long)key, (void*)(long)i);
+			latest[key] = i;
+			count[key]++;
+		}
+		if (i % 100 == 0)
+			check(table, latest, count);
+	}
+	check(table, latest, count);
+
+	destroy_hash_table(table);
+}
+
+int main(void)
+{
+	srand(1);
+
+	// no resize and no delete
+	run(hash_fn_int, NR_OPS, 0);
+	run(hash_fn_bad, NR_OPS, 0);
+	// growing from the minimum size
+	run(hash_fn_int, 0, 0);
+	run(hash_fn_bad, 0, 0);
+	// with deletes
+	run(hash_fn_int, 0, 1);
+	run(hash_fn_bad, 0, 1);
+
+	printf("hash_test: %s\n", errors ? "FAILED" : "passed");
+	return errors ? 1 : 0;
+}
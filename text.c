@@ -8,6 +8,7 @@
 #include "asc.h"
 #include "buddy.h"
 #include "chat.h"
+#include "chat_log.h"
 #include "console.h"
 #include "consolewin.h"
 #include "elconfig.h"
@@ -62,8 +63,6 @@ void clear_today_is_special_day(void) { is_special_day = 0; };
 int log_chat = LOG_SERVER;
 
 float	chat_zoom=1.0;
-FILE	*chat_log=NULL;
-FILE	*srv_log=NULL;
 
 ec_reference harvesting_effect_reference = NULL;
 
@@ -149,35 +148,16 @@ void open_chat_log(){
 	char starttime[200], sttime[200];
 	struct tm *l_time; time_t c_time;
 
-	char chat_log_file[100];
-	char srv_log_file[100];
-
 	time(&c_time);
 	l_time = localtime(&c_time);
 
-	if (get_rotate_chat_log())
-	{
-		char logsuffix[7];
-		strftime(logsuffix, sizeof(logsuffix), "%Y%m", l_time);
-		safe_snprintf (chat_log_file, sizeof (chat_log_file),  "chat_log_%s.txt", logsuffix);
-		safe_snprintf (srv_log_file, sizeof (srv_log_file), "srv_log_%s.txt", logsuffix); 
-	}
-	else
-	{
-		safe_strncpy(chat_log_file, "chat_log.txt", sizeof(chat_log_file));
-		safe_strncpy(srv_log_file, "srv_log.txt", sizeof(srv_log_file));
-	}
-
-	chat_log = open_file_config (chat_log_file, "a");
-	if (log_chat == LOG_SERVER || log_chat == LOG_SERVER_SEPERATE)
-		srv_log = open_file_config (srv_log_file, "a");
-	if (chat_log == NULL)
+	if (!chat_log_open(log_chat == LOG_SERVER || log_chat == LOG_SERVER_SEPERATE))
 	{
 		LOG_TO_CONSOLE(c_red3, "Unable to open log file to write. We will NOT be recording anything.");
 		log_chat = LOG_NONE;
 		return;
 	}
-	else if ((log_chat == LOG_SERVER || log_chat == LOG_SERVER_SEPERATE) && srv_log == NULL)
+	else if ((log_chat == LOG_SERVER || log_chat == LOG_SERVER_SEPERATE) && !chat_log_is_open(CHAT_LOG_SERVER))
 	{
 		LOG_TO_CONSOLE(c_red3, "Unable to open server log file to write. We will fall back to recording everything in chat_log.txt.");
 		log_chat = LOG_CHAT;
@@ -185,7 +165,7 @@ void open_chat_log(){
 	}
 	strftime(sttime, sizeof(sttime), "\n\nLog started at %Y-%m-%d %H:%M:%S localtime", l_time);
 	safe_snprintf(starttime, sizeof(starttime), "%s (%s)\n\n", sttime, tzname[l_time->tm_isdst>0]);
-	fwrite (starttime, strlen(starttime), 1, chat_log);
+	chat_log_write(CHAT_LOG_CHAT, CHAT_LOG_NO_CHANNEL, starttime, strlen(starttime));
 }
 
 
@@ -197,14 +177,14 @@ void timestamp_chat_log(){
 		return; //we're not logging anything
 	}
 
-	if (chat_log == NULL){
+	if (!chat_log_is_open(CHAT_LOG_CHAT)){
 		open_chat_log();
 	} else {
 		time(&c_time);
 		l_time = localtime(&c_time);
 		strftime(sttime, sizeof(sttime), "Hourly time-stamp: log continued at %Y-%m-%d %H:%M:%S localtime", l_time);
 		safe_snprintf(starttime, sizeof(starttime), "%s (%s)\n", sttime, tzname[l_time->tm_isdst>0]);
-		fwrite (starttime, strlen(starttime), 1, chat_log);
+		chat_log_write(CHAT_LOG_CHAT, CHAT_LOG_NO_CHANNEL, starttime, strlen(starttime));
 	}
 }
 
@@ -213,9 +193,10 @@ void write_to_log (Uint8 channel, const Uint8* const data, int len)
 {
 	int i, j;
 	Uint8 ch;
-	char str[1024];
+	char local_str[1024];
+	char *str = local_str;
 	struct tm *l_time; time_t c_time;
-	FILE *fout;
+	int stream;
 
 #ifdef NEW_SOUND
 	// Check if this string matches text we play a sound for
@@ -227,22 +208,26 @@ void write_to_log (Uint8 channel, const Uint8* const data, int len)
 		// we're not logging those
 		return;
 
-	if (chat_log == NULL){
+	if (!chat_log_is_open(CHAT_LOG_CHAT)){
 		open_chat_log();
-		if(chat_log == NULL){
+		if(!chat_log_is_open(CHAT_LOG_CHAT)){
 			return;
 		}
 	}
 
-	// The file we'll write to
-	fout = (channel == CHAT_SERVER && log_chat >= 3) ? srv_log : chat_log;
+	// The log we'll write to
+	stream = (channel == CHAT_SERVER && log_chat >= 3) ? CHAT_LOG_SERVER : CHAT_LOG_CHAT;
+
+	// time stamp, text and newline have to fit, the log writer wants whole lines
+	if (len + 16 > (int)sizeof(local_str))
+		str = malloc(len + 16);
 
 	if(!show_timestamp)
 	{
 		// Start filling the buffer with the time stamp
 		time (&c_time);
 		l_time = localtime (&c_time);
-		j = strftime (str, sizeof(str), "[%H:%M:%S] ", l_time);
+		j = strftime (str, 16, "[%H:%M:%S] ", l_time);
 	}
 	else
 	{
@@ -250,28 +235,22 @@ void write_to_log (Uint8 channel, const Uint8* const data, int len)
 		j=0;
 	}
 
-	i = 0;
-	while (i < len)
+	for (i = 0; i < len; i++)
 	{
-		for ( ; i < len && j < sizeof (str) - 1; i++)
-		{
-			ch = data[i];
-
-			// remove colorization and soft wrapping characters when
-			// writing to the chat log
-			if (!is_color (ch) && ch != '\r')
-				str[j++] = ch;
-		}
-		if (i >= len) str[j++]='\n';
+		ch = data[i];
 
-		fwrite (str, j, 1, fout);
-
-		// start again at the beginning of the buffer
-		j = 0;
+		// remove colorization and soft wrapping characters when
+		// writing to the chat log
+		if (!is_color (ch) && ch != '\r')
+			str[j++] = ch;
 	}
+	str[j++]='\n';
+
+	// Queued for the log writer, which takes care of flushing.
+	chat_log_write(stream, channel, str, j);
 
-	// Flush the file, so the content is written even when EL crashes.
-	fflush (fout);
+	if (str != local_str)
+		free(str);
 }
 
 void send_input_text_line (char *line, int line_len)
@@ -51,6 +51,45 @@ static Uint32 texture_handles_used = 0;
 static Uint32 texture_cache_sorted[TEXTURE_CACHE_MAX];
 #endif
 
+typedef struct
+{
+	Uint32 compression;
+	Uint32 strip_mipmaps;
+	Uint32 base_level;
+	Uint32 wrap_mode_repeat;
+	Uint32 af;
+	GLenum min_filter;
+	texture_format_type format;
+} texture_load_params_t;
+
+#ifdef	ELC
+#define TEXTURE_STREAM_THREAD_COUNT 2
+
+/*
+ * Mesh textures are decoded by the stream threads and uploaded by
+ * update_texture_streaming, a placeholder is bound until then. The threads
+ * take the pending request with the largest screen size first.
+ */
+typedef struct
+{
+	Uint32 handle;
+	texture_load_params_t params;
+	image_t image;
+	Uint32 loaded;
+} texture_stream_request_t;
+
+int texture_upload_budget = 1024;
+
+static SDL_Thread* texture_stream_threads[TEXTURE_STREAM_THREAD_COUNT];
+static Uint32 texture_stream_threads_done = 0;
+static SDL_mutex* texture_stream_mutex = NULL;
+static SDL_cond* texture_stream_condition = NULL;
+static texture_stream_request_t* texture_stream_pending[TEXTURE_CACHE_MAX];
+static Uint32 texture_stream_pending_count = 0;
+static queue_t* texture_stream_done = NULL;
+static GLuint texture_placeholder_id = 0;
+#endif	/* ELC */
+
 Uint32 compact_texture(texture_cache_t* texture)
 {
 	Uint32 size;
@@ -540,61 +579,87 @@ static Uint32 get_supported_compression_formats()
 	return result;
 }
 
-static Uint32 load_texture(texture_cache_t* texture_handle)
+static void get_texture_load_params(const texture_type type,
+	texture_load_params_t* params)
 {
-	image_t image;
-	GLuint id;
-	Uint32 strip_mipmaps, base_level, wrap_mode_repeat, af, i, compression;
-	GLenum min_filter;
-	texture_format_type format;
-
-	memset(&image, 0, sizeof(image_t));
+	params->wrap_mode_repeat = 0;
+	params->strip_mipmaps = 0;
+	params->base_level = 0;
+	params->af = 0;
+	params->min_filter = GL_LINEAR;
+	params->format = tft_auto;
 
-	wrap_mode_repeat = 0;
-	strip_mipmaps = 0;
-	base_level = 0;
-	af = 0;
-	min_filter = GL_LINEAR;
-	format = tft_auto;
-
-	compression = get_supported_compression_formats();
+	params->compression = get_supported_compression_formats();
 
-	switch (texture_handle->type)
+	switch (type)
 	{
 		case tt_gui:
-			wrap_mode_repeat = 1;
-			strip_mipmaps = 1;
+			params->wrap_mode_repeat = 1;
+			params->strip_mipmaps = 1;
 			break;
 		case tt_image:
-			strip_mipmaps = 1;
-			if ((compression & tct_s3tc) == tct_s3tc)
+			params->strip_mipmaps = 1;
+			if ((params->compression & tct_s3tc) == tct_s3tc)
 			{
-				format = tft_dxt1;
+				params->format = tft_dxt1;
 			}
 
 			break;
 		case tt_font:
 			break;
 		case tt_mesh:
-			wrap_mode_repeat = 1;
+			params->wrap_mode_repeat = 1;
 			if (poor_man != 0)
 			{
-				min_filter = GL_LINEAR_MIPMAP_NEAREST;
-				base_level = 1;
+				params->min_filter = GL_LINEAR_MIPMAP_NEAREST;
+				params->base_level = 1;
 			}
 			else
 			{
-				min_filter = GL_LINEAR_MIPMAP_LINEAR;
-				af = 1;
+				params->min_filter = GL_LINEAR_MIPMAP_LINEAR;
+				params->af = 1;
 			}
 			break;
 		case tt_atlas:
-			wrap_mode_repeat = 0;
+			params->wrap_mode_repeat = 0;
 			break;
 	}
+}
 
-	if (load_image_data(texture_handle->file_name, compression, 0,
-		strip_mipmaps, base_level, &image) == 0)
+static void build_texture_handle(texture_cache_t* texture_handle,
+	image_t* image, const texture_load_params_t* params)
+{
+	GLuint id;
+	Uint32 i;
+
+	id = build_texture(image, params->wrap_mode_repeat, params->min_filter,
+		params->af, params->format);
+
+	assert(id != 0);
+
+	texture_handle->id = id;
+	texture_handle->alpha = image->alpha;
+	texture_handle->size = 0;
+
+	for (i = 0; i < image->mipmaps; i++)
+	{
+		texture_handle->size += image->sizes[i];
+	}
+
+	free_image(image);
+}
+
+static Uint32 load_texture(texture_cache_t* texture_handle)
+{
+	image_t image;
+	texture_load_params_t params;
+
+	memset(&image, 0, sizeof(image_t));
+
+	get_texture_load_params(texture_handle->type, &params);
+
+	if (load_image_data(texture_handle->file_name, params.compression, 0,
+		params.strip_mipmaps, params.base_level, &image) == 0)
 	{
 		texture_handle->load_err = 1;
 
@@ -604,24 +669,274 @@ static Uint32 load_texture(texture_cache_t* texture_handle)
 		return 0;
 	}
 
-	id = build_texture(&image, wrap_mode_repeat, min_filter, af, format);
+	build_texture_handle(texture_handle, &image, &params);
 
-	assert(id != 0);
+	return 1;
+}
 
-	texture_handle->id = id;
-	texture_handle->alpha = image.alpha;
-	texture_handle->size = 0;
+#ifdef	ELC
+static GLuint get_texture_placeholder()
+{
+	// grey, and invisible for alpha tested and blended objects
+	static const Uint8 pixel[4] = { 128, 128, 128, 0 };
 
-	for (i = 0; i < image.mipmaps; i++)
+	if (texture_placeholder_id == 0)
 	{
-		texture_handle->size += image.sizes[i];
+		glGenTextures(1, &texture_placeholder_id);
+		glBindTexture(GL_TEXTURE_2D, texture_placeholder_id);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA,
+			GL_UNSIGNED_BYTE, pixel);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		last_texture = -1;
 	}
 
-	free_image(&image);
+	return texture_placeholder_id;
+}
+
+/* Queues the texture for the stream threads, returns 0 if it has to be
+ * loaded right away instead. */
+static Uint32 stream_texture_handle(const Uint32 handle)
+{
+	texture_stream_request_t* request;
+
+	if ((texture_stream_mutex == 0) || (texture_upload_budget <= 0) ||
+		(texture_handles[handle].type != tt_mesh))
+	{
+		return 0;
+	}
+
+	// only the main thread changes the state
+	if (texture_handles[handle].state != tst_unloaded)
+	{
+		return 1;
+	}
+
+	request = calloc(1, sizeof(texture_stream_request_t));
+	request->handle = handle;
+	get_texture_load_params(texture_handles[handle].type, &request->params);
+
+	texture_handles[handle].state = tst_image_loading;
+
+	CHECK_AND_LOCK_MUTEX(texture_stream_mutex);
+
+	texture_stream_pending[texture_stream_pending_count] = request;
+	texture_stream_pending_count++;
+
+	SDL_CondSignal(texture_stream_condition);
+
+	CHECK_AND_UNLOCK_MUTEX(texture_stream_mutex);
+
+	return 1;
+}
+
+static int texture_stream_thread(void* done)
+{
+	texture_stream_request_t* request;
+	Uint32 i, best;
+
+	init_thread_log("load_textures");
+
+	CHECK_AND_LOCK_MUTEX(texture_stream_mutex);
+
+	while (*((Uint32*)done) == 0)
+	{
+		if (texture_stream_pending_count == 0)
+		{
+			SDL_CondWait(texture_stream_condition, texture_stream_mutex);
+
+			continue;
+		}
+
+		// the priority is only a hint, it's written without the mutex
+		best = 0;
+
+		for (i = 1; i < texture_stream_pending_count; i++)
+		{
+			if (texture_handles[texture_stream_pending[i]->handle].priority >
+				texture_handles[texture_stream_pending[best]->handle].priority)
+			{
+				best = i;
+			}
+		}
+
+		request = texture_stream_pending[best];
+		texture_stream_pending_count--;
+		texture_stream_pending[best] =
+			texture_stream_pending[texture_stream_pending_count];
+
+		CHECK_AND_UNLOCK_MUTEX(texture_stream_mutex);
+
+		request->loaded = load_image_data(
+			texture_handles[request->handle].file_name,
+			request->params.compression, 0,
+			request->params.strip_mipmaps,
+			request->params.base_level, &request->image);
+
+		queue_push(texture_stream_done, request);
+
+		CHECK_AND_LOCK_MUTEX(texture_stream_mutex);
+	}
+
+	CHECK_AND_UNLOCK_MUTEX(texture_stream_mutex);
 
 	return 1;
 }
 
+void update_texture_streaming()
+{
+	texture_stream_request_t* request;
+	texture_cache_t* texture;
+	Uint32 uploaded, budget;
+
+	if (texture_stream_done == 0)
+	{
+		return;
+	}
+
+	// with streaming turned off, finish what is left
+	if (texture_upload_budget > 0)
+	{
+		budget = texture_upload_budget * 1024;
+	}
+	else
+	{
+		budget = 0xFFFFFFFF;
+	}
+
+	uploaded = 0;
+
+	// at least one texture per frame, however big it is
+	while ((uploaded < budget) &&
+		((request = queue_pop(texture_stream_done)) != 0))
+	{
+		texture = &texture_handles[request->handle];
+		texture->state = tst_unloaded;
+
+		if (request->loaded == 0)
+		{
+			texture->load_err = 1;
+
+			LOG_ERROR("Error loading image '%s'",
+				texture->file_name);
+		}
+		else if (texture->id != 0)
+		{
+			// get_texture_alpha loaded it meanwhile
+			free_image(&request->image);
+		}
+		else
+		{
+			build_texture_handle(texture, &request->image,
+				&request->params);
+
+			cache_adj_size(texture_cache, texture->size, texture);
+
+			uploaded += texture->size;
+		}
+
+		free(request);
+	}
+}
+
+void set_texture_priority(const Uint32 handle, const float priority)
+{
+	texture_cache_t* texture;
+
+	if ((handle >= texture_handles_used) || (texture_stream_mutex == 0))
+	{
+		return;
+	}
+
+	texture = &texture_handles[handle];
+
+	if (texture->id != 0)
+	{
+		return;
+	}
+
+	// the largest size of the current frame wins
+	if ((texture->priority_time != cur_time) ||
+		(texture->priority < priority))
+	{
+		texture->priority = priority;
+		texture->priority_time = cur_time;
+	}
+}
+
+static void init_texture_streaming()
+{
+	Uint32 i;
+
+	texture_stream_mutex = SDL_CreateMutex();
+	texture_stream_condition = SDL_CreateCond();
+	queue_initialise(&texture_stream_done);
+
+	for (i = 0; i < TEXTURE_STREAM_THREAD_COUNT; i++)
+	{
+		texture_stream_threads[i] = SDL_CreateThread(
+			texture_stream_thread, &texture_stream_threads_done);
+	}
+}
+
+static void free_texture_streaming()
+{
+	texture_stream_request_t* request;
+	Uint32 i;
+	int result;
+
+	if (texture_stream_mutex == 0)
+	{
+		return;
+	}
+
+	CHECK_AND_LOCK_MUTEX(texture_stream_mutex);
+
+	texture_stream_threads_done = 1;
+
+	for (i = 0; i < texture_stream_pending_count; i++)
+	{
+		free(texture_stream_pending[i]);
+	}
+
+	texture_stream_pending_count = 0;
+
+	SDL_CondBroadcast(texture_stream_condition);
+
+	CHECK_AND_UNLOCK_MUTEX(texture_stream_mutex);
+
+	for (i = 0; i < TEXTURE_STREAM_THREAD_COUNT; i++)
+	{
+		SDL_WaitThread(texture_stream_threads[i], &result);
+	}
+
+	while ((request = queue_pop(texture_stream_done)) != 0)
+	{
+		if (request->loaded != 0)
+		{
+			free_image(&request->image);
+		}
+
+		free(request);
+	}
+
+	queue_destroy(texture_stream_done);
+	texture_stream_done = NULL;
+
+	SDL_DestroyCond(texture_stream_condition);
+	texture_stream_condition = NULL;
+	SDL_DestroyMutex(texture_stream_mutex);
+	texture_stream_mutex = NULL;
+
+	if (texture_placeholder_id != 0)
+	{
+		glDeleteTextures(1, &texture_placeholder_id);
+		texture_placeholder_id = 0;
+	}
+}
+#endif	/* ELC */
+
 static Uint32 load_texture_handle(const Uint32 handle)
 {
 	if (handle >= texture_handles_used)
@@ -664,6 +979,15 @@ static GLuint get_texture_id(const Uint32 handle)
 		return 0;
 	}
 
+#ifdef	ELC
+	if ((texture_handles[handle].id == 0) &&
+		(texture_handles[handle].load_err == 0) &&
+		(stream_texture_handle(handle) != 0))
+	{
+		return get_texture_placeholder();
+	}
+#endif	/* ELC */
+
 	if (load_texture_handle(handle) == 0)
 	{
 		return 0;
@@ -2222,6 +2546,7 @@ void init_texture_cache()
 	texture_cache = cache_init("texture cache", TEXTURE_CACHE_MAX, 0);
 	cache_set_compact(texture_cache, compact_texture);
 	cache_set_time_limit(texture_cache, 5 * 60 * 1000);
+	cache_set_budget(texture_cache, &texture_cache_budget);
 
 	texture_handles = calloc(TEXTURE_CACHE_MAX, sizeof(texture_cache_t));
 #ifdef	ELC
@@ -2240,6 +2565,8 @@ void init_texture_cache()
 		actor_texture_threads[i] = SDL_CreateThread(
 			load_enhanced_actor_thread, &actor_texture_threads_done);
 	}
+
+	init_texture_streaming();
 #endif	/* ELC */
 }
 
@@ -2272,6 +2599,8 @@ void free_texture_cache()
 	}
 
 	free(actor_texture_handles);
+
+	free_texture_streaming();
 #endif	/* ELC */
 
 	for (i = 0; i < texture_handles_used; i++)
@@ -2307,6 +2636,13 @@ void unload_texture_cache()
 
 #ifdef	ELC
 	unload_actor_texture_cache();
+
+	// the decoded images in flight are still good for the new context
+	if (texture_placeholder_id != 0)
+	{
+		glDeleteTextures(1, &texture_placeholder_id);
+		texture_placeholder_id = 0;
+	}
 #endif	/* ELC */
 }
 
@@ -64,6 +64,9 @@ typedef struct
 	texture_type type;		/*!< the texture type, needed for loading and unloading */
 	Uint8 load_err;			/*!< if true, we tried to load this texture before and failed */
 	Uint8 alpha;			/*!< the texture has an alpha channel */
+	Uint8 state;			/*!< tst_image_loading while the stream threads decode it */
+	float priority;			/*!< the screen size the texture was needed at, larger loads first */
+	Uint32 priority_time;		/*!< the frame the priority was set in */
 } texture_cache_t;
 
 /*!
@@ -157,6 +160,31 @@ void bind_texture_unbuffered(const Uint32 handle);
 Uint32 get_texture_alpha(const Uint32 handle);
 
 #ifdef	ELC
+extern int texture_upload_budget; /*!< KB of streamed mesh textures uploaded per frame, 0 loads them right away */
+
+/*!
+ * \ingroup 	textures
+ * \brief 	Uploads the mesh textures the stream threads loaded
+ *
+ *      	Builds the textures whose images were loaded in the background,
+ *		until texture_upload_budget is used up. Call once per frame.
+ *
+ * \callgraph
+ */
+void update_texture_streaming();
+
+/*!
+ * \ingroup 	textures
+ * \brief 	Sets the load priority of a texture
+ *
+ *      	Textures that are not loaded yet are streamed largest priority
+ *		first. The largest priority set in a frame is used.
+ *
+ * \param	handle The texture handle.
+ * \param	priority The priority, e.g. the screen size of the object.
+ * \callgraph
+ */
+void set_texture_priority(const Uint32 handle, const float priority);
 
 /*!
  * we use a separate cache structure to cache textures.
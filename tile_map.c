@@ -1,5 +1,6 @@
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 #include "2d_objects.h"
 #include "asc.h"
 #include "bbox_tree.h"
@@ -36,9 +37,55 @@ GLfloat* terrain_tile_buffer = 0;
 GLuint terrain_tile_buffer_object = 0;
 int terrain_buffer_usage = 0;
 
+// The vertices of all terrain tiles are built once per map, the visible
+// tiles are drawn through an index list grouped by tile texture.
+typedef struct
+{
+	Uint32 tile;
+	Uint32 count;
+} terrain_run;
+
+static Uint32 *terrain_tile_vertex = NULL;	// first vertex of each tile of the map
+static GLuint *terrain_tile_indices = NULL;
+static terrain_run terrain_runs[256];
+static Uint32 terrain_run_count = 0;
+
 void init_terrain_buffers(int terrain_buffer_size)
 {
+	int x, y, cur_tile;
+	Uint32 j;
+	float x_scaled, y_scaled;
+
 	terrain_tile_buffer = realloc(terrain_tile_buffer, terrain_buffer_size * 4 * 2 * sizeof(GLfloat));
+	terrain_tile_indices = realloc(terrain_tile_indices, terrain_buffer_size * 4 * sizeof(GLuint));
+	terrain_tile_vertex = realloc(terrain_tile_vertex, tile_map_size_x * tile_map_size_y * sizeof(Uint32));
+	terrain_buffer_usage = terrain_buffer_size;
+	terrain_run_count = 0;
+
+	j = 0;
+	for (y = 0; y < tile_map_size_y; y++)
+	{
+		for (x = 0; x < tile_map_size_x; x++)
+		{
+			cur_tile = tile_map[y * tile_map_size_x + x];
+			terrain_tile_vertex[y * tile_map_size_x + x] = j * 4;
+			if (cur_tile == 255 || IS_WATER_TILE(cur_tile))
+				continue;
+
+			x_scaled = x * 3.0f;
+			y_scaled = y * 3.0f;
+
+			terrain_tile_buffer[j * 8 + 0] = x_scaled;
+			terrain_tile_buffer[j * 8 + 1] = y_scaled + 3.0f;
+			terrain_tile_buffer[j * 8 + 2] = x_scaled;
+			terrain_tile_buffer[j * 8 + 3] = y_scaled;
+			terrain_tile_buffer[j * 8 + 4] = x_scaled + 3.0f;
+			terrain_tile_buffer[j * 8 + 5] = y_scaled;
+			terrain_tile_buffer[j * 8 + 6] = x_scaled + 3.0f;
+			terrain_tile_buffer[j * 8 + 7] = y_scaled + 3.0f;
+			j++;
+		}
+	}
 
 	if (have_extension(arb_vertex_buffer_object))
 	{
@@ -46,38 +93,39 @@ void init_terrain_buffers(int terrain_buffer_size)
 		{
 			ELglGenBuffersARB(1, &terrain_tile_buffer_object);
 		}
-		else
-		{
-			ELglBindBufferARB(GL_ARRAY_BUFFER_ARB, terrain_tile_buffer_object);
-			ELglBufferDataARB(GL_ARRAY_BUFFER_ARB, 0, 0, GL_DYNAMIC_DRAW_ARB);
-			ELglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
-		}
+		ELglBindBufferARB(GL_ARRAY_BUFFER_ARB, terrain_tile_buffer_object);
+		ELglBufferDataARB(GL_ARRAY_BUFFER_ARB, terrain_buffer_usage * 4 * 2 * sizeof(GLfloat),
+			terrain_tile_buffer, GL_STATIC_DRAW_ARB);
+		ELglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
 	}
+}
 
+void free_terrain_buffers()
+{
+	free(terrain_tile_buffer);
+	free(terrain_tile_indices);
+	free(terrain_tile_vertex);
+	terrain_tile_buffer = NULL;
+	terrain_tile_indices = NULL;
+	terrain_tile_vertex = NULL;
+	terrain_buffer_usage = 0;
+	terrain_run_count = 0;
 }
 
-static __inline__ void build_terrain_buffer()
+static void build_terrain_runs()
 {
-	unsigned int i, j, l, x, y, start, stop;
-	float x_scaled,y_scaled;
+	unsigned int i, j, l, x, y, start, stop, vertex, tile;
 #ifdef CLUSTER_INSIDES_OLD
 	short cluster = get_actor_cluster ();
 	short tile_cluster;
 #endif
 
-	if (get_bbox_intersect_flag(main_bbox_tree, TYPE_TERRAIN, ide_changed))
-	{
-		clear_bbox_intersect_flag(main_bbox_tree, TYPE_TERRAIN, ide_changed);
-	}
-	else
-	{
-		return;
-	}
-
 	j = 0;
+	terrain_run_count = 0;
 
 	get_intersect_start_stop(main_bbox_tree, TYPE_TERRAIN, &start, &stop);
 
+	// the intersection list is sorted by tile, so each tile texture is one run
 	for (i = start; i < stop; i++)
 	{
 		l = get_intersect_item_ID(main_bbox_tree, i);
@@ -90,28 +138,50 @@ static __inline__ void build_terrain_buffer()
 			continue;
 #endif
 
-		x_scaled = x * 3.0f;
-		y_scaled = y * 3.0f;
-
-		terrain_tile_buffer[j * 8 + 0] = x_scaled;
-		terrain_tile_buffer[j * 8 + 1] = y_scaled + 3.0f;
-		terrain_tile_buffer[j * 8 + 2] = x_scaled;
-		terrain_tile_buffer[j * 8 + 3] = y_scaled;
-		terrain_tile_buffer[j * 8 + 4] = x_scaled + 3.0f;
-		terrain_tile_buffer[j * 8 + 5] = y_scaled;
-		terrain_tile_buffer[j * 8 + 6] = x_scaled + 3.0f;
-		terrain_tile_buffer[j * 8 + 7] = y_scaled + 3.0f;
+		tile = tile_map[y * tile_map_size_x + x];
+		if ((terrain_run_count == 0) || (terrain_runs[terrain_run_count - 1].tile != tile))
+		{
+			if (terrain_run_count >= 256)
+				break;
+			terrain_runs[terrain_run_count].tile = tile;
+			terrain_runs[terrain_run_count].count = 0;
+			terrain_run_count++;
+		}
+
+		vertex = terrain_tile_vertex[y * tile_map_size_x + x];
+		terrain_tile_indices[j * 4 + 0] = vertex + 0;
+		terrain_tile_indices[j * 4 + 1] = vertex + 1;
+		terrain_tile_indices[j * 4 + 2] = vertex + 2;
+		terrain_tile_indices[j * 4 + 3] = vertex + 3;
+		terrain_runs[terrain_run_count - 1].count += 4;
 		j++;
 	}
+}
 
-	terrain_buffer_usage = j;
+static __inline__ void build_terrain_buffer()
+{
+	if (get_bbox_intersect_flag(main_bbox_tree, TYPE_TERRAIN, ide_changed))
+	{
+		clear_bbox_intersect_flag(main_bbox_tree, TYPE_TERRAIN, ide_changed);
+		build_terrain_runs();
+	}
+}
 
-	if (have_extension(arb_vertex_buffer_object))
+static __inline__ void draw_terrain_runs()
+{
+	Uint32 i, first;
+
+	first = 0;
+	for (i = 0; i < terrain_run_count; i++)
 	{
-		ELglBindBufferARB(GL_ARRAY_BUFFER_ARB, terrain_tile_buffer_object);
-		ELglBufferDataARB(GL_ARRAY_BUFFER_ARB, terrain_buffer_usage * 4 * 2 * sizeof(GLfloat),
-			terrain_tile_buffer, GL_DYNAMIC_DRAW_ARB);
-		ELglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+#ifdef	NEW_TEXTURES
+		bind_texture(tile_list[terrain_runs[i].tile]);
+#else	/* NEW_TEXTURES */
+		bind_texture_id(get_texture_id(tile_list[terrain_runs[i].tile]));
+#endif	/* NEW_TEXTURES */
+		glDrawElements(GL_QUADS, terrain_runs[i].count, GL_UNSIGNED_INT,
+			terrain_tile_indices + first);
+		first += terrain_runs[i].count;
 	}
 }
 
@@ -185,44 +255,6 @@ void draw_quad_tiles(const unsigned int start, const unsigned int stop,
 	}
 	glDrawArrays(GL_QUADS, idx * 4, size * 4);
 }
-#else	/* NEW_TEXTURES */
-void draw_terrain_quad_tiles(unsigned int start, unsigned int stop)
-{
-	unsigned int i, l, size, idx;
-	int x, y, cur_texture;
-#ifdef CLUSTER_INSIDES_OLD
-	short cluster = get_actor_cluster ();
-	short tile_cluster;
-#endif
-
-	idx = 0;
-	size = 0;
-
-	for (i = start; i < stop; i++)
-	{
-		l = get_intersect_item_ID(main_bbox_tree, i);
-		x = get_terrain_x(l);
-		y = get_terrain_y(l);
-
-#ifdef CLUSTER_INSIDES_OLD
-		tile_cluster = get_cluster (6*x, 6*y);
-		if (tile_cluster && tile_cluster != cluster)
-			continue;
-#endif
-
-		cur_texture = get_texture_id(tile_list[tile_map[y*tile_map_size_x+x]]);
-		if (cur_texture != last_texture)
-		{
-			glDrawArrays(GL_QUADS, idx * 4, size * 4);
-			bind_texture_id(cur_texture);
-			cur_texture = last_texture;
-			idx += size;
-			size = 0;
-		}
-		size++;
-	}
-	glDrawArrays(GL_QUADS, idx * 4, size * 4);
-}
 #endif	/* NEW_TEXTURES */
 
 static __inline__ void setup_terrain_clous_texgen()
@@ -305,8 +337,6 @@ static __inline__ void disable_terrain_texgen()
 
 void draw_tile_map()
 {
-	unsigned int start, stop;
-
 	glEnable(GL_CULL_FACE);
 
 	build_terrain_buffer();
@@ -345,18 +375,13 @@ void draw_tile_map()
 		glInterleavedArrays(GL_V2F, 0, terrain_tile_buffer);
 	}
 
-	get_intersect_start_stop(main_bbox_tree, TYPE_TERRAIN, &start, &stop);
 #ifdef	FSAA
 	if (fsaa > 1)
 	{
 		glEnable(GL_MULTISAMPLE);
 	}
 #endif	/* FSAA */
-#ifdef	NEW_TEXTURES
-	draw_quad_tiles(start, stop, 0, tile_list[0]);
-#else	/* NEW_TEXTURES */
-	draw_terrain_quad_tiles(start, stop);
-#endif	/* NEW_TEXTURES */
+	draw_terrain_runs();
 #ifdef	FSAA
 	if (fsaa > 1)
 	{
@@ -395,6 +420,84 @@ void draw_tile_map()
 #endif //OPENGL_TRACE
 }
 
+#ifdef RENDER_BENCHMARK
+void terrain_benchmark(char *buffer, size_t len)
+{
+	const int iterations = 1000;
+	unsigned int i, l, x, y, start, stop, tiles;
+	int n, map_tiles, map_changes, map_textures, last_tile, cur_tile;
+	Uint32 used[8];
+	Uint32 index_time, vertex_time;
+	GLfloat *vertices;
+
+	if (terrain_tile_vertex == NULL)
+	{
+		safe_snprintf(buffer, len, "Terrain: no map loaded");
+		return;
+	}
+
+	get_intersect_start_stop(main_bbox_tree, TYPE_TERRAIN, &start, &stop);
+	tiles = stop > start ? stop - start : 0;
+
+	// the index list of the visible tiles, as drawn now
+	index_time = SDL_GetTicks();
+	for (n = 0; n < iterations; n++)
+	{
+		build_terrain_runs();
+	}
+	index_time = SDL_GetTicks() - index_time;
+
+	// the vertices of the visible tiles, as they were built and uploaded
+	// whenever the intersection changed
+	vertices = malloc((tiles + 1) * 8 * sizeof(GLfloat));
+	vertex_time = SDL_GetTicks();
+	for (n = 0; n < iterations; n++)
+	{
+		for (i = start; i < stop; i++)
+		{
+			l = get_intersect_item_ID(main_bbox_tree, i);
+			x = get_terrain_x(l);
+			y = get_terrain_y(l);
+			vertices[(i - start) * 8 + 0] = x * 3.0f;
+			vertices[(i - start) * 8 + 1] = y * 3.0f + 3.0f;
+			vertices[(i - start) * 8 + 2] = x * 3.0f;
+			vertices[(i - start) * 8 + 3] = y * 3.0f;
+			vertices[(i - start) * 8 + 4] = x * 3.0f + 3.0f;
+			vertices[(i - start) * 8 + 5] = y * 3.0f;
+			vertices[(i - start) * 8 + 6] = x * 3.0f + 3.0f;
+			vertices[(i - start) * 8 + 7] = y * 3.0f + 3.0f;
+		}
+	}
+	vertex_time = SDL_GetTicks() - vertex_time;
+	free(vertices);
+
+	// the whole map, with and without grouping the tiles by texture
+	memset(used, 0, sizeof(used));
+	map_tiles = map_changes = map_textures = 0;
+	last_tile = -1;
+	for (n = 0; n < tile_map_size_x * tile_map_size_y; n++)
+	{
+		cur_tile = tile_map[n];
+		if (cur_tile == 255 || IS_WATER_TILE(cur_tile))
+			continue;
+		map_tiles++;
+		if (cur_tile != last_tile)
+			map_changes++;
+		if (!(used[cur_tile / 32] & (1u << (cur_tile % 32))))
+		{
+			used[cur_tile / 32] |= 1u << (cur_tile % 32);
+			map_textures++;
+		}
+		last_tile = cur_tile;
+	}
+
+	safe_snprintf(buffer, len, "Terrain: %u visible tiles in %u binds and draws, index list %.2f usec (%u bytes), vertex rebuild was %.2f usec (%u bytes uploaded); whole map: %d tiles, %d textures, %d texture changes in map order",
+		tiles, terrain_run_count, index_time * 1000.0f / iterations, tiles * 4 * (Uint32)sizeof(GLuint),
+		vertex_time * 1000.0f / iterations, tiles * 8 * (Uint32)sizeof(GLfloat),
+		map_tiles, map_textures, map_changes);
+}
+#endif // RENDER_BENCHMARK
+
 //load only the tiles that are on the map
 void load_map_tiles()
 {
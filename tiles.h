@@ -6,6 +6,8 @@
 #ifndef __TILE_H__
 #define __TILE_H__
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -38,6 +40,20 @@ extern int ground_detail_text;      /*!< The texture for ground details (clouds
  */
 void draw_tile_map();
 
+#ifdef RENDER_BENCHMARK
+/*!
+ * \ingroup	tile
+ * \brief 	Counts the texture binds and draws of the terrain.
+ *
+ *      Times building the draw list of the visible terrain tiles and reports
+ *      the binds and draws it takes, for the view and for the whole map.
+ *
+ * \param	buffer The buffer for the result line
+ * \param	len The size of the buffer
+ */
+void terrain_benchmark(char *buffer, size_t len);
+#endif // RENDER_BENCHMARK
+
 #ifdef	NEW_TEXTURES
 /*!
  * \ingroup	tile
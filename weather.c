@@ -43,11 +43,14 @@ int wind_direction = 0;	//wind direction, based on server's setting and local ra
 #define WEATHER_NONE 0
 #define WEATHER_RAIN 1
 
+// the positions of the drops of one type, one array per coordinate so the
+// update loop can be vectorised by the compiler
 typedef struct
 {
-	float pos1[3];
-	float pos2[3];
-} weather_drop;
+	float x[MAX_RAIN_DROPS];
+	float y[MAX_RAIN_DROPS];
+	float z[MAX_RAIN_DROPS];
+} weather_drops_pos;
 
 typedef struct {
 	int use_sprites;
@@ -82,8 +85,14 @@ typedef struct {
 	float coords[4]; // left bottom right top
 } lightning_def;
 
-weather_drop weather_drops[MAX_WEATHER_TYPES][MAX_RAIN_DROPS];
+weather_drops_pos weather_drops[MAX_WEATHER_TYPES];
 int weather_drops_count[MAX_WEATHER_TYPES];
+// vertex arrays written by the update and drawn as they are: two vertices
+// per drop for lines, a textured quad (4 * (2 texture + 3 vertex coords))
+// per drop for sprites. Allocated the first time a type is used.
+float *weather_drops_coords[MAX_WEATHER_TYPES];
+// the billboard directions of the last rendered frame, for the sprites
+float weather_sprite_delta1[3], weather_sprite_delta2[3];
 
 weather_def weather_defs[MAX_WEATHER_TYPES];
 
@@ -120,15 +129,25 @@ unsigned int rain_sound = 0;
 float weather_color[4] = {0.0, 0.0, 0.0, 1.0};
 float fog_alpha;
 
-// array used to build coordinates of quads to display particles
-float weather_particles_coords[MAX_RAIN_DROPS*20];
-
 static __inline__ float next_random_number()
 {
 	last_random_number = (last_random_number+1)%RANDOM_TABLE_SIZE;
 	return random_table[last_random_number];
 }
 
+/* Returns count consecutive random numbers (count must not be larger than
+ * RANDOM_TABLE_SIZE), so loops can read them without the modulo. */
+static const float *next_random_numbers(int count)
+{
+	const float *numbers;
+
+	if (last_random_number + 1 + count > RANDOM_TABLE_SIZE)
+		last_random_number = -1;
+	numbers = &random_table[last_random_number + 1];
+	last_random_number += count;
+	return numbers;
+}
+
 int weather_read_defs(const char *file_name);
 
 void weather_init()
@@ -161,20 +180,6 @@ void weather_init()
 	for (i = 0; i < RANDOM_TABLE_SIZE; ++i)
 		random_table[i] = (float)rand() / (float)RAND_MAX;
 
-    // init the particles texture coordinates
-    for (i = 0; i < MAX_RAIN_DROPS; ++i)
-    {
-        const int j = i*20;
-        weather_particles_coords[j   ] = 0.0f;
-        weather_particles_coords[j+1 ] = 0.0f;
-        weather_particles_coords[j+5 ] = 1.0f;
-        weather_particles_coords[j+6 ] = 0.0f;
-        weather_particles_coords[j+10] = 1.0f;
-        weather_particles_coords[j+11] = 1.0f;
-        weather_particles_coords[j+15] = 0.0f;
-        weather_particles_coords[j+16] = 1.0f;
-    }
-
 	weather_read_defs("./weather.xml");
 }
 
@@ -300,9 +305,42 @@ void weather_get_color_from_ratios(float color[4], float ratios[MAX_WEATHER_TYPE
 
 static __inline__ void make_drop(int type, int i, float x, float y, float z)
 {
-	weather_drops[type][i].pos1[0] = x + 16.0f * RAND_ONE - 8.0f;
-	weather_drops[type][i].pos1[1] = y + 16.0f * RAND_ONE - 8.0f;
-	weather_drops[type][i].pos1[2] = z + 10.0f * RAND_ONE +  2.0f;
+	weather_drops[type].x[i] = x + 16.0f * RAND_ONE - 8.0f;
+	weather_drops[type].y[i] = y + 16.0f * RAND_ONE - 8.0f;
+	weather_drops[type].z[i] = z + 10.0f * RAND_ONE +  2.0f;
+}
+
+static float *get_drops_coords(int type)
+{
+	int i;
+
+	if (weather_drops_coords[type] != NULL)
+		return weather_drops_coords[type];
+
+	if (!weather_defs[type].use_sprites)
+	{
+		weather_drops_coords[type] = (float*)calloc(MAX_RAIN_DROPS * 6, sizeof(float));
+		return weather_drops_coords[type];
+	}
+
+	weather_drops_coords[type] = (float*)calloc(MAX_RAIN_DROPS * 20, sizeof(float));
+	if (weather_drops_coords[type] == NULL)
+		return NULL;
+
+	// the texture coordinates never change
+	for (i = 0; i < MAX_RAIN_DROPS; ++i)
+	{
+		float *c = &weather_drops_coords[type][i*20];
+		c[0] = 0.0f;
+		c[1] = 0.0f;
+		c[5] = 1.0f;
+		c[6] = 0.0f;
+		c[10] = 1.0f;
+		c[11] = 1.0f;
+		c[15] = 0.0f;
+		c[16] = 1.0f;
+	}
+	return weather_drops_coords[type];
 }
 
 void update_wind(void)
@@ -327,6 +365,23 @@ void update_wind(void)
 	}
 }
 
+/* Moves the drops along one axis and wraps them around if they are too far
+ * away (as wind can cause). One coordinate per call and no branches, so
+ * the compiler can vectorise the loop. */
+static void move_drops(float *pos, const float *rnd, int count, float move,
+	float min, float max)
+{
+	int i;
+
+	for (i = 0; i < count; ++i)
+	{
+		float p = pos[i] + move * (1.1f - 0.2f * rnd[i]);
+
+		p += (p < min ? 16.0f : 0.0f) - (p > max ? 16.0f : 0.0f);
+		pos[i] = p;
+	}
+}
+
 void update_weather_type(int type, float x, float y, float z, int ticks)
 {
 	int num_drops = weather_ratios[type] * weather_defs[type].density * particles_percentage * 0.01 * MAX_RAIN_DROPS;
@@ -338,70 +393,82 @@ void update_weather_type(int type, float x, float y, float z, int ticks)
 	
 	if (num_drops > 0)
 	{
-		int i;
+		int i, count = weather_drops_count[type];
 		float x_move = weather_defs[type].wind_effect * sinf((float)wind_direction*M_PI/180) * wind_speed;
 		float y_move = weather_defs[type].wind_effect * cosf((float)wind_direction*M_PI/180) * wind_speed;
 		float z_move = -weather_defs[type].speed;
 		float dt = ticks * 1E-3;
-		float dx, dy, dz;
-		
-		for(i = 0; i < weather_drops_count[type]; ++i)
+		float *px = weather_drops[type].x;
+		float *py = weather_drops[type].y;
+		float *pz = weather_drops[type].z;
+		// the speed of each drop varies by +-10%, the same numbers are
+		// used for moving the drops and for their tails
+		const float *rnd = next_random_numbers(3 * num_drops);
+		const float *rx = rnd, *ry = rnd + num_drops, *rz = rnd + 2 * num_drops;
+		float *coords = get_drops_coords(type);
+
+		if (coords == NULL)
 		{
-			dx = x_move*(1.1-0.2*RAND_ONE);
-			dy = y_move*(1.1-0.2*RAND_ONE);
-			dz = z_move*(1.1-0.2*RAND_ONE);
+			weather_drops_count[type] = 0;
+			return;
+		}
 
-			if (weather_drops[type][i].pos1[2] < z-1.0f)
+		move_drops(px, rx, count, x_move * dt, x - 8.0f, x + 8.0f);
+		move_drops(py, ry, count, y_move * dt, y - 8.0f, y + 8.0f);
+		for (i = 0; i < count; ++i)
+			pz[i] += z_move * (1.1f - 0.2f * rz[i]) * dt;
+
+		// if there are not enough drops, we create new ones
+		for (i = count; i < num_drops; ++i)
+			make_drop(type, i, x, y, z);
+		weather_drops_count[type] = num_drops;
+
+		// recreate the drops that reached the ground and write the vertex
+		// array that is drawn by weather_render
+		if (!weather_defs[type].use_sprites)
+		{
+			for (i = 0; i < num_drops; ++i)
 			{
-				// the drop should still exist so we recreate it
-				make_drop(type, i, x, y, z);
+				float *c = &coords[i*6];
+
+				if (pz[i] < z - 1.0f)
+					make_drop(type, i, x, y, z);
+				c[0] = px[i];
+				c[1] = py[i];
+				c[2] = pz[i];
+				c[3] = px[i] - x_move * (1.1f - 0.2f * rx[i]) * 0.02f;
+				c[4] = py[i] - y_move * (1.1f - 0.2f * ry[i]) * 0.02f;
+				c[5] = pz[i] - z_move * (1.1f - 0.2f * rz[i]) * 0.02f;
 			}
-			else
-			{
-				// it's moving. so find out how much by, and wrap around the X/Y if it's too far away (as wind can cause)
-				weather_drops[type][i].pos1[0] += dx * dt;
-				if (weather_drops[type][i].pos1[0] < x - 8.0f)
-				{
-					weather_drops[type][i].pos1[0] += 16.0f;
-					weather_drops[type][i].pos2[0] += 16.0f;
-				}
-				else if(weather_drops[type][i].pos1[0] > x + 8.0f)
-				{
-					weather_drops[type][i].pos1[0] -= 16.0f;
-					weather_drops[type][i].pos2[0] -= 16.0f;
-				}
-				
-				weather_drops[type][i].pos1[1] += dy * dt;
-				if (weather_drops[type][i].pos1[1] < y - 8.0f)
-				{
-					weather_drops[type][i].pos1[1] += 16.0f;
-					weather_drops[type][i].pos2[1] += 16.0f;
-				}
-				else if(weather_drops[type][i].pos1[1] > y + 8.0f)
-				{
-					weather_drops[type][i].pos1[1] -= 16.0f;
-					weather_drops[type][i].pos2[1] -= 16.0f;
-				}
-				
-				weather_drops[type][i].pos1[2] += dz * dt;
-			}
-
-			weather_drops[type][i].pos2[0] = weather_drops[type][i].pos1[0] - dx * 0.02;
-			weather_drops[type][i].pos2[1] = weather_drops[type][i].pos1[1] - dy * 0.02;
-			weather_drops[type][i].pos2[2] = weather_drops[type][i].pos1[2] - dz * 0.02;
 		}
-		
-		// if there are not enough drops, we recreate new ones
-		if (weather_drops_count[type] < num_drops)
+		else
 		{
-			for (i = weather_drops_count[type]; i < num_drops; ++i)
+			float delta1[3], delta2[3];
+
+			for (i = 0; i < 3; ++i)
+			{
+				delta1[i] = weather_defs[type].size * weather_sprite_delta1[i];
+				delta2[i] = weather_defs[type].size * weather_sprite_delta2[i];
+			}
+			for (i = 0; i < num_drops; ++i)
 			{
-				make_drop(type, i, x, y, z);
-				weather_drops[type][i].pos2[0] = weather_drops[type][i].pos1[0] - x_move * 0.02;
-				weather_drops[type][i].pos2[1] = weather_drops[type][i].pos1[1] - y_move * 0.02;
-				weather_drops[type][i].pos2[2] = weather_drops[type][i].pos1[2] - z_move * 0.02;
+				float *c = &coords[i*20];
+
+				if (pz[i] < z - 1.0f)
+					make_drop(type, i, x, y, z);
+				c[2] = px[i] - delta1[0];
+				c[3] = py[i] - delta1[1];
+				c[4] = pz[i] - delta1[2];
+				c[7] = px[i] + delta2[0];
+				c[8] = py[i] + delta2[1];
+				c[9] = pz[i] + delta2[2];
+				c[12] = px[i] + delta1[0];
+				c[13] = py[i] + delta1[1];
+				c[14] = pz[i] + delta1[2];
+				c[17] = px[i] - delta2[0];
+				c[18] = py[i] - delta2[1];
+				c[19] = pz[i] - delta2[2];
 			}
-			weather_drops_count[type] = num_drops;
 		}
 	}
 }
@@ -484,7 +551,6 @@ void weather_render()
 	int type;
 	int i;
 	float modelview[16];
-	float delta1[3], delta2[3];
 	float color1[4], color2[4], light_level[3];
 
 	skybox_get_current_color(color1, skybox_light_ambient);
@@ -506,7 +572,15 @@ void weather_render()
 	if (light_level[2] > 1.0) light_level[2] = 1.0;
 
     glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
-          
+
+	// the sprites of the next update face the camera of this frame
+	weather_sprite_delta1[0] = modelview[0]+modelview[1];
+	weather_sprite_delta1[1] = modelview[4]+modelview[5];
+	weather_sprite_delta1[2] = modelview[8]+modelview[9];
+	weather_sprite_delta2[0] = modelview[0]-modelview[1];
+	weather_sprite_delta2[1] = modelview[4]-modelview[5];
+	weather_sprite_delta2[2] = modelview[8]-modelview[9];
+
 	glPushAttrib(GL_ENABLE_BIT);
 	glDisable(GL_LIGHTING);
 	
@@ -529,7 +603,7 @@ void weather_render()
 					  weather_defs[type].color[1]*light_level[1],
 					  weather_defs[type].color[2]*light_level[2],
 					  weather_defs[type].color[3]);
-			glVertexPointer(3, GL_FLOAT, 0, weather_drops[type]);
+			glVertexPointer(3, GL_FLOAT, 0, weather_drops_coords[type]);
 	
 			for (i = 0; i < weather_drops_count[type]; i += 1000) // to avoid long arrays
 			{
@@ -545,36 +619,9 @@ void weather_render()
 	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
 	
 	// we then render the other precipitations as sprites
-    glTexCoordPointer(2, GL_FLOAT, 5*sizeof(float), weather_particles_coords);
-    glVertexPointer(3, GL_FLOAT, 5*sizeof(float), weather_particles_coords+2);
 	for (type = 2; type < MAX_WEATHER_TYPES; ++type)
 		if (weather_defs[type].use_sprites && weather_drops_count[type] > 0)
 		{
-			delta1[0] = weather_defs[type].size*(modelview[0]+modelview[1]);
-			delta1[1] = weather_defs[type].size*(modelview[4]+modelview[5]);
-			delta1[2] = weather_defs[type].size*(modelview[8]+modelview[9]);
-			delta2[0] = weather_defs[type].size*(modelview[0]-modelview[1]);
-			delta2[1] = weather_defs[type].size*(modelview[4]-modelview[5]);
-			delta2[2] = weather_defs[type].size*(modelview[8]-modelview[9]);
-			
-			for (i = 0; i < weather_drops_count[type]; ++i)
-			{
-				const weather_drop *d = &weather_drops[type][i];
-                const int j = i*20;
-                weather_particles_coords[j+2 ] = d->pos1[0]-delta1[0];
-                weather_particles_coords[j+3 ] = d->pos1[1]-delta1[1];
-                weather_particles_coords[j+4 ] = d->pos1[2]-delta1[2];
-                weather_particles_coords[j+7 ] = d->pos1[0]+delta2[0];
-                weather_particles_coords[j+8 ] = d->pos1[1]+delta2[1];
-                weather_particles_coords[j+9 ] = d->pos1[2]+delta2[2];
-                weather_particles_coords[j+12] = d->pos1[0]+delta1[0];
-                weather_particles_coords[j+13] = d->pos1[1]+delta1[1];
-                weather_particles_coords[j+14] = d->pos1[2]+delta1[2];
-                weather_particles_coords[j+17] = d->pos1[0]-delta2[0];
-                weather_particles_coords[j+18] = d->pos1[1]-delta2[1];
-                weather_particles_coords[j+19] = d->pos1[2]-delta2[2];
-			}
-
 			glColor4f(weather_defs[type].color[0]*light_level[0],
 					  weather_defs[type].color[1]*light_level[1],
 					  weather_defs[type].color[2]*light_level[2],
@@ -585,7 +632,9 @@ void weather_render()
 #else	/* NEW_TEXTURES */
 			get_and_set_texture_id(weather_defs[type].texture);
 #endif	/* NEW_TEXTURES */
-            glDrawArrays(GL_QUADS, 0, weather_drops_count[type]);
+			glTexCoordPointer(2, GL_FLOAT, 5*sizeof(float), weather_drops_coords[type]);
+			glVertexPointer(3, GL_FLOAT, 5*sizeof(float), weather_drops_coords[type]+2);
+			glDrawArrays(GL_QUADS, 0, weather_drops_count[type]);
 		}
 
 	glDisableClientState(GL_VERTEX_ARRAY);
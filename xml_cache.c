@@ -0,0 +1,255 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+#include "xml_cache.h"
+#include "asc.h"
+#include "errors.h"
+#include "md5.h"
+#include "io/elfilewrapper.h"
+#include "io/elpathwrapper.h"
+
+/* Increase when the layout of the cache files themselves changes, the
+ * modules have their own version for the layout of their data. */
+#define XML_CACHE_FORMAT	1
+/* How deep external entities including other external entities are
+ * followed when computing the checksum of the sources. */
+#define XML_CACHE_MAX_DEPTH	4
+
+typedef struct
+{
+	char magic[4];
+	Uint32 format;
+	Uint32 version;
+	Uint32 num_sections;
+	MD5_DIGEST digest;
+} xml_cache_header;
+
+typedef struct
+{
+	Uint32 elem_size;
+	Uint32 count;
+} xml_cache_section_header;
+
+static const char xml_cache_magic[4] = { 'E', 'L', 'X', 'C' };
+
+static const char *find_bytes(const char *start, const char *end, const char *str)
+{
+	size_t len = strlen(str);
+
+	for (; start + len <= end; start++)
+	{
+		if (memcmp(start, str, len) == 0)
+			return start;
+	}
+	return NULL;
+}
+
+/* Adds a file and every file it declares as a SYSTEM entity in its internal
+ * DTD subset to the checksum. Missing files only contribute their name, so
+ * adding them later still changes the checksum. */
+static int digest_source(MD5 *md5, const char *file_name, int depth)
+{
+	el_file_ptr file;
+	const char *data, *end, *pos;
+	char include[256];
+	size_t dir_len;
+	Sint64 size;
+
+	MD5Digest(md5, file_name, strlen(file_name) + 1);
+
+	file = el_open(file_name);
+	if (file == NULL)
+		return depth > 0;
+
+	size = el_get_size(file);
+	data = (const char*)el_get_pointer(file);
+	if (size <= 0 || data == NULL)
+	{
+		el_close(file);
+		return depth > 0;
+	}
+	end = data + size;
+	MD5Digest(md5, data, size);
+
+	pos = find_bytes(data, end, "<!DOCTYPE");
+	if (pos != NULL)
+		end = find_bytes(pos, end, "]>");
+
+	if (pos != NULL && end != NULL && depth < XML_CACHE_MAX_DEPTH)
+	{
+		// includes are relative to the including file
+		dir_len = 0;
+		if (strrchr(file_name, '/') != NULL)
+			dir_len = strrchr(file_name, '/') - file_name + 1;
+
+		while ((pos = find_bytes(pos, end, "SYSTEM")) != NULL)
+		{
+			const char *name_end;
+			char quote;
+
+			for (pos += 6; pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\r' || *pos == '\n'); pos++)
+				/* nothing */;
+			if (pos >= end || (*pos != '"' && *pos != '\''))
+				continue;
+			quote = *pos++;
+			for (name_end = pos; name_end < end && *name_end != quote; name_end++)
+				/* nothing */;
+			if (name_end >= end || dir_len + (name_end - pos) >= sizeof(include))
+				break;
+
+			memcpy(include, file_name, dir_len);
+			memcpy(include + dir_len, pos, name_end - pos);
+			include[dir_len + (name_end - pos)] = '\0';
+			digest_source(md5, include, depth + 1);
+			pos = name_end + 1;
+		}
+	}
+
+	el_close(file);
+	return 1;
+}
+
+static int get_source_digest(const char *source, MD5_DIGEST digest)
+{
+	MD5 md5;
+	int ok;
+
+	MD5Open(&md5);
+	ok = digest_source(&md5, source, 0);
+	MD5Close(&md5, digest);
+
+	return ok;
+}
+
+static void get_cache_file_name(const char *name, char *buffer, size_t size)
+{
+	safe_snprintf(buffer, size, "%scache/%s.bin", get_path_config_base(), name);
+}
+
+int xml_cache_load(const char *name, Uint32 version, const char *source,
+	xml_cache_section *sections, int num_sections)
+{
+	xml_cache_header header;
+	xml_cache_section_header *section_headers = NULL;
+	MD5_DIGEST digest;
+	char file_name[512];
+	char *data = NULL;
+	Uint32 start, total;
+	FILE *file;
+	int i, ok = 0;
+
+	start = SDL_GetTicks();
+
+	if (!get_source_digest(source, digest))
+		return 0;
+
+	get_cache_file_name(name, file_name, sizeof(file_name));
+	file = fopen(file_name, "rb");
+	if (file == NULL)
+		return 0;
+
+	if (fread(&header, sizeof(header), 1, file) != 1
+		|| memcmp(header.magic, xml_cache_magic, sizeof(header.magic)) != 0
+		|| header.format != XML_CACHE_FORMAT || header.version != version
+		|| header.num_sections != num_sections)
+	{
+		LOG_DEBUG("Cache file %s is for a different version", file_name);
+		goto done;
+	}
+	if (memcmp(header.digest, digest, sizeof(digest)) != 0)
+	{
+		LOG_DEBUG("Cache file %s is out of date", file_name);
+		goto done;
+	}
+
+	section_headers = (xml_cache_section_header*)malloc(num_sections * sizeof(xml_cache_section_header));
+	if (fread(section_headers, sizeof(xml_cache_section_header), num_sections, file) != (size_t)num_sections)
+		goto done;
+
+	total = 0;
+	for (i = 0; i < num_sections; i++)
+	{
+		if (section_headers[i].elem_size != sections[i].elem_size
+			|| section_headers[i].count > sections[i].max_count)
+		{
+			LOG_DEBUG("Cache file %s doesn't match section %d", file_name, i);
+			goto done;
+		}
+		total += section_headers[i].elem_size * section_headers[i].count;
+	}
+
+	// read everything before touching the sections, so a broken file
+	// leaves them as they were
+	data = (char*)malloc(total > 0 ? total : 1);
+	if (total > 0 && fread(data, total, 1, file) != 1)
+	{
+		LOG_ERROR("Cache file %s is truncated", file_name);
+		goto done;
+	}
+
+	total = 0;
+	for (i = 0; i < num_sections; i++)
+	{
+		Uint32 size = section_headers[i].elem_size * section_headers[i].count;
+
+		memcpy(sections[i].data, data + total, size);
+		sections[i].count = section_headers[i].count;
+		total += size;
+	}
+	ok = 1;
+
+	LOG_INFO("Loaded %s from %s in %u ms", source, file_name, SDL_GetTicks() - start);
+
+done:
+	fclose(file);
+	free(section_headers);
+	free(data);
+	return ok;
+}
+
+int xml_cache_save(const char *name, Uint32 version, const char *source,
+	const xml_cache_section *sections, int num_sections)
+{
+	xml_cache_header header;
+	xml_cache_section_header section_header;
+	char file_name[512];
+	FILE *file;
+	int i, ok;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, xml_cache_magic, sizeof(header.magic));
+	header.format = XML_CACHE_FORMAT;
+	header.version = version;
+	header.num_sections = num_sections;
+	if (!get_source_digest(source, header.digest))
+		return 0;
+
+	get_cache_file_name(name, file_name, sizeof(file_name));
+	if (!mkdir_tree(file_name, 0) || (file = fopen(file_name, "wb")) == NULL)
+	{
+		LOG_ERROR("Unable to write cache file %s", file_name);
+		return 0;
+	}
+
+	ok = fwrite(&header, sizeof(header), 1, file) == 1;
+	for (i = 0; ok && i < num_sections; i++)
+	{
+		section_header.elem_size = sections[i].elem_size;
+		section_header.count = sections[i].count;
+		ok = fwrite(&section_header, sizeof(section_header), 1, file) == 1;
+	}
+	for (i = 0; ok && i < num_sections; i++)
+	{
+		if (sections[i].count > 0)
+			ok = fwrite(sections[i].data, sections[i].elem_size, sections[i].count, file) == sections[i].count;
+	}
+
+	fclose(file);
+	if (!ok)
+	{
+		LOG_ERROR("Unable to write cache file %s", file_name);
+		remove(file_name);
+	}
+	return ok;
+}
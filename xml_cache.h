@@ -0,0 +1,77 @@
+/*!
+ * \file
+ * \ingroup load
+ * \brief Binary cache for data read from XML files.
+ *
+ *      Parsing the bigger XML definition files with libxml2 is a noticable
+ *      part of the startup time. A module can store the structures it built
+ *      from such a file with \ref xml_cache_save, and next time get them back
+ *      with \ref xml_cache_load instead of parsing the file again. The cache
+ *      file remembers an MD5 sum of the XML file and of every file it
+ *      includes as an external entity, so any change to the data makes the
+ *      cache miss and the module falls back to parsing.
+ *
+ *      The data is stored as raw memory, so it must not contain pointers,
+ *      and modules have to change their version number whenever the layout
+ *      of the cached structures changes.
+ */
+#ifndef __XML_CACHE_H__
+#define __XML_CACHE_H__
+
+#include <SDL_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * One array of structures stored in a cache file.
+ */
+typedef struct
+{
+	void *data;		/*!< the array */
+	Uint32 elem_size;	/*!< size of one element */
+	Uint32 count;		/*!< elements to save, or the elements that were read by \ref xml_cache_load */
+	Uint32 max_count;	/*!< room in \a data when loading */
+} xml_cache_section;
+
+/*!
+ * \ingroup load
+ * \brief Loads data previously stored for an XML file.
+ *
+ *      Reads cache/\a name.bin from the config directory. Nothing is copied
+ *      unless the whole file is valid: the version must be \a version, the
+ *      MD5 sum of \a source and its includes must match, and every section
+ *      must have the same element size and fit into \a sections.
+ *
+ * \param name		the name of the cache file, without directory and extension
+ * \param version	the version of the layout of the cached data
+ * \param source	the XML file the data was read from
+ * \param sections	where to put the data, \a count is set for each
+ * \param num_sections	the number of sections
+ * \retval int	1 if the data was loaded, 0 if the XML file has to be parsed
+ * \sa xml_cache_save
+ */
+int xml_cache_load(const char *name, Uint32 version, const char *source,
+	xml_cache_section *sections, int num_sections);
+
+/*!
+ * \ingroup load
+ * \brief Stores data read from an XML file.
+ *
+ * \param name		the name of the cache file, without directory and extension
+ * \param version	the version of the layout of the cached data
+ * \param source	the XML file the data was read from
+ * \param sections	the data to store
+ * \param num_sections	the number of sections
+ * \retval int	1 if the cache file was written
+ * \sa xml_cache_load
+ */
+int xml_cache_save(const char *name, Uint32 version, const char *source,
+	const xml_cache_section *sections, int num_sections);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // __XML_CACHE_H__